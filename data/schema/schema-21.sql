@@ -0,0 +1,11 @@
+CREATE INDEX IF NOT EXISTS idx_playcount ON songs (playcount);
+
+CREATE INDEX IF NOT EXISTS idx_skipcount ON songs (skipcount);
+
+CREATE INDEX IF NOT EXISTS idx_lastplayed ON songs (lastplayed);
+
+CREATE INDEX IF NOT EXISTS idx_rating ON songs (rating);
+
+CREATE INDEX IF NOT EXISTS idx_ctime ON songs (ctime);
+
+UPDATE schema_version SET version=21;
@@ -36,8 +36,13 @@
 #include <QShowEvent>
 #include <QHideEvent>
 #include <QTimerEvent>
+#include <QThread>
+#include <QMutex>
+#include <QMetaObject>
 
+#include "utilities/timeconstants.h"
 #include "engine/enginebase.h"
+#include "analyzerrenderer.h"
 
 // INSTRUCTIONS Base2D
 // 1. do anything that depends on height() in init(), Base2D will call it before you are shown
@@ -57,18 +62,25 @@ AnalyzerBase::AnalyzerBase(QWidget *parent, const uint scopeSize)
       lastscope_(512),
       new_frame_(false),
       is_playing_(false),
-      timeout_(40) {
+      timeout_(40),
+      state_(EngineBase::State::Empty),
+      render_thread_(nullptr),
+      renderer_(nullptr),
+      render_pending_(false),
+      render_cost_msec_(0),
+      interval_(40) {
 
   setAttribute(Qt::WA_OpaquePaintEvent, true);
 
 }
 
 AnalyzerBase::~AnalyzerBase() {
+  setThreadedRendering(false);
   delete fht_;
 }
 
 void AnalyzerBase::showEvent(QShowEvent*) {
-  timer_.start(timeout(), this);
+  restartTimer();
 }
 
 void AnalyzerBase::hideEvent(QHideEvent*) {
@@ -80,11 +92,22 @@ void AnalyzerBase::ChangeTimeout(const int timeout) {
   timeout_ = timeout;
   if (timer_.isActive()) {
     timer_.stop();
-    timer_.start(timeout_, this);
+    restartTimer();
   }
 
 }
 
+void AnalyzerBase::restartTimer() {
+
+  interval_ = timeout_;
+  if (renderer_ && render_cost_msec_ > 0) {
+    // Leave some headroom so the render thread isn't busy all the time.
+    interval_ = qMax(timeout_, static_cast<int>(render_cost_msec_ * 1.25));
+  }
+  timer_.start(interval_, this);
+
+}
+
 void AnalyzerBase::transform(Scope &scope) {
 
   QVector<float> aux(fht_->size());
@@ -107,28 +130,53 @@ void AnalyzerBase::paintEvent(QPaintEvent *e) {
   QPainter p(this);
   p.fillRect(e->rect(), palette().color(QPalette::Window));
 
-  switch (engine_->state()) {
-    case EngineBase::State::Playing:{
-      const EngineBase::Scope &thescope = engine_->scope(timeout_);
-      int i = 0;
+  if (renderer_) {
+    renderer_->DrawLatestFrame(p);
+    return;
+  }
 
-      // convert to mono here - our built in analyzers need mono, but the engines provide interleaved pcm
-      for (uint x = 0; static_cast<int>(x) < fht_->size(); ++x) {
-        lastscope_[x] = static_cast<float>(thescope[i] + thescope[i + 1]) / (2 * (1U << 15U));
-        i += 2;
-      }
+  QMutexLocker l(&frame_mutex_);
+
+  const EngineBase::State state = engine_->state();
+  if (state == EngineBase::State::Playing) {
+    readScope(lastscope_);
+  }
 
+  renderFrame(p, state, new_frame_);
+
+  new_frame_ = false;
+
+}
+
+void AnalyzerBase::readScope(Scope &scope) {
+
+  const EngineBase::Scope &thescope = engine_->scope(timeout_);
+  int i = 0;
+
+  // convert to mono here - our built in analyzers need mono, but the engines provide interleaved pcm
+  for (uint x = 0; static_cast<int>(x) < fht_->size(); ++x) {
+    scope[x] = static_cast<float>(thescope[i] + thescope[i + 1]) / (2 * (1U << 15U));
+    i += 2;
+  }
+
+}
+
+void AnalyzerBase::renderFrame(QPainter &p, const EngineBase::State state, const bool new_frame) {
+
+  state_ = state;
+  new_frame_ = new_frame;
+
+  switch (state) {
+    case EngineBase::State::Playing:
       is_playing_ = true;
       transform(lastscope_);
-      analyze(p, lastscope_, new_frame_);
-
+      analyze(p, lastscope_, new_frame);
       lastscope_.resize(fht_->size());
-
       break;
-    }
+
     case EngineBase::State::Paused:
       is_playing_ = false;
-      analyze(p, lastscope_, new_frame_);
+      analyze(p, lastscope_, new_frame);
       break;
 
     default:
@@ -136,7 +184,86 @@ void AnalyzerBase::paintEvent(QPaintEvent *e) {
       demo(p);
   }
 
-  new_frame_ = false;
+}
+
+void AnalyzerBase::renderFrame(QPainter &p, const Scope &scope, const EngineBase::State state, const bool new_frame) {
+
+  QMutexLocker l(&frame_mutex_);
+
+  if (state == EngineBase::State::Playing) {
+    lastscope_ = scope;
+  }
+
+  renderFrame(p, state, new_frame);
+
+}
+
+void AnalyzerBase::setThreadedRendering(const bool enabled) {
+
+  if (enabled == threadedRendering()) return;
+
+  if (enabled) {
+    render_thread_ = new QThread;
+    render_thread_->setObjectName(QStringLiteral("AnalyzerRenderer"));
+    renderer_ = new AnalyzerRenderer(this);
+    renderer_->moveToThread(render_thread_);
+    QObject::connect(renderer_, &AnalyzerRenderer::FrameReady, this, &AnalyzerBase::RenderedFrame, Qt::QueuedConnection);
+    render_thread_->start(QThread::LowPriority);
+  }
+  else {
+    render_thread_->quit();
+    render_thread_->wait();
+    delete renderer_;
+    renderer_ = nullptr;
+    delete render_thread_;
+    render_thread_ = nullptr;
+    render_pending_ = false;
+    render_cost_msec_ = 0;
+  }
+
+  if (timer_.isActive()) {
+    timer_.stop();
+    restartTimer();
+  }
+
+}
+
+void AnalyzerBase::requestFrame() {
+
+  // Drop this frame if the render thread is still busy with the previous one.
+  if (render_pending_) return;
+
+  const EngineBase::State state = engine_->state();
+  Scope scope;
+  if (state == EngineBase::State::Playing) {
+    scope.resize(fht_->size());
+    readScope(scope);
+  }
+
+  AnalyzerRenderer *renderer = renderer_;
+  const QSize size = this->size();
+  const QPalette palette = this->palette();
+  render_pending_ = true;
+  QMetaObject::invokeMethod(renderer_, [renderer, scope, state, size, palette]() { renderer->Render(scope, state, true, size, palette); }, Qt::QueuedConnection);
+
+}
+
+void AnalyzerBase::RenderedFrame() {
+
+  if (!renderer_) return;
+
+  render_pending_ = false;
+
+  const double cost_msec = static_cast<double>(renderer_->last_render_nsec()) / static_cast<double>(kNsecPerMsec);
+  render_cost_msec_ = render_cost_msec_ > 0 ? render_cost_msec_ * 0.9 + cost_msec * 0.1 : cost_msec;
+
+  // Adapt the frame interval to the measured render cost.
+  const int interval = qMax(timeout_, static_cast<int>(render_cost_msec_ * 1.25));
+  if (timer_.isActive() && qAbs(interval - interval_) > interval_ / 10) {
+    restartTimer();
+  }
+
+  update();
 
 }
 
@@ -254,7 +381,15 @@ void AnalyzerBase::timerEvent(QTimerEvent *e) {
     return;
   }
 
-  new_frame_ = true;
+  if (renderer_) {
+    requestFrame();
+    return;
+  }
+
+  {
+    QMutexLocker l(&frame_mutex_);
+    new_frame_ = true;
+  }
   update();
 
 }
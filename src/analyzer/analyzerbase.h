@@ -35,8 +35,11 @@
 #include <QObject>
 #include <QWidget>
 #include <QBasicTimer>
+#include <QMutex>
 #include <QString>
 #include <QPainter>
+#include <QSize>
+#include <QPalette>
 
 #include "core/shared_ptr.h"
 #include "analyzer/fht.h"
@@ -46,6 +49,8 @@ class QHideEvent;
 class QShowEvent;
 class QPaintEvent;
 class QTimerEvent;
+class QThread;
+class AnalyzerRenderer;
 
 class AnalyzerBase : public QWidget {
   Q_OBJECT
@@ -61,6 +66,9 @@ class AnalyzerBase : public QWidget {
 
   virtual void framerateChanged() {}
 
+ private slots:
+  void RenderedFrame();
+
  protected:
   using Scope = std::vector<float>;
   explicit AnalyzerBase(QWidget*, const uint scopeSize = 7);
@@ -80,15 +88,46 @@ class AnalyzerBase : public QWidget {
   void interpolate(const Scope&, Scope&);
   void initSin(Scope&, const uint = 6000);
 
+  // Threaded rendering: transform(), analyze() and demo() run on a worker thread into an image, and paintEvent() only draws the latest finished frame.
+  // Only for analyzers that paint with the given QPainter and into QImages they own, without touching the widget or the engine.
+  // Subclasses enabling it must disable it again in their destructor.
+  void setThreadedRendering(const bool enabled);
+  bool threadedRendering() const { return render_thread_ != nullptr; }
+
+  // Called on the render thread before the next frame when the size or palette of the widget changed.
+  virtual void renderResize(const QSize&, const QPalette&) {}
+
+ private:
+  friend class AnalyzerRenderer;
+
+  void readScope(Scope &scope);
+  void renderFrame(QPainter &p, const EngineBase::State state, const bool new_frame);
+  void renderFrame(QPainter &p, const Scope &scope, const EngineBase::State state, const bool new_frame);
+  void requestFrame();
+  void restartTimer();
+
  protected:
   QBasicTimer timer_;
   FHT *fht_;
   SharedPtr<EngineBase> engine_;
+  // The frame state is written by renderFrame(), on the render thread when threaded rendering is enabled.
+  // frame_mutex_ is held while a frame is rendered, so analyze() and demo() can read it without locking.
+  QMutex frame_mutex_;
   Scope lastscope_;
 
   bool new_frame_;
   bool is_playing_;
   int timeout_;
+  // State of the engine for the frame being drawn.
+  EngineBase::State state_;
+
+ private:
+  QThread *render_thread_;
+  AnalyzerRenderer *renderer_;
+  bool render_pending_;
+  // Exponentially weighted average time it takes the render thread to finish a frame.
+  double render_cost_msec_;
+  int interval_;
 };
 
 #endif  // ANALYZERBASE_H
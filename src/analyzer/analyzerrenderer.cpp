@@ -0,0 +1,82 @@
+/*
+   Strawberry Music Player
+   Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <vector>
+
+#include <QObject>
+#include <QMutex>
+#include <QImage>
+#include <QSize>
+#include <QPalette>
+#include <QPainter>
+#include <QElapsedTimer>
+
+#include "analyzerbase.h"
+#include "analyzerrenderer.h"
+
+AnalyzerRenderer::AnalyzerRenderer(AnalyzerBase *analyzer)
+    : QObject(nullptr),
+      analyzer_(analyzer),
+      last_render_nsec_(0) {}
+
+void AnalyzerRenderer::Render(const std::vector<float> &scope, const EngineBase::State state, const bool new_frame, const QSize &size, const QPalette &palette) {
+
+  if (size.isEmpty()) return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  if (size != size_ || palette != palette_) {
+    size_ = size;
+    palette_ = palette;
+    back_ = QImage(size_, QImage::Format_RGB32);
+    analyzer_->renderResize(size_, palette_);
+  }
+
+  {
+    QPainter p(&back_);
+    p.fillRect(back_.rect(), palette_.color(QPalette::Window));
+    analyzer_->renderFrame(p, scope, state, new_frame);
+  }
+
+  {
+    QMutexLocker l(&front_mutex_);
+    front_.swap(back_);
+  }
+
+  // The previous front buffer has the wrong size after a resize.
+  if (back_.size() != size_) {
+    back_ = QImage(size_, QImage::Format_RGB32);
+  }
+
+  last_render_nsec_.storeRelease(timer.nsecsElapsed());
+
+  emit FrameReady();
+
+}
+
+void AnalyzerRenderer::DrawLatestFrame(QPainter &p) {
+
+  QMutexLocker l(&front_mutex_);
+  if (!front_.isNull()) {
+    p.drawImage(0, 0, front_);
+  }
+
+}
@@ -0,0 +1,70 @@
+/*
+   Strawberry Music Player
+   Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ANALYZERRENDERER_H
+#define ANALYZERRENDERER_H
+
+#include "config.h"
+
+#include <vector>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMutex>
+#include <QImage>
+#include <QSize>
+#include <QPalette>
+#include <QAtomicInteger>
+
+#include "engine/enginebase.h"
+
+class QPainter;
+class AnalyzerBase;
+
+// Runs the transform and rasterization of an analyzer on its own thread into a double buffered image.
+// The widget only draws the latest completed frame.
+class AnalyzerRenderer : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit AnalyzerRenderer(AnalyzerBase *analyzer);
+
+  // Render thread
+  void Render(const std::vector<float> &scope, const EngineBase::State state, const bool new_frame, const QSize &size, const QPalette &palette);
+
+  // GUI thread
+  void DrawLatestFrame(QPainter &p);
+  qint64 last_render_nsec() const { return last_render_nsec_.loadAcquire(); }
+
+ signals:
+  void FrameReady();
+
+ private:
+  AnalyzerBase *analyzer_;
+
+  QImage back_;
+  QSize size_;
+  QPalette palette_;
+
+  QMutex front_mutex_;
+  QImage front_;
+
+  QAtomicInteger<qint64> last_render_nsec_;
+};
+
+#endif  // ANALYZERRENDERER_H
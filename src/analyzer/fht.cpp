@@ -28,6 +28,10 @@
 #include <QVector>
 #include <QtMath>
 
+#include "realfft.h"
+
+const uint FHT::kRealFFTMinExp = 5;
+
 FHT::FHT(uint n) : num_((n < 3) ? 0 : 1 << n), exp2_((n < 3) ? -1 : static_cast<int>(n)) {
 
   if (n > 3) {
@@ -36,6 +40,10 @@ FHT::FHT(uint n) : num_((n < 3) ? 0 : 1 << n), exp2_((n < 3) ? -1 : static_cast<
     makeCasTable();
   }
 
+  if (n >= kRealFFTMinExp) {
+    fft_.reset(new RealFFT(num_));
+  }
+
 }
 
 FHT::~FHT() = default;
@@ -126,6 +134,11 @@ void FHT::power(float *p) {
 
 void FHT::power2(float *p) {
 
+  if (fft_) {
+    fft_->power2(p);
+    return;
+  }
+
   _transform(p, num_, 0);
 
   *p = static_cast<float>(2 * pow(*p, 2));
@@ -25,6 +25,10 @@
 
 #include <QVector>
 
+#include "core/scoped_ptr.h"
+
+class RealFFT;
+
 /**
  * Implementation of the Hartley Transform after Bracewell's discrete
  * algorithm. The algorithm is subject to US patent No. 4,646,256 (1987)
@@ -34,6 +38,8 @@
  * [1] Computer in Physics, Vol. 9, No. 4, Jul/Aug 1995 pp 373-379
  */
 class FHT {
+  static const uint kRealFFTMinExp;
+
   const int num_;
   const int exp2_;
 
@@ -41,6 +47,9 @@ class FHT {
   QVector<float> tab_vector_;
   QVector<int> log_vector_;
 
+  // Used for the power spectrum of larger sizes, where it is faster than the Hartley transform.
+  ScopedPtr<RealFFT> fft_;
+
   float *buf_();
   float *tab_();
   int *log_();
@@ -110,6 +119,7 @@ class FHT {
    * result. The values need to be multiplied by 0.5 to be exact.
    * Note that you only get @f$2^{n-1}@f$ power values for a data set
    * of @f$2^n@f$ input values. This is the fastest transform.
+   * For @f$n \geq 5@f$ the upper half of the array is left untouched.
    * @see FHT::power()
    */
   void power2(float*);
@@ -0,0 +1,243 @@
+/*
+   Strawberry Music Player
+   Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64)
+#  include <xmmintrin.h>
+#  define REALFFT_SSE
+#endif
+
+#ifdef HAVE_FFTW3F
+#  include <fftw3.h>
+#endif
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QMap>
+#include <QtMath>
+
+#include "core/shared_ptr.h"
+#include "core/scoped_ptr.h"
+#include "realfft.h"
+
+using std::make_shared;
+
+// Tables for a complex FFT of size / 2 points plus the post processing twiddles to get the spectrum of size real values.
+struct RealFFT::Plan {
+  int half_size;
+  std::vector<int> bitrev;
+  // Twiddles of all butterfly stages, laid out contiguously per stage: the stage with span h starts at index h - 1.
+  std::vector<float> stage_re;
+  std::vector<float> stage_im;
+  // exp(-2 pi i k / size) for k < size / 2.
+  std::vector<float> split_re;
+  std::vector<float> split_im;
+};
+
+struct RealFFT::FFTWPlan {
+#ifdef HAVE_FFTW3F
+  FFTWPlan() : input(nullptr), output(nullptr), plan(nullptr) {}
+  ~FFTWPlan();
+  float *input;
+  fftwf_complex *output;
+  fftwf_plan plan;
+#endif
+};
+
+namespace {
+
+#ifdef HAVE_FFTW3F
+// The FFTW planner is not thread-safe.
+QMutex fftw_planner_mutex;
+#endif
+
+QMutex plans_mutex;
+
+}  // namespace
+
+#ifdef HAVE_FFTW3F
+RealFFT::FFTWPlan::~FFTWPlan() {
+
+  if (plan) {
+    QMutexLocker l(&fftw_planner_mutex);
+    fftwf_destroy_plan(plan);
+  }
+  if (input) fftwf_free(input);
+  if (output) fftwf_free(output);
+
+}
+#endif
+
+RealFFT::RealFFT(const int size) : size_(size) {
+
+#ifdef HAVE_FFTW3F
+  fftw_plan_.reset(new FFTWPlan);
+  fftw_plan_->input = static_cast<float*>(fftwf_malloc(sizeof(float) * static_cast<size_t>(size_)));
+  fftw_plan_->output = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * static_cast<size_t>(size_ / 2 + 1)));
+  if (fftw_plan_->input && fftw_plan_->output) {
+    QMutexLocker l(&fftw_planner_mutex);
+    fftw_plan_->plan = fftwf_plan_dft_r2c_1d(size_, fftw_plan_->input, fftw_plan_->output, FFTW_ESTIMATE);
+  }
+  if (fftw_plan_->plan) return;
+  fftw_plan_.reset();
+#endif
+
+  plan_ = GetPlan(size_);
+  re_.resize(static_cast<size_t>(size_ / 2));
+  im_.resize(static_cast<size_t>(size_ / 2));
+
+}
+
+RealFFT::~RealFFT() = default;
+
+SharedPtr<const RealFFT::Plan> RealFFT::GetPlan(const int size) {
+
+  static QMap<int, SharedPtr<const Plan>> plans;
+
+  QMutexLocker l(&plans_mutex);
+
+  if (plans.contains(size)) return plans.value(size);
+
+  SharedPtr<Plan> plan = make_shared<Plan>();
+  const int half_size = size / 2;
+  plan->half_size = half_size;
+
+  int bits = 0;
+  while ((1 << bits) < half_size) ++bits;
+  plan->bitrev.resize(static_cast<size_t>(half_size));
+  for (int i = 0; i < half_size; ++i) {
+    int r = 0;
+    for (int b = 0; b < bits; ++b) {
+      if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+    }
+    plan->bitrev[static_cast<size_t>(i)] = r;
+  }
+
+  plan->stage_re.resize(static_cast<size_t>(qMax(1, half_size - 1)));
+  plan->stage_im.resize(static_cast<size_t>(qMax(1, half_size - 1)));
+  for (int span = 1; span < half_size; span *= 2) {
+    for (int j = 0; j < span; ++j) {
+      const double angle = -M_PI * static_cast<double>(j) / static_cast<double>(span);
+      plan->stage_re[static_cast<size_t>(span - 1 + j)] = static_cast<float>(cos(angle));
+      plan->stage_im[static_cast<size_t>(span - 1 + j)] = static_cast<float>(sin(angle));
+    }
+  }
+
+  plan->split_re.resize(static_cast<size_t>(half_size));
+  plan->split_im.resize(static_cast<size_t>(half_size));
+  for (int k = 0; k < half_size; ++k) {
+    const double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+    plan->split_re[static_cast<size_t>(k)] = static_cast<float>(cos(angle));
+    plan->split_im[static_cast<size_t>(k)] = static_cast<float>(sin(angle));
+  }
+
+  plans.insert(size, plan);
+
+  return plan;
+
+}
+
+void RealFFT::power2(float *p) {
+
+#ifdef HAVE_FFTW3F
+  if (fftw_plan_) {
+    std::copy(p, p + size_, fftw_plan_->input);
+    fftwf_execute(fftw_plan_->plan);
+    for (int k = 0; k < size_ / 2; ++k) {
+      p[k] = 2.0F * (fftw_plan_->output[k][0] * fftw_plan_->output[k][0] + fftw_plan_->output[k][1] * fftw_plan_->output[k][1]);
+    }
+    return;
+  }
+#endif
+
+  const int half_size = plan_->half_size;
+  float *re = re_.data();
+  float *im = im_.data();
+
+  // Pack even samples into the real part and odd samples into the imaginary part, in bit reversed order.
+  for (int i = 0; i < half_size; ++i) {
+    const int r = plan_->bitrev[static_cast<size_t>(i)];
+    re[r] = p[2 * i];
+    im[r] = p[2 * i + 1];
+  }
+
+  Transform();
+
+  // Untangle the spectra of the even and odd samples to get the spectrum of the real input.
+  const float *split_re = plan_->split_re.data();
+  const float *split_im = plan_->split_im.data();
+  for (int k = 0; k < half_size; ++k) {
+    const int m = k == 0 ? 0 : half_size - k;
+    const float even_re = (re[k] + re[m]) * 0.5F;
+    const float even_im = (im[k] - im[m]) * 0.5F;
+    const float odd_re = (im[k] + im[m]) * 0.5F;
+    const float odd_im = (re[m] - re[k]) * 0.5F;
+    const float x_re = even_re + split_re[k] * odd_re - split_im[k] * odd_im;
+    const float x_im = even_im + split_re[k] * odd_im + split_im[k] * odd_re;
+    p[k] = 2.0F * (x_re * x_re + x_im * x_im);
+  }
+
+}
+
+void RealFFT::Transform() {
+
+  const int half_size = plan_->half_size;
+  float *re = re_.data();
+  float *im = im_.data();
+
+  for (int span = 1; span < half_size; span *= 2) {
+    const float *w_re = plan_->stage_re.data() + span - 1;
+    const float *w_im = plan_->stage_im.data() + span - 1;
+    for (int i = 0; i < half_size; i += 2 * span) {
+      float *a_re = re + i;
+      float *a_im = im + i;
+      float *b_re = a_re + span;
+      float *b_im = a_im + span;
+      int j = 0;
+#ifdef REALFFT_SSE
+      for (; j + 4 <= span; j += 4) {
+        const __m128 wr = _mm_loadu_ps(w_re + j);
+        const __m128 wi = _mm_loadu_ps(w_im + j);
+        const __m128 br = _mm_loadu_ps(b_re + j);
+        const __m128 bi = _mm_loadu_ps(b_im + j);
+        const __m128 ar = _mm_loadu_ps(a_re + j);
+        const __m128 ai = _mm_loadu_ps(a_im + j);
+        const __m128 vr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+        const __m128 vi = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+        _mm_storeu_ps(a_re + j, _mm_add_ps(ar, vr));
+        _mm_storeu_ps(a_im + j, _mm_add_ps(ai, vi));
+        _mm_storeu_ps(b_re + j, _mm_sub_ps(ar, vr));
+        _mm_storeu_ps(b_im + j, _mm_sub_ps(ai, vi));
+      }
+#endif
+      for (; j < span; ++j) {
+        const float vr = b_re[j] * w_re[j] - b_im[j] * w_im[j];
+        const float vi = b_re[j] * w_im[j] + b_im[j] * w_re[j];
+        b_re[j] = a_re[j] - vr;
+        b_im[j] = a_im[j] - vi;
+        a_re[j] += vr;
+        a_im[j] += vi;
+      }
+    }
+  }
+
+}
@@ -0,0 +1,71 @@
+/*
+   Strawberry Music Player
+   Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include "config.h"
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include "core/shared_ptr.h"
+#include "core/scoped_ptr.h"
+
+/**
+ * Real input FFT used by FHT for the power spectrum of the analyzers.
+ *
+ * Uses single precision FFTW when available, otherwise a radix-2 FFT of
+ * half the size on split real/imaginary arrays with SSE butterflies.
+ * Twiddle and bit reversal tables are computed once per size by the
+ * planner and shared by all instances of that size.
+ */
+class RealFFT {
+ public:
+  // @param size is the number of real input values, a power of two of at least 4.
+  explicit RealFFT(const int size);
+  ~RealFFT();
+
+  int size() const { return size_; }
+
+  /**
+   * FFT power spectrum with doubled values, same scaling as FHT::power2().
+   * Reads @f$n@f$ input values from @param p and writes the @f$n/2@f$
+   * power values to its first half.
+   */
+  void power2(float *p);
+
+ private:
+  struct Plan;
+  struct FFTWPlan;
+
+  static SharedPtr<const Plan> GetPlan(const int size);
+
+  void Transform();
+
+  const int size_;
+  SharedPtr<const Plan> plan_;
+  ScopedPtr<FFTWPlan> fftw_plan_;
+  std::vector<float> re_;
+  std::vector<float> im_;
+
+  Q_DISABLE_COPY(RealFFT)
+};
+
+#endif  // REALFFT_H
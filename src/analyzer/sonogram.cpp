@@ -21,8 +21,12 @@
    along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstring>
+
+#include <QImage>
+#include <QColor>
 #include <QPainter>
-#include <QResizeEvent>
+#include <QPalette>
 
 #include "engine/enginebase.h"
 
@@ -31,33 +35,48 @@
 const char *Sonogram::kName = QT_TRANSLATE_NOOP("AnalyzerContainer", "Sonogram");
 
 Sonogram::Sonogram(QWidget *parent)
-    : AnalyzerBase(parent, 9) {}
+    : AnalyzerBase(parent, 9) {
+
+  setThreadedRendering(true);
 
-void Sonogram::resizeEvent(QResizeEvent *e) {
+}
+
+Sonogram::~Sonogram() {
+  setThreadedRendering(false);
+}
 
-  Q_UNUSED(e)
+void Sonogram::renderResize(const QSize &size, const QPalette &palette) {
 
-  canvas_ = QPixmap(size());
-  canvas_.fill(palette().color(QPalette::Window));
+  background_ = palette.color(QPalette::Window);
+  canvas_ = QImage(size, QImage::Format_RGB32);
+  canvas_.fill(background_);
 
 }
 
 void Sonogram::analyze(QPainter &p, const Scope &s, bool new_frame) {
 
-  if (!new_frame || engine_->state() == EngineBase::State::Paused) {
-    p.drawPixmap(0, 0, canvas_);
+  if (canvas_.isNull()) return;
+
+  if (!new_frame || state_ == EngineBase::State::Paused) {
+    p.drawImage(0, 0, canvas_);
     return;
   }
 
-  QPainter canvas_painter(&canvas_);
-  canvas_painter.drawPixmap(0, 0, canvas_, 1, 0, width() - 1, -1);
+  const int width = canvas_.width();
+  const int height = canvas_.height();
+
+  // Scroll one pixel to the left.
+  for (int y = 0; y < height; ++y) {
+    QRgb *line = reinterpret_cast<QRgb*>(canvas_.scanLine(y));
+    memmove(line, line + 1, static_cast<size_t>(width - 1) * sizeof(QRgb));
+  }
 
   Scope::const_iterator it = s.begin(), end = s.end();
 
-  for (int y = height() - 1; y;) {
+  for (int y = height - 1; y;) {
     QColor c;
     if (it >= end || *it < .005) {
-      c = palette().color(QPalette::Window);
+      c = background_;
     }
     else if (*it < .05) {
       c.setHsv(95, 255, 255 - static_cast<int>(*it * 4000.0));
@@ -69,15 +88,12 @@ void Sonogram::analyze(QPainter &p, const Scope &s, bool new_frame) {
       c = Qt::red;
     }
 
-    canvas_painter.setPen(c);
-    canvas_painter.drawPoint(width() - 1, y--);
+    reinterpret_cast<QRgb*>(canvas_.scanLine(y--))[width - 1] = c.rgb();
 
     if (it < end) ++it;
   }
 
-  canvas_painter.end();
-
-  p.drawPixmap(0, 0, canvas_);
+  p.drawImage(0, 0, canvas_);
 
 }
 
@@ -24,7 +24,8 @@
 #ifndef SONOGRAM_H
 #define SONOGRAM_H
 
-#include <QPixmap>
+#include <QImage>
+#include <QColor>
 #include <QPainter>
 
 #include "analyzerbase.h"
@@ -33,17 +34,19 @@ class Sonogram : public AnalyzerBase {
   Q_OBJECT
  public:
   Q_INVOKABLE explicit Sonogram(QWidget *parent);
+  ~Sonogram() override;
 
   static const char *kName;
 
  protected:
-  void resizeEvent(QResizeEvent *e) override;
+  void renderResize(const QSize &size, const QPalette &palette) override;
   void analyze(QPainter &p, const Scope &s, bool new_frame) override;
   void transform(Scope &scope) override;
   void demo(QPainter &p) override;
 
  private:
-  QPixmap canvas_;
+  QImage canvas_;
+  QColor background_;
 };
 
 #endif  // SONOGRAM_H
@@ -22,11 +22,16 @@
 #include "config.h"
 
 #include <memory>
+#include <utility>
 
 #include <QtGlobal>
 #include <QObject>
 #include <QThread>
 #include <QList>
+#include <QHash>
+#include <QMap>
+#include <QByteArray>
+#include <QUrl>
 #include <QSettings>
 #include <QtConcurrentRun>
 
@@ -46,12 +51,27 @@
 #include "scrobbler/lastfmimport.h"
 #include "settings/collectionsettingspage.h"
 
+#ifdef HAVE_GSTREAMER
+#  include "engine/songanalysispipeline.h"
+#endif
+#ifdef HAVE_SONGFINGERPRINTING
+#  include "engine/chromaprinter.h"
+#endif
+#ifdef HAVE_MOODBAR
+#  include "moodbar/moodbarloader.h"
+#  include "settings/moodbarsettingspage.h"
+#endif
+
 using std::make_shared;
 
 const char *SCollection::kSongsTable = "songs";
 const char *SCollection::kDirsTable = "directories";
 const char *SCollection::kSubdirsTable = "subdirectories";
 
+namespace {
+constexpr int kAnalyzeSongsBatchSize = 50;
+}
+
 SCollection::SCollection(Application *app, QObject *parent)
     : QObject(parent),
       app_(app),
@@ -61,7 +81,12 @@ SCollection::SCollection(Application *app, QObject *parent)
       watcher_thread_(nullptr),
       original_thread_(nullptr),
       save_playcounts_to_files_(false),
-      save_ratings_to_files_(false) {
+      save_ratings_to_files_(false),
+      song_tracking_(false),
+      song_ebur128_loudness_analysis_(false),
+      moodbar_enabled_(false),
+      analyze_songs_running_(0),
+      analyze_songs_abort_(0) {
 
   original_thread_ = thread();
 
@@ -122,8 +147,10 @@ void SCollection::Init() {
   QObject::connect(watcher_, &CollectionWatcher::CompilationsNeedUpdating, &*backend_, &CollectionBackend::CompilationsNeedUpdating);
   QObject::connect(watcher_, &CollectionWatcher::UpdateLastSeen, &*backend_, &CollectionBackend::UpdateLastSeen);
 
-  QObject::connect(&*app_->lastfm_import(), &LastFMImport::UpdateLastPlayed, &*backend_, &CollectionBackend::UpdateLastPlayed);
-  QObject::connect(&*app_->lastfm_import(), &LastFMImport::UpdatePlayCount, &*backend_, &CollectionBackend::UpdatePlayCount);
+  QObject::connect(&*app_->lastfm_import(), &LastFMImport::StatisticsImportStarted, &*backend_, &CollectionBackend::StartStatisticsImport);
+  QObject::connect(&*app_->lastfm_import(), &LastFMImport::StatisticsReceived, &*backend_, &CollectionBackend::AddStatisticsImport);
+  QObject::connect(&*app_->lastfm_import(), &LastFMImport::StatisticsImportFinished, &*backend_, &CollectionBackend::FinishStatisticsImport);
+  QObject::connect(&*app_->lastfm_import(), &LastFMImport::StatisticsImportAborted, &*backend_, &CollectionBackend::AbortStatisticsImport);
 
   // This will start the watcher checking for updates
   backend_->LoadDirectoriesAsync();
@@ -161,6 +188,8 @@ void SCollection::FullScan() { watcher_->FullScanAsync(); }
 
 void SCollection::AbortScan() { watcher_->Stop(); }
 
+void SCollection::AbortAnalyzeSongs() { analyze_songs_abort_.storeRelease(1); }
+
 void SCollection::Rescan(const SongList &songs) {
 
   qLog(Debug) << "Rescan" << songs.size() << "songs";
@@ -183,7 +212,15 @@ void SCollection::ReloadSettings() {
   s.beginGroup(CollectionSettingsPage::kSettingsGroup);
   save_playcounts_to_files_ = s.value("save_playcounts", false).toBool();
   save_ratings_to_files_ = s.value("save_ratings", false).toBool();
+  song_tracking_ = s.value("song_tracking", false).toBool();
+  song_ebur128_loudness_analysis_ = s.value("song_ebur128_loudness_analysis", false).toBool();
+  s.endGroup();
+
+#ifdef HAVE_MOODBAR
+  s.beginGroup(MoodbarSettingsPage::kSettingsGroup);
+  moodbar_enabled_ = s.value("enabled", false).toBool();
   s.endGroup();
+#endif
 
 }
 
@@ -214,6 +251,139 @@ void SCollection::SyncPlaycountAndRatingToFiles() {
 
 }
 
+void SCollection::AnalyzeSongsAsync() {
+
+  if (!analyze_songs_running_.testAndSetAcquire(0, 1)) return;
+  analyze_songs_abort_.storeRelease(0);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  (void)QtConcurrent::run(&SCollection::AnalyzeSongs, this, song_tracking_, song_ebur128_loudness_analysis_, moodbar_enabled_);
+#else
+  (void)QtConcurrent::run(this, &SCollection::AnalyzeSongs, song_tracking_, song_ebur128_loudness_analysis_, moodbar_enabled_);
+#endif
+
+}
+
+void SCollection::AnalyzeSongs(const bool song_tracking, const bool song_ebur128_loudness_analysis, const bool moodbar_enabled) {
+
+#if !defined(HAVE_GSTREAMER) || !defined(HAVE_MOODBAR)
+  Q_UNUSED(moodbar_enabled);
+#endif
+
+#ifdef HAVE_GSTREAMER
+  using Analysis = SongAnalysisPipeline::Analysis;
+  using Analyses = SongAnalysisPipeline::Analyses;
+
+  Analyses analyses;
+  if (song_tracking) analyses |= Analysis::Fingerprint;
+  if (song_ebur128_loudness_analysis) analyses |= Analysis::EBUR128;
+  analyses &= SongAnalysisPipeline::SupportedAnalyses();
+
+  // Collect everything that is missing for a song, so each file is only decoded once.
+  QMap<int, Song> songs;
+  QHash<int, Analyses> pending;
+  const CollectionDirectoryList dirs = analyses ? backend_->GetAllDirectories() : CollectionDirectoryList();
+  for (const CollectionDirectory &dir : dirs) {
+    if (analyses.testFlag(Analysis::Fingerprint)) {
+      const SongList songs_missing_fingerprint = backend_->SongsWithMissingFingerprint(dir.id);
+      for (const Song &song : songs_missing_fingerprint) {
+        songs.insert(song.id(), song);
+        pending[song.id()] |= Analysis::Fingerprint;
+      }
+    }
+    if (analyses.testFlag(Analysis::EBUR128)) {
+      const SongList songs_missing_loudness = backend_->SongsWithMissingLoudnessCharacteristics(dir.id);
+      for (const Song &song : songs_missing_loudness) {
+        songs.insert(song.id(), song);
+        pending[song.id()] |= Analysis::EBUR128;
+      }
+    }
+  }
+
+  if (songs.isEmpty()) {
+    analyze_songs_running_.storeRelease(0);
+    return;
+  }
+
+  const int task_id = app_->task_manager()->StartTask(tr("Analyzing songs"));
+
+  // Fingerprints of CUE sheets are made from the whole file, and shared by all sections.
+  QHash<QString, QString> cue_fingerprints;
+  SongList updated_songs;
+  const qint64 nb_songs = songs.size();
+  int i = 0;
+  for (Song song : std::as_const(songs)) {
+    if (analyze_songs_abort_.loadAcquire()) break;
+
+    Analyses song_analyses = pending.value(song.id());
+
+#ifdef HAVE_SONGFINGERPRINTING
+    if (song.has_cue() && song_analyses.testFlag(Analysis::Fingerprint)) {
+      const QString filename = song.url().toLocalFile();
+      if (!cue_fingerprints.contains(filename)) {
+        Chromaprinter chromaprinter(filename);
+        const QString fingerprint = chromaprinter.CreateFingerprint();
+        cue_fingerprints.insert(filename, fingerprint.isEmpty() ? QStringLiteral("NONE") : fingerprint);
+      }
+      song.set_fingerprint(cue_fingerprints.value(filename));
+      song_analyses.setFlag(Analysis::Fingerprint, false);
+    }
+#endif
+
+#ifdef HAVE_MOODBAR
+    // Create the moodbar while the file is decoded anyway.
+    if (moodbar_enabled && !song.has_cue() && !app_->moodbar_loader()->HasData(song.url())) {
+      song_analyses |= Analysis::Moodbar;
+    }
+#endif
+
+    SongAnalysisPipeline pipeline(song);
+    const Analyses done = pipeline.Run(song_analyses);
+
+    if (song_analyses.testFlag(Analysis::Fingerprint)) {
+      // Mark failures like the collection watcher does, so the file is not retried on every run.
+      song.set_fingerprint(done.testFlag(Analysis::Fingerprint) ? pipeline.fingerprint() : QStringLiteral("NONE"));
+    }
+    if (done.testFlag(Analysis::EBUR128)) {
+      song.set_ebur128_integrated_loudness_lufs(pipeline.ebur128_measures()->loudness_lufs);
+      song.set_ebur128_loudness_range_lu(pipeline.ebur128_measures()->range_lu);
+    }
+#ifdef HAVE_MOODBAR
+    if (done.testFlag(Analysis::Moodbar)) {
+      SharedPtr<MoodbarLoader> moodbar_loader = app_->moodbar_loader();
+      const QUrl url = song.url();
+      const QByteArray moodbar_data = pipeline.moodbar_data();
+      QMetaObject::invokeMethod(&*moodbar_loader, [moodbar_loader, url, moodbar_data]() { moodbar_loader->SaveData(url, moodbar_data); }, Qt::QueuedConnection);
+    }
+#endif
+
+    if (song.fingerprint() != songs.value(song.id()).fingerprint() || done.testFlag(Analysis::EBUR128)) {
+      updated_songs << song;
+    }
+    if (updated_songs.count() >= kAnalyzeSongsBatchSize) {
+      backend_->UpdateSongsAnalysisAsync(updated_songs);
+      updated_songs.clear();
+    }
+
+    app_->task_manager()->SetTaskProgress(task_id, ++i, nb_songs);
+  }
+
+  if (!updated_songs.isEmpty()) {
+    backend_->UpdateSongsAnalysisAsync(updated_songs);
+  }
+
+  qLog(Debug) << "Analyzed" << i << "of" << nb_songs << "songs";
+
+  app_->task_manager()->SetTaskFinished(task_id);
+#else
+  Q_UNUSED(song_tracking);
+  Q_UNUSED(song_ebur128_loudness_analysis);
+#endif  // HAVE_GSTREAMER
+
+  analyze_songs_running_.storeRelease(0);
+
+}
+
 void SCollection::SongsPlaycountChanged(const SongList &songs, const bool save_tags) {
 
   if (save_tags || save_playcounts_to_files_) {
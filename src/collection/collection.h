@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <QObject>
+#include <QAtomicInteger>
 #include <QList>
 #include <QHash>
 #include <QString>
@@ -63,6 +64,8 @@ class SCollection : public QObject {
 
  private:
   void SyncPlaycountAndRatingToFiles();
+  // The settings are passed in, so they are not read from the worker thread while ReloadSettings() writes them.
+  void AnalyzeSongs(const bool song_tracking, const bool song_ebur128_loudness_analysis, const bool moodbar_enabled);
 
  public slots:
   void ReloadSettings();
@@ -76,6 +79,10 @@ class SCollection : public QObject {
 
   void IncrementalScan();
 
+  // Creates missing fingerprints and loudness characteristics, decoding each file only once.
+  void AnalyzeSongsAsync();
+  void AbortAnalyzeSongs();
+
  private slots:
   void ExitReceived();
   void SongsPlaycountChanged(const SongList &songs, const bool save_tags = false);
@@ -101,6 +108,12 @@ class SCollection : public QObject {
 
   bool save_playcounts_to_files_;
   bool save_ratings_to_files_;
+  bool song_tracking_;
+  bool song_ebur128_loudness_analysis_;
+  bool moodbar_enabled_;
+
+  QAtomicInt analyze_songs_running_;
+  QAtomicInt analyze_songs_abort_;
 };
 
 #endif
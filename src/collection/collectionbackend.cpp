@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <optional>
+#include <algorithm>
 #include <utility>
 
 #include <QtGlobal>
@@ -29,10 +30,13 @@
 #include <QApplication>
 #include <QThread>
 #include <QMutex>
+#include <QMutexLocker>
+#include <QCache>
 #include <QSet>
 #include <QMap>
 #include <QVector>
 #include <QVariant>
+#include <QVariantMap>
 #include <QByteArray>
 #include <QString>
 #include <QStringList>
@@ -52,6 +56,7 @@
 #include "core/song.h"
 #include "core/sqlrow.h"
 #include "smartplaylists/smartplaylistsearch.h"
+#include "covermanager/thumbnailstore.h"
 
 #include "collectiondirectory.h"
 #include "collectionbackend.h"
@@ -59,15 +64,56 @@
 #include "collectionquery.h"
 #include "collectiontask.h"
 
+const int CollectionBackend::kSmartPlaylistsCacheMaxIds = 2000000;
+
+namespace {
+
+bool SmartPlaylistSearchUsesFields(const SmartPlaylistSearch &search, const QList<SmartPlaylistSearchTerm::Field> &fields) {
+
+  if (search.search_type_ == SmartPlaylistSearch::SearchType::All) return false;
+
+  return std::any_of(search.terms_.begin(), search.terms_.end(), [&fields](const SmartPlaylistSearchTerm &term) { return fields.contains(term.field_); });
+
+}
+
+// Searches like "in the last 7 days" are compared with the current time, so their IDs change without the collection changing.
+bool SmartPlaylistSearchIsTimeRelative(const SmartPlaylistSearch &search) {
+
+  if (search.search_type_ == SmartPlaylistSearch::SearchType::All) return false;
+
+  return std::any_of(search.terms_.begin(), search.terms_.end(), [](const SmartPlaylistSearchTerm &term) {
+    return SmartPlaylistSearchTerm::TypeOf(term.field_) == SmartPlaylistSearchTerm::Type::Date &&
+           (term.operator_ == SmartPlaylistSearchTerm::Operator::NumericDate ||
+            term.operator_ == SmartPlaylistSearchTerm::Operator::NumericDateNot ||
+            term.operator_ == SmartPlaylistSearchTerm::Operator::RelativeDate);
+  });
+
+}
+
+}  // namespace
+
 CollectionBackend::CollectionBackend(QObject *parent)
     : CollectionBackendInterface(parent),
       db_(nullptr),
       task_manager_(nullptr),
       source_(Song::Source::Unknown),
-      original_thread_(nullptr) {
+      original_thread_(nullptr),
+      smart_playlists_ids_(kSmartPlaylistsCacheMaxIds),
+      smart_playlists_generation_(0),
+      smart_playlists_statistics_generation_(0),
+      smart_playlists_rating_generation_(0) {
 
   original_thread_ = thread();
 
+  // Any of these can change which songs match a smart playlist search.
+  QObject::connect(this, &CollectionBackend::SongsAdded, this, &CollectionBackend::SmartPlaylistsClearCache);
+  QObject::connect(this, &CollectionBackend::SongsDeleted, this, &CollectionBackend::SmartPlaylistsClearCache);
+  QObject::connect(this, &CollectionBackend::SongsChanged, this, &CollectionBackend::SmartPlaylistsClearCache);
+  // Statistics and ratings change on every play, so only the searches using them are cleared.
+  QObject::connect(this, &CollectionBackend::SongsStatisticsChanged, this, &CollectionBackend::SmartPlaylistsClearStatisticsCache);
+  QObject::connect(this, &CollectionBackend::SongsRatingChanged, this, &CollectionBackend::SmartPlaylistsClearRatingCache);
+  QObject::connect(this, &CollectionBackend::DatabaseReset, this, &CollectionBackend::SmartPlaylistsClearCache);
+
 }
 
 CollectionBackend::~CollectionBackend() {
@@ -730,8 +776,20 @@ void CollectionBackend::UpdateSongsBySongIDAsync(const SongMap &new_songs) {
   QMetaObject::invokeMethod(this, "UpdateSongsBySongID", Qt::QueuedConnection, Q_ARG(SongMap, new_songs));
 }
 
+void CollectionBackend::MergeSongsBySongIDAsync(const SongMap &new_songs, const QString &id_column, const QStringList &keep_ids) {
+  QMetaObject::invokeMethod(this, "MergeSongsBySongID", Qt::QueuedConnection, Q_ARG(SongMap, new_songs), Q_ARG(QString, id_column), Q_ARG(QStringList, keep_ids));
+}
+
 void CollectionBackend::UpdateSongsBySongID(const SongMap &new_songs) {
 
+  MergeSongsBySongID(new_songs, QStringLiteral("song_id"), new_songs.keys());
+
+}
+
+// Adds or updates new_songs by song ID, without a full reload of the songs that didn't change.
+// If id_column is set, songs with an artist_id, album_id or song_id not in keep_ids are deleted.
+void CollectionBackend::MergeSongsBySongID(const SongMap &new_songs, const QString &id_column, const QStringList &keep_ids) {
+
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -801,9 +859,15 @@ void CollectionBackend::UpdateSongsBySongID(const SongMap &new_songs) {
   }
 
   // Delete songs
-  const QList old_songs_list = old_songs.values();
+  QSet<QString> keep_ids_set;
+  for (const QString &id : keep_ids) keep_ids_set.insert(id);
+  const SongList old_songs_list = id_column.isEmpty() ? SongList() : old_songs.values();
   for (const Song &old_song : old_songs_list) {
-    if (!new_songs.contains(old_song.song_id())) {
+    QString id;
+    if (id_column == QLatin1String("artist_id")) id = old_song.artist_id();
+    else if (id_column == QLatin1String("album_id")) id = old_song.album_id();
+    else id = old_song.song_id();
+    if (!new_songs.contains(old_song.song_id()) && !keep_ids_set.contains(id)) {
       {
         SqlQuery q(db);
         q.prepare(QStringLiteral("DELETE FROM %1 WHERE ROWID = :id").arg(songs_table_));
@@ -849,6 +913,39 @@ void CollectionBackend::UpdateMTimesOnly(const SongList &songs) {
 
 }
 
+void CollectionBackend::UpdateSongsAnalysisAsync(const SongList &songs) {
+  QMetaObject::invokeMethod(this, "UpdateSongsAnalysis", Qt::QueuedConnection, Q_ARG(SongList, songs));
+}
+
+void CollectionBackend::UpdateSongsAnalysis(const SongList &songs) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QStringList ids;
+  ids.reserve(songs.count());
+
+  ScopedTransaction transaction(&db);
+  for (const Song &song : songs) {
+    SqlQuery q(db);
+    q.prepare(QStringLiteral("UPDATE %1 SET fingerprint = :fingerprint, ebur128_integrated_loudness_lufs = :ebur128_integrated_loudness_lufs, ebur128_loudness_range_lu = :ebur128_loudness_range_lu WHERE ROWID = :id").arg(songs_table_));
+    q.BindStringValue(QStringLiteral(":fingerprint"), song.fingerprint());
+    q.BindDoubleOrNullValue(QStringLiteral(":ebur128_integrated_loudness_lufs"), song.ebur128_integrated_loudness_lufs());
+    q.BindDoubleOrNullValue(QStringLiteral(":ebur128_loudness_range_lu"), song.ebur128_loudness_range_lu());
+    q.BindValue(QStringLiteral(":id"), song.id());
+    if (!q.Exec()) {
+      db_->ReportErrors(q);
+      return;
+    }
+    ids << QString::number(song.id());
+  }
+  transaction.Commit();
+
+  // Read the songs again, the other columns might have changed since the songs were analyzed.
+  emit SongsChanged(GetSongsById(ids, db));
+
+}
+
 void CollectionBackend::DeleteSongs(const SongList &songs) {
 
   QMutexLocker l(db_->Mutex());
@@ -1598,6 +1695,8 @@ void CollectionBackend::UpdateEmbeddedAlbumArt(const QString &effective_albumart
     }
   }
 
+  ThumbnailStore::InvalidateAlbum(source_, effective_albumartist, album);
+
   SongList songs;
   {
     CollectionQuery q(db, songs_table_);
@@ -1644,6 +1743,8 @@ void CollectionBackend::UpdateManualAlbumArt(const QString &effective_albumartis
     }
   }
 
+  ThumbnailStore::InvalidateAlbum(source_, effective_albumartist, album);
+
   SongList songs;
   {
     CollectionQuery q(db, songs_table_);
@@ -1689,6 +1790,8 @@ void CollectionBackend::UnsetAlbumArt(const QString &effective_albumartist, cons
     }
   }
 
+  ThumbnailStore::InvalidateAlbum(source_, effective_albumartist, album);
+
   SongList songs;
   {
     CollectionQuery q(db, songs_table_);
@@ -1735,6 +1838,8 @@ void CollectionBackend::ClearAlbumArt(const QString &effective_albumartist, cons
     }
   }
 
+  ThumbnailStore::InvalidateAlbum(source_, effective_albumartist, album);
+
   SongList songs;
   {
     CollectionQuery q(db, songs_table_);
@@ -1924,18 +2029,26 @@ void CollectionBackend::DeleteAll() {
 
 }
 
-SongList CollectionBackend::SmartPlaylistsFindSongs(const SmartPlaylistSearch &search) {
+SongList CollectionBackend::SmartPlaylistsFindSongs(const SmartPlaylistSearch &search, QVariant *last_sort_value) {
 
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
+  if (search.sort_type_ != SmartPlaylistSearch::SortType::Random) {
+    SmartPlaylistsCheckSortIndex(search, db);
+  }
+
   // Build the query
-  QString sql = search.ToSql(songs_table());
+  QVariantMap bound_values;
+  QString sql = search.ToSql(songs_table(), bound_values);
 
   // Run the query
   SongList ret;
   SqlQuery query(db);
   query.prepare(sql);
+  for (QVariantMap::const_iterator it = bound_values.constBegin(); it != bound_values.constEnd(); ++it) {
+    query.BindValue(it.key(), it.value());
+  }
   if (!query.Exec()) {
     db_->ReportErrors(query);
     return ret;
@@ -1946,11 +2059,158 @@ SongList CollectionBackend::SmartPlaylistsFindSongs(const SmartPlaylistSearch &s
     Song song;
     song.InitFromQuery(query, true);
     ret << song;
+    if (last_sort_value && search.sort_type_ != SmartPlaylistSearch::SortType::Random) {
+      *last_sort_value = query.value(static_cast<int>(Song::kColumns.count()) + 1);
+    }
   }
   return ret;
 
 }
 
+QStringList CollectionBackend::SmartPlaylistsQueryPlan(const SmartPlaylistSearch &search) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  return SmartPlaylistsQueryPlan(search, db);
+
+}
+
+QStringList CollectionBackend::SmartPlaylistsQueryPlan(const SmartPlaylistSearch &search, QSqlDatabase &db) {
+
+  QVariantMap bound_values;
+  const QString sql = search.ToSql(songs_table(), bound_values);
+
+  SqlQuery q(db);
+  q.prepare(QLatin1String("EXPLAIN QUERY PLAN ") + sql);
+  for (QVariantMap::const_iterator it = bound_values.constBegin(); it != bound_values.constEnd(); ++it) {
+    q.BindValue(it.key(), it.value());
+  }
+  if (!q.Exec()) {
+    db_->ReportErrors(q);
+    return QStringList();
+  }
+
+  QStringList plan;
+  while (q.next()) {
+    plan << q.value(3).toString();
+  }
+
+  return plan;
+
+}
+
+void CollectionBackend::SmartPlaylistsCheckSortIndex(const SmartPlaylistSearch &search, QSqlDatabase &db) {
+
+  const QString column = SmartPlaylistSearchTerm::FieldColumnName(search.sort_field_);
+
+  {
+    QMutexLocker l(&smart_playlists_mutex_);
+    if (smart_playlists_checked_sort_columns_.contains(column)) return;
+    smart_playlists_checked_sort_columns_.insert(column);
+  }
+
+  // Without an index on the sort column SQLite has to sort all matching songs for every page.
+  const QStringList plan = SmartPlaylistsQueryPlan(search, db);
+  for (const QString &detail : plan) {
+    if (detail.contains(QLatin1String("USE TEMP B-TREE FOR ORDER BY"))) {
+      qLog(Debug) << "Smart playlists sorted by" << column << "are not using an index, consider adding one with" << QStringLiteral("CREATE INDEX idx_%1 ON %2 (%1)").arg(column, songs_table_);
+      break;
+    }
+  }
+
+}
+
+QList<int> CollectionBackend::SmartPlaylistsFindSongIds(const SmartPlaylistSearch &search) {
+
+  QVariantMap bound_values;
+  const QString sql = search.ToIdSql(songs_table(), bound_values);
+
+  // The same query can have different values.
+  QString cache_key = sql;
+  for (QVariantMap::const_iterator it = bound_values.constBegin(); it != bound_values.constEnd(); ++it) {
+    cache_key += QLatin1Char('\n') + it.key() + QLatin1Char('=') + it.value().toString();
+  }
+
+  const bool uses_statistics = SmartPlaylistSearchUsesFields(search, QList<SmartPlaylistSearchTerm::Field>() << SmartPlaylistSearchTerm::Field::PlayCount << SmartPlaylistSearchTerm::Field::SkipCount << SmartPlaylistSearchTerm::Field::LastPlayed);
+  const bool uses_rating = SmartPlaylistSearchUsesFields(search, QList<SmartPlaylistSearchTerm::Field>() << SmartPlaylistSearchTerm::Field::Rating);
+  const bool cache = !SmartPlaylistSearchIsTimeRelative(search);
+
+  quint64 generation = 0;
+  quint64 statistics_generation = 0;
+  quint64 rating_generation = 0;
+  {
+    QMutexLocker l(&smart_playlists_mutex_);
+    if (QList<int> *ids = cache ? smart_playlists_ids_.object(cache_key) : nullptr) {
+      return *ids;
+    }
+    generation = smart_playlists_generation_;
+    statistics_generation = smart_playlists_statistics_generation_;
+    rating_generation = smart_playlists_rating_generation_;
+  }
+
+  QList<int> ids;
+  {
+    QMutexLocker l(db_->Mutex());
+    QSqlDatabase db(db_->Connect());
+    SqlQuery q(db);
+    q.prepare(sql);
+    for (QVariantMap::const_iterator it = bound_values.constBegin(); it != bound_values.constEnd(); ++it) {
+      q.BindValue(it.key(), it.value());
+    }
+    if (!q.Exec()) {
+      db_->ReportErrors(q);
+      return ids;
+    }
+    while (q.next()) {
+      ids << q.value(0).toInt();
+    }
+  }
+
+  // Don't cache the IDs if the collection changed while we were reading them.
+  QMutexLocker l(&smart_playlists_mutex_);
+  if (cache && generation == smart_playlists_generation_ && (!uses_statistics || statistics_generation == smart_playlists_statistics_generation_) && (!uses_rating || rating_generation == smart_playlists_rating_generation_)) {
+    smart_playlists_ids_.insert(cache_key, new QList<int>(ids), std::max(1, static_cast<int>(ids.count())));
+    if (uses_statistics) smart_playlists_statistics_keys_.insert(cache_key);
+    if (uses_rating) smart_playlists_rating_keys_.insert(cache_key);
+  }
+
+  return ids;
+
+}
+
+void CollectionBackend::SmartPlaylistsClearCache() {
+
+  QMutexLocker l(&smart_playlists_mutex_);
+  smart_playlists_ids_.clear();
+  smart_playlists_statistics_keys_.clear();
+  smart_playlists_rating_keys_.clear();
+  ++smart_playlists_generation_;
+
+}
+
+void CollectionBackend::SmartPlaylistsClearStatisticsCache() {
+
+  QMutexLocker l(&smart_playlists_mutex_);
+  for (const QString &cache_key : std::as_const(smart_playlists_statistics_keys_)) {
+    smart_playlists_ids_.remove(cache_key);
+  }
+  smart_playlists_statistics_keys_.clear();
+  ++smart_playlists_statistics_generation_;
+
+}
+
+void CollectionBackend::SmartPlaylistsClearRatingCache() {
+
+  QMutexLocker l(&smart_playlists_mutex_);
+  for (const QString &cache_key : std::as_const(smart_playlists_rating_keys_)) {
+    smart_playlists_ids_.remove(cache_key);
+  }
+  smart_playlists_rating_keys_.clear();
+  ++smart_playlists_rating_generation_;
+
+}
+
 SongList CollectionBackend::SmartPlaylistsGetAllSongs() {
 
   // Get all the songs!
@@ -2043,6 +2303,133 @@ void CollectionBackend::UpdatePlayCount(const QString &artist, const QString &ti
 
 }
 
+void CollectionBackend::StartStatisticsImport() {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Drop anything left from an aborted import.
+  const QStringList queries = QStringList() << QStringLiteral("DROP TABLE IF EXISTS temp.statistics_import_matches")
+                                            << QStringLiteral("DROP TABLE IF EXISTS temp.statistics_import")
+                                            << QStringLiteral("CREATE TEMP TABLE statistics_import (artist TEXT NOT NULL COLLATE NOCASE, album TEXT NOT NULL COLLATE NOCASE, title TEXT NOT NULL COLLATE NOCASE, lastplayed INTEGER NOT NULL, playcount INTEGER NOT NULL)");
+  for (const QString &query : queries) {
+    SqlQuery q(db);
+    q.prepare(query);
+    if (!q.Exec()) {
+      db_->ReportErrors(q);
+      return;
+    }
+  }
+
+}
+
+void CollectionBackend::AddStatisticsImport(const SongList &songs) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  ScopedTransaction transaction(&db);
+
+  SqlQuery q(db);
+  q.prepare(QStringLiteral("INSERT INTO temp.statistics_import (artist, album, title, lastplayed, playcount) VALUES (:artist, :album, :title, :lastplayed, :playcount)"));
+  for (const Song &song : songs) {
+    q.BindValue(QStringLiteral(":artist"), song.artist().trimmed());
+    q.BindValue(QStringLiteral(":album"), song.album().trimmed());
+    q.BindValue(QStringLiteral(":title"), song.title().trimmed());
+    q.BindValue(QStringLiteral(":lastplayed"), song.lastplayed());
+    q.BindValue(QStringLiteral(":playcount"), song.playcount());
+    if (!q.Exec()) {
+      db_->ReportErrors(q);
+      return;
+    }
+  }
+
+  transaction.Commit();
+
+}
+
+void CollectionBackend::FinishStatisticsImport() {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QStringList id_str_list;
+
+  {
+    ScopedTransaction transaction(&db);
+
+    // Match the staged statistics to the songs once, keeping the latest last played time and the highest play count for each song.
+    const QStringList queries = QStringList() << QStringLiteral("CREATE INDEX temp.idx_statistics_import ON statistics_import (artist, title)")
+                                              << QStringLiteral("CREATE TEMP TABLE statistics_import_matches (song_id INTEGER PRIMARY KEY, lastplayed INTEGER NOT NULL, playcount INTEGER NOT NULL)")
+                                              << QStringLiteral("INSERT INTO temp.statistics_import_matches (song_id, lastplayed, playcount) SELECT s.ROWID, MAX(i.lastplayed), MAX(i.playcount) FROM %1 s JOIN temp.statistics_import i ON i.artist = s.artist AND i.title = s.title AND (i.album = '' OR i.album = s.album) GROUP BY s.ROWID").arg(songs_table_);
+    for (const QString &query : queries) {
+      SqlQuery q(db);
+      q.prepare(query);
+      if (!q.Exec()) {
+        db_->ReportErrors(q);
+        return;
+      }
+    }
+
+    {
+      SqlQuery q(db);
+      q.prepare(QStringLiteral("SELECT m.song_id FROM temp.statistics_import_matches m JOIN %1 s ON s.ROWID = m.song_id WHERE m.lastplayed > s.lastplayed OR (m.playcount > 0 AND m.playcount != s.playcount)").arg(songs_table_));
+      if (!q.Exec()) {
+        db_->ReportErrors(q);
+        return;
+      }
+      while (q.next()) {
+        id_str_list << q.value(0).toString();
+      }
+    }
+
+    if (!id_str_list.isEmpty()) {
+      const QStringList update_queries = QStringList() << QStringLiteral("UPDATE %1 SET lastplayed = (SELECT m.lastplayed FROM temp.statistics_import_matches m WHERE m.song_id = %1.ROWID) WHERE lastplayed < (SELECT m.lastplayed FROM temp.statistics_import_matches m WHERE m.song_id = %1.ROWID)").arg(songs_table_)
+                                                       << QStringLiteral("UPDATE %1 SET playcount = (SELECT m.playcount FROM temp.statistics_import_matches m WHERE m.song_id = %1.ROWID) WHERE ROWID IN (SELECT song_id FROM temp.statistics_import_matches WHERE playcount > 0) AND playcount != (SELECT m.playcount FROM temp.statistics_import_matches m WHERE m.song_id = %1.ROWID)").arg(songs_table_);
+      for (const QString &query : update_queries) {
+        SqlQuery q(db);
+        q.prepare(query);
+        if (!q.Exec()) {
+          db_->ReportErrors(q);
+          return;
+        }
+      }
+    }
+
+    transaction.Commit();
+  }
+
+  DropStatisticsImport(db);
+
+  qLog(Debug) << "Updated play statistics for" << id_str_list.count() << "songs";
+
+  if (id_str_list.isEmpty()) return;
+
+  emit SongsStatisticsChanged(GetSongsById(id_str_list, db));
+
+}
+
+void CollectionBackend::AbortStatisticsImport() {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  DropStatisticsImport(db);
+
+}
+
+void CollectionBackend::DropStatisticsImport(QSqlDatabase &db) {
+
+  for (const QString &table : QStringList() << QStringLiteral("statistics_import_matches") << QStringLiteral("statistics_import")) {
+    SqlQuery q(db);
+    q.prepare(QStringLiteral("DROP TABLE IF EXISTS temp.%1").arg(table));
+    if (!q.Exec()) {
+      db_->ReportErrors(q);
+    }
+  }
+
+}
+
 void CollectionBackend::UpdateSongRating(const int id, const float rating, const bool save_tags) {
 
   if (id == -1) return;
@@ -29,10 +29,14 @@
 
 #include <QtGlobal>
 #include <QObject>
+#include <QMutex>
+#include <QCache>
 #include <QFileInfo>
 #include <QList>
 #include <QString>
 #include <QStringList>
+#include <QSet>
+#include <QVariant>
 #include <QUrl>
 #include <QSqlDatabase>
 
@@ -228,10 +232,19 @@ class CollectionBackend : public CollectionBackendInterface {
   SongList GetSongsByFingerprint(const QString &fingerprint) override;
 
   SongList SmartPlaylistsGetAllSongs();
-  SongList SmartPlaylistsFindSongs(const SmartPlaylistSearch &search);
+  // For sorted searches, last_sort_value is set to the sort column value of the last song, so the next page can continue after it.
+  SongList SmartPlaylistsFindSongs(const SmartPlaylistSearch &search, QVariant *last_sort_value = nullptr);
+  // Returns the details of EXPLAIN QUERY PLAN for the search.
+  QStringList SmartPlaylistsQueryPlan(const SmartPlaylistSearch &search);
+  // Returns the IDs of all songs matching the search in no particular order.
+  // The IDs are cached for each search until songs in the collection are changed, searches relative to the current time are not cached.
+  QList<int> SmartPlaylistsFindSongIds(const SmartPlaylistSearch &search);
 
   void AddOrUpdateSongsAsync(const SongList &songs);
+  // Only updates the fingerprint and loudness columns.
+  void UpdateSongsAnalysisAsync(const SongList &songs);
   void UpdateSongsBySongIDAsync(const SongMap &new_songs);
+  void MergeSongsBySongIDAsync(const SongMap &new_songs, const QString &id_column = QString(), const QStringList &keep_ids = QStringList());
 
   void UpdateSongRatingAsync(const int id, const float rating, const bool save_tags = false);
   void UpdateSongsRatingAsync(const QList<int> &ids, const float rating, const bool save_tags = false);
@@ -247,7 +260,9 @@ class CollectionBackend : public CollectionBackendInterface {
   void RemoveDirectory(const CollectionDirectory &dir);
   void AddOrUpdateSongs(const SongList &songs);
   void UpdateSongsBySongID(const SongMap &new_songs);
+  void MergeSongsBySongID(const SongMap &new_songs, const QString &id_column, const QStringList &keep_ids);
   void UpdateMTimesOnly(const SongList &songs);
+  void UpdateSongsAnalysis(const SongList &songs);
   void DeleteSongs(const SongList &songs);
   void MarkSongsUnavailable(const SongList &songs, const bool unavailable = true);
   void AddOrUpdateSubdirs(const CollectionSubdirectoryList &subdirs);
@@ -269,6 +284,14 @@ class CollectionBackend : public CollectionBackendInterface {
   void UpdateLastPlayed(const QString &artist, const QString &album, const QString &title, const qint64 lastplayed);
   void UpdatePlayCount(const QString &artist, const QString &title, const int playcount, const bool save_tags = false);
 
+  // Imported play statistics are staged in a temporary table and applied to the songs in a single transaction when the import is finished.
+  // The songs only need artist, album and title, and lastplayed or playcount set, an empty album matches any album.
+  void StartStatisticsImport();
+  void AddStatisticsImport(const SongList &songs);
+  void FinishStatisticsImport();
+  // Drops the staged statistics without applying them.
+  void AbortStatisticsImport();
+
   void UpdateSongRating(const int id, const float rating, const bool save_tags = false);
   void UpdateSongsRating(const QList<int> &id_list, const float rating, const bool save_tags = false);
 
@@ -296,6 +319,11 @@ class CollectionBackend : public CollectionBackendInterface {
 
   void Error(const QString &error);
 
+ private slots:
+  void SmartPlaylistsClearCache();
+  void SmartPlaylistsClearStatisticsCache();
+  void SmartPlaylistsClearRatingCache();
+
  private:
   struct CompilationInfo {
     CompilationInfo() : has_compilation_detected(0), has_not_compilation_detected(0) {}
@@ -318,6 +346,11 @@ class CollectionBackend : public CollectionBackendInterface {
   Song GetSongBySongId(const QString &song_id, QSqlDatabase &db);
   SongList GetSongsBySongId(const QStringList &song_ids, QSqlDatabase &db);
 
+  QStringList SmartPlaylistsQueryPlan(const SmartPlaylistSearch &search, QSqlDatabase &db);
+  void SmartPlaylistsCheckSortIndex(const SmartPlaylistSearch &search, QSqlDatabase &db);
+
+  void DropStatisticsImport(QSqlDatabase &db);
+
  private:
   SharedPtr<Database> db_;
   SharedPtr<TaskManager> task_manager_;
@@ -326,6 +359,17 @@ class CollectionBackend : public CollectionBackendInterface {
   QString dirs_table_;
   QString subdirs_table_;
   QThread *original_thread_;
+
+  static const int kSmartPlaylistsCacheMaxIds;
+  QMutex smart_playlists_mutex_;
+  QCache<QString, QList<int>> smart_playlists_ids_;
+  quint64 smart_playlists_generation_;
+  quint64 smart_playlists_statistics_generation_;
+  quint64 smart_playlists_rating_generation_;
+  // Cache keys of the searches using the play statistics or the rating.
+  QSet<QString> smart_playlists_statistics_keys_;
+  QSet<QString> smart_playlists_rating_keys_;
+  QSet<QString> smart_playlists_checked_sort_columns_;
 };
 
 #endif  // COLLECTIONBACKEND_H
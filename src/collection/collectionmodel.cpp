@@ -38,6 +38,8 @@
 #include <QList>
 #include <QSet>
 #include <QMap>
+#include <QHash>
+#include <QCache>
 #include <QMetaType>
 #include <QVariant>
 #include <QString>
@@ -46,13 +48,11 @@
 #include <QImage>
 #include <QChar>
 #include <QRegularExpression>
-#include <QPixmapCache>
-#include <QNetworkDiskCache>
 #include <QSettings>
 #include <QStandardPaths>
+#include <QDir>
 #include <QTimer>
 
-#include "core/scoped_ptr.h"
 #include "core/shared_ptr.h"
 #include "core/application.h"
 #include "core/database.h"
@@ -73,15 +73,18 @@
 #include "covermanager/albumcoverloaderoptions.h"
 #include "covermanager/albumcoverloaderresult.h"
 #include "covermanager/albumcoverloader.h"
+#include "covermanager/thumbnailstore.h"
 #include "settings/collectionsettingspage.h"
 
 const int CollectionModel::kPrettyCoverSize = 32;
 namespace {
 constexpr char kPixmapDiskCacheDir[] = "pixmapcache";
+constexpr char kThumbnailStoreFilename[] = "collection-thumbnails.store";
 constexpr char kVariousArtists[] = QT_TR_NOOP("Various artists");
 }  // namespace
 
-QNetworkDiskCache *CollectionModel::sIconCache = nullptr;
+// Shared by all collection models and kept for the lifetime of the process.
+ThumbnailStore *CollectionModel::sThumbnailStore = nullptr;
 
 CollectionModel::CollectionModel(SharedPtr<CollectionBackend> backend, Application *app, QObject *parent)
     : SimpleTreeModel<CollectionItem>(new CollectionItem(this), parent),
@@ -92,6 +95,8 @@ CollectionModel::CollectionModel(SharedPtr<CollectionBackend> backend, Applicati
       timer_reload_(new QTimer(this)),
       timer_update_(new QTimer(this)),
       icon_artist_(IconLoader::Load(QStringLiteral("folder-sound"))),
+      icon_cache_hits_(0),
+      icon_cache_misses_(0),
       use_disk_cache_(false),
       total_song_count_(0),
       total_artist_count_(0),
@@ -114,9 +119,24 @@ CollectionModel::CollectionModel(SharedPtr<CollectionBackend> backend, Applicati
     pixmap_no_cover_ = nocover.pixmap(nocover_sizes.last()).scaled(kPrettyCoverSize, kPrettyCoverSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
   }
 
-  if (app_ && !sIconCache) {
-    sIconCache = new QNetworkDiskCache(this);
-    sIconCache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1Char('/') + QLatin1String(kPixmapDiskCacheDir));
+  if (app_ && !sThumbnailStore) {
+    const QString cache_path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    Settings settings;
+    settings.beginGroup(CollectionSettingsPage::kSettingsGroup);
+    const qint64 max_size = MaximumCacheSize(&settings, CollectionSettingsPage::kSettingsDiskCacheSize, CollectionSettingsPage::kSettingsDiskCacheSizeUnit, CollectionSettingsPage::kSettingsDiskCacheSizeDefault);
+    settings.endGroup();
+    ThumbnailStore *thumbnail_store = new ThumbnailStore(cache_path + QLatin1Char('/') + QLatin1String(kThumbnailStoreFilename), QSize(kPrettyCoverSize, kPrettyCoverSize), max_size);
+    sThumbnailStore = thumbnail_store;
+    // Opening maps and indexes the whole file, so it runs in the background like the thumbnail loads and saves.
+    const QString old_cache_path = cache_path + QLatin1Char('/') + QLatin1String(kPixmapDiskCacheDir);
+    (void)QtConcurrent::run([thumbnail_store, old_cache_path]() {
+      // Thumbnails used to be stored as XPM files in a network disk cache.
+      QDir old_cache_dir(old_cache_path);
+      if (old_cache_dir.exists()) old_cache_dir.removeRecursively();
+      if (!thumbnail_store->Open()) {
+        qLog(Error) << "Failed to open collection thumbnail store";
+      }
+    });
     QObject::connect(app_, &Application::ClearPixmapDiskCache, this, &CollectionModel::ClearDiskCache);
   }
 
@@ -177,6 +197,7 @@ void CollectionModel::Clear() {
   divider_nodes_.clear();
   pending_art_.clear();
   pending_cache_keys_.clear();
+  pending_disk_cache_.clear();
 
 }
 
@@ -205,6 +226,10 @@ void CollectionModel::Reload() {
 
   options_active_ = options_current_;
 
+  if (icon_cache_hits_ + icon_cache_misses_ > 0) {
+    qLog(Debug) << "Collection icon cache for" << Song::TextForSource(backend_->source()) << "hit rate" << icon_cache_hit_rate() << "hits" << icon_cache_hits_ << "misses" << icon_cache_misses_ << "icons" << icon_cache_.count() << "size" << icon_cache_.totalCost() << "KB";
+  }
+
   BeginReset();
   // Show a loading indicator in the model.
   CollectionItem *loading = new CollectionItem(CollectionItem::Type::LoadingIndicator, root_);
@@ -233,9 +258,9 @@ void CollectionModel::ReloadSettings() {
   const bool sort_skips_articles = settings.value("sort_skips_articles", true).toBool();
 
   use_disk_cache_ = settings.value(CollectionSettingsPage::kSettingsDiskCacheEnable, false).toBool();
-  QPixmapCache::setCacheLimit(static_cast<int>(MaximumCacheSize(&settings, CollectionSettingsPage::kSettingsCacheSize, CollectionSettingsPage::kSettingsCacheSizeUnit, CollectionSettingsPage::kSettingsCacheSizeDefault) / 1024));
-  if (sIconCache) {
-    sIconCache->setMaximumCacheSize(MaximumCacheSize(&settings, CollectionSettingsPage::kSettingsDiskCacheSize, CollectionSettingsPage::kSettingsDiskCacheSizeUnit, CollectionSettingsPage::kSettingsDiskCacheSizeDefault));
+  icon_cache_.setMaxCost(static_cast<int>(MaximumCacheSize(&settings, CollectionSettingsPage::kSettingsCacheSize, CollectionSettingsPage::kSettingsCacheSizeUnit, CollectionSettingsPage::kSettingsCacheSizeDefault) / 1024));
+  if (sThumbnailStore) {
+    sThumbnailStore->set_max_size(MaximumCacheSize(&settings, CollectionSettingsPage::kSettingsDiskCacheSize, CollectionSettingsPage::kSettingsDiskCacheSizeUnit, CollectionSettingsPage::kSettingsDiskCacheSizeDefault));
   }
 
   settings.endGroup();
@@ -298,16 +323,9 @@ QVariant CollectionModel::data(const QModelIndex &idx, const int role) const {
   // this is here instead of in the other data() function to let us use the
   // QModelIndex& version of GetChildSongs, which satisfies const-ness, instead
   // of the CollectionItem *version, which doesn't.
-  if (options_active_.show_pretty_covers) {
-    bool is_album_node = false;
-    if (role == Qt::DecorationRole && item->type == CollectionItem::Type::Container) {
-      GroupBy container_group_by = options_active_.group_by[item->container_level];
-      is_album_node = IsAlbumGroupBy(container_group_by);
-    }
-    if (is_album_node) {
-      // It has const behaviour some of the time - that's ok right?
-      return const_cast<CollectionModel*>(this)->AlbumIcon(idx);
-    }
+  if (options_active_.show_pretty_covers && role == Qt::DecorationRole && IsAlbumNode(item)) {
+    // It has const behaviour some of the time - that's ok right?
+    return const_cast<CollectionModel*>(this)->AlbumIcon(idx);
   }
 
   return data(item, role);
@@ -856,6 +874,12 @@ void CollectionModel::LoadSongsFromSqlAsyncFinished() {
 
 }
 
+bool CollectionModel::IsAlbumNode(const CollectionItem *item) const {
+
+  return item && item->type == CollectionItem::Type::Container && IsAlbumGroupBy(options_active_.group_by[item->container_level]);
+
+}
+
 QString CollectionModel::AlbumIconPixmapCacheKey(const QModelIndex &idx) const {
 
   QStringList path;
@@ -869,9 +893,19 @@ QString CollectionModel::AlbumIconPixmapCacheKey(const QModelIndex &idx) const {
 
 }
 
-QUrl CollectionModel::AlbumIconPixmapDiskCacheKey(const QString &cache_key) {
+QImage CollectionModel::LoadAlbumIconFromDiskCache(const quint64 album_key, const quint64 cover_source_hash) {
+
+  if (!sThumbnailStore) return QImage();
 
-  return QUrl(QString::fromLatin1(QUrl::toPercentEncoding(cache_key)));
+  return sThumbnailStore->Get(album_key, cover_source_hash);
+
+}
+
+void CollectionModel::SaveAlbumIconToDiskCache(const quint64 album_key, const quint64 cover_source_hash, const QImage &image) {
+
+  if (!sThumbnailStore) return;
+
+  sThumbnailStore->Put(album_key, cover_source_hash, image);
 
 }
 
@@ -879,21 +913,40 @@ void CollectionModel::ClearItemPixmapCache(CollectionItem *item) {
 
   // Remove from pixmap cache
   const QString cache_key = AlbumIconPixmapCacheKey(ItemToIndex(item));
-  QPixmapCache::remove(cache_key);
-  if (use_disk_cache_ && sIconCache) sIconCache->remove(AlbumIconPixmapDiskCacheKey(cache_key));
+  icon_cache_.remove(cache_key);
   if (pending_cache_keys_.contains(cache_key)) {
     pending_cache_keys_.remove(cache_key);
   }
 
+  // Remove from the thumbnail store, the cover source is the same when a cover file is replaced.
+  if (sThumbnailStore) {
+    CollectionItem *first_song = item;
+    while (first_song->type != CollectionItem::Type::Song && !first_song->children.isEmpty()) {
+      first_song = first_song->children.first();
+    }
+    const Song &song = first_song->type == CollectionItem::Type::Song ? first_song->metadata : item->metadata;
+    if (!song.album().isEmpty()) {
+      sThumbnailStore->Remove(ThumbnailStore::AlbumKey(backend_->source(), song.effective_albumartist(), song.album()));
+    }
+  }
+
   // Remove from pending art loading
-  for (QMap<quint64, ItemAndCacheKey>::iterator it = pending_art_.begin(); it != pending_art_.end();) {
-    if (it.value().first == item) {
+  for (QMap<quint64, PendingAlbumIcon>::iterator it = pending_art_.begin(); it != pending_art_.end();) {
+    if (it.value().item == item) {
       it = pending_art_.erase(it);
     }
     else {
       ++it;
     }
   }
+  for (QHash<QString, CollectionItem*>::iterator it = pending_disk_cache_.begin(); it != pending_disk_cache_.end();) {
+    if (it.key() == cache_key || it.value() == item) {
+      it = pending_disk_cache_.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
 
 }
 
@@ -904,41 +957,113 @@ QVariant CollectionModel::AlbumIcon(const QModelIndex &idx) {
 
   // Check the cache for a pixmap we already loaded.
   const QString cache_key = AlbumIconPixmapCacheKey(idx);
-
-  QPixmap cached_pixmap;
-  if (QPixmapCache::find(cache_key, &cached_pixmap)) {
-    return cached_pixmap;
+  if (QPixmap *cached_pixmap = icon_cache_.object(cache_key)) {
+    ++icon_cache_hits_;
+    return *cached_pixmap;
   }
+  ++icon_cache_misses_;
 
-  // Try to load it from the disk cache
-  if (use_disk_cache_ && sIconCache) {
-    ScopedPtr<QIODevice> disk_cache_img(sIconCache->data(AlbumIconPixmapDiskCacheKey(cache_key)));
-    if (disk_cache_img) {
-      QImage cached_image;
-      if (cached_image.load(&*disk_cache_img, "XPM")) {
-        QPixmapCache::insert(cache_key, QPixmap::fromImage(cached_image));
-        return QPixmap::fromImage(cached_image);
-      }
+  // Nothing is read or decoded here, show the no cover image until the icon is loaded.
+  LoadAlbumIconAsync(idx, item, cache_key);
+
+  return pixmap_no_cover_;
+
+}
+
+void CollectionModel::PrefetchAlbumIcons(const QModelIndexList &indexes) {
+
+  if (!options_active_.show_pretty_covers) return;
+
+  for (const QModelIndex &idx : indexes) {
+    CollectionItem *item = IndexToItem(idx);
+    if (!IsAlbumNode(item)) continue;
+    const QString cache_key = AlbumIconPixmapCacheKey(idx);
+    if (!icon_cache_.contains(cache_key)) {
+      LoadAlbumIconAsync(idx, item, cache_key);
     }
   }
 
+}
+
+void CollectionModel::LoadAlbumIconAsync(const QModelIndex &idx, CollectionItem *item, const QString &cache_key) {
+
   // Maybe we're loading a pixmap already?
-  if (pending_cache_keys_.contains(cache_key)) {
-    return pixmap_no_cover_;
+  if (pending_cache_keys_.contains(cache_key)) return;
+
+  // Load art for the first song in the album.
+  const SongList songs = GetChildSongs(idx);
+  if (songs.isEmpty()) return;
+  const Song song = songs.first();
+
+  pending_cache_keys_.insert(cache_key);
+
+  // Try the disk cache first, the cover is loaded if it's not there.
+  if (use_disk_cache_ && sThumbnailStore) {
+    pending_disk_cache_.insert(cache_key, item);
+    const quint64 album_key = ThumbnailStore::AlbumKey(backend_->source(), song.effective_albumartist(), song.album());
+    QFuture<QImage> future = QtConcurrent::run(&CollectionModel::LoadAlbumIconFromDiskCache, album_key, ThumbnailStore::CoverSourceHash(song));
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    QObject::connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, cache_key, song]() {
+      const QImage image = watcher->result();
+      watcher->deleteLater();
+      AlbumIconDiskCacheLoaded(cache_key, song, image);
+    });
+    watcher->setFuture(future);
+    return;
   }
 
-  // No art is cached and we're not loading it already.  Load art for the first song in the album.
-  SongList songs = GetChildSongs(idx);
-  if (!songs.isEmpty()) {
-    AlbumCoverLoaderOptions cover_loader_options(AlbumCoverLoaderOptions::Option::ScaledImage | AlbumCoverLoaderOptions::Option::PadScaledImage);
-    cover_loader_options.desired_scaled_size = QSize(kPrettyCoverSize, kPrettyCoverSize);
-    cover_loader_options.types = cover_types_;
-    const quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options, songs.first());
-    pending_art_[id] = ItemAndCacheKey(item, cache_key);
-    pending_cache_keys_.insert(cache_key);
+  LoadAlbumCover(item, cache_key, song);
+
+}
+
+void CollectionModel::AlbumIconDiskCacheLoaded(const QString &cache_key, const Song &song, const QImage &image) {
+
+  // The item was removed or the icon invalidated while we were reading the disk cache.
+  CollectionItem *item = pending_disk_cache_.take(cache_key);
+  if (!item) return;
+
+  if (image.isNull()) {
+    LoadAlbumCover(item, cache_key, song);
+    return;
   }
 
-  return pixmap_no_cover_;
+  pending_cache_keys_.remove(cache_key);
+  InsertAlbumIcon(cache_key, QPixmap::fromImage(image));
+
+  const QModelIndex idx = ItemToIndex(item);
+  if (!idx.isValid()) return;
+
+  emit dataChanged(idx, idx);
+
+}
+
+void CollectionModel::LoadAlbumCover(CollectionItem *item, const QString &cache_key, const Song &song) {
+
+  AlbumCoverLoaderOptions cover_loader_options(AlbumCoverLoaderOptions::Option::ScaledImage | AlbumCoverLoaderOptions::Option::PadScaledImage);
+  cover_loader_options.desired_scaled_size = QSize(kPrettyCoverSize, kPrettyCoverSize);
+  cover_loader_options.types = cover_types_;
+  const quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options, song);
+  pending_art_[id] = PendingAlbumIcon{ item, cache_key, ThumbnailStore::AlbumKey(backend_->source(), song.effective_albumartist(), song.album()), ThumbnailStore::CoverSourceHash(song) };
+
+}
+
+void CollectionModel::InsertAlbumIcon(const QString &cache_key, const QPixmap &pixmap) {
+
+  const qint64 size_kb = static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8 / 1024;
+  icon_cache_.insert(cache_key, new QPixmap(pixmap), static_cast<int>(qMax(1LL, size_kb)));
+
+}
+
+double CollectionModel::icon_cache_hit_rate() const {
+
+  const quint64 lookups = icon_cache_hits_ + icon_cache_misses_;
+  return lookups == 0 ? 0.0 : static_cast<double>(icon_cache_hits_) / static_cast<double>(lookups);
+
+}
+
+quint64 CollectionModel::icon_cache_disk_size() {
+
+  return sThumbnailStore ? static_cast<quint64>(sThumbnailStore->file_size()) : 0;
 
 }
 
@@ -946,41 +1071,25 @@ void CollectionModel::AlbumCoverLoaded(const quint64 id, const AlbumCoverLoaderR
 
   if (!pending_art_.contains(id)) return;
 
-  ItemAndCacheKey item_and_cache_key = pending_art_.take(id);
-  CollectionItem *item = item_and_cache_key.first;
+  const PendingAlbumIcon pending_album_icon = pending_art_.take(id);
+  CollectionItem *item = pending_album_icon.item;
   if (!item) return;
 
-  const QString &cache_key = item_and_cache_key.second;
+  const QString &cache_key = pending_album_icon.cache_key;
 
   pending_cache_keys_.remove(cache_key);
 
   // Insert this image in the cache.
   if (!result.success || result.image_scaled.isNull() || result.type == AlbumCoverLoaderResult::Type::Unset) {
     // Set the no_cover image so we don't continually try to load art.
-    QPixmapCache::insert(cache_key, pixmap_no_cover_);
+    InsertAlbumIcon(cache_key, pixmap_no_cover_);
   }
   else {
-    QPixmap image_pixmap;
-    image_pixmap = QPixmap::fromImage(result.image_scaled);
-    QPixmapCache::insert(cache_key, image_pixmap);
-  }
-
-  // If we have a valid cover not already in the disk cache
-  if (use_disk_cache_ && sIconCache && result.success && !result.image_scaled.isNull()) {
-    const QUrl disk_cache_key = AlbumIconPixmapDiskCacheKey(cache_key);
-    ScopedPtr<QIODevice> disk_cache_img(sIconCache->data(disk_cache_key));
-    if (!disk_cache_img) {
-      QNetworkCacheMetaData disk_cache_metadata;
-      disk_cache_metadata.setSaveToDisk(true);
-      disk_cache_metadata.setUrl(disk_cache_key);
-      // Qt 6 now ignores any entry without headers, so add a fake header.
-      disk_cache_metadata.setRawHeaders(QNetworkCacheMetaData::RawHeaderList() << qMakePair(QByteArray("collection-thumbnail"), cache_key.toUtf8()));
-      QIODevice *device_iconcache = sIconCache->prepare(disk_cache_metadata);
-      if (device_iconcache) {
-        result.image_scaled.save(device_iconcache, "XPM");
-        sIconCache->insert(device_iconcache);
-      }
-    }
+    InsertAlbumIcon(cache_key, QPixmap::fromImage(result.image_scaled));
+  }
+
+  if (use_disk_cache_ && sThumbnailStore && result.success && !result.image_scaled.isNull()) {
+    (void)QtConcurrent::run(&CollectionModel::SaveAlbumIconToDiskCache, pending_album_icon.album_key, pending_album_icon.cover_source_hash, result.image_scaled);
   }
 
   const QModelIndex idx = ItemToIndex(item);
@@ -1534,7 +1643,7 @@ void CollectionModel::TotalAlbumCountUpdatedSlot(const int count) {
 }
 
 void CollectionModel::ClearDiskCache() {
-  if (sIconCache) sIconCache->clear();
+  if (sThumbnailStore) sThumbnailStore->Clear();
 }
 
 void CollectionModel::ExpandAll(CollectionItem *item) const {
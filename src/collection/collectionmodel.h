@@ -34,6 +34,8 @@
 #include <QSet>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QCache>
 #include <QVariant>
 #include <QString>
 #include <QStringList>
@@ -41,7 +43,6 @@
 #include <QImage>
 #include <QIcon>
 #include <QPixmap>
-#include <QNetworkDiskCache>
 #include <QQueue>
 
 #include "core/shared_ptr.h"
@@ -61,6 +62,7 @@ class Application;
 class CollectionBackend;
 class CollectionDirectoryModel;
 class CollectionFilter;
+class ThumbnailStore;
 
 class CollectionModel : public SimpleTreeModel<CollectionItem> {
   Q_OBJECT
@@ -155,7 +157,10 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   int total_artist_count() const { return total_artist_count_; }
   int total_album_count() const { return total_album_count_; }
 
-  quint64 icon_cache_disk_size() { return sIconCache->cacheSize(); }
+  quint64 icon_cache_disk_size();
+  quint64 icon_cache_hits() const { return icon_cache_hits_; }
+  quint64 icon_cache_misses() const { return icon_cache_misses_; }
+  double icon_cache_hit_rate() const;
 
   const CollectionModel::Grouping GetGroupBy() const { return options_current_.group_by; }
   void SetGroupBy(const CollectionModel::Grouping g, const std::optional<bool> separate_albums_by_grouping = std::optional<bool>());
@@ -200,6 +205,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
 
   void ExpandAll(CollectionItem *item = nullptr) const;
 
+  // Starts loading the album icons for the indexes not in the icon cache, used for rows about to be scrolled into view.
+  void PrefetchAlbumIcons(const QModelIndexList &indexes);
+
  signals:
   void TotalSongCountUpdated(const int count);
   void TotalArtistCountUpdated(const int count);
@@ -246,9 +254,15 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
 
   // Helpers
   static bool IsCompilationArtistNode(const CollectionItem *node) { return node == node->parent->compilation_artist_node_; }
+  bool IsAlbumNode(const CollectionItem *item) const;
   QString AlbumIconPixmapCacheKey(const QModelIndex &idx) const;
-  static QUrl AlbumIconPixmapDiskCacheKey(const QString &cache_key);
+  static QImage LoadAlbumIconFromDiskCache(const quint64 album_key, const quint64 cover_source_hash);
+  static void SaveAlbumIconToDiskCache(const quint64 album_key, const quint64 cover_source_hash, const QImage &image);
   QVariant AlbumIcon(const QModelIndex &idx);
+  void LoadAlbumIconAsync(const QModelIndex &idx, CollectionItem *item, const QString &cache_key);
+  void LoadAlbumCover(CollectionItem *item, const QString &cache_key, const Song &song);
+  void AlbumIconDiskCacheLoaded(const QString &cache_key, const Song &song, const QImage &image);
+  void InsertAlbumIcon(const QString &cache_key, const QPixmap &pixmap);
   void ClearItemPixmapCache(CollectionItem *item);
   bool CompareItems(const CollectionItem *a, const CollectionItem *b) const;
   static qint64 MaximumCacheSize(Settings *s, const char *size_id, const char *size_unit_id, const qint64 cache_size_default);
@@ -271,7 +285,7 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   void RowsRemoved(const QModelIndex &parent, const int first, const int last);
 
  private:
-  static QNetworkDiskCache *sIconCache;
+  static ThumbnailStore *sThumbnailStore;
   SharedPtr<CollectionBackend> backend_;
   Application *app_;
   CollectionDirectoryModel *dir_model_;
@@ -280,6 +294,11 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   QTimer *timer_update_;
 
   QPixmap pixmap_no_cover_;
+
+  // Decoded album icons, the cost is the size in KB.
+  QCache<QString, QPixmap> icon_cache_;
+  quint64 icon_cache_hits_;
+  quint64 icon_cache_misses_;
   QIcon icon_artist_;
 
   Options options_current_;
@@ -305,9 +324,15 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   // Keyed on a letter, a year, a century, etc.
   QMap<QString, CollectionItem*> divider_nodes_;
 
-  using ItemAndCacheKey = QPair<CollectionItem*, QString>;
-  QMap<quint64, ItemAndCacheKey> pending_art_;
+  struct PendingAlbumIcon {
+    CollectionItem *item;
+    QString cache_key;
+    quint64 album_key;
+    quint64 cover_source_hash;
+  };
+  QMap<quint64, PendingAlbumIcon> pending_art_;
   QSet<QString> pending_cache_keys_;
+  QHash<QString, CollectionItem*> pending_disk_cache_;
 };
 
 Q_DECLARE_METATYPE(CollectionModel::Grouping)
@@ -46,6 +46,8 @@
 #include <QAction>
 #include <QMessageBox>
 #include <QSettings>
+#include <QScrollBar>
+#include <QTimer>
 #include <QtEvents>
 
 #include "core/application.h"
@@ -79,6 +81,7 @@ CollectionView::CollectionView(QWidget *parent)
     : AutoExpandingTreeView(parent),
       app_(nullptr),
       filter_(nullptr),
+      timer_prefetch_icons_(new QTimer(this)),
       total_song_count_(-1),
       total_artist_count_(-1),
       total_album_count_(-1),
@@ -114,6 +117,13 @@ CollectionView::CollectionView(QWidget *parent)
 
   setStyleSheet(QStringLiteral("QTreeView::item{padding-top:1px;}"));
 
+  // Wait for scrolling to settle, so we don't load icons for rows that are only scrolled past.
+  timer_prefetch_icons_->setSingleShot(true);
+  timer_prefetch_icons_->setInterval(100);
+  QObject::connect(timer_prefetch_icons_, &QTimer::timeout, this, &CollectionView::PrefetchAlbumIcons);
+  QObject::connect(verticalScrollBar(), &QScrollBar::valueChanged, timer_prefetch_icons_, QOverload<>::of(&QTimer::start));
+  QObject::connect(this, &CollectionView::expanded, timer_prefetch_icons_, QOverload<>::of(&QTimer::start));
+
 }
 
 CollectionView::~CollectionView() = default;
@@ -692,6 +702,36 @@ void CollectionView::scrollTo(const QModelIndex &idx, ScrollHint hint) {
 
 }
 
+void CollectionView::PrefetchAlbumIcons() {
+
+  QSortFilterProxyModel *proxy_model = qobject_cast<QSortFilterProxyModel*>(model());
+  if (!proxy_model) return;
+  CollectionModel *collection_model = qobject_cast<CollectionModel*>(proxy_model->sourceModel());
+  if (!collection_model) return;
+
+  const QModelIndex first_visible = indexAt(QPoint(0, 0));
+  if (!first_visible.isValid()) return;
+
+  // The visible rows are loaded when they are painted, prefetch one page above and below them.
+  const int page_rows = qMax(1, viewport()->height() / qMax(1, rowHeight(first_visible)));
+
+  QModelIndexList indexes;
+  QModelIndex idx = first_visible;
+  for (int i = 0; i < page_rows && idx.isValid(); ++i) {
+    idx = indexAbove(idx);
+    if (idx.isValid()) indexes << proxy_model->mapToSource(idx);
+  }
+
+  idx = indexAt(QPoint(0, viewport()->height() - 1));
+  for (int i = 0; i < page_rows && idx.isValid(); ++i) {
+    idx = indexBelow(idx);
+    if (idx.isValid()) indexes << proxy_model->mapToSource(idx);
+  }
+
+  collection_model->PrefetchAlbumIcons(indexes);
+
+}
+
 SongList CollectionView::GetSelectedSongs() const {
 
   QModelIndexList selected_indexes = qobject_cast<QSortFilterProxyModel*>(model())->mapSelectionToSource(selectionModel()->selection()).indexes();
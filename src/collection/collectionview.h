@@ -41,6 +41,7 @@ class QAction;
 class QContextMenuEvent;
 class QMouseEvent;
 class QPaintEvent;
+class QTimer;
 
 class Application;
 class CollectionFilterWidget;
@@ -113,6 +114,7 @@ class CollectionView : public AutoExpandingTreeView {
   void NoShowInVarious();
   void Delete();
   void DeleteFilesFinished(const SongList &songs_with_errors);
+  void PrefetchAlbumIcons();
 
  private:
   void RecheckIsEmpty();
@@ -123,6 +125,7 @@ class CollectionView : public AutoExpandingTreeView {
  private:
   Application *app_;
   CollectionFilterWidget *filter_;
+  QTimer *timer_prefetch_icons_;
 
   int total_song_count_;
   int total_artist_count_;
@@ -113,6 +113,9 @@
 #include "dialogs/errordialog.h"
 #include "dialogs/about.h"
 #include "dialogs/console.h"
+#ifdef HAVE_GSTREAMER
+#  include "dialogs/pipelinemetricsdialog.h"
+#endif
 #include "dialogs/trackselectiondialog.h"
 #include "dialogs/edittagdialog.h"
 #include "dialogs/addstreamdialog.h"
@@ -204,6 +207,7 @@
 
 #ifdef HAVE_MOODBAR
 #  include "moodbar/moodbarcontroller.h"
+#  include "moodbar/moodbarloader.h"
 #  include "moodbar/moodbarproxystyle.h"
 #endif
 
@@ -298,6 +302,10 @@ MainWindow::MainWindow(Application *app, SharedPtr<SystemTrayIcon> tray_icon, OS
         TranscodeDialog *dialog = new TranscodeDialog(this);
         return dialog;
       }),
+      pipeline_metrics_dialog_([app]() {
+        PipelineMetricsDialog *dialog = new PipelineMetricsDialog(app);
+        return dialog;
+      }),
 #endif
       add_stream_dialog_([this]() {
         AddStreamDialog *add_stream_dialog = new AddStreamDialog;
@@ -490,6 +498,7 @@ MainWindow::MainWindow(Application *app, SharedPtr<SystemTrayIcon> tray_icon, OS
   ui_->action_update_collection->setIcon(IconLoader::Load(QStringLiteral("view-refresh")));
   ui_->action_full_collection_scan->setIcon(IconLoader::Load(QStringLiteral("view-refresh")));
   ui_->action_abort_collection_scan->setIcon(IconLoader::Load(QStringLiteral("dialog-error")));
+  ui_->action_analyze_collection->setIcon(IconLoader::Load(QStringLiteral("view-refresh")));
   ui_->action_settings->setIcon(IconLoader::Load(QStringLiteral("configure")));
   ui_->action_import_data_from_last_fm->setIcon(IconLoader::Load(QStringLiteral("scrobble")));
   ui_->action_console->setIcon(IconLoader::Load(QStringLiteral("keyboard")));
@@ -556,6 +565,12 @@ MainWindow::MainWindow(Application *app, SharedPtr<SystemTrayIcon> tray_icon, OS
   QObject::connect(ui_->action_update_collection, &QAction::triggered, &*app_->collection(), &SCollection::IncrementalScan);
   QObject::connect(ui_->action_full_collection_scan, &QAction::triggered, &*app_->collection(), &SCollection::FullScan);
   QObject::connect(ui_->action_abort_collection_scan, &QAction::triggered, &*app_->collection(), &SCollection::AbortScan);
+  QObject::connect(ui_->action_abort_collection_scan, &QAction::triggered, &*app_->collection(), &SCollection::AbortAnalyzeSongs);
+#if defined(HAVE_GSTREAMER)
+  QObject::connect(ui_->action_analyze_collection, &QAction::triggered, &*app_->collection(), &SCollection::AnalyzeSongsAsync);
+#else
+  ui_->action_analyze_collection->setDisabled(true);
+#endif
 #if defined(HAVE_GSTREAMER)
   QObject::connect(ui_->action_add_files_to_transcoder, &QAction::triggered, this, &MainWindow::AddFilesToTranscoder);
   ui_->action_add_files_to_transcoder->setIcon(IconLoader::Load(QStringLiteral("tools-wizard")));
@@ -870,6 +885,10 @@ MainWindow::MainWindow(Application *app, SharedPtr<SystemTrayIcon> tray_icon, OS
 #ifdef HAVE_MOODBAR
   // Moodbar connections
   QObject::connect(&*app_->moodbar_controller(), &MoodbarController::CurrentMoodbarDataChanged, ui_->track_slider->moodbar_style(), &MoodbarProxyStyle::SetMoodbarData);
+  QObject::connect(ui_->action_generate_moodbars, &QAction::triggered, &*app_->moodbar_loader(), &MoodbarLoader::GenerateAllAsync);
+  QObject::connect(ui_->action_abort_collection_scan, &QAction::triggered, &*app_->moodbar_loader(), &MoodbarLoader::AbortGenerateAll);
+#else
+  ui_->action_generate_moodbars->setVisible(false);
 #endif
 
   // Playing widget
@@ -885,6 +904,11 @@ MainWindow::MainWindow(Application *app, SharedPtr<SystemTrayIcon> tray_icon, OS
   QObject::connect(this, &MainWindow::SearchCoverInProgress, ui_->widget_playing, &PlayingWidget::SearchCoverInProgress);
 
   QObject::connect(ui_->action_console, &QAction::triggered, this, &MainWindow::ShowConsole);
+#ifdef HAVE_GSTREAMER
+  QObject::connect(ui_->action_pipeline_metrics, &QAction::triggered, this, &MainWindow::ShowPipelineMetrics);
+#else
+  ui_->action_pipeline_metrics->setVisible(false);
+#endif
   PlayingWidgetPositionChanged(ui_->widget_playing->show_above_status_bar());
 
   StyleSheetLoader *css_loader = new StyleSheetLoader(this);
@@ -2947,6 +2971,15 @@ void MainWindow::ShowTranscodeDialog() {
 
 }
 
+void MainWindow::ShowPipelineMetrics() {
+
+#ifdef HAVE_GSTREAMER
+  pipeline_metrics_dialog_->show();
+  pipeline_metrics_dialog_->raise();
+#endif
+
+}
+
 void MainWindow::ShowErrorDialog(const QString &message) {
   error_dialog_->ShowMessage(message);
 }
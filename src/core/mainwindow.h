@@ -64,6 +64,7 @@
 
 class About;
 class Console;
+class PipelineMetricsDialog;
 class AlbumCoverManager;
 class Application;
 class ContextView;
@@ -248,6 +249,7 @@ class MainWindow : public QMainWindow, public PlatformInterface {
   void HandleNotificationPreview(const OSDBase::Behaviour type, const QString &line1, const QString &line2);
 
   void ShowConsole();
+  void ShowPipelineMetrics();
 
   void LoadCoverFromFile();
   void SaveCoverToFile();
@@ -330,6 +332,7 @@ class MainWindow : public QMainWindow, public PlatformInterface {
   Lazy<OrganizeDialog> organize_dialog_;
 #ifdef HAVE_GSTREAMER
   Lazy<TranscodeDialog> transcode_dialog_;
+  Lazy<PipelineMetricsDialog> pipeline_metrics_dialog_;
 #endif
   Lazy<AddStreamDialog> add_stream_dialog_;
 
@@ -21,12 +21,15 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #include <QtGlobal>
 #include <QObject>
 #include <QCoreApplication>
 #include <QIODevice>
 #include <QByteArray>
 #include <QString>
+#include <QDateTime>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -68,3 +71,24 @@ QNetworkReply *NetworkAccessManager::createRequest(Operation op, const QNetworkR
   return QNetworkAccessManager::createRequest(op, new_request, outgoingData);
 
 }
+
+qint64 NetworkAccessManager::RetryAfterMsec(const QNetworkReply *reply) {
+
+  if (!reply->hasRawHeader("Retry-After")) return 0;
+
+  // Retry-After is either a number of seconds or a HTTP date.
+  const QByteArray retry_after = reply->rawHeader("Retry-After").trimmed();
+  bool ok = false;
+  const int seconds = retry_after.toInt(&ok);
+  if (ok) {
+    return std::max(0LL, static_cast<qint64>(seconds) * 1000);
+  }
+
+  const QDateTime retry_after_date = QDateTime::fromString(QString::fromLatin1(retry_after), Qt::RFC2822Date);
+  if (retry_after_date.isValid()) {
+    return std::max(0LL, QDateTime::currentDateTime().msecsTo(retry_after_date));
+  }
+
+  return 0;
+
+}
@@ -38,6 +38,9 @@ class NetworkAccessManager : public QNetworkAccessManager {
  public:
   explicit NetworkAccessManager(QObject *parent = nullptr);
 
+  // Returns the time the server asked us to wait in the Retry-After header, or 0 if there is none.
+  static qint64 RetryAfterMsec(const QNetworkReply *reply);
+
  protected:
   QNetworkReply *createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData) override;
 };
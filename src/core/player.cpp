@@ -30,6 +30,7 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QMap>
+#include <QList>
 #include <QVariant>
 #include <QString>
 #include <QUrl>
@@ -74,6 +75,7 @@ using namespace std::chrono_literals;
 using std::make_shared;
 
 const char *Player::kSettingsGroup = "Player";
+const int Player::kStreamUrlPrefetchCount = 2;
 
 Player::Player(Application *app, QObject *parent)
     : PlayerInterface(parent),
@@ -722,6 +724,8 @@ void Player::PlayAt(const int index, const quint64 offset_nanosec, EngineBase::T
   pause_time_ = QDateTime();
   play_offset_nanosec_ = offset_nanosec;
 
+  engine_->TrackChangeRequested();
+
   if (current_item_ && change & EngineBase::TrackChangeType::Manual && engine_->position_nanosec() != engine_->length_nanosec()) {
     emit TrackSkipped(current_item_);
   }
@@ -756,6 +760,47 @@ void Player::PlayAt(const int index, const quint64 offset_nanosec, EngineBase::T
     engine_->Play(current_item_->Url(), url, change, current_item_->Metadata().has_cue(), current_item_->effective_beginning_nanosec(), current_item_->effective_end_nanosec(), offset_nanosec, current_item_->effective_ebur128_integrated_loudness_lufs());
   }
 
+  PrepareStandby();
+  PrefetchStreamUrls();
+
+}
+
+void Player::PrepareStandby() {
+
+  Playlist *playlist = app_->playlist_manager()->active();
+  if (!playlist) return;
+
+  // The current track's pipeline is reused when repeating it.
+  if (playlist->RepeatMode() == PlaylistSequence::RepeatMode::Track) return;
+
+  // next_row() can reshuffle the playlist, only peek at the next row.
+  const QList<int> rows = playlist->upcoming_rows(1);
+  if (rows.isEmpty() || !playlist->has_item_at(rows.first())) return;
+
+  PlaylistItemPtr next_item = playlist->item_at(rows.first());
+  const QUrl url = next_item->StreamUrl();
+
+  // URL handlers resolve to stream URLs that can expire, so only prepare tracks that can be opened directly.
+  if (url_handlers_.contains(url.scheme()) || next_item->Metadata().is_module_music()) return;
+
+  engine_->PrepareStandby(next_item->Url(), url, next_item->Metadata().has_cue(), next_item->effective_beginning_nanosec(), next_item->effective_end_nanosec());
+
+}
+
+void Player::PrefetchStreamUrls() {
+
+  Playlist *playlist = app_->playlist_manager()->active();
+  if (!playlist) return;
+
+  const QList<int> rows = playlist->upcoming_rows(kStreamUrlPrefetchCount);
+  for (const int row : rows) {
+    if (!playlist->has_item_at(row)) continue;
+    const QUrl url = playlist->item_at(row)->StreamUrl();
+    if (url_handlers_.contains(url.scheme()) && !loading_async_.contains(url)) {
+      url_handlers_[url.scheme()]->Prefetch(url);
+    }
+  }
+
 }
 
 void Player::CurrentMetadataChanged(const Song &metadata) {
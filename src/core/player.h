@@ -133,6 +133,7 @@ class Player : public PlayerInterface {
   explicit Player(Application *app, QObject *parent = nullptr);
 
   static const char *kSettingsGroup;
+  static const int kStreamUrlPrefetchCount;
 
   EngineBase::Type CreateEngine(EngineBase::Type Type);
   void Init();
@@ -216,6 +217,11 @@ class Player : public PlayerInterface {
 
   void UnPause();
 
+  // Lets the engine prepare the next track in the playlist in case the user skips to it.
+  void PrepareStandby();
+  // Lets URL handlers resolve the stream URLs of the next few tracks before they're played.
+  void PrefetchStreamUrls();
+
  private:
   Application *app_;
   SharedPtr<EngineBase> engine_;
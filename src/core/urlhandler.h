@@ -90,6 +90,9 @@ class UrlHandler : public QObject {
   // Called by the Player when a song starts loading - gives the handler a chance to do something clever to get a playable track.
   virtual LoadResult StartLoading(const QUrl &url) { return LoadResult(url); }
 
+  // Called by the Player for upcoming playlist items, so the handler can resolve the URL before StartLoading() is called for it.
+  virtual void Prefetch(const QUrl &url) { Q_UNUSED(url); }
+
  signals:
   void AsyncLoadComplete(const UrlHandler::LoadResult &result);
 
@@ -97,6 +97,7 @@ AlbumCoverExport::DialogResult AlbumCoverExport::Exec() {
     result.height_ = height.toInt();
     result.export_downloaded_ = ui_->export_downloaded->isChecked();
     result.export_embedded_ = ui_->export_embedded->isChecked();
+    result.threads_ = s.value("threads", 0).toInt();
   }
 
   return result;
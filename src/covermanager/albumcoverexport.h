@@ -46,7 +46,7 @@ class AlbumCoverExport : public QDialog {
   };
 
   struct DialogResult {
-    DialogResult() : cancelled_(false), export_downloaded_(false), export_embedded_(false), forcesize_(false), width_(0), height_(0) {}
+    DialogResult() : cancelled_(false), export_downloaded_(false), export_embedded_(false), forcesize_(false), width_(0), height_(0), threads_(0) {}
     bool cancelled_;
 
     bool export_downloaded_;
@@ -57,6 +57,8 @@ class AlbumCoverExport : public QDialog {
     bool forcesize_;
     int width_;
     int height_;
+    // Number of covers exported at the same time, 0 uses one thread per core.
+    int threads_;
 
     bool IsSizeForced() const {
       return forcesize_ && width_ > 0 && height_ > 0;
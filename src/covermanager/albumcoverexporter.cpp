@@ -20,28 +20,41 @@
 
 #include "config.h"
 
+#include <algorithm>
+
+#include <QtGlobal>
 #include <QObject>
+#include <QThread>
 #include <QThreadPool>
 
+#include "core/logging.h"
 #include "core/song.h"
+#include "utilities/strutils.h"
 #include "albumcoverloaderoptions.h"
 #include "albumcoverexport.h"
 #include "albumcoverexporter.h"
 #include "coverexportrunnable.h"
 
-const int AlbumCoverExporter::kMaxConcurrentRequests = 3;
-
 AlbumCoverExporter::AlbumCoverExporter(QObject *parent)
     : QObject(parent),
       thread_pool_(new QThreadPool(this)),
+      running_(0),
       exported_(0),
       skipped_(0),
-      all_(0) {
-  thread_pool_->setMaxThreadCount(kMaxConcurrentRequests);
+      all_(0),
+      bytes_written_(0) {
+
+  thread_pool_->setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+
 }
 
 void AlbumCoverExporter::SetDialogResult(const AlbumCoverExport::DialogResult &dialog_result) {
+
   dialog_result_ = dialog_result;
+
+  // Exporting is mostly disk bound, so don't use more threads than cores unless configured.
+  thread_pool_->setMaxThreadCount(dialog_result_.threads_ > 0 ? dialog_result_.threads_ : std::max(1, QThread::idealThreadCount()));
+
 }
 
 void AlbumCoverExporter::SetCoverTypes(const AlbumCoverLoaderOptions::Types &cover_types) {
@@ -55,41 +68,64 @@ void AlbumCoverExporter::AddExportRequest(const Song &song) {
 
 }
 
-void AlbumCoverExporter::Cancel() { requests_.clear(); }
+void AlbumCoverExporter::Cancel() {
+
+  qDeleteAll(requests_);
+  requests_.clear();
+
+}
 
 void AlbumCoverExporter::StartExporting() {
 
   exported_ = 0;
   skipped_ = 0;
+  bytes_written_ = 0;
+  timer_elapsed_.start();
   AddJobsToPool();
 
 }
 
 void AlbumCoverExporter::AddJobsToPool() {
 
-  while (!requests_.isEmpty() && thread_pool_->activeThreadCount() < thread_pool_->maxThreadCount()) {
+  // Keep one job queued in the pool for each thread, so a thread doesn't wait for the event loop to get the next job.
+  while (!requests_.isEmpty() && running_ < thread_pool_->maxThreadCount() * 2) {
     CoverExportRunnable *runnable = requests_.dequeue();
 
     QObject::connect(runnable, &CoverExportRunnable::CoverExported, this, &AlbumCoverExporter::CoverExported);
     QObject::connect(runnable, &CoverExportRunnable::CoverSkipped, this, &AlbumCoverExporter::CoverSkipped);
 
+    ++running_;
     thread_pool_->start(runnable);
   }
 
 }
 
-void AlbumCoverExporter::CoverExported() {
+void AlbumCoverExporter::CoverExported(const qint64 bytes) {
 
   ++exported_;
-  emit AlbumCoversExportUpdate(exported_, skipped_, all_);
-  AddJobsToPool();
+  bytes_written_ += bytes;
+  JobFinished();
 
 }
 
 void AlbumCoverExporter::CoverSkipped() {
 
   ++skipped_;
-  emit AlbumCoversExportUpdate(exported_, skipped_, all_);
+  JobFinished();
+
+}
+
+void AlbumCoverExporter::JobFinished() {
+
+  --running_;
+
+  const qint64 elapsed_msec = timer_elapsed_.elapsed();
+  emit AlbumCoversExportUpdate(exported_, skipped_, all_, bytes_written_, elapsed_msec);
+
+  if (exported_ + skipped_ >= all_) {
+    qLog(Info) << "Exported" << exported_ << "covers," << skipped_ << "skipped," << Utilities::PrettySize(static_cast<quint64>(bytes_written_)) << "written in" << elapsed_msec << "ms using" << thread_pool_->maxThreadCount() << "threads";
+  }
+
   AddJobsToPool();
 
 }
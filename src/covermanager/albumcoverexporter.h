@@ -23,9 +23,11 @@
 
 #include "config.h"
 
+#include <QtGlobal>
 #include <QObject>
 #include <QQueue>
 #include <QString>
+#include <QElapsedTimer>
 
 #include "albumcoverloaderoptions.h"
 #include "albumcoverexport.h"
@@ -40,8 +42,6 @@ class AlbumCoverExporter : public QObject {
  public:
   explicit AlbumCoverExporter(QObject *parent = nullptr);
 
-  static const int kMaxConcurrentRequests;
-
   void SetDialogResult(const AlbumCoverExport::DialogResult &dialog_result);
   void SetCoverTypes(const AlbumCoverLoaderOptions::Types &cover_types);
   void AddExportRequest(const Song &song);
@@ -51,14 +51,15 @@ class AlbumCoverExporter : public QObject {
   int request_count() { return static_cast<int>(requests_.size()); }
 
  signals:
-  void AlbumCoversExportUpdate(const int exported, const int skipped, const int all);
+  void AlbumCoversExportUpdate(const int exported, const int skipped, const int all, const qint64 bytes_written, const qint64 elapsed_msec);
 
  private slots:
-  void CoverExported();
+  void CoverExported(const qint64 bytes);
   void CoverSkipped();
 
  private:
   void AddJobsToPool();
+  void JobFinished();
 
   AlbumCoverLoaderOptions::Types cover_types_;
   AlbumCoverExport::DialogResult dialog_result_;
@@ -66,9 +67,12 @@ class AlbumCoverExporter : public QObject {
   QQueue<CoverExportRunnable*> requests_;
   QThreadPool *thread_pool_;
 
+  int running_;
   int exported_;
   int skipped_;
   int all_;
+  qint64 bytes_written_;
+  QElapsedTimer timer_elapsed_;
 };
 
 #endif  // ALBUMCOVEREXPORTER_H
@@ -36,7 +36,8 @@
 
 using namespace std::chrono_literals;
 
-const int AlbumCoverFetcher::kMaxConcurrentRequests = 5;
+// The requests to each provider are limited by the CoverProviderScheduler.
+const int AlbumCoverFetcher::kMaxConcurrentRequests = 20;
 
 AlbumCoverFetcher::AlbumCoverFetcher(SharedPtr<CoverProviders> cover_providers, SharedPtr<NetworkAccessManager> network, QObject *parent)
     : QObject(parent),
@@ -145,6 +146,8 @@ void AlbumCoverFetcher::SingleSearchFinished(const quint64 request_id, const Cov
   search->deleteLater();
   emit SearchFinished(request_id, results, search->statistics());
 
+  StartRequests();
+
 }
 
 void AlbumCoverFetcher::SingleCoverFetched(const quint64 request_id, const AlbumCoverImageResult &result) {
@@ -155,4 +158,6 @@ void AlbumCoverFetcher::SingleCoverFetched(const quint64 request_id, const Album
   search->deleteLater();
   emit AlbumCoverFetched(request_id, result, search->statistics());
 
+  StartRequests();
+
 }
@@ -23,6 +23,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include <utility>
 
 #include <QObject>
 #include <QCoreApplication>
@@ -45,35 +46,45 @@
 #include "albumcoverfetchersearch.h"
 #include "coverprovider.h"
 #include "coverproviders.h"
+#include "coverproviderscheduler.h"
 #include "albumcoverimageresult.h"
 
 const int AlbumCoverFetcherSearch::kSearchTimeoutMs = 20000;
 const int AlbumCoverFetcherSearch::kImageLoadTimeoutMs = 6000;
 const int AlbumCoverFetcherSearch::kTargetSize = 500;
 const float AlbumCoverFetcherSearch::kGoodScore = 4.0;
+const float AlbumCoverFetcherSearch::kGoodExactMatchScore = 3.0;
 
 AlbumCoverFetcherSearch::AlbumCoverFetcherSearch(const CoverSearchRequest &request, SharedPtr<NetworkAccessManager> network, QObject *parent)
     : QObject(parent),
       request_(request),
+      scheduler_(nullptr),
       image_load_timeout_(new NetworkTimeouts(kImageLoadTimeoutMs, this)),
       network_(network),
-      cancel_requested_(false) {
-
-  // We will terminate the search after kSearchTimeoutMs milliseconds if we are not able to find all of the results before that point in time
-  QTimer::singleShot(kSearchTimeoutMs, this, &AlbumCoverFetcherSearch::TerminateSearch);
-
-}
+      cancel_requested_(false),
+      timeout_started_(false) {}
 
 AlbumCoverFetcherSearch::~AlbumCoverFetcherSearch() {
+  if (scheduler_) {
+    scheduler_->Cancel(this);
+    for (CoverProvider *provider : std::as_const(pending_requests_)) {
+      scheduler_->Finished(provider);
+    }
+  }
   pending_requests_.clear();
   Cancel();
 }
 
 void AlbumCoverFetcherSearch::TerminateSearch() {
 
+  if (scheduler_) scheduler_->Cancel(this);
+  queued_providers_.clear();
+
   QList<int> ids = pending_requests_.keys();
   for (const int id : ids) {
-    pending_requests_.take(id)->CancelSearch(id);
+    CoverProvider *provider = pending_requests_.take(id);
+    provider->CancelSearch(id);
+    if (scheduler_) scheduler_->Finished(provider);
   }
 
   AllProvidersFinished();
@@ -82,6 +93,9 @@ void AlbumCoverFetcherSearch::TerminateSearch() {
 
 void AlbumCoverFetcherSearch::Start(SharedPtr<CoverProviders> cover_providers) {
 
+  cover_providers_ = cover_providers;
+  scheduler_ = cover_providers->scheduler();
+
   // Ignore Radio Paradise "commercial" break.
   if (request_.artist.compare(QLatin1String("commercial-free"), Qt::CaseInsensitive) == 0 && request_.title.compare(QLatin1String("listener-supported"), Qt::CaseInsensitive) == 0) {
     TerminateSearch();
@@ -110,20 +124,48 @@ void AlbumCoverFetcherSearch::Start(SharedPtr<CoverProviders> cover_providers) {
       continue;
     }
 
-    QObject::connect(provider, &CoverProvider::SearchResults, this, QOverload<const int, const CoverProviderSearchResults&>::of(&AlbumCoverFetcherSearch::ProviderSearchResults));
-    QObject::connect(provider, &CoverProvider::SearchFinished, this, &AlbumCoverFetcherSearch::ProviderSearchFinished);
-    const int id = cover_providers->NextId();
-    const bool success = provider->StartSearch(request_.artist, request_.album, request_.title, id);
-
-    if (success) {
-      pending_requests_[id] = provider;
-      statistics_.network_requests_made_++;
-    }
+    queued_providers_ << provider;
   }
 
   // End this search before it even began if there are no providers...
-  if (pending_requests_.isEmpty()) {
+  if (queued_providers_.isEmpty()) {
     TerminateSearch();
+    return;
+  }
+
+  const QList<CoverProvider*> providers = queued_providers_;
+  for (CoverProvider *provider : providers) {
+    scheduler_->Schedule(provider, this, [this, provider]() { StartProviderSearch(provider); });
+  }
+
+}
+
+void AlbumCoverFetcherSearch::StartProviderSearch(CoverProvider *provider) {
+
+  queued_providers_.removeAll(provider);
+
+  // We will terminate the search after kSearchTimeoutMs milliseconds if we are not able to find all of the results before that point in time.
+  // Time spent waiting for the scheduler does not count.
+  if (!timeout_started_) {
+    timeout_started_ = true;
+    QTimer::singleShot(kSearchTimeoutMs, this, &AlbumCoverFetcherSearch::TerminateSearch);
+  }
+
+  QObject::connect(provider, &CoverProvider::SearchResults, this, QOverload<const int, const CoverProviderSearchResults&>::of(&AlbumCoverFetcherSearch::ProviderSearchResults), Qt::UniqueConnection);
+  QObject::connect(provider, &CoverProvider::SearchFinished, this, &AlbumCoverFetcherSearch::ProviderSearchFinished, Qt::UniqueConnection);
+  const int id = cover_providers_->NextId();
+  const bool success = provider->StartSearch(request_.artist, request_.album, request_.title, id);
+
+  if (success) {
+    pending_requests_[id] = provider;
+    statistics_.network_requests_made_++;
+    return;
+  }
+
+  scheduler_->Finished(provider);
+
+  if (pending_requests_.isEmpty() && queued_providers_.isEmpty()) {
+    AllProvidersFinished();
   }
 
 }
@@ -231,10 +273,16 @@ void AlbumCoverFetcherSearch::ProviderSearchFinished(const int id, const CoverPr
   if (!pending_requests_.contains(id)) return;
 
   CoverProvider *provider = pending_requests_.take(id);
+  scheduler_->Finished(provider);
   ProviderSearchResults(provider, results);
 
   // Do we have more providers left?
-  if (!pending_requests_.isEmpty()) {
+  if (!pending_requests_.isEmpty() || !queued_providers_.isEmpty()) {
+    // No need to wait for the other providers when fetching if we already have an exact match from a good provider.
+    if (!request_.search && HasGoodExactMatch()) {
+      qLog(Debug) << "Got an exact match for" << request_.artist << request_.album << "from" << provider->name() << "skipping remaining providers";
+      TerminateSearch();
+    }
     return;
   }
 
@@ -242,6 +290,12 @@ void AlbumCoverFetcherSearch::ProviderSearchFinished(const int id, const CoverPr
 
 }
 
+bool AlbumCoverFetcherSearch::HasGoodExactMatch() const {
+
+  return std::any_of(results_.begin(), results_.end(), [](const CoverProviderSearchResult &result) { return result.score_match >= 1.0F && result.score() >= kGoodExactMatchScore; });
+
+}
+
 void AlbumCoverFetcherSearch::AllProvidersFinished() {
 
   if (cancel_requested_) {
@@ -407,7 +461,7 @@ void AlbumCoverFetcherSearch::Cancel() {
 
   cancel_requested_ = true;
 
-  if (!pending_requests_.isEmpty()) {
+  if (!pending_requests_.isEmpty() || !queued_providers_.isEmpty()) {
     TerminateSearch();
   }
   else if (!pending_image_loads_.isEmpty()) {
@@ -27,6 +27,7 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QPair>
+#include <QList>
 #include <QMap>
 #include <QMultiMap>
 #include <QHash>
@@ -43,12 +44,15 @@
 class QNetworkReply;
 class CoverProvider;
 class CoverProviders;
+class CoverProviderScheduler;
 class NetworkAccessManager;
 class NetworkTimeouts;
 
 // This class encapsulates a single search for covers initiated by an AlbumCoverFetcher.
 // The search engages all of the known cover providers.
-// AlbumCoverFetcherSearch signals search results to an interested AlbumCoverFetcher when all of the providers have done their part.
+// AlbumCoverFetcherSearch signals search results to an interested AlbumCoverFetcher when all of the providers have done their part,
+// or as soon as one of them returned an exact match that is good enough when fetching a cover.
+// The provider searches are started through the CoverProviderScheduler.
 class AlbumCoverFetcherSearch : public QObject {
   Q_OBJECT
 
@@ -79,7 +83,9 @@ class AlbumCoverFetcherSearch : public QObject {
   void TerminateSearch();
 
  private:
+  void StartProviderSearch(CoverProvider *provider);
   void ProviderSearchResults(CoverProvider *provider, const CoverProviderSearchResults &results);
+  bool HasGoodExactMatch() const;
   void AllProvidersFinished();
 
   void FetchMoreImages();
@@ -94,6 +100,7 @@ class AlbumCoverFetcherSearch : public QObject {
   static const int kImageLoadTimeoutMs;
   static const int kTargetSize;
   static const float kGoodScore;
+  static const float kGoodExactMatchScore;
 
   CoverSearchStatistics statistics_;
 
@@ -103,6 +110,11 @@ class AlbumCoverFetcherSearch : public QObject {
   // Complete results (from all of the available providers).
   CoverProviderSearchResults results_;
 
+  SharedPtr<CoverProviders> cover_providers_;
+  CoverProviderScheduler *scheduler_;
+
+  // Providers waiting for the scheduler to start the search.
+  QList<CoverProvider*> queued_providers_;
   QMap<int, CoverProvider*> pending_requests_;
   QHash<QNetworkReply*, CoverProviderSearchResult> pending_image_loads_;
   NetworkTimeouts *image_load_timeout_;
@@ -118,6 +130,7 @@ class AlbumCoverFetcherSearch : public QObject {
   SharedPtr<NetworkAccessManager> network_;
 
   bool cancel_requested_;
+  bool timeout_started_;
 
 };
 
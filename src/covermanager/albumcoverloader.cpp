@@ -18,18 +18,25 @@
  */
 
 #include <memory>
+#include <functional>
 
 #include <QtGlobal>
 #include <QObject>
 #include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 #include <QMutex>
+#include <QList>
 #include <QSet>
+#include <QHash>
 #include <QQueue>
+#include <QStringList>
 #include <QVariant>
 #include <QByteArray>
 #include <QString>
 #include <QUrl>
 #include <QFile>
+#include <QFileInfo>
 #include <QImage>
 #include <QNetworkReply>
 #include <QNetworkRequest>
@@ -50,11 +57,14 @@ AlbumCoverLoader::AlbumCoverLoader(QObject *parent)
     : QObject(parent),
       network_(new NetworkAccessManager(this)),
       stop_requested_(false),
+      running_tasks_(0),
       load_image_async_id_(1),
       original_thread_(nullptr) {
 
   original_thread_ = thread();
 
+  thread_pool_.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), kMaxThreads));
+
 }
 
 void AlbumCoverLoader::ExitAsync() {
@@ -67,6 +77,18 @@ void AlbumCoverLoader::ExitAsync() {
 void AlbumCoverLoader::Exit() {
 
   Q_ASSERT(QThread::currentThread() == thread());
+
+  {
+    QMutexLocker l(&mutex_load_image_async_);
+    for (TaskPtr task : std::as_const(tasks_by_id_)) {
+      task->ids.clear();
+    }
+    tasks_.clear();
+    tasks_by_id_.clear();
+    tasks_by_key_.clear();
+  }
+  thread_pool_.waitForDone();
+
   moveToThread(original_thread_);
   emit ExitFinished();
 
@@ -75,31 +97,41 @@ void AlbumCoverLoader::Exit() {
 void AlbumCoverLoader::CancelTask(const quint64 id) {
 
   QMutexLocker l(&mutex_load_image_async_);
-  for (QQueue<TaskPtr>::iterator it = tasks_.begin(); it != tasks_.end(); ++it) {
-    TaskPtr task = *it;
-    if (task->id == id) {
-      tasks_.erase(it);
-      break;
-    }
-  }
+  CancelTaskLocked(id);
 
 }
 
 void AlbumCoverLoader::CancelTasks(const QSet<quint64> &ids) {
 
   QMutexLocker l(&mutex_load_image_async_);
-  for (QQueue<TaskPtr>::iterator it = tasks_.begin(); it != tasks_.end();) {
-    TaskPtr task = *it;
-    if (ids.contains(task->id)) {
-      it = tasks_.erase(it);
-    }
-    else {
-      ++it;
-    }
+  for (const quint64 id : ids) {
+    CancelTaskLocked(id);
   }
 
 }
 
+void AlbumCoverLoader::CancelTaskLocked(const quint64 id) {
+
+  TaskPtr task = tasks_by_id_.take(id);
+  if (!task) return;
+
+  task->ids.removeAll(id);
+  if (!task->ids.isEmpty()) return;
+
+  // Nobody is waiting for the task anymore, ProcessTasks skips it if it's queued, and a running task stops at the next step.
+  if (!task->key.isEmpty() && tasks_by_key_.value(task->key) == task) {
+    tasks_by_key_.remove(task->key);
+  }
+
+}
+
+bool AlbumCoverLoader::TaskCancelled(TaskPtr task) {
+
+  QMutexLocker l(&mutex_load_image_async_);
+  return task->ids.isEmpty();
+
+}
+
 quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions &options, const Song &song) {
 
   TaskPtr task = make_shared<Task>();
@@ -151,35 +183,96 @@ quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions &options,
 
 }
 
+QString AlbumCoverLoader::TaskKey(TaskPtr task) {
+
+  // Tasks with an image already only need to be scaled, these are not coalesced.
+  if (task->album_cover.is_valid()) return QString();
+
+  QStringList types;
+  types.reserve(task->options.types.count());
+  for (const AlbumCoverLoaderOptions::Type type : std::as_const(task->options.types)) {
+    types << QString::number(static_cast<int>(type));
+  }
+
+  // Songs of the same album share the cover, so tasks are keyed on the art sources and the album, not the song.
+  // The song URL is only needed for embedded art, and InitArt looks for automatic art in the directory of the song.
+  const bool init_art = task->song.is_valid() && task->song.url().isLocalFile() && !task->art_manual.isValid() && !task->art_automatic.isValid();
+  return (QStringList() << QString::number(static_cast<int>(task->options.options))
+                        << QString::number(task->options.desired_scaled_size.width())
+                        << QString::number(task->options.desired_scaled_size.height())
+                        << QString::number(task->options.device_pixel_ratio)
+                        << types.join(QLatin1Char(','))
+                        << task->options.default_cover
+                        << QString::number(task->art_unset)
+                        << task->art_automatic.toString()
+                        << task->art_manual.toString()
+                        << (task->art_embedded ? task->song_url.toString() : QString())
+                        << (init_art ? QFileInfo(task->song.url().toLocalFile()).path() : QString())
+                        << QString::number(static_cast<int>(task->song_source))
+                        << task->song.effective_albumartist()
+                        << task->song.effective_album()).join(QLatin1Char('\n'));
+
+}
+
 quint64 AlbumCoverLoader::EnqueueTask(TaskPtr task) {
 
+  task->key = TaskKey(task);
+
+  quint64 id = 0;
   {
     QMutexLocker l(&mutex_load_image_async_);
-    task->id = load_image_async_id_++;
+    id = load_image_async_id_++;
+    if (!task->key.isEmpty() && tasks_by_key_.contains(task->key)) {
+      // An identical task is already queued or running, wait for that one.
+      TaskPtr identical_task = tasks_by_key_.value(task->key);
+      identical_task->ids << id;
+      tasks_by_id_.insert(id, identical_task);
+      return id;
+    }
+    task->ids << id;
+    tasks_by_id_.insert(id, task);
+    if (!task->key.isEmpty()) {
+      tasks_by_key_.insert(task->key, task);
+    }
     tasks_.enqueue(task);
   }
 
   QMetaObject::invokeMethod(this, &AlbumCoverLoader::ProcessTasks, Qt::QueuedConnection);
 
-  return task->id;
+  return id;
 
 }
 
 void AlbumCoverLoader::ProcessTasks() {
 
-  TaskPtr task;
-  {
-    QMutexLocker l(&mutex_load_image_async_);
-    if (tasks_.isEmpty()) return;
-    task = tasks_.dequeue();
+  QMutexLocker l(&mutex_load_image_async_);
+  while (!tasks_.isEmpty() && running_tasks_ < thread_pool_.maxThreadCount()) {
+    TaskPtr task = tasks_.dequeue();
+    if (task->ids.isEmpty()) continue;  // Cancelled before it was started.
+    RunTaskLocked([this, task]() { ProcessTask(task); });
   }
 
-  ProcessTask(task);
+}
+
+void AlbumCoverLoader::RunTaskLocked(const std::function<void()> &func) {
+
+  ++running_tasks_;
+
+  (void)QtConcurrent::run(&thread_pool_, [this, func]() {
+    func();
+    {
+      QMutexLocker l(&mutex_load_image_async_);
+      --running_tasks_;
+    }
+    ProcessTasks();
+  });
 
 }
 
 void AlbumCoverLoader::ProcessTask(TaskPtr task) {
 
+  if (TaskCancelled(task)) return;
+
   // If we have album cover already, only do scale and pad.
   if (task->album_cover.is_valid()) {
     task->success = true;
@@ -189,6 +282,7 @@ void AlbumCoverLoader::ProcessTask(TaskPtr task) {
   }
 
   while (!task->success && !task->options.types.isEmpty()) {
+    if (TaskCancelled(task)) return;
     const AlbumCoverLoaderOptions::Type type = task->options.types.takeFirst();
     const LoadImageResult result = LoadImage(task, type);
     if (result.status == LoadImageResult::Status::Async) {
@@ -212,6 +306,8 @@ void AlbumCoverLoader::ProcessTask(TaskPtr task) {
 
 void AlbumCoverLoader::FinishTask(TaskPtr task, const AlbumCoverLoaderResult::Type result_type) {
 
+  if (TaskCancelled(task)) return;
+
   QImage image_scaled;
   if (!task->album_cover.image_data.isEmpty() && !task->album_cover.image.isNull()) {
     task->result_type = result_type;
@@ -227,7 +323,23 @@ void AlbumCoverLoader::FinishTask(TaskPtr task, const AlbumCoverLoaderResult::Ty
     }
   }
 
-  emit AlbumCoverLoaded(task->id, AlbumCoverLoaderResult(task->success, task->result_type, task->album_cover, image_scaled, task->art_manual_updated, task->art_automatic_updated));
+  QList<quint64> ids;
+  {
+    QMutexLocker l(&mutex_load_image_async_);
+    ids = task->ids;
+    task->ids.clear();
+    for (const quint64 id : std::as_const(ids)) {
+      tasks_by_id_.remove(id);
+    }
+    if (!task->key.isEmpty() && tasks_by_key_.value(task->key) == task) {
+      tasks_by_key_.remove(task->key);
+    }
+  }
+
+  const AlbumCoverLoaderResult result(task->success, task->result_type, task->album_cover, image_scaled, task->art_manual_updated, task->art_automatic_updated);
+  for (const quint64 id : std::as_const(ids)) {
+    emit AlbumCoverLoaded(id, result);
+  }
 
 }
 
@@ -251,6 +363,21 @@ void AlbumCoverLoader::InitArt(TaskPtr task) {
 
 }
 
+bool AlbumCoverLoader::DecodeImage(TaskPtr task) {
+
+  // When only the scaled image is wanted, let the decoder downscale it.
+  if (task->scaled_image() && !task->original_image()) {
+    const QSize scale_size(static_cast<int>(task->options.desired_scaled_size.width() * task->options.device_pixel_ratio), static_cast<int>(task->options.desired_scaled_size.height() * task->options.device_pixel_ratio));
+    task->album_cover.image = ImageUtils::ReadImageFromData(task->album_cover.image_data, scale_size);
+  }
+  else {
+    task->album_cover.image = ImageUtils::ReadImageFromData(task->album_cover.image_data);
+  }
+
+  return !task->album_cover.image.isNull();
+
+}
+
 AlbumCoverLoader::LoadImageResult AlbumCoverLoader::LoadImage(TaskPtr task, const AlbumCoverLoaderOptions::Type type) {
 
   switch (type) {
@@ -291,7 +418,7 @@ AlbumCoverLoader::LoadImageResult AlbumCoverLoader::LoadEmbeddedImage(TaskPtr ta
 
   if (task->art_embedded && task->song_url.isValid() && task->song_url.isLocalFile()) {
     task->album_cover.image_data = TagReaderClient::Instance()->LoadEmbeddedArtBlocking(task->song_url.toLocalFile());
-    if (!task->album_cover.image_data.isEmpty() && task->album_cover.image.loadFromData(task->album_cover.image_data)) {
+    if (!task->album_cover.image_data.isEmpty() && DecodeImage(task)) {
       return LoadImageResult(AlbumCoverLoaderResult::Type::Embedded, LoadImageResult::Status::Success);
     }
   }
@@ -354,7 +481,7 @@ AlbumCoverLoader::LoadImageResult AlbumCoverLoader::LoadLocalFileImage(TaskPtr t
     return LoadImageResult(result_type, LoadImageResult::Status::Failure);
   }
 
-  if (!task->album_cover.image.loadFromData(task->album_cover.image_data)) {
+  if (!DecodeImage(task)) {
     qLog(Error) << "Failed to load image from cover file" << cover_file << ":" << file.errorString();
     return LoadImageResult(result_type, LoadImageResult::Status::Failure);
   }
@@ -365,6 +492,17 @@ AlbumCoverLoader::LoadImageResult AlbumCoverLoader::LoadLocalFileImage(TaskPtr t
 
 AlbumCoverLoader::LoadImageResult AlbumCoverLoader::LoadRemoteUrlImage(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url) {
 
+  // The network access manager belongs to the loader thread.
+  QMetaObject::invokeMethod(this, [this, task, result_type, cover_url]() { StartRemoteImageRequest(task, result_type, cover_url); }, Qt::QueuedConnection);
+
+  return LoadImageResult(result_type, LoadImageResult::Status::Async);
+
+}
+
+void AlbumCoverLoader::StartRemoteImageRequest(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url) {
+
+  if (TaskCancelled(task)) return;
+
   qLog(Debug) << "Loading remote cover from URL" << cover_url;
 
   QNetworkRequest request(cover_url);
@@ -372,8 +510,6 @@ AlbumCoverLoader::LoadImageResult AlbumCoverLoader::LoadRemoteUrlImage(TaskPtr t
   QNetworkReply *reply = network_->get(request);
   QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, task, result_type, cover_url]() { LoadRemoteImageFinished(reply, task, result_type, cover_url); });
 
-  return LoadImageResult(result_type, LoadImageResult::Status::Async);
-
 }
 
 void AlbumCoverLoader::LoadRemoteImageFinished(QNetworkReply *reply, TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url) {
@@ -387,7 +523,8 @@ void AlbumCoverLoader::LoadRemoteImageFinished(QNetworkReply *reply, TaskPtr tas
   if (redirect.isValid() && redirect.type() == QVariant::Url) {
 #endif
     if (task->redirects++ >= kMaxRedirects) {
-      ProcessTask(task);
+      QMutexLocker l(&mutex_load_image_async_);
+      RunTaskLocked([this, task]() { ProcessTask(task); });
       return;
     }
     const QUrl redirect_url = redirect.toUrl();
@@ -401,20 +538,31 @@ void AlbumCoverLoader::LoadRemoteImageFinished(QNetworkReply *reply, TaskPtr tas
   }
 
   if (reply->error() == QNetworkReply::NoError) {
-    task->album_cover.image_data = reply->readAll();
-    if (!task->album_cover.image_data.isEmpty() && task->album_cover.image.loadFromData(task->album_cover.image_data)) {
-      task->success = true;
-      FinishTask(task, result_type);
-      return;
-    }
-    else {
-      qLog(Error) << "Unable to load album cover image from URL" << cover_url;
-    }
+    // Decode the image in the thread pool.
+    const QByteArray image_data = reply->readAll();
+    QMutexLocker l(&mutex_load_image_async_);
+    RunTaskLocked([this, task, result_type, cover_url, image_data]() { LoadRemoteImageData(task, result_type, cover_url, image_data); });
+    return;
   }
-  else {
-    qLog(Error) << "Unable to get album cover from URL" << cover_url << reply->error() << reply->errorString();
+
+  qLog(Error) << "Unable to get album cover from URL" << cover_url << reply->error() << reply->errorString();
+
+  QMutexLocker l(&mutex_load_image_async_);
+  RunTaskLocked([this, task]() { ProcessTask(task); });
+
+}
+
+void AlbumCoverLoader::LoadRemoteImageData(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url, const QByteArray &image_data) {
+
+  task->album_cover.image_data = image_data;
+  if (!task->album_cover.image_data.isEmpty() && DecodeImage(task)) {
+    task->success = true;
+    FinishTask(task, result_type);
+    return;
   }
 
+  qLog(Error) << "Unable to load album cover image from URL" << cover_url;
+
   ProcessTask(task);
 
 }
@@ -22,9 +22,13 @@
 
 #include "config.h"
 
+#include <functional>
+
 #include <QtGlobal>
 #include <QObject>
 #include <QMutex>
+#include <QThreadPool>
+#include <QList>
 #include <QSet>
 #include <QHash>
 #include <QQueue>
@@ -42,6 +46,8 @@ class QThread;
 class QNetworkReply;
 class NetworkAccessManager;
 
+// Covers are loaded, decoded and scaled by a pool of worker threads, only the network requests are done in the loader thread.
+// Identical requests are coalesced, so the image is loaded once and the result is sent for each of the request IDs.
 class AlbumCoverLoader : public QObject {
   Q_OBJECT
 
@@ -66,9 +72,12 @@ class AlbumCoverLoader : public QObject {
  private:
   class Task {
    public:
-    explicit Task() : id(0), success(false), art_embedded(false), art_unset(false), song_source(Song::Source::Unknown), result_type(AlbumCoverLoaderResult::Type::None), redirects(0) {}
+    explicit Task() : success(false), art_embedded(false), art_unset(false), song_source(Song::Source::Unknown), result_type(AlbumCoverLoaderResult::Type::None), redirects(0) {}
 
-    quint64 id;
+    // The request IDs waiting for this task, more than one when identical requests were coalesced.
+    QList<quint64> ids;
+    // Identifies identical requests, empty if the task can't be coalesced.
+    QString key;
     bool success;
 
     AlbumCoverLoaderOptions options;
@@ -106,28 +115,40 @@ class AlbumCoverLoader : public QObject {
   };
 
  private:
+  static QString TaskKey(TaskPtr task);
   quint64 EnqueueTask(TaskPtr task);
+  void CancelTaskLocked(const quint64 id);
+  bool TaskCancelled(TaskPtr task);
+  void RunTaskLocked(const std::function<void()> &func);
   void ProcessTask(TaskPtr task);
   void InitArt(TaskPtr task);
+  static bool DecodeImage(TaskPtr task);
   LoadImageResult LoadImage(TaskPtr task, const AlbumCoverLoaderOptions::Type type);
   LoadImageResult LoadEmbeddedImage(TaskPtr task);
   LoadImageResult LoadUrlImage(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url);
   LoadImageResult LoadLocalUrlImage(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url);
   LoadImageResult LoadLocalFileImage(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QString &cover_file);
   LoadImageResult LoadRemoteUrlImage(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url);
+  void LoadRemoteImageData(TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url, const QByteArray &image_data);
   void FinishTask(TaskPtr task, const AlbumCoverLoaderResult::Type result_type);
 
  private slots:
   void Exit();
   void ProcessTasks();
+  void StartRemoteImageRequest(AlbumCoverLoader::TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url);
   void LoadRemoteImageFinished(QNetworkReply *reply, AlbumCoverLoader::TaskPtr task, const AlbumCoverLoaderResult::Type result_type, const QUrl &cover_url);
 
  private:
   static const int kMaxRedirects = 3;
+  static const int kMaxThreads = 4;
   SharedPtr<NetworkAccessManager> network_;
   bool stop_requested_;
+  QThreadPool thread_pool_;
   QMutex mutex_load_image_async_;
   QQueue<TaskPtr> tasks_;
+  QHash<quint64, TaskPtr> tasks_by_id_;
+  QHash<QString, TaskPtr> tasks_by_key_;
+  int running_tasks_;
   quint64 load_image_async_id_;
   QThread *original_thread_;
 };
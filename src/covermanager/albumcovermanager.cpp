@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <utility>
 #include <algorithm>
 
 #include <QObject>
@@ -60,12 +61,14 @@
 #include <QSettings>
 #include <QFlags>
 #include <QSize>
+#include <QStandardPaths>
 #include <QtEvents>
 
 #include "core/scoped_ptr.h"
 #include "core/shared_ptr.h"
 #include "core/application.h"
 #include "core/iconloader.h"
+#include "core/logging.h"
 #include "core/tagreaderclient.h"
 #include "core/database.h"
 #include "core/sqlrow.h"
@@ -92,11 +95,14 @@
 #include "coversearchstatistics.h"
 #include "coversearchstatisticsdialog.h"
 #include "albumcoverimageresult.h"
+#include "thumbnailstore.h"
 
 #include "ui_albumcovermanager.h"
 
 const char *AlbumCoverManager::kSettingsGroup = "CoverManager";
 constexpr int AlbumCoverManager::kThumbnailSize = 120;
+constexpr qint64 AlbumCoverManager::kThumbnailStoreMaxSize = 256LL * 1024LL * 1024LL;
+constexpr int AlbumCoverManager::kFetchProgressSaveInterval = 25;
 
 AlbumCoverManager::AlbumCoverManager(Application *app, SharedPtr<CollectionBackend> collection_backend, QMainWindow *mainwindow, QWidget *parent)
     : QMainWindow(parent),
@@ -108,6 +114,7 @@ AlbumCoverManager::AlbumCoverManager(Application *app, SharedPtr<CollectionBacke
       filter_all_(nullptr),
       filter_with_covers_(nullptr),
       filter_without_covers_(nullptr),
+      thumbnail_store_(new ThumbnailStore(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/covermanager-thumbnails.store"), QSize(kThumbnailSize, kThumbnailSize) * devicePixelRatioF(), kThumbnailStoreMaxSize)),
       cover_fetcher_(new AlbumCoverFetcher(app_->cover_providers(), app_->network(), this)),
       cover_searcher_(nullptr),
       cover_export_(nullptr),
@@ -120,11 +127,17 @@ AlbumCoverManager::AlbumCoverManager(Application *app, SharedPtr<CollectionBacke
       progress_bar_(new QProgressBar(this)),
       abort_progress_(new QPushButton(this)),
       jobs_(0),
+      fetching_missing_covers_(false),
+      fetch_progress_unsaved_(0),
       all_artists_(nullptr) {
 
   ui_->setupUi(this);
   ui_->albums->set_cover_manager(this);
 
+  if (!thumbnail_store_->Open()) {
+    qLog(Error) << "Failed to open cover manager thumbnail store";
+  }
+
   // Icons
   ui_->action_fetch->setIcon(IconLoader::Load(QStringLiteral("download")));
   ui_->export_covers->setIcon(IconLoader::Load(QStringLiteral("document-save")));
@@ -309,8 +322,59 @@ void AlbumCoverManager::SaveSettings() {
 
 }
 
+void AlbumCoverManager::LoadFetchProgress() {
+
+  fetch_missing_attempted_.clear();
+
+  Settings s;
+  s.beginGroup(kSettingsGroup);
+  const QStringList attempted = s.value("fetch_missing_attempted").toStringList();
+  s.endGroup();
+
+  for (const QString &key : attempted) {
+    bool ok = false;
+    const quint64 album_key = key.toULongLong(&ok, 16);
+    if (ok) fetch_missing_attempted_.insert(album_key);
+  }
+
+}
+
+void AlbumCoverManager::SaveFetchProgress() {
+
+  QStringList attempted;
+  attempted.reserve(fetch_missing_attempted_.count());
+  for (const quint64 album_key : std::as_const(fetch_missing_attempted_)) {
+    attempted << QString::number(album_key, 16);
+  }
+
+  Settings s;
+  s.beginGroup(kSettingsGroup);
+  s.setValue("fetch_missing_attempted", attempted);
+  s.endGroup();
+
+  fetch_progress_unsaved_ = 0;
+
+}
+
+void AlbumCoverManager::ClearFetchProgress() {
+
+  fetch_missing_attempted_.clear();
+  fetch_progress_unsaved_ = 0;
+
+  Settings s;
+  s.beginGroup(kSettingsGroup);
+  s.remove("fetch_missing_attempted");
+  s.endGroup();
+
+}
+
 void AlbumCoverManager::CancelRequests() {
 
+  if (fetching_missing_covers_) {
+    SaveFetchProgress();
+    fetching_missing_covers_ = false;
+  }
+
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
   app_->album_cover_loader()->CancelTasks(QSet<quint64>(cover_loading_tasks_.keyBegin(), cover_loading_tasks_.keyEnd()));
 #else
@@ -442,6 +506,7 @@ void AlbumCoverManager::AlbumCoverLoaded(const quint64 id, const AlbumCoverLoade
   }
   else {
     album_item->setIcon(QPixmap::fromImage(result.image_scaled));
+    thumbnail_store_->Put(AlbumThumbnailKey(album_item), AlbumThumbnailCoverSourceHash(album_item), result.image_scaled);
   }
 
   UpdateFilter();
@@ -512,17 +577,38 @@ bool AlbumCoverManager::ShouldHide(const AlbumItem &album_item, const QString &f
 
 void AlbumCoverManager::FetchAlbumCovers() {
 
+  // Skip albums where an earlier fetch that didn't complete found nothing.
+  if (!fetching_missing_covers_) {
+    LoadFetchProgress();
+    fetching_missing_covers_ = true;
+  }
+
+  int skipped = 0;
   for (int i = 0; i < ui_->albums->count(); ++i) {
     AlbumItem *album_item = static_cast<AlbumItem*>(ui_->albums->item(i));
     if (album_item->isHidden()) continue;
     if (ItemHasCover(*album_item)) continue;
+    if (fetch_missing_attempted_.contains(AlbumThumbnailKey(album_item))) {
+      ++skipped;
+      continue;
+    }
 
     quint64 id = cover_fetcher_->FetchAlbumCover(album_item->data(Role_AlbumArtist).toString(), album_item->data(Role_Album).toString(), QString(), true);
     cover_fetching_tasks_[id] = album_item;
     jobs_++;
   }
 
-  if (!cover_fetching_tasks_.isEmpty()) ui_->button_fetch->setEnabled(false);
+  if (skipped > 0) {
+    qLog(Info) << "Continuing fetching missing covers, skipping" << skipped << "albums already searched";
+  }
+
+  if (cover_fetching_tasks_.isEmpty()) {
+    ClearFetchProgress();
+    fetching_missing_covers_ = false;
+  }
+  else {
+    ui_->button_fetch->setEnabled(false);
+  }
 
   progress_bar_->setMaximum(jobs_);
   progress_bar_->show();
@@ -540,8 +626,18 @@ void AlbumCoverManager::AlbumCoverFetched(const quint64 id, const AlbumCoverImag
   if (!result.image.isNull()) {
     SaveAndSetCover(album_item, result);
   }
+  else if (fetching_missing_covers_) {
+    fetch_missing_attempted_.insert(AlbumThumbnailKey(album_item));
+    if (++fetch_progress_unsaved_ >= kFetchProgressSaveInterval) {
+      SaveFetchProgress();
+    }
+  }
 
   if (cover_fetching_tasks_.isEmpty()) {
+    if (fetching_missing_covers_) {
+      ClearFetchProgress();
+      fetching_missing_covers_ = false;
+    }
     EnableCoversButtons();
   }
 
@@ -1020,14 +1116,19 @@ void AlbumCoverManager::ExportCovers() {
 
 }
 
-void AlbumCoverManager::UpdateExportStatus(const int exported, const int skipped, const int max) {
+void AlbumCoverManager::UpdateExportStatus(const int exported, const int skipped, const int max, const qint64 bytes_written, const qint64 elapsed_msec) {
 
-  progress_bar_->setValue(exported);
+  progress_bar_->setValue(exported + skipped);
 
   QString message = tr("Exported %1 covers out of %2 (%3 skipped)")
                         .arg(exported)
                         .arg(max)
                         .arg(skipped);
+  if (elapsed_msec > 0) {
+    message += QLatin1String(", ") + tr("%1 covers/s, %2/s")
+                                         .arg(static_cast<double>(exported + skipped) * 1000.0 / static_cast<double>(elapsed_msec), 0, 'f', 1)
+                                         .arg(Utilities::PrettySize(static_cast<quint64>(bytes_written * 1000 / elapsed_msec)));
+  }
   statusBar()->showMessage(message);
 
   // End of the current process
@@ -1075,6 +1176,14 @@ void AlbumCoverManager::SaveEmbeddedCoverFinished(TagReaderReply *reply, AlbumIt
 
 void AlbumCoverManager::LoadAlbumCoverAsync(AlbumItem *album_item) {
 
+  // Thumbnails already in the store are copied instead of decoding the cover again.
+  QImage thumbnail = thumbnail_store_->Get(AlbumThumbnailKey(album_item), AlbumThumbnailCoverSourceHash(album_item));
+  if (!thumbnail.isNull()) {
+    thumbnail.setDevicePixelRatio(devicePixelRatioF());
+    album_item->setIcon(QPixmap::fromImage(thumbnail));
+    return;
+  }
+
   AlbumCoverLoaderOptions cover_options(AlbumCoverLoaderOptions::Option::ScaledImage | AlbumCoverLoaderOptions::Option::PadScaledImage);
   cover_options.types = cover_types_;
   cover_options.desired_scaled_size = QSize(kThumbnailSize, kThumbnailSize);
@@ -1083,3 +1192,15 @@ void AlbumCoverManager::LoadAlbumCoverAsync(AlbumItem *album_item) {
   cover_loading_tasks_.insert(cover_load_id, album_item);
 
 }
+
+quint64 AlbumCoverManager::AlbumThumbnailKey(const AlbumItem *album_item) const {
+
+  return ThumbnailStore::AlbumKey(collection_backend_->source(), album_item->data(Role_AlbumArtist).toString(), album_item->data(Role_Album).toString());
+
+}
+
+quint64 AlbumCoverManager::AlbumThumbnailCoverSourceHash(const AlbumItem *album_item) {
+
+  return ThumbnailStore::CoverSourceHash(album_item->data(Role_ArtEmbedded).toBool(), album_item->data(Role_ArtAutomatic).toUrl(), album_item->data(Role_ArtManual).toUrl(), album_item->data(Role_ArtUnset).toBool());
+
+}
@@ -32,10 +32,12 @@
 #include <QListWidgetItem>
 #include <QMap>
 #include <QMultiMap>
+#include <QSet>
 #include <QString>
 #include <QImage>
 #include <QIcon>
 
+#include "core/scoped_ptr.h"
 #include "core/shared_ptr.h"
 #include "core/song.h"
 #include "core/tagreaderclient.h"
@@ -58,6 +60,7 @@ class Application;
 class CollectionBackend;
 class SongMimeData;
 class AlbumCoverExport;
+class ThumbnailStore;
 class AlbumCoverExporter;
 class AlbumCoverFetcher;
 class AlbumCoverSearcher;
@@ -125,6 +128,9 @@ class AlbumCoverManager : public QMainWindow {
 
   void LoadGeometry();
   void SaveSettings();
+  void LoadFetchProgress();
+  void SaveFetchProgress();
+  void ClearFetchProgress();
 
   QString InitialPathForOpenCoverDialog(const QString &path_automatic, const QString &first_file_name) const;
 
@@ -148,6 +154,8 @@ class AlbumCoverManager : public QMainWindow {
   bool ItemHasCover(const AlbumItem &album_item) const;
 
   void LoadAlbumCoverAsync(AlbumItem *album_item);
+  quint64 AlbumThumbnailKey(const AlbumItem *album_item) const;
+  static quint64 AlbumThumbnailCoverSourceHash(const AlbumItem *album_item);
 
  signals:
   void Error(const QString &error);
@@ -180,13 +188,15 @@ class AlbumCoverManager : public QMainWindow {
   void LoadSelectedToPlaylist();
 
   void UpdateCoverInList(AlbumItem *album_item, const QUrl &cover);
-  void UpdateExportStatus(const int exported, const int skipped, const int max);
+  void UpdateExportStatus(const int exported, const int skipped, const int max, const qint64 bytes_written, const qint64 elapsed_msec);
 
   void SaveEmbeddedCoverFinished(TagReaderReply *reply, AlbumItem *album_item, const QUrl &url, const bool art_embedded);
 
  private:
   static const char *kSettingsGroup;
   static const int kThumbnailSize;
+  static const qint64 kThumbnailStoreMaxSize;
+  static const int kFetchProgressSaveInterval;
 
   Ui_CoverManager *ui_;
   QMainWindow *mainwindow_;
@@ -199,6 +209,7 @@ class AlbumCoverManager : public QMainWindow {
   QAction *filter_without_covers_;
 
   QMap<quint64, AlbumItem*> cover_loading_tasks_;
+  ScopedPtr<ThumbnailStore> thumbnail_store_;
 
   AlbumCoverFetcher *cover_fetcher_;
   QMap<quint64, AlbumItem*> cover_fetching_tasks_;
@@ -220,6 +231,11 @@ class AlbumCoverManager : public QMainWindow {
   QPushButton *abort_progress_;
   int jobs_;
 
+  // Albums where fetching missing covers found nothing, saved so an interrupted fetch continues where it stopped.
+  bool fetching_missing_covers_;
+  QSet<quint64> fetch_missing_attempted_;
+  int fetch_progress_unsaved_;
+
   QMultiMap<AlbumItem*, QUrl> cover_save_tasks_;
 
   QListWidgetItem *all_artists_;
@@ -24,12 +24,18 @@
 #include <utility>
 
 #include <QFile>
+#include <QFileInfo>
+#include <QBuffer>
+#include <QByteArray>
 #include <QSize>
 #include <QString>
 #include <QImage>
+#include <QImageReader>
+#include <QCryptographicHash>
 
 #include "core/song.h"
 #include "core/tagreaderclient.h"
+#include "utilities/mimeutils.h"
 #include "albumcoverloaderoptions.h"
 #include "albumcoverexport.h"
 #include "coverexportrunnable.h"
@@ -44,197 +50,225 @@ void CoverExportRunnable::run() {
 
   if (song_.art_unset() || (!song_.art_embedded() && !song_.art_automatic_is_valid() && !song_.art_manual_is_valid())) {
     EmitCoverSkipped();
+    return;
+  }
+
+  QByteArray embedded_data;
+  QString cover_path;
+  if (!FindCover(&embedded_data, &cover_path)) {
+    EmitCoverSkipped();
+    return;
+  }
+
+  // Embedded covers are always exported as JPEG.
+  const QString extension = embedded_data.isEmpty() ? cover_path.section(QLatin1Char('.'), -1) : QStringLiteral("jpg");
+  const QString cover_dir = song_.url().toLocalFile().section(QLatin1Char('/'), 0, -2);
+  const QString new_file = cover_dir + QLatin1Char('/') + dialog_result_.filename_ + QLatin1Char('.') + extension;
+
+  // If the file exists, do not override!
+  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode::None && QFile::exists(new_file)) {
+    EmitCoverSkipped();
+    return;
+  }
+
+  if (dialog_result_.RequiresCoverProcessing()) {
+    ProcessAndExportCover(embedded_data, cover_path, new_file);
   }
   else {
-    if (dialog_result_.RequiresCoverProcessing()) {
-      ProcessAndExportCover();
-    }
-    else {
-      ExportCover();
-    }
+    ExportCover(embedded_data, cover_path, new_file);
   }
 
 }
 
-// Exports a single album cover using a "save QImage to file" approach.
-// For performance reasons this method will be invoked only if loading and in memory processing of images is necessary for current settings which means that:
-// - either the force size flag is being used
-// - or the "overwrite smaller" mode is used
-// In all other cases, the faster ExportCover() method will be used.
-void CoverExportRunnable::ProcessAndExportCover() {
-
-  QImage image;
-  QString extension;
+// Finds the cover to export in the order of the cover types, either the embedded cover data or the path of a cover file.
+// Only the image header is read to check that the cover can be used.
+bool CoverExportRunnable::FindCover(QByteArray *embedded_data, QString *cover_path) {
 
   for (const AlbumCoverLoaderOptions::Type cover_type : std::as_const(cover_types_)) {
     switch (cover_type) {
       case AlbumCoverLoaderOptions::Type::Unset:
         if (song_.art_unset()) {
-          EmitCoverSkipped();
-          return;
+          return false;
         }
         break;
       case AlbumCoverLoaderOptions::Type::Embedded:
         if (song_.art_embedded() && dialog_result_.export_embedded_) {
-          image = TagReaderClient::Instance()->LoadEmbeddedArtAsImageBlocking(song_.url().toLocalFile());
-          if (!image.isNull()) {
-            extension = QLatin1String("jpg");
+          *embedded_data = TagReaderClient::Instance()->LoadEmbeddedArtBlocking(song_.url().toLocalFile());
+          if (!embedded_data->isEmpty()) {
+            return true;
           }
         }
         break;
       case AlbumCoverLoaderOptions::Type::Manual:
         if (dialog_result_.export_downloaded_ && song_.art_manual_is_valid()) {
-          const QString cover_path = song_.art_manual().toLocalFile();
-          if (image.load(cover_path)) {
-            extension = cover_path.section(QLatin1Char('.'), -1);
+          *cover_path = song_.art_manual().toLocalFile();
+          if (QImageReader(*cover_path).canRead()) {
+            return true;
           }
         }
         break;
       case AlbumCoverLoaderOptions::Type::Automatic:
         if (dialog_result_.export_downloaded_ && song_.art_automatic_is_valid()) {
-          const QString cover_path = song_.art_automatic().toLocalFile();
-          if (image.load(cover_path)) {
-            extension = cover_path.section(QLatin1Char('.'), -1);
+          *cover_path = song_.art_automatic().toLocalFile();
+          if (QImageReader(*cover_path).canRead()) {
+            return true;
           }
         }
         break;
     }
-    if (!image.isNull() && !extension.isEmpty()) break;
   }
 
-  if (image.isNull() || extension.isEmpty()) {
-    EmitCoverSkipped();
-    return;
-  }
+  return false;
 
-  // Rescale if necessary
-  if (dialog_result_.IsSizeForced()) {
-    image = image.scaled(QSize(dialog_result_.width_, dialog_result_.height_), Qt::IgnoreAspectRatio);
-  }
+}
 
-  QString cover_dir = song_.url().toLocalFile().section(QLatin1Char('/'), 0, -2);
-  QString new_file = cover_dir + QLatin1Char('/') + dialog_result_.filename_ + QLatin1Char('.') + (song_.art_embedded() ? QLatin1String("jpg") : extension);
+// Exports a single album cover when the image needs to be decoded, which means that:
+// - either the force size flag is being used
+// - or the "overwrite smaller" mode is used
+// In "overwrite smaller" mode the sizes are read from the image headers, the image is only decoded if it's rescaled.
+void CoverExportRunnable::ProcessAndExportCover(const QByteArray &embedded_data, const QString &cover_path, const QString &new_file) {
 
-  // If the file exists, do not override!
-  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode::None && QFile::exists(new_file)) {
-    EmitCoverSkipped();
-    return;
+  QSize size;
+  if (dialog_result_.IsSizeForced()) {
+    size = QSize(dialog_result_.width_, dialog_result_.height_);
+  }
+  else if (embedded_data.isEmpty()) {
+    size = QImageReader(cover_path).size();
+  }
+  else {
+    QBuffer buffer;
+    buffer.setData(embedded_data);
+    size = QImageReader(&buffer).size();
   }
 
-  // We're handling overwrite as remove + copy so we need to delete the old file first
-  if (QFile::exists(new_file) && dialog_result_.overwrite_ != AlbumCoverExport::OverwriteMode::None) {
-
-    // if the mode is "overwrite smaller" then skip the cover if a bigger one is already available in the folder
-    if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode::Smaller) {
-      QImage image_existing;
-      image_existing.load(new_file);
-
-      if (image_existing.isNull() || image_existing.size().height() >= image.size().height() || image_existing.size().width() >= image.size().width()) {
-        EmitCoverSkipped();
-        return;
-      }
-    }
-
-    if (!QFile::remove(new_file)) {
+  // If the mode is "overwrite smaller" then skip the cover if a bigger one is already available in the folder
+  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode::Smaller && QFile::exists(new_file)) {
+    const QSize existing_size = QImageReader(new_file).size();
+    if (!existing_size.isValid() || !size.isValid() || existing_size.height() >= size.height() || existing_size.width() >= size.width()) {
       EmitCoverSkipped();
       return;
     }
   }
 
-  if (image.save(new_file)) {
-    EmitCoverExported();
-  }
-  else {
-    EmitCoverSkipped();
+  if (!dialog_result_.IsSizeForced()) {
+    ExportCover(embedded_data, cover_path, new_file);
+    return;
   }
 
-}
-
-// Exports a single album cover using a "copy file" approach.
-void CoverExportRunnable::ExportCover() {
-
   QImage image;
-  QString extension;
-  QString cover_path;
-  bool embedded_cover = false;
-
-  for (const AlbumCoverLoaderOptions::Type cover_type : std::as_const(cover_types_)) {
-    switch (cover_type) {
-      case AlbumCoverLoaderOptions::Type::Unset:
-        if (song_.art_unset()) {
-          EmitCoverSkipped();
-          return;
-        }
-        break;
-      case AlbumCoverLoaderOptions::Type::Embedded:
-        if (song_.art_embedded() && dialog_result_.export_embedded_) {
-          image = TagReaderClient::Instance()->LoadEmbeddedArtAsImageBlocking(song_.url().toLocalFile());
-          if (!image.isNull()) {
-            embedded_cover = true;
-            extension = QLatin1String("jpg");
-          }
-        }
-        break;
-      case AlbumCoverLoaderOptions::Type::Manual:
-        if (dialog_result_.export_downloaded_ && song_.art_manual_is_valid()) {
-          cover_path = song_.art_manual().toLocalFile();
-          if (image.load(cover_path)) {
-            extension = cover_path.section(QLatin1Char('.'), -1);
-          }
-        }
-        break;
-      case AlbumCoverLoaderOptions::Type::Automatic:
-        if (dialog_result_.export_downloaded_ && song_.art_automatic_is_valid()) {
-          cover_path = song_.art_automatic().toLocalFile();
-          if (image.load(cover_path)) {
-            extension = cover_path.section(QLatin1Char('.'), -1);
-          }
-        }
-        break;
-    }
-    if (!image.isNull() && !extension.isEmpty() && (embedded_cover || !cover_path.isEmpty())) break;
+  if (embedded_data.isEmpty()) {
+    image.load(cover_path);
   }
-
-  if (image.isNull() || extension.isEmpty()) {
+  else {
+    image.loadFromData(embedded_data);
+  }
+  if (image.isNull()) {
     EmitCoverSkipped();
     return;
   }
 
-  QString cover_dir = song_.url().toLocalFile().section(QLatin1Char('/'), 0, -2);
-  QString new_file = cover_dir + QLatin1Char('/') + dialog_result_.filename_ + QLatin1Char('.') + extension;
+  image = image.scaled(size, Qt::IgnoreAspectRatio);
 
-  // If the file exists, do not override!
-  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode::None && QFile::exists(new_file)) {
+  QByteArray data;
+  QBuffer buffer(&data);
+  if (!buffer.open(QIODevice::WriteOnly) || !image.save(&buffer, QFileInfo(new_file).suffix().toUtf8().constData())) {
     EmitCoverSkipped();
     return;
   }
+  buffer.close();
 
-  // We're handling overwrite as remove + copy so we need to delete the old file first
-  if (dialog_result_.overwrite_ != AlbumCoverExport::OverwriteMode::None && QFile::exists(new_file)) {
-    if (!QFile::remove(new_file)) {
+  WriteCover(data, new_file);
+
+}
+
+// Exports a single album cover by copying the file or writing the embedded cover data as it is.
+// Embedded covers are only decoded if they need to be converted to JPEG.
+void CoverExportRunnable::ExportCover(const QByteArray &embedded_data, const QString &cover_path, const QString &new_file) {
+
+  if (!embedded_data.isEmpty()) {
+    if (Utilities::MimeTypeFromData(embedded_data) == QLatin1String("image/jpeg")) {
+      WriteCover(embedded_data, new_file);
+      return;
+    }
+    QImage image;
+    QByteArray data;
+    QBuffer buffer(&data);
+    if (!image.loadFromData(embedded_data) || !buffer.open(QIODevice::WriteOnly) || !image.save(&buffer, "JPG")) {
       EmitCoverSkipped();
       return;
     }
+    buffer.close();
+    WriteCover(data, new_file);
+    return;
   }
 
-  if (embedded_cover) {
-    if (!image.save(new_file)) {
+  // Automatic or manual cover, available in an image file
+  if (QFile::exists(new_file)) {
+    if (FilesHaveSameContent(cover_path, new_file)) {
       EmitCoverSkipped();
       return;
     }
-  }
-  else {
-    // Automatic or manual cover, available in an image file
-    if (!QFile::copy(cover_path, new_file)) {
+    // We're handling overwrite as remove + copy so we need to delete the old file first
+    if (!QFile::remove(new_file)) {
       EmitCoverSkipped();
       return;
     }
   }
 
-  EmitCoverExported();
+  if (!QFile::copy(cover_path, new_file)) {
+    EmitCoverSkipped();
+    return;
+  }
+
+  EmitCoverExported(QFileInfo(new_file).size());
+
+}
+
+void CoverExportRunnable::WriteCover(const QByteArray &data, const QString &new_file) {
+
+  // Don't rewrite a cover that didn't change.
+  if (QFile::exists(new_file) && FileHasContent(new_file, data)) {
+    EmitCoverSkipped();
+    return;
+  }
+
+  QFile file(new_file);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(data) != data.size()) {
+    EmitCoverSkipped();
+    return;
+  }
+  file.close();
+
+  EmitCoverExported(data.size());
+
+}
+
+bool CoverExportRunnable::FileHasContent(const QString &filename, const QByteArray &data) {
+
+  QFile file(filename);
+  if (file.size() != data.size() || !file.open(QIODevice::ReadOnly)) return false;
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  if (!hash.addData(&file)) return false;
+
+  return hash.result() == QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+}
+
+bool CoverExportRunnable::FilesHaveSameContent(const QString &filename1, const QString &filename2) {
+
+  QFile file1(filename1);
+  QFile file2(filename2);
+  if (file1.size() != file2.size() || !file1.open(QIODevice::ReadOnly) || !file2.open(QIODevice::ReadOnly)) return false;
+
+  QCryptographicHash hash1(QCryptographicHash::Sha1);
+  QCryptographicHash hash2(QCryptographicHash::Sha1);
+  if (!hash1.addData(&file1) || !hash2.addData(&file2)) return false;
+
+  return hash1.result() == hash2.result();
 
 }
 
-void CoverExportRunnable::EmitCoverExported() { emit CoverExported(); }
+void CoverExportRunnable::EmitCoverExported(const qint64 bytes) { emit CoverExported(bytes); }
 
 void CoverExportRunnable::EmitCoverSkipped() { emit CoverSkipped(); }
@@ -24,8 +24,10 @@
 
 #include "config.h"
 
+#include <QtGlobal>
 #include <QObject>
 #include <QRunnable>
+#include <QByteArray>
 #include <QString>
 
 #include "core/song.h"
@@ -41,15 +43,20 @@ class CoverExportRunnable : public QObject, public QRunnable {
   void run() override;
 
  signals:
-  void CoverExported();
+  void CoverExported(const qint64 bytes);
   void CoverSkipped();
 
  private:
-  void EmitCoverExported();
+  void EmitCoverExported(const qint64 bytes);
   void EmitCoverSkipped();
 
-  void ProcessAndExportCover();
-  void ExportCover();
+  bool FindCover(QByteArray *embedded_data, QString *cover_path);
+  void ProcessAndExportCover(const QByteArray &embedded_data, const QString &cover_path, const QString &new_file);
+  void ExportCover(const QByteArray &embedded_data, const QString &cover_path, const QString &new_file);
+  void WriteCover(const QByteArray &data, const QString &new_file);
+
+  static bool FileHasContent(const QString &filename, const QByteArray &data);
+  static bool FilesHaveSameContent(const QString &filename1, const QString &filename2);
 
   AlbumCoverExport::DialogResult dialog_result_;
   AlbumCoverLoaderOptions::Types cover_types_;
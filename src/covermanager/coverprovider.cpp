@@ -21,11 +21,31 @@
 
 #include "config.h"
 
+#include <climits>
+#include <algorithm>
+
 #include <QObject>
 #include <QString>
+#include <QNetworkRequest>
+#include <QNetworkReply>
 
+#include "core/logging.h"
 #include "core/shared_ptr.h"
+#include "core/networkaccessmanager.h"
 #include "core/application.h"
 #include "coverprovider.h"
 
 CoverProvider::CoverProvider(const QString &name, const bool enabled, const bool authentication_required, const float quality, const bool batch, const bool allow_missing_album, Application *app, SharedPtr<NetworkAccessManager> network, QObject *parent) : QObject(parent), app_(app), network_(network), name_(name), enabled_(enabled), order_(0), authentication_required_(authentication_required), quality_(quality), batch_(batch), allow_missing_album_(allow_missing_album) {}
+
+void CoverProvider::CheckRateLimited(QNetworkReply *reply) {
+
+  const int http_code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (http_code != 429 && http_code != 503) return;
+
+  const qint64 retry_after_ms = NetworkAccessManager::RetryAfterMsec(reply);
+
+  qLog(Debug) << name_ << "is rate limiting requests, received HTTP code" << http_code;
+
+  emit RateLimited(static_cast<int>(std::min(retry_after_ms, static_cast<qint64>(INT_MAX))));
+
+}
@@ -33,6 +33,7 @@
 #include "core/shared_ptr.h"
 #include "albumcoverfetcher.h"
 
+class QNetworkReply;
 class Application;
 class NetworkAccessManager;
 
@@ -74,11 +75,16 @@ class CoverProvider : public QObject {
   void AuthenticationFailure(const QStringList &errors);
   void SearchResults(const int id, const CoverProviderSearchResults &results);
   void SearchFinished(const int id, const CoverProviderSearchResults &results);
+  // The service asked us to slow down, retry_after_ms is 0 if it didn't say for how long.
+  void RateLimited(const int retry_after_ms);
 
  protected:
   using Param = QPair<QString, QString>;
   using ParamList = QList<Param>;
 
+  // Emits RateLimited if the reply is HTTP 429 or 503.
+  void CheckRateLimited(QNetworkReply *reply);
+
   Application *app_;
   SharedPtr<NetworkAccessManager> network_;
   QString name_;
@@ -35,12 +35,13 @@
 #include "core/settings.h"
 #include "coverprovider.h"
 #include "coverproviders.h"
+#include "coverproviderscheduler.h"
 
 #include "settings/coverssettingspage.h"
 
 int CoverProviders::NextOrderId = 0;
 
-CoverProviders::CoverProviders(QObject *parent) : QObject(parent) {}
+CoverProviders::CoverProviders(QObject *parent) : QObject(parent), scheduler_(new CoverProviderScheduler(this)) {}
 
 CoverProviders::~CoverProviders() {
 
@@ -33,6 +33,7 @@
 #include <QAtomicInt>
 
 class CoverProvider;
+class CoverProviderScheduler;
 
 // This is a repository for cover providers.
 // Providers are automatically unregistered from the repository when they are deleted.  The class is thread safe.
@@ -59,6 +60,9 @@ class CoverProviders : public QObject {
 
   int NextId();
 
+  // Shared by all cover fetchers so the limits apply to all requests to a provider.
+  CoverProviderScheduler *scheduler() const { return scheduler_; }
+
  private slots:
   void ProviderDestroyed();
 
@@ -71,6 +75,8 @@ class CoverProviders : public QObject {
   QMutex mutex_;
 
   QAtomicInt next_id_;
+
+  CoverProviderScheduler *scheduler_;
 };
 
 #endif  // COVERPROVIDERS_H
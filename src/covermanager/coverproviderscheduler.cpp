@@ -0,0 +1,231 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include <QObject>
+#include <QTimer>
+#include <QList>
+
+#include "core/logging.h"
+#include "coverprovider.h"
+#include "coverproviderscheduler.h"
+
+const double CoverProviderScheduler::kDefaultRequestsPerSecond = 4.0;
+const int CoverProviderScheduler::kDefaultBurst = 4;
+const int CoverProviderScheduler::kDefaultMaxConcurrency = 8;
+const double CoverProviderScheduler::kInitialConcurrency = 2.0;
+const qint64 CoverProviderScheduler::kMinBackoffMsec = 2000;
+const qint64 CoverProviderScheduler::kMaxBackoffMsec = 300000;
+
+CoverProviderScheduler::CoverProviderScheduler(QObject *parent)
+    : QObject(parent),
+      timer_dispatch_(new QTimer(this)),
+      requests_per_second_(kDefaultRequestsPerSecond),
+      burst_(kDefaultBurst),
+      max_concurrency_(kDefaultMaxConcurrency) {
+
+  timer_clock_.start();
+  clock_ = [this]() { return timer_clock_.elapsed(); };
+
+  timer_dispatch_->setSingleShot(true);
+  QObject::connect(timer_dispatch_, &QTimer::timeout, this, &CoverProviderScheduler::Dispatch);
+
+}
+
+void CoverProviderScheduler::set_rate(const double requests_per_second, const int burst) {
+
+  requests_per_second_ = requests_per_second;
+  burst_ = std::max(1, burst);
+
+}
+
+CoverProviderScheduler::ProviderState &CoverProviderScheduler::State(CoverProvider *provider) {
+
+  if (!providers_.contains(provider)) {
+    ProviderState &state = providers_[provider];
+    state.tokens = burst_;
+    state.concurrency = kInitialConcurrency;
+    state.refilled_msec = clock_();
+    QObject::connect(provider, &CoverProvider::RateLimited, this, &CoverProviderScheduler::ProviderRateLimited);
+    QObject::connect(provider, &CoverProvider::destroyed, this, &CoverProviderScheduler::ProviderDestroyed);
+    return state;
+  }
+
+  return providers_[provider];
+
+}
+
+void CoverProviderScheduler::Schedule(CoverProvider *provider, QObject *context, StartFunction start) {
+
+  QueuedRequest request;
+  request.context = context;
+  request.start = std::move(start);
+  State(provider).queue.enqueue(request);
+
+  ScheduleDispatch(0);
+
+}
+
+void CoverProviderScheduler::Finished(CoverProvider *provider) {
+
+  if (!providers_.contains(provider)) return;
+
+  ProviderState &state = providers_[provider];
+  state.active = std::max(0, state.active - 1);
+
+  // Grow the window by about one request for each window of successful requests.
+  if (clock_() >= state.paused_until_msec) {
+    state.concurrency = std::min(static_cast<double>(max_concurrency_), state.concurrency + 1.0 / state.concurrency);
+    state.backoff_msec = 0;
+  }
+
+  ScheduleDispatch(0);
+
+}
+
+void CoverProviderScheduler::Cancel(QObject *context) {
+
+  for (ProviderState &state : providers_) {
+    for (QQueue<QueuedRequest>::iterator it = state.queue.begin(); it != state.queue.end();) {
+      if (it->context == context) {
+        it = state.queue.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+
+}
+
+int CoverProviderScheduler::queued(CoverProvider *provider) const {
+  return providers_.contains(provider) ? static_cast<int>(providers_[provider].queue.count()) : 0;
+}
+
+int CoverProviderScheduler::active(CoverProvider *provider) const {
+  return providers_.contains(provider) ? providers_[provider].active : 0;
+}
+
+int CoverProviderScheduler::concurrency(CoverProvider *provider) const {
+  return static_cast<int>(std::floor(providers_.contains(provider) ? providers_[provider].concurrency : kInitialConcurrency));
+}
+
+bool CoverProviderScheduler::paused(CoverProvider *provider) const {
+  return providers_.contains(provider) && clock_() < providers_[provider].paused_until_msec;
+}
+
+void CoverProviderScheduler::ScheduleDispatch(const qint64 delay_msec) {
+
+  if (timer_dispatch_->isActive() && timer_dispatch_->remainingTime() <= delay_msec) return;
+
+  timer_dispatch_->start(static_cast<int>(delay_msec));
+
+}
+
+void CoverProviderScheduler::Dispatch() {
+
+  const qint64 now_msec = clock_();
+  qint64 next_dispatch_msec = -1;
+
+  // Collect the requests first, starting a search might call back into the scheduler.
+  QList<StartFunction> starts;
+  for (ProviderState &state : providers_) {
+    state.tokens = std::min(static_cast<double>(burst_), state.tokens + static_cast<double>(now_msec - state.refilled_msec) * requests_per_second_ / 1000.0);
+    state.refilled_msec = now_msec;
+
+    while (!state.queue.isEmpty() && !state.queue.head().context) {
+      state.queue.dequeue();
+    }
+    if (state.queue.isEmpty()) continue;
+
+    if (now_msec < state.paused_until_msec) {
+      const qint64 wait_msec = state.paused_until_msec - now_msec;
+      next_dispatch_msec = next_dispatch_msec == -1 ? wait_msec : std::min(next_dispatch_msec, wait_msec);
+      continue;
+    }
+
+    while (!state.queue.isEmpty() && state.active < static_cast<int>(std::floor(state.concurrency)) && state.tokens >= 1.0) {
+      QueuedRequest request = state.queue.dequeue();
+      if (!request.context) continue;
+      state.tokens -= 1.0;
+      ++state.active;
+      starts << request.start;
+    }
+
+    // If we're waiting for a request to finish, Finished() will dispatch again.
+    if (!state.queue.isEmpty() && state.tokens < 1.0 && requests_per_second_ > 0.0) {
+      const qint64 wait_msec = static_cast<qint64>(std::ceil((1.0 - state.tokens) * 1000.0 / requests_per_second_));
+      next_dispatch_msec = next_dispatch_msec == -1 ? wait_msec : std::min(next_dispatch_msec, wait_msec);
+    }
+  }
+
+  if (next_dispatch_msec >= 0) {
+    ScheduleDispatch(next_dispatch_msec);
+  }
+
+  for (const StartFunction &start : std::as_const(starts)) {
+    start();
+  }
+
+}
+
+void CoverProviderScheduler::ProviderRateLimited(const int retry_after_msec) {
+
+  CoverProvider *provider = qobject_cast<CoverProvider*>(sender());
+  if (!provider || !providers_.contains(provider)) return;
+
+  ProviderState &state = providers_[provider];
+  const qint64 now_msec = clock_();
+
+  // Requests already in flight when we were rate limited are likely to fail too, only back off once for them.
+  if (now_msec < state.paused_until_msec) {
+    if (retry_after_msec > 0) {
+      state.paused_until_msec = std::max(state.paused_until_msec, now_msec + std::min(static_cast<qint64>(retry_after_msec), kMaxBackoffMsec));
+    }
+    return;
+  }
+
+  // Use Retry-After if the provider sent it, otherwise double the pause for each time we're rate limited in a row.
+  if (retry_after_msec > 0) {
+    state.backoff_msec = std::min(static_cast<qint64>(retry_after_msec), kMaxBackoffMsec);
+  }
+  else {
+    state.backoff_msec = state.backoff_msec == 0 ? kMinBackoffMsec : std::min(state.backoff_msec * 2, kMaxBackoffMsec);
+  }
+  state.paused_until_msec = now_msec + state.backoff_msec;
+  state.concurrency = std::max(1.0, state.concurrency / 2.0);
+  state.tokens = 0.0;
+
+  qLog(Debug) << "Pausing" << provider->name() << "for" << state.backoff_msec << "ms, concurrency is now" << static_cast<int>(state.concurrency);
+
+  ScheduleDispatch(state.backoff_msec);
+
+}
+
+void CoverProviderScheduler::ProviderDestroyed() {
+
+  CoverProvider *provider = static_cast<CoverProvider*>(sender());
+  providers_.remove(provider);
+
+}
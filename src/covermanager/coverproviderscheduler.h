@@ -0,0 +1,113 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COVERPROVIDERSCHEDULER_H
+#define COVERPROVIDERSCHEDULER_H
+
+#include "config.h"
+
+#include <functional>
+#include <utility>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QQueue>
+#include <QElapsedTimer>
+
+class QTimer;
+class CoverProvider;
+
+// Decides when searches are started on each cover provider, so fetching many covers doesn't overload the services.
+// Each provider has a token bucket limiting the request rate, and a concurrency window which grows slowly while requests succeed,
+// and is halved when the provider rate limits us (HTTP 429 or 503), in which case the provider is also paused for a while.
+class CoverProviderScheduler : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit CoverProviderScheduler(QObject *parent = nullptr);
+
+  static const double kDefaultRequestsPerSecond;
+  static const int kDefaultBurst;
+  static const int kDefaultMaxConcurrency;
+
+  using StartFunction = std::function<void()>;
+  // Returns milliseconds since an arbitrary start.
+  using ClockFunction = std::function<qint64()>;
+
+  void set_rate(const double requests_per_second, const int burst);
+  void set_max_concurrency(const int max_concurrency) { max_concurrency_ = max_concurrency; }
+  // Replaces the monotonic clock, so tests can advance time without waiting.
+  void set_clock(ClockFunction clock) { clock_ = std::move(clock); }
+
+  // Calls start from the event loop when the provider can take another request, unless context is deleted or cancelled first.
+  void Schedule(CoverProvider *provider, QObject *context, StartFunction start);
+  // Must be called once for each started request when it's finished or cancelled.
+  void Finished(CoverProvider *provider);
+  // Drops all queued requests for context.
+  void Cancel(QObject *context);
+
+  // Starts the requests that can be started now, normally called from a timer after Schedule() and Finished().
+  void Dispatch();
+
+  int queued(CoverProvider *provider) const;
+  int active(CoverProvider *provider) const;
+  int concurrency(CoverProvider *provider) const;
+  bool paused(CoverProvider *provider) const;
+
+ private:
+  struct QueuedRequest {
+    QPointer<QObject> context;
+    StartFunction start;
+  };
+
+  struct ProviderState {
+    ProviderState() : tokens(0.0), concurrency(0.0), active(0), refilled_msec(0), paused_until_msec(0), backoff_msec(0) {}
+    double tokens;
+    double concurrency;
+    int active;
+    qint64 refilled_msec;
+    qint64 paused_until_msec;
+    qint64 backoff_msec;
+    QQueue<QueuedRequest> queue;
+  };
+
+  ProviderState &State(CoverProvider *provider);
+  void ScheduleDispatch(const qint64 delay_msec);
+
+ private slots:
+  void ProviderRateLimited(const int retry_after_msec);
+  void ProviderDestroyed();
+
+ private:
+  static const double kInitialConcurrency;
+  static const qint64 kMinBackoffMsec;
+  static const qint64 kMaxBackoffMsec;
+
+  QElapsedTimer timer_clock_;
+  ClockFunction clock_;
+  QTimer *timer_dispatch_;
+  double requests_per_second_;
+  int burst_;
+  int max_concurrency_;
+  QHash<CoverProvider*, ProviderState> providers_;
+};
+
+#endif  // COVERPROVIDERSCHEDULER_H
@@ -295,6 +295,7 @@ QByteArray LastFmCoverProvider::GetReplyData(QNetworkReply *reply) {
     data = reply->readAll();
   }
   else {
+    CheckRateLimited(reply);
     if (reply->error() != QNetworkReply::NoError && reply->error() < 200) {
       // This is a network error, there is nothing more to do.
       Error(QStringLiteral("%1 (%2)").arg(reply->errorString()).arg(reply->error()));
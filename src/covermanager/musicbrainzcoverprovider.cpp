@@ -234,6 +234,7 @@ QByteArray MusicbrainzCoverProvider::GetReplyData(QNetworkReply *reply) {
     data = reply->readAll();
   }
   else {
+    CheckRateLimited(reply);
     if (reply->error() != QNetworkReply::NoError && reply->error() < 200) {
       // This is a network error, there is nothing more to do.
       QString failure_reason = QStringLiteral("%1 (%2)").arg(reply->errorString()).arg(reply->error());
@@ -89,6 +89,8 @@ void MusixmatchCoverProvider::HandleSearchReply(QNetworkReply *reply, const int
 
   CoverProviderSearchResults results;
 
+  CheckRateLimited(reply);
+
   if (reply->error() != QNetworkReply::NoError) {
     Error(QStringLiteral("%1 (%2)").arg(reply->errorString()).arg(reply->error()));
     emit SearchFinished(id, results);
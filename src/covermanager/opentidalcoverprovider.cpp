@@ -249,6 +249,8 @@ QJsonObject OpenTidalCoverProvider::ExtractJsonObj(const QByteArray &data) {
 
 QJsonObject OpenTidalCoverProvider::GetJsonObject(QNetworkReply *reply) {
 
+  CheckRateLimited(reply);
+
   if (reply->error() != QNetworkReply::NoError) {
     qLog(Error) << "OpenTidal:" << reply->errorString() << reply->error();
     return QJsonObject();
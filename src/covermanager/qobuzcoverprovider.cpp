@@ -121,6 +121,7 @@ QByteArray QobuzCoverProvider::GetReplyData(QNetworkReply *reply) {
     data = reply->readAll();
   }
   else {
+    CheckRateLimited(reply);
     if (reply->error() != QNetworkReply::NoError && reply->error() < 200) {
       // This is a network error, there is nothing more to do.
       Error(QStringLiteral("%1 (%2)").arg(reply->errorString()).arg(reply->error()));
@@ -0,0 +1,438 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QMutex>
+#include <QList>
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+#include <QSize>
+#include <QImage>
+#include <QCryptographicHash>
+
+#include "core/logging.h"
+#include "core/song.h"
+#include "thumbnailstore.h"
+
+// File layout:
+//   header: magic (8 bytes), version (4 bytes), tile width (4 bytes), tile height (4 bytes), reserved (12 bytes)
+//   tiles: key (8 bytes), cover source hash (8 bytes), flags (4 bytes), width (4 bytes), height (4 bytes), reserved (4 bytes), pixels (tile width * tile height * 4 bytes)
+// The header numbers are little endian, the pixels are QImage::Format_ARGB32_Premultiplied in native byte order.
+// The headers are 32 bytes so the pixels of every tile are aligned.
+
+const char ThumbnailStore::kMagic[] = "SBTHUMBS";
+const quint32 ThumbnailStore::kVersion = 1;
+const qint64 ThumbnailStore::kFileHeaderSize = 32;
+const qint64 ThumbnailStore::kTileHeaderSize = 32;
+const int ThumbnailStore::kGrowSlots = 64;
+
+QMutex ThumbnailStore::sStoresMutex;
+QList<ThumbnailStore*> ThumbnailStore::sStores;
+
+namespace {
+
+constexpr quint32 kFlagUsed = 0x1;
+
+quint64 HashToKey(const QByteArray &data) {
+
+  const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+  return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(hash.constData()));
+
+}
+
+}  // namespace
+
+ThumbnailStore::ThumbnailStore(const QString &filename, const QSize tile_size, const qint64 max_size)
+    : filename_(filename),
+      tile_size_(tile_size),
+      tile_bytes_(static_cast<qint64>(tile_size.width()) * tile_size.height() * 4),
+      max_size_(max_size),
+      map_(nullptr),
+      map_size_(0),
+      slots_(0),
+      next_reuse_slot_(0) {
+
+  QMutexLocker l(&sStoresMutex);
+  sStores << this;
+
+}
+
+ThumbnailStore::~ThumbnailStore() {
+
+  {
+    QMutexLocker l(&sStoresMutex);
+    sStores.removeAll(this);
+  }
+
+  Close();
+
+}
+
+quint64 ThumbnailStore::AlbumKey(const Song::Source source, const QString &effective_albumartist, const QString &album) {
+
+  return HashToKey(Song::TextForSource(source).toUtf8() + '\n' + effective_albumartist.toUtf8() + '\n' + album.toUtf8());
+
+}
+
+quint64 ThumbnailStore::CoverSourceHash(const bool art_embedded, const QUrl &art_automatic, const QUrl &art_manual, const bool art_unset) {
+
+  return HashToKey(QByteArray::number(art_embedded) + '\n' + art_automatic.toEncoded() + '\n' + art_manual.toEncoded() + '\n' + QByteArray::number(art_unset));
+
+}
+
+quint64 ThumbnailStore::CoverSourceHash(const Song &song) {
+
+  return CoverSourceHash(song.art_embedded(), song.art_automatic(), song.art_manual(), song.art_unset());
+
+}
+
+void ThumbnailStore::InvalidateAlbum(const Song::Source source, const QString &effective_albumartist, const QString &album) {
+
+  const quint64 key = AlbumKey(source, effective_albumartist, album);
+
+  QMutexLocker l(&sStoresMutex);
+  for (ThumbnailStore *store : std::as_const(sStores)) {
+    store->Remove(key);
+  }
+
+}
+
+bool ThumbnailStore::Open() {
+
+  QMutexLocker l(&mutex_);
+  return OpenLocked();
+
+}
+
+void ThumbnailStore::Close() {
+
+  QMutexLocker l(&mutex_);
+  CloseLocked();
+
+}
+
+bool ThumbnailStore::OpenLocked() {
+
+  CloseLocked();
+
+  if (tile_size_.isEmpty()) return false;
+
+  const QFileInfo fileinfo(filename_);
+  if (!fileinfo.dir().exists() && !QDir().mkpath(fileinfo.dir().path())) {
+    qLog(Error) << "Could not create directory for" << filename_;
+    return false;
+  }
+
+  file_.setFileName(filename_);
+  if (!file_.open(QIODevice::ReadWrite)) {
+    qLog(Error) << "Could not open thumbnail store" << filename_ << file_.errorString();
+    return false;
+  }
+
+  bool valid_header = false;
+  if (file_.size() >= kFileHeaderSize) {
+    const QByteArray header = file_.read(kFileHeaderSize);
+    const uchar *data = reinterpret_cast<const uchar*>(header.constData());
+    valid_header = header.size() == kFileHeaderSize && memcmp(data, kMagic, 8) == 0 && qFromLittleEndian<quint32>(data + 8) == kVersion && qFromLittleEndian<quint32>(data + 12) == static_cast<quint32>(tile_size_.width()) && qFromLittleEndian<quint32>(data + 16) == static_cast<quint32>(tile_size_.height());
+  }
+
+  if (!valid_header) {
+    if (file_.size() > 0) {
+      qLog(Warning) << "Discarding invalid thumbnail store" << filename_;
+    }
+    if (!InitLocked()) {
+      file_.close();
+      return false;
+    }
+  }
+
+  // Drop a partially written tile at the end.
+  const qint64 slot_size = kTileHeaderSize + tile_bytes_;
+  slots_ = static_cast<int>((file_.size() - kFileHeaderSize) / slot_size);
+  if (file_.size() != SlotOffset(slots_) && !file_.resize(SlotOffset(slots_))) {
+    qLog(Error) << "Could not truncate thumbnail store" << filename_ << file_.errorString();
+    file_.close();
+    return false;
+  }
+
+  if (!MapLocked()) {
+    file_.close();
+    return false;
+  }
+
+  // Build the index from the tile headers.
+  for (int slot = 0; slot < slots_; ++slot) {
+    const uchar *header = map_ + SlotOffset(slot);
+    const quint64 key = qFromLittleEndian<quint64>(header);
+    const quint32 flags = qFromLittleEndian<quint32>(header + 16);
+    if (flags & kFlagUsed) {
+      if (index_.contains(key)) {
+        const int old_slot = index_.value(key);
+        RemoveSlotLocked(old_slot);
+        free_slots_.prepend(old_slot);
+      }
+      index_.insert(key, slot);
+    }
+    else {
+      free_slots_.prepend(slot);
+    }
+  }
+
+  qLog(Debug) << "Opened thumbnail store" << filename_ << "with" << index_.count() << "thumbnails of" << tile_size_;
+
+  return true;
+
+}
+
+void ThumbnailStore::CloseLocked() {
+
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+  map_size_ = 0;
+  if (file_.isOpen()) file_.close();
+  slots_ = 0;
+  index_.clear();
+  free_slots_.clear();
+  next_reuse_slot_ = 0;
+
+}
+
+bool ThumbnailStore::InitLocked() {
+
+  QByteArray header(static_cast<int>(kFileHeaderSize), 0);
+  uchar *data = reinterpret_cast<uchar*>(header.data());
+  memcpy(data, kMagic, 8);
+  qToLittleEndian<quint32>(kVersion, data + 8);
+  qToLittleEndian<quint32>(static_cast<quint32>(tile_size_.width()), data + 12);
+  qToLittleEndian<quint32>(static_cast<quint32>(tile_size_.height()), data + 16);
+
+  if (!file_.resize(0) || !file_.seek(0) || file_.write(header) != kFileHeaderSize || !file_.flush()) {
+    qLog(Error) << "Could not initialize thumbnail store" << filename_ << file_.errorString();
+    return false;
+  }
+
+  return true;
+
+}
+
+bool ThumbnailStore::MapLocked() {
+
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+
+  map_size_ = file_.size();
+  map_ = file_.map(0, map_size_);
+  if (!map_) {
+    qLog(Error) << "Could not map thumbnail store" << filename_ << file_.errorString();
+    map_size_ = 0;
+    return false;
+  }
+
+  return true;
+
+}
+
+qint64 ThumbnailStore::SlotOffset(const int slot) const {
+
+  return kFileHeaderSize + static_cast<qint64>(slot) * (kTileHeaderSize + tile_bytes_);
+
+}
+
+int ThumbnailStore::TakeSlotLocked() {
+
+  if (!free_slots_.isEmpty()) {
+    return free_slots_.takeLast();
+  }
+
+  // Grow the file, as long as it stays below the maximum size.
+  const int max_slots = static_cast<int>(qMax(0LL, (max_size_ - kFileHeaderSize) / (kTileHeaderSize + tile_bytes_)));
+  const int new_slots = std::min(kGrowSlots, max_slots - slots_);
+  if (new_slots > 0) {
+    if (file_.resize(SlotOffset(slots_ + new_slots)) && MapLocked()) {
+      for (int slot = slots_ + new_slots - 1; slot >= slots_; --slot) {
+        free_slots_ << slot;
+      }
+      slots_ += new_slots;
+      return free_slots_.takeLast();
+    }
+    qLog(Error) << "Could not grow thumbnail store" << filename_ << file_.errorString();
+    if (!map_ && !MapLocked()) return -1;
+  }
+
+  if (slots_ == 0) return -1;
+
+  // The store is full, reuse the tiles in turn.
+  const int slot = next_reuse_slot_ % slots_;
+  next_reuse_slot_ = (slot + 1) % slots_;
+  RemoveSlotLocked(slot);
+
+  return slot;
+
+}
+
+void ThumbnailStore::RemoveSlotLocked(const int slot) {
+
+  uchar *header = map_ + SlotOffset(slot);
+  const quint64 key = qFromLittleEndian<quint64>(header);
+  if (index_.value(key, -1) == slot) {
+    index_.remove(key);
+  }
+  qToLittleEndian<quint32>(0, header + 16);
+
+}
+
+QImage ThumbnailStore::Get(const quint64 key, const quint64 cover_source_hash) {
+
+  QMutexLocker l(&mutex_);
+
+  if (!map_ || !index_.contains(key)) return QImage();
+
+  const uchar *header = map_ + SlotOffset(index_.value(key));
+  if (qFromLittleEndian<quint64>(header + 8) != cover_source_hash) return QImage();
+
+  const int width = static_cast<int>(qFromLittleEndian<quint32>(header + 20));
+  const int height = static_cast<int>(qFromLittleEndian<quint32>(header + 24));
+  if (width <= 0 || height <= 0 || width > tile_size_.width() || height > tile_size_.height()) return QImage();
+
+  // The mapping changes when the file grows, so the caller gets its own copy.
+  QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+  const uchar *pixels = header + kTileHeaderSize;
+  const qint64 tile_line_bytes = static_cast<qint64>(tile_size_.width()) * 4;
+  for (int y = 0; y < height; ++y) {
+    memcpy(image.scanLine(y), pixels + (y * tile_line_bytes), static_cast<size_t>(width) * 4);
+  }
+
+  return image;
+
+}
+
+bool ThumbnailStore::Put(const quint64 key, const quint64 cover_source_hash, const QImage &image) {
+
+  if (image.isNull() || image.width() > tile_size_.width() || image.height() > tile_size_.height()) return false;
+
+  const QImage tile_image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+  QMutexLocker l(&mutex_);
+
+  if (!map_) return false;
+
+  int slot = index_.value(key, -1);
+  if (slot == -1) {
+    slot = TakeSlotLocked();
+    if (slot == -1) return false;
+  }
+
+  // Clear the used flag while writing, so a crash leaves a free tile instead of a broken one.
+  uchar *header = map_ + SlotOffset(slot);
+  qToLittleEndian<quint32>(0, header + 16);
+
+  uchar *pixels = header + kTileHeaderSize;
+  const qint64 tile_line_bytes = static_cast<qint64>(tile_size_.width()) * 4;
+  for (int y = 0; y < tile_image.height(); ++y) {
+    memcpy(pixels + (y * tile_line_bytes), tile_image.constScanLine(y), static_cast<size_t>(tile_image.width()) * 4);
+  }
+
+  qToLittleEndian<quint64>(key, header);
+  qToLittleEndian<quint64>(cover_source_hash, header + 8);
+  qToLittleEndian<quint32>(static_cast<quint32>(tile_image.width()), header + 20);
+  qToLittleEndian<quint32>(static_cast<quint32>(tile_image.height()), header + 24);
+  qToLittleEndian<quint32>(kFlagUsed, header + 16);
+
+  index_.insert(key, slot);
+
+  return true;
+
+}
+
+void ThumbnailStore::Remove(const quint64 key) {
+
+  QMutexLocker l(&mutex_);
+
+  if (!map_ || !index_.contains(key)) return;
+
+  const int slot = index_.value(key);
+  RemoveSlotLocked(slot);
+  free_slots_ << slot;
+
+}
+
+void ThumbnailStore::Clear() {
+
+  QMutexLocker l(&mutex_);
+
+  if (!file_.isOpen()) return;
+
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+  map_size_ = 0;
+  slots_ = 0;
+  index_.clear();
+  free_slots_.clear();
+  next_reuse_slot_ = 0;
+
+  if (!InitLocked() || !MapLocked()) {
+    CloseLocked();
+  }
+
+}
+
+void ThumbnailStore::set_max_size(const qint64 max_size) {
+
+  bool clear = false;
+  {
+    QMutexLocker l(&mutex_);
+    max_size_ = max_size;
+    clear = map_size_ > max_size_;
+  }
+
+  if (clear) Clear();
+
+}
+
+int ThumbnailStore::count() {
+
+  QMutexLocker l(&mutex_);
+  return static_cast<int>(index_.count());
+
+}
+
+qint64 ThumbnailStore::file_size() {
+
+  QMutexLocker l(&mutex_);
+  return map_size_;
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QList>
+#include <QHash>
+#include <QFile>
+#include <QString>
+#include <QSize>
+#include <QImage>
+
+#include "core/song.h"
+
+class QUrl;
+
+// Album thumbnails packed in a single memory mapped file of fixed size tiles.
+// The pixels are stored raw as premultiplied ARGB32, so reading a thumbnail is a copy instead of a decode.
+// Each tile is keyed by the album and stores a hash of where the cover came from, so a thumbnail isn't returned after the album gets a different cover.
+// A cover file replaced in place has the same source, so the album must be removed when its cover changes.
+// When the store is full the tiles are reused in turn, starting from the first tile each time the store is opened.
+// All methods are thread-safe.
+class ThumbnailStore {
+ public:
+  explicit ThumbnailStore(const QString &filename, const QSize tile_size, const qint64 max_size);
+  ~ThumbnailStore();
+
+  bool Open();
+  void Close();
+
+  static quint64 AlbumKey(const Song::Source source, const QString &effective_albumartist, const QString &album);
+  static quint64 CoverSourceHash(const bool art_embedded, const QUrl &art_automatic, const QUrl &art_manual, const bool art_unset);
+  static quint64 CoverSourceHash(const Song &song);
+
+  // Removes the album from all open stores, called when the album cover is changed.
+  static void InvalidateAlbum(const Song::Source source, const QString &effective_albumartist, const QString &album);
+
+  QSize tile_size() const { return tile_size_; }
+
+  // Returns a null image if there is no thumbnail for the key and cover source.
+  QImage Get(const quint64 key, const quint64 cover_source_hash);
+  // The image must not be larger than the tile size.
+  bool Put(const quint64 key, const quint64 cover_source_hash, const QImage &image);
+  void Remove(const quint64 key);
+  void Clear();
+
+  void set_max_size(const qint64 max_size);
+
+  int count();
+  qint64 file_size();
+
+ private:
+  bool OpenLocked();
+  void CloseLocked();
+  bool MapLocked();
+  bool InitLocked();
+  qint64 SlotOffset(const int slot) const;
+  int TakeSlotLocked();
+  void RemoveSlotLocked(const int slot);
+
+ private:
+  static const char kMagic[];
+  static const quint32 kVersion;
+  static const qint64 kFileHeaderSize;
+  static const qint64 kTileHeaderSize;
+  static const int kGrowSlots;
+
+  static QMutex sStoresMutex;
+  static QList<ThumbnailStore*> sStores;
+
+  const QString filename_;
+  const QSize tile_size_;
+  const qint64 tile_bytes_;
+  qint64 max_size_;
+  QMutex mutex_;
+  QFile file_;
+  uchar *map_;
+  qint64 map_size_;
+  int slots_;
+  QHash<quint64, int> index_;
+  QList<int> free_slots_;
+  int next_reuse_slot_;
+
+  Q_DISABLE_COPY(ThumbnailStore)
+};
+
+#endif  // THUMBNAILSTORE_H
@@ -0,0 +1,159 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QWidget>
+#include <QDialog>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QFont>
+#include <QShowEvent>
+#include <QHideEvent>
+
+#include "core/shared_ptr.h"
+#include "core/application.h"
+#include "core/player.h"
+#include "engine/enginebase.h"
+#include "engine/gstengine.h"
+#include "engine/gstenginepipelinemetrics.h"
+#include "pipelinemetricsdialog.h"
+
+const int PipelineMetricsDialog::kRefreshIntervalMsec = 1000;
+
+PipelineMetricsDialog::PipelineMetricsDialog(Application *app, QWidget *parent)
+    : QDialog(parent),
+      app_(app),
+      refresh_timer_(new QTimer(this)),
+      summary_(new QLabel(this)),
+      events_(new QTreeWidget(this)),
+      shown_event_count_(-1),
+      shown_last_timestamp_msec_(-1) {
+
+  setWindowTitle(tr("Playback metrics"));
+  setWindowFlags(windowFlags() | Qt::WindowMaximizeButtonHint);
+  resize(800, 480);
+
+  summary_->setWordWrap(true);
+  summary_->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+  QFont font(QStringLiteral("Monospace"));
+  font.setStyleHint(QFont::TypeWriter);
+  events_->setFont(font);
+  events_->setRootIsDecorated(false);
+  events_->setUniformRowHeights(true);
+  events_->setHeaderLabels(QStringList() << tr("Time") << tr("Pipeline") << tr("Event") << tr("Duration") << tr("Value") << tr("Details"));
+  events_->header()->setStretchLastSection(true);
+
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+  QPushButton *clear_button = buttons->addButton(tr("Clear"), QDialogButtonBox::ResetRole);
+  QObject::connect(clear_button, &QPushButton::clicked, this, &PipelineMetricsDialog::Clear);
+  QObject::connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addWidget(summary_);
+  layout->addWidget(events_);
+  layout->addWidget(buttons);
+
+  refresh_timer_->setInterval(kRefreshIntervalMsec);
+  QObject::connect(refresh_timer_, &QTimer::timeout, this, &PipelineMetricsDialog::Refresh);
+
+}
+
+void PipelineMetricsDialog::showEvent(QShowEvent *e) {
+
+  shown_event_count_ = -1;
+  Refresh();
+  refresh_timer_->start();
+
+  QDialog::showEvent(e);
+
+}
+
+void PipelineMetricsDialog::hideEvent(QHideEvent *e) {
+
+  refresh_timer_->stop();
+
+  QDialog::hideEvent(e);
+
+}
+
+SharedPtr<GstEnginePipelineMetrics> PipelineMetricsDialog::metrics() const {
+
+  SharedPtr<EngineBase> engine = app_->player()->engine();
+  if (!engine || engine->type() != EngineBase::Type::GStreamer) return SharedPtr<GstEnginePipelineMetrics>();
+
+  return static_cast<GstEngine*>(&*engine)->metrics();
+
+}
+
+void PipelineMetricsDialog::Refresh() {
+
+  SharedPtr<GstEnginePipelineMetrics> pipeline_metrics = metrics();
+  if (!pipeline_metrics) {
+    summary_->setText(tr("Playback metrics are only available with the GStreamer engine."));
+    events_->clear();
+    return;
+  }
+
+  summary_->setText(pipeline_metrics->SummaryText());
+
+  const QList<GstEnginePipelineMetrics::Event> events = pipeline_metrics->events();
+  const qint64 last_timestamp_msec = events.isEmpty() ? -1 : events.last().timestamp_msec;
+  if (events.count() == shown_event_count_ && last_timestamp_msec == shown_last_timestamp_msec_) {
+    return;
+  }
+  shown_event_count_ = static_cast<int>(events.count());
+  shown_last_timestamp_msec_ = last_timestamp_msec;
+
+  events_->clear();
+  QList<QTreeWidgetItem*> items;
+  items.reserve(events.count());
+  for (const GstEnginePipelineMetrics::Event &event : events) {
+    QTreeWidgetItem *item = new QTreeWidgetItem;
+    item->setText(0, QString::number(static_cast<double>(event.timestamp_msec) / 1000.0, 'f', 3));
+    item->setText(1, QString::number(event.pipeline_id));
+    item->setText(2, GstEnginePipelineMetrics::EventTypeName(event.type));
+    item->setText(3, event.duration_msec >= 0 ? QStringLiteral("%1 ms").arg(event.duration_msec) : QString());
+    item->setText(4, QString::number(event.value));
+    item->setText(5, event.text);
+    items << item;
+  }
+  events_->addTopLevelItems(items);
+  events_->scrollToBottom();
+
+}
+
+void PipelineMetricsDialog::Clear() {
+
+  SharedPtr<GstEnginePipelineMetrics> pipeline_metrics = metrics();
+  if (pipeline_metrics) pipeline_metrics->Clear();
+
+  Refresh();
+
+}
@@ -0,0 +1,69 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PIPELINEMETRICSDIALOG_H
+#define PIPELINEMETRICSDIALOG_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QObject>
+#include <QDialog>
+
+#include "core/shared_ptr.h"
+
+class QWidget;
+class QTimer;
+class QLabel;
+class QTreeWidget;
+class QShowEvent;
+class QHideEvent;
+class Application;
+class GstEnginePipelineMetrics;
+
+// Shows the timing spans and health events recorded by the GStreamer pipelines.
+class PipelineMetricsDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit PipelineMetricsDialog(Application *app, QWidget *parent = nullptr);
+
+ protected:
+  void showEvent(QShowEvent *e) override;
+  void hideEvent(QHideEvent *e) override;
+
+ private slots:
+  void Refresh();
+  void Clear();
+
+ private:
+  SharedPtr<GstEnginePipelineMetrics> metrics() const;
+
+ private:
+  static const int kRefreshIntervalMsec;
+
+  Application *app_;
+  QTimer *refresh_timer_;
+  QLabel *summary_;
+  QTreeWidget *events_;
+  int shown_event_count_;
+  qint64 shown_last_timestamp_msec_;
+};
+
+#endif  // PIPELINEMETRICSDIALOG_H
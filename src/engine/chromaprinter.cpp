@@ -43,9 +43,10 @@
 using u_int32_t = unsigned int;
 #endif
 
-static const int kDecodeRate = 11025;
-static const int kDecodeChannels = 1;
-static const int kPlayLengthSecs = 30;
+const int Chromaprinter::kDecodeRate = 11025;
+const int Chromaprinter::kDecodeChannels = 1;
+const int Chromaprinter::kPlayLengthSecs = 30;
+
 static const int kTimeoutSecs = 10;
 
 Chromaprinter::Chromaprinter(const QString &filename)
@@ -150,11 +151,27 @@ QString Chromaprinter::CreateFingerprint() {
   buffer_.close();
 
   // Generate fingerprint from recorded buffer data
-  QByteArray data = buffer_.data();
+  const QString fingerprint = CreateFingerprint(buffer_.data());
+
+  const qint64 codegen_time = time.elapsed();
+
+  qLog(Debug) << "Decode time:" << decode_time << "Codegen time:" << codegen_time;
+
+  // Cleanup
+  callbacks.new_sample = nullptr;
+  gst_object_unref(bus);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+
+  return fingerprint;
+
+}
+
+QString Chromaprinter::CreateFingerprint(const QByteArray &data) {
 
   ChromaprintContext *chromaprint = chromaprint_new(CHROMAPRINT_ALGORITHM_DEFAULT);
   chromaprint_start(chromaprint, kDecodeRate, kDecodeChannels);
-  chromaprint_feed(chromaprint, reinterpret_cast<int16_t*>(data.data()), static_cast<int>(data.size() / 2));
+  chromaprint_feed(chromaprint, reinterpret_cast<const int16_t*>(data.constData()), static_cast<int>(data.size() / 2));
   chromaprint_finish(chromaprint);
 
   u_int32_t *fprint = nullptr;
@@ -173,16 +190,6 @@ QString Chromaprinter::CreateFingerprint() {
   }
   chromaprint_free(chromaprint);
 
-  const qint64 codegen_time = time.elapsed();
-
-  qLog(Debug) << "Decode time:" << decode_time << "Codegen time:" << codegen_time;
-
-  // Cleanup
-  callbacks.new_sample = nullptr;
-  gst_object_unref(bus);
-  gst_element_set_state(pipeline, GST_STATE_NULL);
-  gst_object_unref(pipeline);
-
   return QString::fromUtf8(fingerprint);
 
 }
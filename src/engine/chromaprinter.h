@@ -29,6 +29,7 @@
 #include <gst/app/gstappsink.h>
 
 #include <QBuffer>
+#include <QByteArray>
 #include <QString>
 
 class Chromaprinter {
@@ -46,6 +47,15 @@ class Chromaprinter {
   // Returns an empty string if no fingerprint could be created.
   QString CreateFingerprint();
 
+  // Creates a fingerprint from PCM data decoded elsewhere, in the format given by the constants below.
+  static QString CreateFingerprint(const QByteArray &data);
+
+  // Chromaprint expects mono 16-bit ints at a sample rate of 11025Hz.
+  static const int kDecodeRate;
+  static const int kDecodeChannels;
+  // Only the beginning of the song is fingerprinted.
+  static const int kPlayLengthSecs;
+
  private:
   static GstElement *CreateElement(const QString &factory_name, GstElement *bin = nullptr);
 
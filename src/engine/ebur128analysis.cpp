@@ -343,31 +343,48 @@ void EBUR128AnalysisImpl::NewPadCallback(GstElement *elt, GstPad *pad, gpointer
 
 }
 
-GstFlowReturn EBUR128AnalysisImpl::NewBufferCallback(GstAppSink *app_sink, gpointer self) {
-
-  EBUR128AnalysisImpl *me = reinterpret_cast<EBUR128AnalysisImpl*>(self);
+bool AddSampleToState(std::optional<EBUR128State> &state, GstSample *sample) {
 
-  unique_ptr<GstSample, GstSampleDeleter> sample(gst_app_sink_pull_sample(app_sink));
-  if (!sample) return GST_FLOW_ERROR;
-
-  const FrameFormat dsc(gst_sample_get_caps(&*sample));
-  if (!me->state) {
-    me->state.emplace(dsc);
+  const FrameFormat dsc(gst_sample_get_caps(sample));
+  if (!state) {
+    state.emplace(dsc);
   }
-  else if (me->state->dsc != dsc) {
-    return GST_FLOW_ERROR;
+  else if (state->dsc != dsc) {
+    return false;
   }
 
-  GstBuffer *buffer = gst_sample_get_buffer(&*sample);
+  GstBuffer *buffer = gst_sample_get_buffer(sample);
   if (buffer) {
     GstMapInfo map;
     if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-      me->state->AddFrames(reinterpret_cast<const char*>(map.data), static_cast<qint64>(map.size));
+      state->AddFrames(reinterpret_cast<const char*>(map.data), static_cast<qint64>(map.size));
       gst_buffer_unmap(buffer, &map);
     }
   }
 
-  return GST_FLOW_OK;
+  return true;
+
+}
+
+GstCaps *EBUR128Caps() {
+
+  GstStaticCaps static_caps = GST_STATIC_CAPS(
+    "audio/x-raw,"
+    "format = (string) { S16LE, S32LE, F32LE, F64LE },"
+    "layout = (string) interleaved");
+
+  return gst_static_caps_get(&static_caps);
+
+}
+
+GstFlowReturn EBUR128AnalysisImpl::NewBufferCallback(GstAppSink *app_sink, gpointer self) {
+
+  EBUR128AnalysisImpl *me = reinterpret_cast<EBUR128AnalysisImpl*>(self);
+
+  unique_ptr<GstSample, GstSampleDeleter> sample(gst_app_sink_pull_sample(app_sink));
+  if (!sample) return GST_FLOW_ERROR;
+
+  return AddSampleToState(me->state, &*sample) ? GST_FLOW_OK : GST_FLOW_ERROR;
 
 }
 
@@ -410,12 +427,7 @@ std::optional<EBUR128Measures> EBUR128AnalysisImpl::Compute(const Song &song) {
   // Connect the elements
   gst_element_link_many(src, decode, nullptr);
 
-  GstStaticCaps static_caps = GST_STATIC_CAPS(
-    "audio/x-raw,"
-    "format = (string) { S16LE, S32LE, F32LE, F64LE },"
-    "layout = (string) interleaved");
-
-  GstCaps *caps = gst_static_caps_get(&static_caps);
+  GstCaps *caps = EBUR128Caps();
   // Place a queue before the sink. It really does matter for performance.
   gst_element_link_filtered(convert, queue, caps);
   gst_element_link_many(queue, sink, nullptr);
@@ -510,3 +522,42 @@ std::optional<EBUR128Measures> EBUR128Analysis::Compute(const Song &song) {
   return EBUR128AnalysisImpl::Compute(song);
 
 }
+
+struct EBUR128Accumulator::Private {
+  std::optional<EBUR128State> state;
+  bool failed = false;
+};
+
+EBUR128Accumulator::EBUR128Accumulator() : d_(new Private) {}
+
+EBUR128Accumulator::~EBUR128Accumulator() = default;
+
+GstCaps *EBUR128Accumulator::SupportedCaps() {
+
+  return EBUR128Caps();
+
+}
+
+bool EBUR128Accumulator::AddSample(GstSample *sample) {
+
+  if (d_->failed) return false;
+
+  if (!AddSampleToState(d_->state, sample)) {
+    d_->failed = true;
+    return false;
+  }
+
+  return true;
+
+}
+
+std::optional<EBUR128Measures> EBUR128Accumulator::Finish() {
+
+  if (d_->failed || !d_->state) return std::nullopt;
+
+  std::optional<EBUR128Measures> result = EBUR128State::Finalize(std::move(d_->state.value()));
+  d_->state.reset();
+
+  return result;
+
+}
@@ -24,6 +24,11 @@
 
 #include <optional>
 
+#include <gst/gst.h>
+
+#include <QtGlobal>
+
+#include "core/scoped_ptr.h"
 #include "core/song.h"
 #include "ebur128measures.h"
 
@@ -38,4 +43,28 @@ class EBUR128Analysis {
   static std::optional<EBUR128Measures> Compute(const Song &song);
 };
 
+// Incremental EBU R 128 analysis of audio decoded by someone else,
+// used when several analyses share a single decoding pipeline.
+class EBUR128Accumulator {
+ public:
+  EBUR128Accumulator();
+  ~EBUR128Accumulator();
+
+  // The raw audio formats accepted by AddSample().
+  // The caller owns the returned caps.
+  static GstCaps *SupportedCaps();
+
+  // Returns false if the sample can not be analyzed, for example if the format changed.
+  bool AddSample(GstSample *sample);
+
+  // Returns `std::nullopt` if no audio was added.
+  std::optional<EBUR128Measures> Finish();
+
+ private:
+  struct Private;
+  ScopedPtr<Private> d_;
+
+  Q_DISABLE_COPY(EBUR128Accumulator)
+};
+
 #endif  // EBUR128ANALYSIS_H
@@ -37,6 +37,7 @@
 #include <QVariant>
 #include <QString>
 #include <QUrl>
+#include <QElapsedTimer>
 
 #include "devicefinders.h"
 #include "enginemetadata.h"
@@ -104,6 +105,8 @@ class EngineBase : public QObject {
   virtual bool Init() = 0;
   virtual State state() const = 0;
   virtual void StartPreloading(const QUrl&, const QUrl&, const bool, const qint64, const qint64) {}
+  // Prepares the track that is most likely played next, so that skipping to it doesn't have to wait for it to be opened.
+  virtual void PrepareStandby(const QUrl&, const QUrl&, const bool, const qint64, const qint64) {}
   virtual bool Load(const QUrl &media_url, const QUrl &stream_url, const TrackChangeFlags change, const bool force_stop_at_end, const quint64 beginning_nanosec, const qint64 end_nanosec, const std::optional<double> ebur128_integrated_loudness_lufs);
   virtual bool Play(const quint64 offset_nanosec) = 0;
   virtual void Stop(const bool stop_after = false) = 0;
@@ -136,6 +139,9 @@ class EngineBase : public QObject {
   bool Play(const QUrl &media_url, const QUrl &stream_url, const TrackChangeFlags flags, const bool force_stop_at_end, const quint64 beginning_nanosec, const qint64 end_nanosec, const quint64 offset_nanosec, const std::optional<double> ebur128_integrated_loudness_lufs);
   void SetVolume(const uint volume);
 
+  // Called when the user changes track, the engine measures the time from here until the new track is audible.
+  void TrackChangeRequested() { track_change_timer_.start(); }
+
  public slots:
   virtual void ReloadSettings();
   void UpdateVolume(const uint volume);
@@ -255,6 +261,8 @@ class EngineBase : public QObject {
 
   bool about_to_end_emitted_;
 
+  QElapsedTimer track_change_timer_;
+
   Q_DISABLE_COPY(EngineBase)
 };
 
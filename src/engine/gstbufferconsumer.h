@@ -36,7 +36,14 @@ class GstBufferConsumer {
 
   // This is called in some unspecified GStreamer thread.
   // Ownership of the buffer is transferred to the BufferConsumer, and it should gst_buffer_unref it.
-  virtual void ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format) = 0;
+  // The buffer must not be modified, format is the format of the samples in it.
+  // It holds 16 bit samples if NeedsS16Buffers() returned true, use a GstPcmTap to get the audio data in the format it's played.
+  // timestamp_nanosec is relative to the start of the stream, comparable to GstEnginePipeline::position().
+  virtual void ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format, const qint64 timestamp_nanosec) = 0;
+
+  // Called for every buffer in the same thread as ConsumeBuffer().
+  // Consumers that only look at the samples some of the time return false when they don't, and get the buffer as it's played without converting it.
+  virtual bool NeedsS16Buffers() { return true; }
 
  private:
   Q_DISABLE_COPY(GstBufferConsumer)
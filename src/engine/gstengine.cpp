@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include <cstdint>
 #include <cmath>
 #include <algorithm>
 #include <optional>
@@ -48,16 +49,21 @@
 #include <QEasingCurve>
 #include <QMetaObject>
 #include <QTimerEvent>
+#include <QElapsedTimer>
 
 #include "core/shared_ptr.h"
 #include "core/logging.h"
 #include "core/taskmanager.h"
 #include "core/signalchecker.h"
+#include "core/settings.h"
 #include "utilities/timeconstants.h"
+#include "settings/backendsettingspage.h"
 #include "enginebase.h"
 #include "gstengine.h"
 #include "gstenginepipeline.h"
 #include "gstbufferconsumer.h"
+#include "scoperingbuffer.h"
+#include "gstenginepipelinemetrics.h"
 #include "enginemetadata.h"
 
 using std::make_shared;
@@ -79,6 +85,9 @@ const int GstEngine::kDiscoveryTimeoutS = 10;
 const qint64 GstEngine::kTimerIntervalNanosec = 1000 * kNsecPerMsec;  // 1s
 const qint64 GstEngine::kPreloadGapNanosec = 8000 * kNsecPerMsec;     // 8s
 const qint64 GstEngine::kSeekDelayNanosec = 100 * kNsecPerMsec;       // 100msec
+const int GstEngine::kScopeRingBufferFrames = 256;                     // ~3s of 44.1kHz stereo
+const qint64 GstEngine::kScopeMaxLeadNanosec = 2000 * kNsecPerMsec;   // 2s
+const qint64 GstEngine::kScopeIdleMsec = 1000;                         // 1s
 
 GstEngine::GstEngine(SharedPtr<TaskManager> task_manager, QObject *parent)
     : EngineBase(parent),
@@ -86,7 +95,10 @@ GstEngine::GstEngine(SharedPtr<TaskManager> task_manager, QObject *parent)
       gst_startup_(nullptr),
       discoverer_(nullptr),
       buffering_task_id_(-1),
-      latest_buffer_(nullptr),
+      scope_buffer_(kScopeRingBufferFrames, kScopeSize),
+      metrics_(make_shared<GstEnginePipelineMetrics>()),
+      metrics_log_interval_(0),
+      metrics_log_ticks_(0),
       stereo_balancer_enabled_(false),
       stereo_balance_(0.0F),
       equalizer_enabled_(false),
@@ -97,11 +109,21 @@ GstEngine::GstEngine(SharedPtr<TaskManager> task_manager, QObject *parent)
       timer_id_(-1),
       is_fading_out_to_pause_(false),
       has_faded_out_(false),
-      scope_chunk_(0),
-      have_new_buffer_(false),
-      scope_chunks_(0),
+      standby_beginning_nanosec_(0),
+      standby_end_nanosec_(0),
+      current_pipeline_standby_(false),
       discovery_finished_cb_id_(-1),
-      discovery_discovered_cb_id_(-1) {
+      discovery_discovered_cb_id_(-1),
+      scope_pipeline_id_(-1),
+      scope_buffer_writing_(0),
+      scope_requested_msec_(0),
+      track_change_pipeline_id_(-1),
+      track_change_requested_msec_(0),
+      track_change_standby_(false),
+      track_changes_cold_(0),
+      track_changes_standby_(0),
+      track_change_cold_total_msec_(0),
+      track_change_standby_total_msec_(0) {
 
   seek_timer_->setSingleShot(true);
   seek_timer_->setInterval(kSeekDelayNanosec / kNsecPerMsec);
@@ -114,13 +136,9 @@ GstEngine::GstEngine(SharedPtr<TaskManager> task_manager, QObject *parent)
 GstEngine::~GstEngine() {
 
   EnsureInitialized();
+  standby_pipeline_.reset();
   current_pipeline_.reset();
 
-  if (latest_buffer_) {
-    gst_buffer_unref(latest_buffer_);
-    latest_buffer_ = nullptr;
-  }
-
   if (discoverer_) {
 
     if (discovery_discovered_cb_id_ != -1) {
@@ -182,6 +200,66 @@ void GstEngine::StartPreloading(const QUrl &media_url, const QUrl &stream_url, c
 
 }
 
+void GstEngine::PrepareStandby(const QUrl &media_url, const QUrl &stream_url, const bool force_stop_at_end, const qint64 beginning_nanosec, const qint64 end_nanosec) {
+
+  const qint64 standby_end_nanosec = force_stop_at_end ? end_nanosec : 0;
+  if (media_url == standby_media_url_ && stream_url == standby_stream_url_ && beginning_nanosec == standby_beginning_nanosec_ && standby_end_nanosec == standby_end_nanosec_) return;
+
+  ClearStandby();
+
+  // CD devices and Spotify can only play one track at a time.
+  if (!OutputSupportsStandby() || stream_url.scheme() == QLatin1String("cdda") || media_url.scheme() == QLatin1String("spotify")) return;
+
+  standby_media_url_ = media_url;
+  standby_stream_url_ = stream_url;
+  standby_beginning_nanosec_ = beginning_nanosec;
+  standby_end_nanosec_ = standby_end_nanosec;
+
+  // Wait with opening it until the current track is playing, so they don't compete.
+  if (current_pipeline_ && current_pipeline_->state() == GST_STATE_PLAYING) {
+    StartStandby();
+  }
+
+}
+
+void GstEngine::StartStandby() {
+
+  if (standby_pipeline_ || standby_stream_url_.isEmpty()) return;
+
+  EnsureInitialized();
+
+  SharedPtr<GstEnginePipeline> pipeline = CreatePipeline();
+  QString error;
+  if (!pipeline->InitFromUrl(standby_media_url_, standby_stream_url_, FixupUrl(standby_stream_url_), standby_end_nanosec_, 0.0, error)) {
+    qLog(Debug) << "Could not create standby pipeline for" << standby_media_url_ << error;
+    ClearStandby();
+    return;
+  }
+
+  // Nothing from the standby pipeline should be seen before it's used.
+  DetachPipeline(pipeline);
+
+  qLog(Debug) << "Prerolling standby pipeline" << pipeline->id() << "for" << standby_media_url_;
+  pipeline->SetState(GST_STATE_PAUSED);
+  // Tracks from CUE sheets start inside the file, the seek is held back until the pipeline has prerolled.
+  if (standby_beginning_nanosec_ != 0) {
+    pipeline->Seek(standby_beginning_nanosec_);
+  }
+  standby_pipeline_ = pipeline;
+
+}
+
+void GstEngine::ClearStandby() {
+
+  standby_pipeline_.reset();
+  standby_metadata_.clear();
+  standby_media_url_.clear();
+  standby_stream_url_.clear();
+  standby_beginning_nanosec_ = 0;
+  standby_end_nanosec_ = 0;
+
+}
+
 bool GstEngine::Load(const QUrl &media_url, const QUrl &stream_url, const EngineBase::TrackChangeFlags change, const bool force_stop_at_end, const quint64 beginning_nanosec, const qint64 end_nanosec, const std::optional<double> ebur128_integrated_loudness_lufs) {
 
   EnsureInitialized();
@@ -196,19 +274,50 @@ bool GstEngine::Load(const QUrl &media_url, const QUrl &stream_url, const Engine
     crossfade = false;
   }
 
+  const qint64 track_change_requested_msec = track_change_timer_.isValid() ? track_change_timer_.msecsSinceReference() : -1;
+  track_change_timer_.invalidate();
+
   if (!crossfade && current_pipeline_ && current_pipeline_->stream_url() == stream_url && change & EngineBase::TrackChangeType::Auto) {
     // We're not crossfading, and the pipeline is already playing the URI we want, so just do nothing.
     current_pipeline_->SetEBUR128LoudnessNormalizingGain_dB(ebur128_loudness_normalizing_gain_db_);
     return true;
   }
 
-  SharedPtr<GstEnginePipeline> pipeline = CreatePipeline(media_url, stream_url, gst_url, force_stop_at_end ? end_nanosec : 0, ebur128_loudness_normalizing_gain_db_);
-  if (!pipeline) return false;
+  SharedPtr<GstEnginePipeline> pipeline;
+  QList<EngineMetadata> standby_metadata;
+  const bool use_standby = standby_pipeline_ && standby_media_url_ == media_url && standby_stream_url_ == stream_url && standby_beginning_nanosec_ == static_cast<qint64>(beginning_nanosec) && standby_end_nanosec_ == (force_stop_at_end ? end_nanosec : 0);
+  if (use_standby) {
+    qLog(Debug) << "Using standby pipeline" << standby_pipeline_->id() << "for" << media_url;
+    pipeline = standby_pipeline_;
+    standby_metadata = standby_metadata_;
+    standby_pipeline_.reset();
+    AttachPipeline(pipeline);
+    pipeline->SetEBUR128LoudnessNormalizingGain_dB(ebur128_loudness_normalizing_gain_db_);
+  }
+  else {
+    pipeline = CreatePipeline(media_url, stream_url, gst_url, force_stop_at_end ? end_nanosec : 0, ebur128_loudness_normalizing_gain_db_);
+    if (!pipeline) return false;
+  }
+  ClearStandby();
 
   if (crossfade) StartFadeout();
 
   BufferingFinished();
   current_pipeline_ = pipeline;
+  current_pipeline_standby_ = use_standby;
+  scope_pipeline_id_.storeRelease(current_pipeline_->id());
+
+  // Send the tags found while the standby pipeline was prerolled, once the player has moved on to the track.
+  for (const EngineMetadata &engine_metadata : std::as_const(standby_metadata)) {
+    const int pipeline_id = current_pipeline_->id();
+    QMetaObject::invokeMethod(this, [this, pipeline_id, engine_metadata]() { NewMetaData(pipeline_id, engine_metadata); }, Qt::QueuedConnection);
+  }
+
+  if (track_change_requested_msec != -1) {
+    track_change_requested_msec_.storeRelaxed(track_change_requested_msec);
+    track_change_standby_ = use_standby;
+    track_change_pipeline_id_.storeRelease(current_pipeline_->id());
+  }
 
   SetVolume(volume_);
   SetStereoBalance(stereo_balance_);
@@ -284,6 +393,7 @@ void GstEngine::Stop(const bool stop_after) {
 
   if (fadeout_enabled_ && current_pipeline_ && !stop_after) StartFadeout();
 
+  ClearStandby();
   current_pipeline_.reset();
   BufferingFinished();
   emit StateChanged(EngineBase::State::Empty);
@@ -380,25 +490,47 @@ qint64 GstEngine::length_nanosec() const {
 
 }
 
+bool GstEngine::NeedsS16Buffers() {
+
+  // The scope is polled by the analyzer while it's shown, stop converting buffers for it shortly after it stops.
+  const qint64 scope_requested_msec = scope_requested_msec_.loadRelaxed();
+  if (scope_requested_msec == 0) return false;
+
+  QElapsedTimer now;
+  now.start();
+  return now.msecsSinceReference() - scope_requested_msec < kScopeIdleMsec;
+
+}
+
 const EngineBase::Scope &GstEngine::scope(const int chunk_length) {
 
-  // The new buffer could have a different size
-  if (have_new_buffer_) {
-    if (latest_buffer_) {
-      scope_chunks_ = ceil((static_cast<double>(GST_BUFFER_DURATION(latest_buffer_) / static_cast<double>(chunk_length * kNsecPerMsec))));
-    }
+  Q_UNUSED(chunk_length)
 
-    // if the buffer is shorter than the chunk length
-    if (scope_chunks_ <= 0) {
-      scope_chunks_ = 1;
-    }
+  QElapsedTimer now;
+  now.start();
+  scope_requested_msec_.storeRelaxed(now.msecsSinceReference());
 
-    scope_chunk_ = 0;
-    have_new_buffer_ = false;
-  }
+  if (!current_pipeline_) return scope_;
 
-  if (latest_buffer_) {
-    UpdateScope(chunk_length);
+  const int pipeline_id = current_pipeline_->id();
+  const qint64 position = current_pipeline_->position();
+
+  // Drop everything that was already played, and show the frame that is audible right now.
+  // Frames that are still ahead of the playback position are left in the ring for the next call.
+  while (const ScopeRingBuffer::Frame *frame = scope_buffer_.Peek()) {
+    if (frame->pipeline_id != pipeline_id) {
+      scope_buffer_.Pop();
+      continue;
+    }
+    if (frame->timestamp_nanosec > position + kScopeMaxLeadNanosec) {
+      // Left over from before a seek.
+      scope_buffer_.Pop();
+      continue;
+    }
+    if (frame->timestamp_nanosec > position) break;
+    std::copy(frame->samples.begin(), frame->samples.begin() + qMin(frame->samples.size(), scope_.size()), scope_.begin());
+    if (frame->timestamp_nanosec + frame->duration_nanosec > position) break;
+    scope_buffer_.Pop();
   }
 
   return scope_;
@@ -466,28 +598,74 @@ bool GstEngine::ExclusiveModeSupport(const QString &output) {
   return output == QLatin1String(kWASAPISink);
 }
 
+bool GstEngine::OutputSupportsStandby() const {
+
+  // The standby pipeline keeps a second sink open, so the output has to mix streams.
+  if (exclusive_mode_) return false;
+
+  if (output_ == QLatin1String(kALSASink)) {
+    // hw and plughw devices go straight to the sound card, only one stream can have them open.
+    const QString device = device_.toString();
+    return !device.startsWith(QLatin1String("hw:")) && !device.startsWith(QLatin1String("plughw:"));
+  }
+
+  // JACK ports, bluetooth, OSS and OpenAL devices are not opened twice.
+  return output_ == QLatin1String(kAutoSink) || output_ == QLatin1String(kPulseSink) || output_ == QLatin1String(kOSXAudioSink) || output_ == QLatin1String(kDirectSoundSink) || output_ == QLatin1String(kWASAPISink);
+
+}
+
 void GstEngine::ReloadSettings() {
 
   EngineBase::ReloadSettings();
 
   if (output_.isEmpty()) output_ = QLatin1String(kAutoSink);
 
+  Settings s;
+  s.beginGroup(BackendSettingsPage::kSettingsGroup);
+  metrics_log_interval_ = s.value("pipeline_metrics_log_interval", 0).toInt();
+  s.endGroup();
+
+  // The standby pipeline was created with the old settings.
+  ClearStandby();
+
 }
 
-void GstEngine::ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format) {
+void GstEngine::ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format, const qint64 timestamp_nanosec) {
 
-  // Schedule this to run in the GUI thread.  The buffer gets added to the queue and unreffed by UpdateScope.
-  if (!QMetaObject::invokeMethod(this, "AddBufferToScope", Q_ARG(GstBuffer*, buffer), Q_ARG(int, pipeline_id), Q_ARG(QString, format))) {
-    qLog(Warning) << "Failed to invoke AddBufferToScope on GstEngine";
-    gst_buffer_unref(buffer);
+  // This runs in the streaming thread, the frames are picked up by scope() in the GUI thread.
+
+  // The first buffer of the new track after a track change.
+  if (pipeline_id == track_change_pipeline_id_.loadAcquire() && track_change_pipeline_id_.testAndSetOrdered(pipeline_id, -1)) {
+    QElapsedTimer now;
+    now.start();
+    const qint64 latency_msec = now.msecsSinceReference() - track_change_requested_msec_.loadRelaxed();
+    const bool standby = track_change_standby_;
+    QMetaObject::invokeMethod(this, [this, pipeline_id, latency_msec, standby]() { TrackChangeFinished(pipeline_id, latency_msec, standby); }, Qt::QueuedConnection);
   }
 
+  // Buffers are only converted to 16 bit while the scope is used, and formats that can't be converted are passed as they are.
+  if (format.startsWith(QLatin1String("S16LE")) || format.startsWith(QLatin1String("U16LE"))) {
+    // The ring has a single producer, so only the current pipeline writes to it, and never two streaming threads at once.
+    // A fading or replaced pipeline can still deliver a few buffers in its streaming thread after the switch.
+    if (pipeline_id == scope_pipeline_id_.loadAcquire() && timestamp_nanosec >= 0 && GST_BUFFER_DURATION_IS_VALID(buffer) && GST_BUFFER_DURATION(buffer) > 0 && scope_buffer_writing_.testAndSetAcquire(0, 1)) {
+      GstMapInfo map;
+      if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        scope_buffer_.Write(pipeline_id, timestamp_nanosec, static_cast<qint64>(GST_BUFFER_DURATION(buffer)), reinterpret_cast<const int16_t*>(map.data), static_cast<qint64>(map.size / sizeof(int16_t)));
+        gst_buffer_unmap(buffer, &map);
+      }
+      scope_buffer_writing_.storeRelease(0);
+    }
+  }
+
+  gst_buffer_unref(buffer);
+
 }
 
 void GstEngine::SetStereoBalancerEnabled(const bool enabled) {
 
   stereo_balancer_enabled_ = enabled;
   if (current_pipeline_) current_pipeline_->set_stereo_balancer_enabled(enabled);
+  if (standby_pipeline_) standby_pipeline_->set_stereo_balancer_enabled(enabled);
 
 }
 
@@ -502,6 +680,7 @@ void GstEngine::SetEqualizerEnabled(const bool enabled) {
 
   equalizer_enabled_ = enabled;
   if (current_pipeline_) current_pipeline_->set_equalizer_enabled(enabled);
+  if (standby_pipeline_) standby_pipeline_->set_equalizer_enabled(enabled);
 
 }
 
@@ -528,10 +707,32 @@ void GstEngine::RemoveBufferConsumer(GstBufferConsumer *consumer) {
 
 }
 
+void GstEngine::AddPcmTap(SharedPtr<GstPcmTap> pcm_tap) {
+
+  pcm_taps_ << pcm_tap;
+  if (current_pipeline_) current_pipeline_->AddPcmTap(pcm_tap);
+
+}
+
+void GstEngine::RemovePcmTap(SharedPtr<GstPcmTap> pcm_tap) {
+
+  pcm_taps_.removeAll(pcm_tap);
+  if (current_pipeline_) current_pipeline_->RemovePcmTap(pcm_tap);
+
+}
+
 void GstEngine::timerEvent(QTimerEvent *e) {
 
   if (e->timerId() != timer_id_) return;
 
+  if (current_pipeline_) {
+    current_pipeline_->UpdateQueueLevel();
+    if (metrics_log_interval_ > 0 && ++metrics_log_ticks_ * kTimerIntervalNanosec / kNsecPerSec >= metrics_log_interval_) {
+      metrics_log_ticks_ = 0;
+      qLog(Info) << "Pipeline" << current_pipeline_->id() << metrics_->SummaryText();
+    }
+  }
+
   if (current_pipeline_ && !about_to_end_emitted_) {
     const qint64 current_length = length_nanosec();
     // Only if we know the length of the current stream...
@@ -567,6 +768,13 @@ void GstEngine::EndOfStreamReached(const int pipeline_id, const bool has_next_tr
 
 void GstEngine::HandlePipelineError(const int pipeline_id, const int domain, const int error_code, const QString &message, const QString &debugstr) {
 
+  if (standby_pipeline_ && standby_pipeline_->id() == pipeline_id) {
+    // Not worth bothering the user with, the track is opened again if it's played.
+    qLog(Debug) << "Standby pipeline for" << standby_media_url_ << "failed:" << message;
+    ClearStandby();
+    return;
+  }
+
   if (!current_pipeline_ || current_pipeline_->id() != pipeline_id) return;
 
   qLog(Error) << "GStreamer error:" << domain << error_code << message;
@@ -596,25 +804,14 @@ void GstEngine::HandlePipelineError(const int pipeline_id, const int domain, con
 
 void GstEngine::NewMetaData(const int pipeline_id, const EngineMetadata &engine_metadata) {
 
-  if (!current_pipeline_|| current_pipeline_->id() != pipeline_id) return;
-  emit MetaData(engine_metadata);
-
-}
-
-void GstEngine::AddBufferToScope(GstBuffer *buf, const int pipeline_id, const QString &format) {
-
-  if (!current_pipeline_ || current_pipeline_->id() != pipeline_id) {
-    gst_buffer_unref(buf);
+  // Kept until the standby pipeline is used, the player would take them for the current track.
+  if (standby_pipeline_ && standby_pipeline_->id() == pipeline_id) {
+    standby_metadata_ << engine_metadata;
     return;
   }
 
-  if (latest_buffer_) {
-    gst_buffer_unref(latest_buffer_);
-  }
-
-  buffer_format_ = format;
-  latest_buffer_ = buf;
-  have_new_buffer_ = true;
+  if (!current_pipeline_|| current_pipeline_->id() != pipeline_id) return;
+  emit MetaData(engine_metadata);
 
 }
 
@@ -652,6 +849,9 @@ void GstEngine::SeekNow() {
     qLog(Warning) << "Seek failed";
   }
 
+  // Frames queued before the seek would otherwise hold back the scope until playback catches up with them.
+  scope_buffer_.Clear();
+
 }
 
 void GstEngine::PlayDone(const GstStateChangeReturn ret, const quint64 offset_nanosec, const int pipeline_id) {
@@ -666,6 +866,7 @@ void GstEngine::PlayDone(const GstStateChangeReturn ret, const quint64 offset_na
     if (!redirect_url.isEmpty() && redirect_url != current_pipeline_->gst_url()) {
       qLog(Info) << "Redirecting to" << redirect_url;
       current_pipeline_ = CreatePipeline(current_pipeline_->media_url(), current_pipeline_->stream_url(), redirect_url, end_nanosec_, current_pipeline_->ebur128_loudness_normalizing_gain_db());
+      scope_pipeline_id_.storeRelease(current_pipeline_->id());
       Play(offset_nanosec);
       return;
     }
@@ -679,15 +880,37 @@ void GstEngine::PlayDone(const GstStateChangeReturn ret, const quint64 offset_na
 
   StartTimers();
 
-  // Initial offset
-  if (offset_nanosec != 0 || beginning_nanosec_ != 0) {
+  // Initial offset, a standby pipeline was already prerolled at the beginning of the track.
+  if (offset_nanosec != 0 || (beginning_nanosec_ != 0 && !current_pipeline_standby_)) {
     Seek(offset_nanosec);
   }
+  current_pipeline_standby_ = false;
 
   emit StateChanged(EngineBase::State::Playing);
   // We've successfully started playing a media stream with this url
   emit ValidSongRequested(stream_url_);
 
+  StartStandby();
+
+}
+
+void GstEngine::TrackChangeFinished(const int pipeline_id, const qint64 latency_msec, const bool standby) {
+
+  metrics_->AddEvent(pipeline_id, GstEnginePipelineMetrics::EventType::TrackChange, latency_msec, standby ? 1 : 0, standby ? QStringLiteral("Standby pipeline") : QStringLiteral("New pipeline"));
+
+  if (standby) {
+    ++track_changes_standby_;
+    track_change_standby_total_msec_ += latency_msec;
+  }
+  else {
+    ++track_changes_cold_;
+    track_change_cold_total_msec_ += latency_msec;
+  }
+
+  qLog(Debug) << "Track change to first audio buffer took" << latency_msec << "ms" << (standby ? "using standby pipeline." : "using new pipeline.")
+              << "Average:" << (track_changes_standby_ > 0 ? track_change_standby_total_msec_ / track_changes_standby_ : 0) << "ms with standby over" << track_changes_standby_ << "changes,"
+              << (track_changes_cold_ > 0 ? track_change_cold_total_msec_ / track_changes_cold_ : 0) << "ms without over" << track_changes_cold_ << "changes.";
+
 }
 
 void GstEngine::BufferingStarted() {
@@ -759,6 +982,7 @@ void GstEngine::StartFadeout() {
   fadeout_pipeline_ = current_pipeline_;
   QObject::disconnect(&*fadeout_pipeline_, nullptr, nullptr, nullptr);
   fadeout_pipeline_->RemoveAllBufferConsumers();
+  fadeout_pipeline_->RemoveAllPcmTaps();
 
   fadeout_pipeline_->StartFader(fadeout_duration_nanosec_, QTimeLine::Backward);
   QObject::connect(&*fadeout_pipeline_, &GstEnginePipeline::FaderFinished, this, &GstEngine::FadeoutFinished);
@@ -815,103 +1039,65 @@ SharedPtr<GstEnginePipeline> GstEngine::CreatePipeline() {
   ret->set_bs2b_enabled(bs2b_enabled_);
   ret->set_strict_ssl_enabled(strict_ssl_enabled_);
   ret->set_fading_enabled(fadeout_enabled_ || autocrossfade_enabled_ || fadeout_pause_enabled_);
+  ret->set_metrics(metrics_);
 
 #ifdef HAVE_SPOTIFY
   ret->set_spotify_login(spotify_username_, spotify_password_);
 #endif
 
-  ret->AddBufferConsumer(this);
-  for (GstBufferConsumer *consumer : std::as_const(buffer_consumers_)) {
-    ret->AddBufferConsumer(consumer);
-  }
-
   QObject::connect(&*ret, &GstEnginePipeline::EndOfStreamReached, this, &GstEngine::EndOfStreamReached);
   QObject::connect(&*ret, &GstEnginePipeline::Error, this, &GstEngine::HandlePipelineError);
   QObject::connect(&*ret, &GstEnginePipeline::MetadataFound, this, &GstEngine::NewMetaData);
-  QObject::connect(&*ret, &GstEnginePipeline::BufferingStarted, this, &GstEngine::BufferingStarted);
-  QObject::connect(&*ret, &GstEnginePipeline::BufferingProgress, this, &GstEngine::BufferingProgress);
-  QObject::connect(&*ret, &GstEnginePipeline::BufferingFinished, this, &GstEngine::BufferingFinished);
-  QObject::connect(&*ret, &GstEnginePipeline::VolumeChanged, this, &EngineBase::UpdateVolume);
-  QObject::connect(&*ret, &GstEnginePipeline::AboutToFinish, this, &EngineBase::EmitAboutToFinish);
+
+  AttachPipeline(ret);
 
   return ret;
 
 }
 
-SharedPtr<GstEnginePipeline> GstEngine::CreatePipeline(const QUrl &media_url, const QUrl &stream_url, const QByteArray &gst_url, const qint64 end_nanosec, const double ebur128_loudness_normalizing_gain_db) {
+void GstEngine::AttachPipeline(SharedPtr<GstEnginePipeline> pipeline) {
 
-  SharedPtr<GstEnginePipeline> ret = CreatePipeline();
-  QString error;
-  if (!ret->InitFromUrl(media_url, stream_url, gst_url, end_nanosec, ebur128_loudness_normalizing_gain_db, error)) {
-    ret.reset();
-    emit Error(error);
-    emit StateChanged(EngineBase::State::Error);
-    emit FatalError();
+  pipeline->AddBufferConsumer(this);
+  for (GstBufferConsumer *consumer : std::as_const(buffer_consumers_)) {
+    pipeline->AddBufferConsumer(consumer);
+  }
+  for (const SharedPtr<GstPcmTap> &pcm_tap : std::as_const(pcm_taps_)) {
+    pipeline->AddPcmTap(pcm_tap);
   }
 
-  return ret;
+  QObject::connect(&*pipeline, &GstEnginePipeline::BufferingStarted, this, &GstEngine::BufferingStarted);
+  QObject::connect(&*pipeline, &GstEnginePipeline::BufferingProgress, this, &GstEngine::BufferingProgress);
+  QObject::connect(&*pipeline, &GstEnginePipeline::BufferingFinished, this, &GstEngine::BufferingFinished);
+  QObject::connect(&*pipeline, &GstEnginePipeline::VolumeChanged, this, &EngineBase::UpdateVolume);
+  QObject::connect(&*pipeline, &GstEnginePipeline::AboutToFinish, this, &EngineBase::EmitAboutToFinish);
 
 }
 
-void GstEngine::UpdateScope(const int chunk_length) {
-
-  using sample_type = EngineBase::Scope::value_type;
-
-  // Prevent dbz or invalid chunk size
-  if (!GST_CLOCK_TIME_IS_VALID(GST_BUFFER_DURATION(latest_buffer_))) return;
-  if (GST_BUFFER_DURATION(latest_buffer_) == 0) return;
-
-  GstMapInfo map;
-  gst_buffer_map(latest_buffer_, &map, GST_MAP_READ);
-
-  // Determine where to split the buffer
-  int chunk_density = static_cast<int>((map.size * kNsecPerMsec) / GST_BUFFER_DURATION(latest_buffer_));
-
-  int chunk_size = chunk_length * chunk_density;
-
-  // In case a buffer doesn't arrive in time
-  if (scope_chunk_ >= scope_chunks_) {
-    scope_chunk_ = 0;
-    gst_buffer_unmap(latest_buffer_, &map);
-    return;
-  }
+void GstEngine::DetachPipeline(SharedPtr<GstEnginePipeline> pipeline) {
 
-  const sample_type *source = reinterpret_cast<sample_type*>(map.data);
-  sample_type *dest = scope_.data();
-  source += (chunk_size / sizeof(sample_type)) * scope_chunk_;
+  pipeline->RemoveAllBufferConsumers();
+  pipeline->RemoveAllPcmTaps();
 
-  size_t bytes = 0;
+  QObject::disconnect(&*pipeline, &GstEnginePipeline::BufferingStarted, this, &GstEngine::BufferingStarted);
+  QObject::disconnect(&*pipeline, &GstEnginePipeline::BufferingProgress, this, &GstEngine::BufferingProgress);
+  QObject::disconnect(&*pipeline, &GstEnginePipeline::BufferingFinished, this, &GstEngine::BufferingFinished);
+  QObject::disconnect(&*pipeline, &GstEnginePipeline::VolumeChanged, this, &EngineBase::UpdateVolume);
+  QObject::disconnect(&*pipeline, &GstEnginePipeline::AboutToFinish, this, &EngineBase::EmitAboutToFinish);
 
-  // Make sure we don't go beyond the end of the buffer
-  if (scope_chunk_ == scope_chunks_ - 1) {
-    bytes = qMin(static_cast<EngineBase::Scope::size_type>(map.size - (chunk_size * scope_chunk_)), scope_.size() * sizeof(sample_type));
-  }
-  else {
-    bytes = qMin(static_cast<EngineBase::Scope::size_type>(chunk_size), scope_.size() * sizeof(sample_type));
-  }
+}
 
-  scope_chunk_++;
+SharedPtr<GstEnginePipeline> GstEngine::CreatePipeline(const QUrl &media_url, const QUrl &stream_url, const QByteArray &gst_url, const qint64 end_nanosec, const double ebur128_loudness_normalizing_gain_db) {
 
-  if (buffer_format_.startsWith(QLatin1String("S16LE")) ||
-      buffer_format_.startsWith(QLatin1String("U16LE")) ||
-      buffer_format_.startsWith(QLatin1String("S24LE")) ||
-      buffer_format_.startsWith(QLatin1String("S24_32LE")) ||
-      buffer_format_.startsWith(QLatin1String("S32LE")) ||
-      buffer_format_.startsWith(QLatin1String("F32LE"))
-  ) {
-    memcpy(dest, source, bytes);
-  }
-  else {
-    memset(dest, 0, bytes);
+  SharedPtr<GstEnginePipeline> ret = CreatePipeline();
+  QString error;
+  if (!ret->InitFromUrl(media_url, stream_url, gst_url, end_nanosec, ebur128_loudness_normalizing_gain_db, error)) {
+    ret.reset();
+    emit Error(error);
+    emit StateChanged(EngineBase::State::Error);
+    emit FatalError();
   }
 
-  gst_buffer_unmap(latest_buffer_, &map);
-
-  if (scope_chunk_ == scope_chunks_) {
-    gst_buffer_unref(latest_buffer_);
-    latest_buffer_ = nullptr;
-    buffer_format_.clear();
-  }
+  return ret;
 
 }
 
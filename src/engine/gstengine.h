@@ -32,6 +32,8 @@
 
 #include <QtGlobal>
 #include <QObject>
+#include <QAtomicInt>
+#include <QAtomicInteger>
 #include <QFuture>
 #include <QByteArray>
 #include <QList>
@@ -42,6 +44,9 @@
 #include "enginebase.h"
 #include "gststartup.h"
 #include "gstbufferconsumer.h"
+#include "scoperingbuffer.h"
+#include "gstenginepipelinemetrics.h"
+#include "gstpcmtap.h"
 
 class QTimer;
 class QTimerEvent;
@@ -61,6 +66,7 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   bool Init() override;
   EngineBase::State state() const override;
   void StartPreloading(const QUrl &media_url, const QUrl &stream_url, const bool force_stop_at_end, const qint64 beginning_nanosec, const qint64 end_nanosec) override;
+  void PrepareStandby(const QUrl &media_url, const QUrl &stream_url, const bool force_stop_at_end, const qint64 beginning_nanosec, const qint64 end_nanosec) override;
   bool Load(const QUrl &media_url, const QUrl &stream_url, const EngineBase::TrackChangeFlags change, const bool force_stop_at_end, const quint64 beginning_nanosec, const qint64 end_nanosec, const std::optional<double> ebur128_integrated_loudness_lufs) override;
   bool Play(const quint64 offset_nanosec) override;
   void Stop(const bool stop_after = false) override;
@@ -86,7 +92,10 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   void SetStartup(GstStartup *gst_startup) { gst_startup_ = gst_startup; }
   void EnsureInitialized() { gst_startup_->EnsureInitialized(); }
 
-  void ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format) override;
+  void ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format, const qint64 timestamp_nanosec) override;
+  bool NeedsS16Buffers() override;
+
+  SharedPtr<GstEnginePipelineMetrics> metrics() const { return metrics_; }
 
  public slots:
   void ReloadSettings() override;
@@ -106,6 +115,9 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   void AddBufferConsumer(GstBufferConsumer *consumer);
   void RemoveBufferConsumer(GstBufferConsumer *consumer);
 
+  void AddPcmTap(SharedPtr<GstPcmTap> pcm_tap);
+  void RemovePcmTap(SharedPtr<GstPcmTap> pcm_tap);
+
  protected:
   void timerEvent(QTimerEvent *e) override;
 
@@ -113,7 +125,6 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   void EndOfStreamReached(const int pipeline_id, const bool has_next_track);
   void HandlePipelineError(const int pipeline_id, const int domain, const int error_code, const QString &message, const QString &debugstr);
   void NewMetaData(const int pipeline_id, const EngineMetadata &engine_metadata);
-  void AddBufferToScope(GstBuffer *buf, const int pipeline_id, const QString &format);
   void FadeoutFinished();
   void FadeoutPauseFinished();
   void SeekNow();
@@ -132,11 +143,17 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   void StartTimers();
   void StopTimers();
 
+  void StartStandby();
+  void ClearStandby();
+  bool OutputSupportsStandby() const;
+
+  void TrackChangeFinished(const int pipeline_id, const qint64 latency_msec, const bool standby);
+
   SharedPtr<GstEnginePipeline> CreatePipeline();
+  void AttachPipeline(SharedPtr<GstEnginePipeline> pipeline);
+  void DetachPipeline(SharedPtr<GstEnginePipeline> pipeline);
   SharedPtr<GstEnginePipeline> CreatePipeline(const QUrl &media_url, const QUrl &stream_url, const QByteArray &gst_url, const qint64 end_nanosec, const double ebur128_loudness_normalizing_gain_db);
 
-  void UpdateScope(int chunk_length);
-
   static void StreamDiscovered(GstDiscoverer*, GstDiscovererInfo *info, GError*, gpointer self);
   static void StreamDiscoveryFinished(GstDiscoverer*, gpointer);
   static QString GSTdiscovererErrorMessage(GstDiscovererResult result);
@@ -158,6 +175,9 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   static const qint64 kTimerIntervalNanosec;
   static const qint64 kPreloadGapNanosec;
   static const qint64 kSeekDelayNanosec;
+  static const int kScopeRingBufferFrames;
+  static const qint64 kScopeMaxLeadNanosec;
+  static const qint64 kScopeIdleMsec;
 
   SharedPtr<TaskManager> task_manager_;
   GstStartup *gst_startup_;
@@ -169,9 +189,28 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   SharedPtr<GstEnginePipeline> fadeout_pipeline_;
   SharedPtr<GstEnginePipeline> fadeout_pause_pipeline_;
 
+  // Prerolled to PAUSED with the track most likely played next, it's used instead of a new pipeline when that track is loaded.
+  SharedPtr<GstEnginePipeline> standby_pipeline_;
+  QUrl standby_media_url_;
+  QUrl standby_stream_url_;
+  qint64 standby_beginning_nanosec_;
+  qint64 standby_end_nanosec_;
+  // Tags found while prerolling, sent when the standby pipeline becomes the current pipeline.
+  QList<EngineMetadata> standby_metadata_;
+  // The current pipeline was the standby pipeline and hasn't started playing yet.
+  bool current_pipeline_standby_;
+
   QList<GstBufferConsumer*> buffer_consumers_;
+  QList<SharedPtr<GstPcmTap>> pcm_taps_;
+
+  // Written by the streaming thread in ConsumeBuffer, read by scope() in the GUI thread.
+  ScopeRingBuffer scope_buffer_;
 
-  GstBuffer *latest_buffer_;
+  // Shared by all pipelines, so the history survives track changes.
+  SharedPtr<GstEnginePipelineMetrics> metrics_;
+  // Seconds between the metrics summary log lines, 0 to disable.
+  int metrics_log_interval_;
+  int metrics_log_ticks_;
 
   bool stereo_balancer_enabled_;
   float stereo_balance_;
@@ -190,13 +229,25 @@ class GstEngine : public EngineBase, public GstBufferConsumer {
   bool is_fading_out_to_pause_;
   bool has_faded_out_;
 
-  int scope_chunk_;
-  bool have_new_buffer_;
-  int scope_chunks_;
-  QString buffer_format_;
-
   int discovery_finished_cb_id_;
   int discovery_discovered_cb_id_;
+
+  // The only pipeline allowed to write to scope_buffer_, and set while a streaming thread is writing to it.
+  QAtomicInt scope_pipeline_id_;
+  QAtomicInt scope_buffer_writing_;
+  // When scope() was last called, buffers are only converted to 16 bit for the scope while it's used.
+  QAtomicInteger<qint64> scope_requested_msec_;
+
+  // The pipeline we're waiting for the first buffer from after a track change, and when the track change was requested.
+  // Checked in the streaming thread by ConsumeBuffer().
+  QAtomicInt track_change_pipeline_id_;
+  QAtomicInteger<qint64> track_change_requested_msec_;
+  bool track_change_standby_;
+
+  int track_changes_cold_;
+  int track_changes_standby_;
+  qint64 track_change_cold_total_msec_;
+  qint64 track_change_standby_total_msec_;
 };
 
 #endif  // GSTENGINE_H
@@ -23,6 +23,8 @@
 
 #include <QtGlobal>
 
+#include <algorithm>
+#include <utility>
 #include <cstdint>
 #include <cstring>
 #include <cmath>
@@ -53,6 +55,7 @@
 #include <QEasingCurve>
 #include <QMetaObject>
 #include <QUuid>
+#include <QElapsedTimer>
 
 #include "core/logging.h"
 #include "core/signalchecker.h"
@@ -137,6 +140,10 @@ GstEnginePipeline::GstEnginePipeline(QObject *parent)
       about_to_finish_cb_id_(-1),
       notify_volume_cb_id_(-1),
       logged_unsupported_analyzer_format_(false),
+      created_msec_(0),
+      state_requested_msec_(0),
+      first_buffer_received_(0),
+      last_buffering_percent_(-1),
       about_to_finish_(false) {
 
   eq_band_gains_.reserve(kEqBandCount);
@@ -300,6 +307,13 @@ void GstEnginePipeline::set_fading_enabled(const bool enabled) {
   fading_enabled_ = enabled;
 }
 
+void GstEnginePipeline::set_metrics(SharedPtr<GstEnginePipelineMetrics> metrics) {
+
+  metrics_ = metrics;
+  if (metrics_) created_msec_ = metrics_->now_msec();
+
+}
+
 #ifdef HAVE_SPOTIFY
 void GstEnginePipeline::set_spotify_login(const QString &spotify_username, const QString &spotify_password) {
 
@@ -346,6 +360,9 @@ GstElement *GstEnginePipeline::CreateElement(const QString &factory_name, const
 
 bool GstEnginePipeline::InitFromUrl(const QUrl &media_url, const QUrl &stream_url, const QByteArray &gst_url, const qint64 end_nanosec, const double ebur128_loudness_normalizing_gain_db, QString &error) {
 
+  QElapsedTimer init_timer;
+  init_timer.start();
+
   media_url_ = media_url;
   stream_url_ = stream_url;
   gst_url_ = gst_url;
@@ -400,6 +417,8 @@ bool GstEnginePipeline::InitFromUrl(const QUrl &media_url, const QUrl &stream_ur
 
   pipeline_is_connected_ = true;
 
+  AddMetricsEvent(GstEnginePipelineMetrics::EventType::Init, init_timer.elapsed(), 0, QString::fromUtf8(gst_url));
+
   return true;
 
 }
@@ -1120,6 +1139,10 @@ GstPadProbeReturn GstEnginePipeline::BufferProbeCallback(GstPad *pad, GstPadProb
 
   GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
 
+  if (instance->metrics_ && instance->first_buffer_received_.testAndSetRelaxed(0, 1)) {
+    instance->AddMetricsEvent(GstEnginePipelineMetrics::EventType::FirstBuffer, instance->metrics_->now_msec() - instance->created_msec_);
+  }
+
   QString format;
   int channels = 1;
   int rate = 0;
@@ -1132,129 +1155,158 @@ GstPadProbeReturn GstEnginePipeline::BufferProbeCallback(GstPad *pad, GstPadProb
       gst_structure_get_int(structure, "channels", &channels);
       gst_structure_get_int(structure, "rate", &rate);
     }
-    gst_caps_unref(caps);
   }
 
-  GstBuffer *buf = gst_pad_probe_info_get_buffer(info);
+  QList<GstBufferConsumer*> consumers;
+  QList<SharedPtr<GstPcmTap>> pcm_taps;
+  {
+    QMutexLocker l(&instance->buffer_consumers_mutex_);
+    consumers = instance->buffer_consumers_;
+    pcm_taps = instance->pcm_taps_;
+  }
+
+  // Only convert to 16 bit when someone asked for it.
+  QList<bool> consumers_need_s16;
+  consumers_need_s16.reserve(consumers.count());
+  for (GstBufferConsumer *consumer : std::as_const(consumers)) {
+    consumers_need_s16 << consumer->NeedsS16Buffers();
+  }
+  const bool convert = consumers_need_s16.contains(true) || std::any_of(pcm_taps.begin(), pcm_taps.end(), [](const SharedPtr<GstPcmTap> &pcm_tap) { return pcm_tap->format() == GstPcmTap::Format::S16LE; });
+
+  GstBuffer *native_buf = gst_pad_probe_info_get_buffer(info);
+  GstBuffer *buf = native_buf;
   GstBuffer *buf16 = nullptr;
 
   quint64 start_time = GST_BUFFER_TIMESTAMP(buf) - instance->segment_start_;
   quint64 duration = GST_BUFFER_DURATION(buf);
   qint64 end_time = static_cast<qint64>(start_time + duration);
 
-  if (format.startsWith(QLatin1String("S16LE"))) {
-    instance->logged_unsupported_analyzer_format_ = false;
-  }
-  else if (format.startsWith(QLatin1String("S32LE"))) {
-
-    GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
-
-    int32_t *s = reinterpret_cast<int32_t*>(map_info.data);
-    int samples = static_cast<int>((map_info.size / sizeof(int32_t)) / channels);
-    int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
-    int16_t *d = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(d, 0, buf16_size);
-    for (int i = 0; i < (samples * channels); ++i) {
-      d[i] = static_cast<int16_t>((s[i] >> 16));
+  if (convert) {
+    if (format.startsWith(QLatin1String("S16LE"))) {
+      instance->logged_unsupported_analyzer_format_ = false;
     }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(d, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
-    buf = buf16;
-
-    instance->logged_unsupported_analyzer_format_ = false;
-  }
+    else if (format.startsWith(QLatin1String("S32LE"))) {
 
-  else if (format.startsWith(QLatin1String("F32LE"))) {
+      GstMapInfo map_info;
+      gst_buffer_map(buf, &map_info, GST_MAP_READ);
 
-    GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
+      int32_t *s = reinterpret_cast<int32_t*>(map_info.data);
+      int samples = static_cast<int>((map_info.size / sizeof(int32_t)) / channels);
+      int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
+      int16_t *d = static_cast<int16_t*>(g_malloc(buf16_size));
+      memset(d, 0, buf16_size);
+      for (int i = 0; i < (samples * channels); ++i) {
+        d[i] = static_cast<int16_t>((s[i] >> 16));
+      }
+      gst_buffer_unmap(buf, &map_info);
+      buf16 = gst_buffer_new_wrapped(d, buf16_size);
+      GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
+      buf = buf16;
 
-    float *s = reinterpret_cast<float*>(map_info.data);
-    int samples = static_cast<int>((map_info.size / sizeof(float)) / channels);
-    int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
-    int16_t *d = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(d, 0, buf16_size);
-    for (int i = 0; i < (samples * channels); ++i) {
-      float sample_float = (s[i] * static_cast<float>(32768.0));
-      d[i] = static_cast<int16_t>(sample_float);
+      instance->logged_unsupported_analyzer_format_ = false;
     }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(d, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
-    buf = buf16;
-
-    instance->logged_unsupported_analyzer_format_ = false;
-  }
-  else if (format.startsWith(QLatin1String("S24LE"))) {
 
-    GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
+    else if (format.startsWith(QLatin1String("F32LE"))) {
 
-    int8_t *s24 = reinterpret_cast<int8_t*>(map_info.data);
-    int8_t *s24e = s24 + map_info.size;
-    int samples = static_cast<int>((map_info.size / sizeof(int8_t)) / channels);
-    int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
-    int16_t *s16 = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(s16, 0, buf16_size);
-    for (int i = 0; i < (samples * channels); ++i) {
-      s16[i] = *(reinterpret_cast<int16_t*>(s24 + 1));
-      s24 += 3;
-      if (s24 >= s24e) break;
-    }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(s16, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
-    buf = buf16;
-
-    instance->logged_unsupported_analyzer_format_ = false;
-  }
-  else if (format.startsWith(QLatin1String("S24_32LE"))) {
+      GstMapInfo map_info;
+      gst_buffer_map(buf, &map_info, GST_MAP_READ);
 
-    GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
+      float *s = reinterpret_cast<float*>(map_info.data);
+      int samples = static_cast<int>((map_info.size / sizeof(float)) / channels);
+      int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
+      int16_t *d = static_cast<int16_t*>(g_malloc(buf16_size));
+      memset(d, 0, buf16_size);
+      for (int i = 0; i < (samples * channels); ++i) {
+        float sample_float = (s[i] * static_cast<float>(32768.0));
+        d[i] = static_cast<int16_t>(sample_float);
+      }
+      gst_buffer_unmap(buf, &map_info);
+      buf16 = gst_buffer_new_wrapped(d, buf16_size);
+      GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
+      buf = buf16;
+
+      instance->logged_unsupported_analyzer_format_ = false;
+    }
+    else if (format.startsWith(QLatin1String("S24LE"))) {
+
+      GstMapInfo map_info;
+      gst_buffer_map(buf, &map_info, GST_MAP_READ);
+
+      int8_t *s24 = reinterpret_cast<int8_t*>(map_info.data);
+      int8_t *s24e = s24 + map_info.size;
+      int samples = static_cast<int>((map_info.size / sizeof(int8_t)) / channels);
+      int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
+      int16_t *s16 = static_cast<int16_t*>(g_malloc(buf16_size));
+      memset(s16, 0, buf16_size);
+      for (int i = 0; i < (samples * channels); ++i) {
+        s16[i] = *(reinterpret_cast<int16_t*>(s24 + 1));
+        s24 += 3;
+        if (s24 >= s24e) break;
+      }
+      gst_buffer_unmap(buf, &map_info);
+      buf16 = gst_buffer_new_wrapped(s16, buf16_size);
+      GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
+      buf = buf16;
+
+      instance->logged_unsupported_analyzer_format_ = false;
+    }
+    else if (format.startsWith(QLatin1String("S24_32LE"))) {
+
+      GstMapInfo map_info;
+      gst_buffer_map(buf, &map_info, GST_MAP_READ);
+
+      int32_t *s32 = reinterpret_cast<int32_t*>(map_info.data);
+      int32_t *s32e = s32 + map_info.size;
+      int32_t *s32p = s32;
+      int samples = static_cast<int>((map_info.size / sizeof(int32_t)) / channels);
+      int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
+      int16_t *s16 = static_cast<int16_t*>(g_malloc(buf16_size));
+      memset(s16, 0, buf16_size);
+      for (int i = 0; i < (samples * channels); ++i) {
+        int8_t *s24 = reinterpret_cast<int8_t*>(s32p);
+        s16[i] = *(reinterpret_cast<int16_t*>(s24 + 1));
+        ++s32p;
+        if (s32p > s32e) break;
+      }
+      gst_buffer_unmap(buf, &map_info);
+      buf16 = gst_buffer_new_wrapped(s16, buf16_size);
+      GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
+      buf = buf16;
 
-    int32_t *s32 = reinterpret_cast<int32_t*>(map_info.data);
-    int32_t *s32e = s32 + map_info.size;
-    int32_t *s32p = s32;
-    int samples = static_cast<int>((map_info.size / sizeof(int32_t)) / channels);
-    int buf16_size = samples * static_cast<int>(sizeof(int16_t)) * channels;
-    int16_t *s16 = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(s16, 0, buf16_size);
-    for (int i = 0; i < (samples * channels); ++i) {
-      int8_t *s24 = reinterpret_cast<int8_t*>(s32p);
-      s16[i] = *(reinterpret_cast<int16_t*>(s24 + 1));
-      ++s32p;
-      if (s32p > s32e) break;
+      instance->logged_unsupported_analyzer_format_ = false;
+    }
+    else if (!instance->logged_unsupported_analyzer_format_) {
+      instance->logged_unsupported_analyzer_format_ = true;
+      qLog(Error) << "Unsupported audio format for the analyzer" << format;
     }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(s16, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) / channels, rate);
-    buf = buf16;
-
-    instance->logged_unsupported_analyzer_format_ = false;
   }
-  else if (!instance->logged_unsupported_analyzer_format_) {
-    instance->logged_unsupported_analyzer_format_ = true;
-    qLog(Error) << "Unsupported audio format for the analyzer" << format;
+
+  if (buf16) {
+    // The converted buffer is ours, timestamp it relative to the start of the stream, the same time base as position().
+    GST_BUFFER_PTS(buf16) = start_time;
   }
 
-  QList<GstBufferConsumer*> consumers;
-  {
-    QMutexLocker l(&instance->buffer_consumers_mutex_);
-    consumers = instance->buffer_consumers_;
+  // The native buffer is shared with the rest of the pipeline, so consumers get the timestamp separately instead of a retimestamped copy.
+  const qint64 timestamp_nanosec = GST_BUFFER_PTS_IS_VALID(native_buf) ? static_cast<qint64>(start_time) : -1;
+  const QString s16_format = buf16 ? QStringLiteral("S16LE") : format;
+  for (int i = 0; i < consumers.count(); ++i) {
+    GstBuffer *consumer_buf = consumers_need_s16[i] ? buf : native_buf;
+    gst_buffer_ref(consumer_buf);
+    consumers[i]->ConsumeBuffer(consumer_buf, instance->id(), consumers_need_s16[i] ? s16_format : format, timestamp_nanosec);
   }
 
-  for (GstBufferConsumer *consumer : consumers) {
-    gst_buffer_ref(buf);
-    consumer->ConsumeBuffer(buf, instance->id(), format);
+  if (!pcm_taps.isEmpty() && caps) {
+    instance->PushToPcmTaps(pcm_taps, native_buf, caps, buf16, channels, rate);
   }
 
   if (buf16) {
     gst_buffer_unref(buf16);
   }
 
+  if (caps) {
+    gst_caps_unref(caps);
+  }
+
   // Calculate the end time of this buffer so we can stop playback if it's after the end time of this song.
   if (instance->end_offset_nanosec_ > 0 && end_time > instance->end_offset_nanosec_) {
     if (instance->has_next_valid_url() && instance->next_stream_url_ == instance->stream_url_ && instance->next_beginning_offset_nanosec_ == instance->end_offset_nanosec_) {
@@ -1337,6 +1389,10 @@ GstBusSyncReply GstEnginePipeline::BusSyncCallback(GstBus *bus, GstMessage *msg,
       instance->StreamStartMessageReceived();
       break;
 
+    case GST_MESSAGE_QOS:
+      instance->QosMessageReceived(msg);
+      break;
+
     default:
       break;
   }
@@ -1575,6 +1631,10 @@ void GstEnginePipeline::StateChangedMessageReceived(GstMessage *msg) {
 
   qLog(Debug) << "Pipeline state changed from" << GstStateText(old_state) << "to" << GstStateText(new_state);
 
+  if (metrics_) {
+    AddMetricsEvent(GstEnginePipelineMetrics::EventType::StateChange, metrics_->now_msec() - state_requested_msec_.loadRelaxed(), static_cast<int>(new_state), GstStateText(old_state) + QStringLiteral(" -> ") + GstStateText(new_state));
+  }
+
   if (!pipeline_is_active_ && (new_state == GST_STATE_PAUSED || new_state == GST_STATE_PLAYING)) {
     qLog(Debug) << "Pipeline is active";
     pipeline_is_active_ = true;
@@ -1626,9 +1686,16 @@ void GstEnginePipeline::BufferingMessageReceived(GstMessage *msg) {
   int percent = 0;
   gst_message_parse_buffering(msg, &percent);
 
+  // Only keep every 10% so the messages don't flood the metrics.
+  if (last_buffering_percent_ == -1 || percent / 10 != last_buffering_percent_ / 10 || (percent == 100 && last_buffering_percent_ != 100)) {
+    last_buffering_percent_ = percent;
+    AddMetricsEvent(GstEnginePipelineMetrics::EventType::Buffering, -1, percent);
+  }
+
   const GstState current_state = state();
 
   if (percent == 0 && current_state == GST_STATE_PLAYING && !buffering_) {
+    AddMetricsEvent(GstEnginePipelineMetrics::EventType::QueueUnderrun);
     buffering_ = true;
     emit BufferingStarted();
 
@@ -1646,6 +1713,41 @@ void GstEnginePipeline::BufferingMessageReceived(GstMessage *msg) {
 
 }
 
+void GstEnginePipeline::QosMessageReceived(GstMessage *msg) {
+
+  // Audio sinks post QoS messages when they have to drop or resync audio that arrived too late.
+  if (!audiosink_ || !metrics_ || (msg->src != GST_OBJECT(audiosink_) && !gst_object_has_as_ancestor(msg->src, GST_OBJECT(audiosink_)))) {
+    return;
+  }
+
+  guint64 processed = 0, dropped = 0;
+  gst_message_parse_qos_stats(msg, nullptr, &processed, &dropped);
+
+  AddMetricsEvent(GstEnginePipelineMetrics::EventType::SinkUnderrun, -1, static_cast<int>(dropped), QString::fromUtf8(GST_OBJECT_NAME(msg->src)));
+
+}
+
+void GstEnginePipeline::AddMetricsEvent(const GstEnginePipelineMetrics::EventType type, const qint64 duration_msec, const int value, const QString &text) {
+
+  if (metrics_) {
+    metrics_->AddEvent(id_, type, duration_msec, value, text);
+  }
+
+}
+
+void GstEnginePipeline::UpdateQueueLevel() {
+
+  if (!metrics_ || !audioqueue_) return;
+
+  guint64 level_nanosec = 0;
+  g_object_get(G_OBJECT(audioqueue_), "current-level-time", &level_nanosec, nullptr);
+
+  const qint64 level_msec = static_cast<qint64>(level_nanosec) / kNsecPerMsec;
+  const int percent = buffer_duration_nanosec_ > 0 ? static_cast<int>(level_nanosec * 100 / buffer_duration_nanosec_) : 0;
+  metrics_->UpdateQueueLevel(id_, level_msec, percent);
+
+}
+
 qint64 GstEnginePipeline::position() const {
 
   if (pipeline_is_active_) {
@@ -1682,6 +1784,7 @@ GstState GstEnginePipeline::state() const {
 QFuture<GstStateChangeReturn> GstEnginePipeline::SetState(const GstState state) {
 
   qLog(Debug) << "Setting pipeline state to" << GstStateText(state);
+  if (metrics_) state_requested_msec_.storeRelaxed(metrics_->now_msec());
   return QtConcurrent::run(&set_state_threadpool_, &gst_element_set_state, pipeline_, state);
 
 }
@@ -1895,6 +1998,37 @@ void GstEnginePipeline::timerEvent(QTimerEvent *e) {
 
 }
 
+void GstEnginePipeline::PushToPcmTaps(const QList<SharedPtr<GstPcmTap>> &pcm_taps, GstBuffer *native_buffer, GstCaps *native_caps, GstBuffer *s16_buffer, const int channels, const int rate) {
+
+  // When the audio already is 16 bit there is no converted buffer and the native sample is used for all taps.
+  const bool native_s16 = g_strcmp0(gst_structure_get_string(gst_caps_get_structure(native_caps, 0), "format"), "S16LE") == 0;
+
+  GstSample *native_sample = nullptr;
+  GstSample *s16_sample = nullptr;
+
+  for (const SharedPtr<GstPcmTap> &pcm_tap : pcm_taps) {
+    if (pcm_tap->format() == GstPcmTap::Format::Native || native_s16) {
+      if (!native_sample) {
+        native_sample = gst_sample_new(native_buffer, native_caps, nullptr, gst_structure_new("pcm-tap", "pipeline-id", G_TYPE_INT, id_, "stream-start", G_TYPE_UINT64, static_cast<guint64>(segment_start_), nullptr));
+      }
+      pcm_tap->Push(native_sample);
+    }
+    else if (s16_buffer) {
+      if (!s16_sample) {
+        GstCaps *s16_caps = gst_caps_new_simple("audio/x-raw", "format", G_TYPE_STRING, "S16LE", "layout", G_TYPE_STRING, "interleaved", "rate", G_TYPE_INT, rate, "channels", G_TYPE_INT, channels, nullptr);
+        // The converted buffer is already timestamped relative to the start of the stream.
+        s16_sample = gst_sample_new(s16_buffer, s16_caps, nullptr, gst_structure_new("pcm-tap", "pipeline-id", G_TYPE_INT, id_, "stream-start", G_TYPE_UINT64, static_cast<guint64>(0), nullptr));
+        gst_caps_unref(s16_caps);
+      }
+      pcm_tap->Push(s16_sample);
+    }
+  }
+
+  if (native_sample) gst_sample_unref(native_sample);
+  if (s16_sample) gst_sample_unref(s16_sample);
+
+}
+
 void GstEnginePipeline::AddBufferConsumer(GstBufferConsumer *consumer) {
   QMutexLocker l(&buffer_consumers_mutex_);
   buffer_consumers_ << consumer;
@@ -1910,6 +2044,21 @@ void GstEnginePipeline::RemoveAllBufferConsumers() {
   buffer_consumers_.clear();
 }
 
+void GstEnginePipeline::AddPcmTap(SharedPtr<GstPcmTap> pcm_tap) {
+  QMutexLocker l(&buffer_consumers_mutex_);
+  pcm_taps_ << pcm_tap;
+}
+
+void GstEnginePipeline::RemovePcmTap(SharedPtr<GstPcmTap> pcm_tap) {
+  QMutexLocker l(&buffer_consumers_mutex_);
+  pcm_taps_.removeAll(pcm_tap);
+}
+
+void GstEnginePipeline::RemoveAllPcmTaps() {
+  QMutexLocker l(&buffer_consumers_mutex_);
+  pcm_taps_.clear();
+}
+
 void GstEnginePipeline::PrepareNextUrl(const QUrl &media_url, const QUrl &stream_url, const QByteArray &gst_url, const qint64 beginning_nanosec, const qint64 end_nanosec) {
 
   next_media_url_ = media_url;
@@ -32,6 +32,8 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicInteger>
 #include <QThreadPool>
 #include <QFuture>
 #include <QTimeLine>
@@ -45,6 +47,8 @@
 
 #include "core/shared_ptr.h"
 #include "enginemetadata.h"
+#include "gstenginepipelinemetrics.h"
+#include "gstpcmtap.h"
 
 class QTimerEvent;
 class GstBufferConsumer;
@@ -76,6 +80,7 @@ class GstEnginePipeline : public QObject {
   void set_bs2b_enabled(const bool enabled);
   void set_strict_ssl_enabled(const bool enabled);
   void set_fading_enabled(const bool enabled);
+  void set_metrics(SharedPtr<GstEnginePipelineMetrics> metrics);
 #ifdef HAVE_SPOTIFY
   void set_spotify_login(const QString &spotify_username, const QString &spotify_password);
 #endif
@@ -88,6 +93,11 @@ class GstEnginePipeline : public QObject {
   void RemoveBufferConsumer(GstBufferConsumer *consumer);
   void RemoveAllBufferConsumers();
 
+  // GstPcmTaps get the audio data without conversion, or converted to 16 bit only when they ask for it.  Thread-safe.
+  void AddPcmTap(SharedPtr<GstPcmTap> pcm_tap);
+  void RemovePcmTap(SharedPtr<GstPcmTap> pcm_tap);
+  void RemoveAllPcmTaps();
+
   // Control the music playback
   Q_INVOKABLE QFuture<GstStateChangeReturn> SetState(const GstState state);
   void SetStateDelayed(const GstState state);
@@ -133,6 +143,9 @@ class GstEnginePipeline : public QObject {
 
   QString source_device() const { return source_device_; }
 
+  // Records how full the queue is in the metrics, called periodically while playing.
+  void UpdateQueueLevel();
+
  public slots:
   void SetFaderVolume(const qreal volume);
 
@@ -174,6 +187,8 @@ class GstEnginePipeline : public QObject {
   static gboolean BusWatchCallback(GstBus *bus, GstMessage *msg, gpointer self);
   static void TaskEnterCallback(GstTask *task, GThread *thread, gpointer self);
 
+  void PushToPcmTaps(const QList<SharedPtr<GstPcmTap>> &pcm_taps, GstBuffer *native_buffer, GstCaps *native_caps, GstBuffer *s16_buffer, const int channels, const int rate);
+
   void TagMessageReceived(GstMessage *msg);
   void ErrorMessageReceived(GstMessage *msg);
   void ElementMessageReceived(GstMessage *msg);
@@ -181,6 +196,9 @@ class GstEnginePipeline : public QObject {
   void BufferingMessageReceived(GstMessage *msg);
   void StreamStatusMessageReceived(GstMessage *msg);
   void StreamStartMessageReceived();
+  void QosMessageReceived(GstMessage *msg);
+
+  void AddMetricsEvent(const GstEnginePipelineMetrics::EventType type, const qint64 duration_msec = -1, const int value = 0, const QString &text = QString());
 
   static QString ParseStrTag(GstTagList *list, const char *tag);
   static guint ParseUIntTag(GstTagList *list, const char *tag);
@@ -260,6 +278,7 @@ class GstEnginePipeline : public QObject {
 
   // These get called when there is a new audio buffer available
   QList<GstBufferConsumer*> buffer_consumers_;
+  QList<SharedPtr<GstPcmTap>> pcm_taps_;
   QMutex buffer_consumers_mutex_;
   qint64 segment_start_;
   bool segment_start_received_;
@@ -345,6 +364,12 @@ class GstEnginePipeline : public QObject {
 
   bool logged_unsupported_analyzer_format_;
 
+  SharedPtr<GstEnginePipelineMetrics> metrics_;
+  qint64 created_msec_;
+  QAtomicInteger<qint64> state_requested_msec_;
+  QAtomicInt first_buffer_received_;
+  int last_buffering_percent_;
+
   bool about_to_finish_;
 
 };
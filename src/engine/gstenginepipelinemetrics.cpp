@@ -0,0 +1,176 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cstdlib>
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "gstenginepipelinemetrics.h"
+
+const int GstEnginePipelineMetrics::kDefaultCapacity = 512;
+const int GstEnginePipelineMetrics::kQueueLevelEventStep = 10;
+
+GstEnginePipelineMetrics::GstEnginePipelineMetrics(const int capacity)
+    : events_(static_cast<size_t>(qMax(1, capacity))),
+      next_event_(0),
+      event_count_(0),
+      last_init_msec_(-1),
+      last_first_buffer_msec_(-1),
+      last_state_change_msec_(-1),
+      last_track_change_msec_(-1),
+      queue_underruns_(0),
+      sink_underruns_(0),
+      last_queue_level_percent_(-1),
+      last_queue_level_event_percent_(-1),
+      last_queue_level_msec_(-1) {
+
+  timer_.start();
+
+}
+
+QString GstEnginePipelineMetrics::EventTypeName(const EventType type) {
+
+  switch (type) {
+    case EventType::Init:          return QStringLiteral("Init");
+    case EventType::StateChange:   return QStringLiteral("State change");
+    case EventType::FirstBuffer:   return QStringLiteral("First buffer");
+    case EventType::Buffering:     return QStringLiteral("Buffering");
+    case EventType::QueueUnderrun: return QStringLiteral("Queue underrun");
+    case EventType::SinkUnderrun:  return QStringLiteral("Sink underrun");
+    case EventType::QueueLevel:    return QStringLiteral("Queue level");
+    case EventType::TrackChange:   return QStringLiteral("Track change");
+  }
+
+  return QString();
+
+}
+
+void GstEnginePipelineMetrics::AddEvent(const int pipeline_id, const EventType type, const qint64 duration_msec, const int value, const QString &text) {
+
+  Event event;
+  event.timestamp_msec = timer_.elapsed();
+  event.pipeline_id = pipeline_id;
+  event.type = type;
+  event.duration_msec = duration_msec;
+  event.value = value;
+  event.text = text;
+
+  QMutexLocker l(&mutex_);
+
+  switch (type) {
+    case EventType::Init:
+      last_init_msec_ = duration_msec;
+      break;
+    case EventType::StateChange:
+      last_state_change_msec_ = duration_msec;
+      break;
+    case EventType::FirstBuffer:
+      last_first_buffer_msec_ = duration_msec;
+      break;
+    case EventType::TrackChange:
+      last_track_change_msec_ = duration_msec;
+      break;
+    case EventType::QueueUnderrun:
+      ++queue_underruns_;
+      break;
+    case EventType::SinkUnderrun:
+      ++sink_underruns_;
+      break;
+    default:
+      break;
+  }
+
+  events_[static_cast<size_t>(next_event_)] = event;
+  next_event_ = (next_event_ + 1) % static_cast<int>(events_.size());
+  event_count_ = qMin(event_count_ + 1, static_cast<int>(events_.size()));
+
+}
+
+void GstEnginePipelineMetrics::UpdateQueueLevel(const int pipeline_id, const qint64 level_msec, const int percent) {
+
+  bool add_event = false;
+  {
+    QMutexLocker l(&mutex_);
+    last_queue_level_percent_ = percent;
+    last_queue_level_msec_ = level_msec;
+    if (last_queue_level_event_percent_ == -1 || std::abs(percent - last_queue_level_event_percent_) >= kQueueLevelEventStep) {
+      last_queue_level_event_percent_ = percent;
+      add_event = true;
+    }
+  }
+
+  if (add_event) {
+    AddEvent(pipeline_id, EventType::QueueLevel, level_msec, percent);
+  }
+
+}
+
+QList<GstEnginePipelineMetrics::Event> GstEnginePipelineMetrics::events() const {
+
+  QMutexLocker l(&mutex_);
+
+  QList<Event> ret;
+  ret.reserve(event_count_);
+  const int size = static_cast<int>(events_.size());
+  for (int i = 0; i < event_count_; ++i) {
+    ret << events_[static_cast<size_t>((next_event_ - event_count_ + i + size) % size)];
+  }
+
+  return ret;
+
+}
+
+void GstEnginePipelineMetrics::Clear() {
+
+  QMutexLocker l(&mutex_);
+  next_event_ = 0;
+  event_count_ = 0;
+  last_init_msec_ = -1;
+  last_first_buffer_msec_ = -1;
+  last_state_change_msec_ = -1;
+  last_track_change_msec_ = -1;
+  queue_underruns_ = 0;
+  sink_underruns_ = 0;
+  last_queue_level_percent_ = -1;
+  last_queue_level_event_percent_ = -1;
+  last_queue_level_msec_ = -1;
+
+}
+
+QString GstEnginePipelineMetrics::SummaryText() const {
+
+  QMutexLocker l(&mutex_);
+
+  return QStringLiteral("Init: %1 ms, last state change: %2 ms, first buffer: %3 ms, track change: %4 ms, queue: %5 ms (%6%), queue underruns: %7, sink underruns: %8")
+    .arg(last_init_msec_)
+    .arg(last_state_change_msec_)
+    .arg(last_first_buffer_msec_)
+    .arg(last_track_change_msec_)
+    .arg(last_queue_level_msec_)
+    .arg(last_queue_level_percent_)
+    .arg(queue_underruns_)
+    .arg(sink_underruns_);
+
+}
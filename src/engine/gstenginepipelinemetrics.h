@@ -0,0 +1,97 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GSTENGINEPIPELINEMETRICS_H
+#define GSTENGINEPIPELINEMETRICS_H
+
+#include "config.h"
+
+#include <vector>
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include <QElapsedTimer>
+
+// Timing spans and health events recorded by the GStreamer pipelines, kept in a fixed size ring buffer.
+// Events are added from the GUI thread, the bus sync handler and the streaming threads, so all methods are thread-safe.
+class GstEnginePipelineMetrics {
+ public:
+  explicit GstEnginePipelineMetrics(const int capacity = kDefaultCapacity);
+
+  enum class EventType {
+    Init,           // InitFromUrl(), duration is the time it took
+    StateChange,    // value is the new GstState, duration is the time since the state change was requested
+    FirstBuffer,    // The first buffer reached the buffer probe, duration is the time since the pipeline was created
+    Buffering,      // value is the queue2 buffering percent
+    QueueUnderrun,  // The queue ran empty while playing and the pipeline had to pause for buffering
+    SinkUnderrun,   // The sink posted a QoS message, it dropped or resynced audio because the data came too late
+    QueueLevel,     // value is the queue2 level in percent of the buffer duration, duration is the level in msec
+    TrackChange     // The first buffer of the new track, duration is the time since the track change, value is 1 when the standby pipeline was used
+  };
+
+  struct Event {
+    qint64 timestamp_msec;
+    int pipeline_id;
+    EventType type;
+    qint64 duration_msec;
+    int value;
+    QString text;
+  };
+
+  static QString EventTypeName(const EventType type);
+
+  // Milliseconds since the metrics were created, the time base of the event timestamps.
+  qint64 now_msec() const { return timer_.elapsed(); }
+
+  void AddEvent(const int pipeline_id, const EventType type, const qint64 duration_msec = -1, const int value = 0, const QString &text = QString());
+
+  // Only adds an event when the level moved noticeably since the last one, but always updates the summary.
+  void UpdateQueueLevel(const int pipeline_id, const qint64 level_msec, const int percent);
+
+  // Oldest first.
+  QList<Event> events() const;
+  void Clear();
+
+  // One line with the last spans and the counters, for the log and the dialog.
+  QString SummaryText() const;
+
+ private:
+  static const int kDefaultCapacity;
+  static const int kQueueLevelEventStep;
+
+  QElapsedTimer timer_;
+  mutable QMutex mutex_;
+  std::vector<Event> events_;
+  int next_event_;
+  int event_count_;
+
+  qint64 last_init_msec_;
+  qint64 last_first_buffer_msec_;
+  qint64 last_state_change_msec_;
+  qint64 last_track_change_msec_;
+  int queue_underruns_;
+  int sink_underruns_;
+  int last_queue_level_percent_;
+  int last_queue_level_event_percent_;
+  qint64 last_queue_level_msec_;
+};
+
+#endif  // GSTENGINEPIPELINEMETRICS_H
@@ -0,0 +1,80 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <gst/gst.h>
+
+#include <QtGlobal>
+
+#include "gstpcmtap.h"
+
+const int GstPcmTap::kDefaultMaxQueued = 64;
+
+GstPcmTap::GstPcmTap(const Format format, const int max_queued, const DropPolicy drop_policy)
+    : format_(format),
+      max_queued_(qMax(1, max_queued)),
+      drop_policy_(drop_policy),
+      queue_(gst_atomic_queue_new(static_cast<guint>(max_queued_))),
+      dropped_(0) {}
+
+GstPcmTap::~GstPcmTap() {
+
+  while (GstSample *sample = Pop()) {
+    gst_sample_unref(sample);
+  }
+  gst_atomic_queue_unref(queue_);
+
+}
+
+void GstPcmTap::Push(GstSample *sample) {
+
+  if (gst_atomic_queue_length(queue_) >= static_cast<guint>(max_queued_)) {
+    dropped_.fetchAndAddRelaxed(1);
+    switch (drop_policy_) {
+      case DropPolicy::DropNewest:
+        return;
+      case DropPolicy::DropOldest:
+        // The consumer may have emptied the queue in the meantime, then there's nothing to drop.
+        if (GstSample *oldest = Pop()) {
+          gst_sample_unref(oldest);
+        }
+        break;
+    }
+  }
+
+  gst_atomic_queue_push(queue_, gst_sample_ref(sample));
+
+  if (notify_callback_) {
+    notify_callback_();
+  }
+
+}
+
+GstSample *GstPcmTap::Pop() {
+
+  return static_cast<GstSample*>(gst_atomic_queue_pop(queue_));
+
+}
+
+int GstPcmTap::queued() const {
+
+  return static_cast<int>(gst_atomic_queue_length(queue_));
+
+}
@@ -0,0 +1,83 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GSTPCMTAP_H
+#define GSTPCMTAP_H
+
+#include "config.h"
+
+#include <functional>
+
+#include <gst/gst.h>
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+
+// Read-only access to the PCM data of the playing pipeline, for consumers that need more than the 16 bit copy a GstBufferConsumer gets.
+// The streaming thread pushes samples to a lock-free queue which the consumer drains from its own thread.
+// When the queue is full the drop policy decides which samples are lost, so a slow consumer never stalls playback.
+//
+// Each sample holds a reference to the buffer and its caps, the buffers are shared with the pipeline and must only be mapped for reading.
+// The sample info structure has the "pipeline-id" (int) and "stream-start" (guint64), subtract the latter from the buffer PTS to get the position in the stream.
+class GstPcmTap {
+ public:
+  enum class Format {
+    Native,  // The format the pipeline plays, nothing is converted or copied
+    S16LE    // Converted to 16 bit for consumers that only handle that, shares the native buffer when it already is
+  };
+
+  enum class DropPolicy {
+    DropNewest,  // Keep what is queued, and drop new samples
+    DropOldest   // Make room for new samples by dropping the oldest ones
+  };
+
+  explicit GstPcmTap(const Format format = Format::Native, const int max_queued = kDefaultMaxQueued, const DropPolicy drop_policy = DropPolicy::DropOldest);
+  ~GstPcmTap();
+
+  Format format() const { return format_; }
+  DropPolicy drop_policy() const { return drop_policy_; }
+  int max_queued() const { return max_queued_; }
+
+  // Called in the streaming thread after a sample was queued, so keep it cheap.
+  // Set it before the tap is added to the engine.
+  void SetNotifyCallback(std::function<void()> callback) { notify_callback_ = callback; }
+
+  // Called in the streaming thread, takes a reference to the sample.
+  void Push(GstSample *sample);
+
+  // Returns nullptr when the queue is empty, otherwise the caller owns the sample and should gst_sample_unref it.
+  GstSample *Pop();
+
+  int queued() const;
+  quint64 dropped() const { return dropped_.loadRelaxed(); }
+
+ private:
+  static const int kDefaultMaxQueued;
+
+  const Format format_;
+  const int max_queued_;
+  const DropPolicy drop_policy_;
+  GstAtomicQueue *queue_;
+  QAtomicInteger<quint64> dropped_;
+  std::function<void()> notify_callback_;
+
+  Q_DISABLE_COPY(GstPcmTap)
+};
+
+#endif  // GSTPCMTAP_H
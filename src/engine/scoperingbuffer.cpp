@@ -0,0 +1,138 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "utilities/timeconstants.h"
+#include "scoperingbuffer.h"
+
+const qint64 ScopeRingBuffer::kDiscontinuityNanosec = kNsecPerMsec;
+
+namespace {
+
+quint32 NextPowerOfTwo(const int value) {
+
+  quint32 result = 1;
+  while (result < static_cast<quint32>(qMax(1, value))) result <<= 1;
+  return result;
+
+}
+
+}  // namespace
+
+ScopeRingBuffer::ScopeRingBuffer(const int capacity, const int frame_size)
+    : frames_(NextPowerOfTwo(capacity)),
+      frame_size_(frame_size),
+      mask_(NextPowerOfTwo(capacity) - 1),
+      read_index_(0),
+      write_index_(0),
+      pending_samples_(0),
+      pending_pipeline_id_(-1),
+      pending_next_timestamp_nanosec_(0) {
+
+  for (Frame &frame : frames_) {
+    frame.pipeline_id = -1;
+    frame.timestamp_nanosec = 0;
+    frame.duration_nanosec = 0;
+    frame.samples.resize(frame_size_, 0);
+  }
+
+}
+
+int ScopeRingBuffer::Write(const int pipeline_id, const qint64 timestamp_nanosec, const qint64 duration_nanosec, const int16_t *data, const qint64 samples) {
+
+  if (!data || samples <= 0 || duration_nanosec <= 0) return 0;
+
+  const double nanosec_per_sample = static_cast<double>(duration_nanosec) / static_cast<double>(samples);
+
+  // Don't glue the start of this buffer onto a frame from another pipeline or from before a seek.
+  if (pending_samples_ > 0 && (pipeline_id != pending_pipeline_id_ || qAbs(timestamp_nanosec - pending_next_timestamp_nanosec_) > kDiscontinuityNanosec)) {
+    pending_samples_ = 0;
+  }
+
+  pending_pipeline_id_ = pipeline_id;
+  pending_next_timestamp_nanosec_ = timestamp_nanosec + duration_nanosec;
+
+  int dropped = 0;
+  qint64 offset = 0;
+  while (offset < samples) {
+    const quint32 write_index = write_index_.loadRelaxed();
+    if (write_index - read_index_.loadAcquire() > mask_) {
+      // The ring is full, the consumer is not keeping up or not reading at all.
+      pending_samples_ = 0;
+      dropped += static_cast<int>((samples - offset + frame_size_ - 1) / frame_size_);
+      break;
+    }
+
+    Frame &frame = frames_[write_index & mask_];
+    if (pending_samples_ == 0) {
+      frame.pipeline_id = pipeline_id;
+      frame.timestamp_nanosec = timestamp_nanosec + static_cast<qint64>(static_cast<double>(offset) * nanosec_per_sample);
+    }
+
+    const qint64 count = qMin(static_cast<qint64>(frame_size_) - pending_samples_, samples - offset);
+    memcpy(frame.samples.data() + pending_samples_, data + offset, static_cast<size_t>(count) * sizeof(int16_t));
+    pending_samples_ += count;
+    offset += count;
+
+    if (pending_samples_ == frame_size_) {
+      frame.duration_nanosec = static_cast<qint64>(static_cast<double>(frame_size_) * nanosec_per_sample);
+      write_index_.storeRelease(write_index + 1);
+      pending_samples_ = 0;
+    }
+  }
+
+  return dropped;
+
+}
+
+const ScopeRingBuffer::Frame *ScopeRingBuffer::Peek() const {
+
+  const quint32 read_index = read_index_.loadRelaxed();
+  if (read_index == write_index_.loadAcquire()) return nullptr;
+
+  return &frames_[read_index & mask_];
+
+}
+
+void ScopeRingBuffer::Pop() {
+
+  const quint32 read_index = read_index_.loadRelaxed();
+  if (read_index == write_index_.loadAcquire()) return;
+
+  read_index_.storeRelease(read_index + 1);
+
+}
+
+void ScopeRingBuffer::Clear() {
+
+  read_index_.storeRelease(write_index_.loadAcquire());
+
+}
+
+int ScopeRingBuffer::size() const {
+
+  return static_cast<int>(write_index_.loadAcquire() - read_index_.loadAcquire());
+
+}
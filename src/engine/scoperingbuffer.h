@@ -0,0 +1,79 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCOPERINGBUFFER_H
+#define SCOPERINGBUFFER_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+
+// Lock-free single producer, single consumer ring of timestamped PCM frames.
+// The producer is the GStreamer streaming thread, the consumer is the GUI thread reading the scope for the analyzers.
+// Frames are preallocated, so neither side allocates memory or touches GstBuffers once the ring is constructed.
+
+class ScopeRingBuffer {
+ public:
+  // Capacity is rounded up to a power of two, frame_size is the number of interleaved 16 bit samples per frame.
+  explicit ScopeRingBuffer(const int capacity, const int frame_size);
+
+  struct Frame {
+    int pipeline_id;
+    qint64 timestamp_nanosec;
+    qint64 duration_nanosec;
+    std::vector<int16_t> samples;
+  };
+
+  int capacity() const { return static_cast<int>(frames_.size()); }
+  int frame_size() const { return frame_size_; }
+
+  // Producer side.
+  // Splits interleaved 16 bit PCM into frames, a partial frame is completed by the next write if it is contiguous.
+  // Returns the number of frames that had to be dropped because the ring was full.
+  int Write(const int pipeline_id, const qint64 timestamp_nanosec, const qint64 duration_nanosec, const int16_t *data, const qint64 samples);
+
+  // Consumer side.
+  const Frame *Peek() const;
+  void Pop();
+  void Clear();
+  int size() const;
+
+ private:
+  static const qint64 kDiscontinuityNanosec;
+
+  std::vector<Frame> frames_;
+  const int frame_size_;
+  const quint32 mask_;
+
+  QAtomicInteger<quint32> read_index_;
+  QAtomicInteger<quint32> write_index_;
+
+  // Only touched by the producer.
+  qint64 pending_samples_;
+  int pending_pipeline_id_;
+  qint64 pending_next_timestamp_nanosec_;
+
+  Q_DISABLE_COPY(ScopeRingBuffer)
+};
+
+#endif  // SCOPERINGBUFFER_H
@@ -0,0 +1,406 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QThread>
+#include <QByteArray>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "core/logging.h"
+#include "core/signalchecker.h"
+#include "core/song.h"
+
+#include "songanalysispipeline.h"
+
+#ifdef HAVE_SONGFINGERPRINTING
+#  include "chromaprinter.h"
+#endif
+
+#ifdef HAVE_EBUR128
+#  include "ebur128analysis.h"
+#endif
+
+#ifdef HAVE_MOODBAR
+#  include "moodbar/moodbarbuilder.h"
+#  include "moodbar/moodbarpipeline.h"
+#  include "ext/gstmoodbar/gstfastspectrum.h"
+#endif
+
+const int SongAnalysisPipeline::kTimeoutSecs = 120;
+// How much decoded audio each branch may buffer, so a slow analysis does not stall the others.
+const qint64 SongAnalysisPipeline::kQueueNanosec = 60 * GST_SECOND;
+
+SongAnalysisPipeline::SongAnalysisPipeline(const Song &song)
+    : song_(song),
+      pipeline_(nullptr),
+      tee_(nullptr),
+      fingerprint_first_pts_(-1),
+      fingerprint_max_bytes_(0) {}
+
+SongAnalysisPipeline::~SongAnalysisPipeline() = default;
+
+SongAnalysisPipeline::Analyses SongAnalysisPipeline::SupportedAnalyses() {
+
+  Analyses analyses;
+#ifdef HAVE_SONGFINGERPRINTING
+  analyses |= Analysis::Fingerprint;
+#endif
+#ifdef HAVE_EBUR128
+  analyses |= Analysis::EBUR128;
+#endif
+#ifdef HAVE_MOODBAR
+  analyses |= Analysis::Moodbar;
+#endif
+  return analyses;
+
+}
+
+SongAnalysisPipeline::Analyses SongAnalysisPipeline::AvailableAnalyses() const {
+
+  if (!song_.url().isLocalFile()) return Analyses();
+
+  Analyses analyses = SupportedAnalyses();
+  if (song_.has_cue()) {
+    analyses.setFlag(Analysis::Fingerprint, false);
+    analyses.setFlag(Analysis::Moodbar, false);
+  }
+
+  return analyses;
+
+}
+
+GstElement *SongAnalysisPipeline::CreateElement(const QString &factory_name, GstElement *bin) {
+
+  // No element names, the branches contain several elements of the same type.
+  GstElement *ret = gst_element_factory_make(factory_name.toLatin1().constData(), nullptr);
+
+  if (ret && bin) gst_bin_add(GST_BIN(bin), ret);
+
+  if (!ret) {
+    qLog(Warning) << "Couldn't create the gstreamer element" << factory_name;
+  }
+
+  return ret;
+
+}
+
+GstElement *SongAnalysisPipeline::CreateQueue() {
+
+  GstElement *queue = CreateElement(QStringLiteral("queue"), pipeline_);
+  if (!queue) return nullptr;
+
+  g_object_set(G_OBJECT(queue), "max-size-time", static_cast<guint64>(kQueueNanosec), nullptr);
+  g_object_set(G_OBJECT(queue), "max-size-buffers", 0, nullptr);
+  g_object_set(G_OBJECT(queue), "max-size-bytes", 0, nullptr);
+
+  if (!gst_element_link(tee_, queue)) {
+    qLog(Error) << "Failed to link analysis branch";
+    return nullptr;
+  }
+
+  return queue;
+
+}
+
+SongAnalysisPipeline::Analyses SongAnalysisPipeline::Run(const Analyses requested_analyses) {
+
+  Q_ASSERT(QThread::currentThread() != qApp->thread());
+
+  const Analyses analyses = requested_analyses & AvailableAnalyses();
+  if (!analyses) return Analyses();
+
+  pipeline_ = gst_pipeline_new("analysis-pipeline");
+  if (!pipeline_) return Analyses();
+
+  GstElement *src = CreateElement(QStringLiteral("filesrc"), pipeline_);
+  GstElement *decode = CreateElement(QStringLiteral("decodebin"), pipeline_);
+  tee_ = CreateElement(QStringLiteral("tee"), pipeline_);
+
+  bool success = src && decode && tee_ && gst_element_link(src, decode);
+
+  GstAppSinkCallbacks fingerprint_callbacks;
+  memset(&fingerprint_callbacks, 0, sizeof(fingerprint_callbacks));
+  GstAppSinkCallbacks ebur128_callbacks;
+  memset(&ebur128_callbacks, 0, sizeof(ebur128_callbacks));
+
+#ifdef HAVE_SONGFINGERPRINTING
+  // queue ! audioconvert ! audioresample ! appsink, only the beginning of the song passes the queue.
+  if (success && analyses.testFlag(Analysis::Fingerprint)) {
+    GstElement *queue = CreateQueue();
+    GstElement *convert = CreateElement(QStringLiteral("audioconvert"), pipeline_);
+    GstElement *resample = CreateElement(QStringLiteral("audioresample"), pipeline_);
+    GstElement *sink = CreateElement(QStringLiteral("appsink"), pipeline_);
+    GstCaps *caps = gst_caps_new_simple("audio/x-raw", "format", G_TYPE_STRING, "S16LE", "channels", G_TYPE_INT, Chromaprinter::kDecodeChannels, "rate", G_TYPE_INT, Chromaprinter::kDecodeRate, nullptr);
+    success = queue && convert && resample && sink && gst_element_link_many(queue, convert, resample, nullptr) && gst_element_link_filtered(resample, sink, caps);
+    gst_caps_unref(caps);
+    if (success) {
+      GstPad *pad = gst_element_get_static_pad(queue, "sink");
+      gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &FingerprintProbeCallback, this, nullptr);
+      gst_object_unref(pad);
+      fingerprint_max_bytes_ = static_cast<qint64>(Chromaprinter::kPlayLengthSecs) * Chromaprinter::kDecodeRate * Chromaprinter::kDecodeChannels * static_cast<qint64>(sizeof(int16_t));
+      fingerprint_callbacks.new_sample = NewFingerprintBufferCallback;
+      gst_app_sink_set_callbacks(reinterpret_cast<GstAppSink*>(sink), &fingerprint_callbacks, this, nullptr);
+      g_object_set(G_OBJECT(sink), "sync", FALSE, nullptr);
+    }
+  }
+#endif
+
+#ifdef HAVE_EBUR128
+  // queue ! audioconvert ! appsink
+  if (success && analyses.testFlag(Analysis::EBUR128)) {
+    GstElement *queue = CreateQueue();
+    GstElement *convert = CreateElement(QStringLiteral("audioconvert"), pipeline_);
+    GstElement *sink = CreateElement(QStringLiteral("appsink"), pipeline_);
+    GstCaps *caps = EBUR128Accumulator::SupportedCaps();
+    success = queue && convert && sink && gst_element_link(queue, convert) && gst_element_link_filtered(convert, sink, caps);
+    gst_caps_unref(caps);
+    if (success) {
+      ebur128_.reset(new EBUR128Accumulator);
+      ebur128_callbacks.new_sample = NewEBUR128BufferCallback;
+      gst_app_sink_set_callbacks(reinterpret_cast<GstAppSink*>(sink), &ebur128_callbacks, this, nullptr);
+      g_object_set(G_OBJECT(sink), "buffer-list", FALSE, nullptr);
+      g_object_set(G_OBJECT(sink), "sync", FALSE, nullptr);
+      g_object_set(G_OBJECT(sink), "max-buffers", 1, nullptr);
+    }
+  }
+#endif
+
+#ifdef HAVE_MOODBAR
+  // queue ! audioconvert ! fastspectrum ! fakesink
+  if (success && analyses.testFlag(Analysis::Moodbar)) {
+    GstElement *queue = CreateQueue();
+    GstElement *convert = CreateElement(QStringLiteral("audioconvert"), pipeline_);
+    GstElement *spectrum = CreateElement(QStringLiteral("fastspectrum"), pipeline_);
+    GstElement *sink = CreateElement(QStringLiteral("fakesink"), pipeline_);
+    success = queue && convert && spectrum && sink && gst_element_link_many(queue, convert, spectrum, sink, nullptr);
+    if (success) {
+      moodbar_.reset(new MoodbarBuilder);
+      g_object_set(spectrum, "bands", MoodbarPipeline::kBands, nullptr);
+      g_object_set(G_OBJECT(sink), "sync", FALSE, nullptr);
+      GstFastSpectrum *fast_spectrum = reinterpret_cast<GstFastSpectrum*>(spectrum);
+      fast_spectrum->output_callback = [this](double *magnitudes, int size) { moodbar_->AddFrame(magnitudes, size); };
+    }
+  }
+#endif
+
+  if (!success) {
+    qLog(Error) << "Failed to create analysis pipeline for" << song_.url();
+    gst_object_unref(pipeline_);
+    pipeline_ = nullptr;
+    return Analyses();
+  }
+
+  // Set the filename
+  g_object_set(src, "location", song_.url().toLocalFile().toUtf8().constData(), nullptr);
+
+  // Connect signals
+  GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
+  CHECKED_GCONNECT(decode, "pad-added", &NewPadCallback, this);
+
+  // Analyze only the specified song
+  gst_element_set_state(pipeline_, GST_STATE_PAUSED);
+  // Wait for state change before seeking
+  gst_element_get_state(pipeline_, nullptr, nullptr, kTimeoutSecs * GST_SECOND);
+  gst_element_seek(pipeline_, 1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, song_.beginning_nanosec() * GST_NSECOND, GST_SEEK_TYPE_SET, song_.end_nanosec() * GST_NSECOND);
+
+  QElapsedTimer time;
+  time.start();
+
+  // Start playing
+  gst_element_set_state(pipeline_, GST_STATE_PLAYING);
+
+  // Wait until EOS or error
+  bool had_error = true;
+  GstMessage *msg = gst_bus_timed_pop_filtered(bus, kTimeoutSecs * GST_SECOND, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  if (msg) {
+    if (msg->type == GST_MESSAGE_ERROR) {
+      // Report error
+      GError *error = nullptr;
+      gchar *debugs = nullptr;
+      gst_message_parse_error(msg, &error, &debugs);
+      if (error) {
+        QString message = QString::fromLocal8Bit(error->message);
+        g_error_free(error);
+        qLog(Debug) << "Error processing" << song_.url() << ":" << message;
+      }
+      if (debugs) free(debugs);
+    }
+    else {
+      had_error = false;
+    }
+    gst_message_unref(msg);
+  }
+  else {
+    qLog(Debug) << "Timeout processing" << song_.url();
+  }
+
+  // Stop the streaming threads before touching the collected data.
+  gst_object_unref(bus);
+  gst_element_set_state(pipeline_, GST_STATE_NULL);
+  gst_object_unref(pipeline_);
+  pipeline_ = nullptr;
+  tee_ = nullptr;
+
+  const qint64 decode_time = time.restart();
+
+  Analyses done;
+  if (had_error) return done;
+
+#ifdef HAVE_SONGFINGERPRINTING
+  if (!fingerprint_pcm_.isEmpty()) {
+    fingerprint_ = Chromaprinter::CreateFingerprint(fingerprint_pcm_);
+    fingerprint_pcm_.clear();
+    if (!fingerprint_.isEmpty()) done |= Analysis::Fingerprint;
+  }
+#endif
+
+#ifdef HAVE_EBUR128
+  if (ebur128_) {
+    ebur128_measures_ = ebur128_->Finish();
+    ebur128_.reset();
+    if (ebur128_measures_) done |= Analysis::EBUR128;
+  }
+#endif
+
+#ifdef HAVE_MOODBAR
+  if (moodbar_) {
+    moodbar_data_ = moodbar_->Finish(1000);
+    moodbar_.reset();
+    if (!moodbar_data_.isEmpty()) done |= Analysis::Moodbar;
+  }
+#endif
+
+  qLog(Debug) << "Analyzed" << song_.url() << "decode time:" << decode_time << "finalization time:" << time.elapsed();
+
+  return done;
+
+}
+
+void SongAnalysisPipeline::NewPadCallback(GstElement *element, GstPad *pad, gpointer self) {
+
+  Q_UNUSED(element);
+
+  SongAnalysisPipeline *me = reinterpret_cast<SongAnalysisPipeline*>(self);
+  GstPad *const teepad = gst_element_get_static_pad(me->tee_, "sink");
+
+  if (GST_PAD_IS_LINKED(teepad)) {
+    qLog(Warning) << "teepad is already linked, unlinking old pad";
+    gst_pad_unlink(teepad, GST_PAD_PEER(teepad));
+  }
+
+  gst_pad_link(pad, teepad);
+  gst_object_unref(teepad);
+
+#ifdef HAVE_MOODBAR
+  if (me->moodbar_) {
+    int rate = 0;
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    if (caps) {
+      GstStructure *structure = gst_caps_get_structure(caps, 0);
+      if (structure) {
+        gst_structure_get_int(structure, "rate", &rate);
+      }
+      gst_caps_unref(caps);
+    }
+    me->moodbar_->Init(MoodbarPipeline::kBands, rate);
+  }
+#endif
+
+}
+
+GstPadProbeReturn SongAnalysisPipeline::FingerprintProbeCallback(GstPad *pad, GstPadProbeInfo *info, gpointer self) {
+
+  Q_UNUSED(pad);
+
+  SongAnalysisPipeline *me = reinterpret_cast<SongAnalysisPipeline*>(self);
+
+  GstBuffer *buffer = gst_pad_probe_info_get_buffer(info);
+  if (!buffer || !GST_BUFFER_PTS_IS_VALID(buffer)) return GST_PAD_PROBE_OK;
+
+  const qint64 pts = static_cast<qint64>(GST_BUFFER_PTS(buffer));
+  if (me->fingerprint_first_pts_ < 0) {
+    me->fingerprint_first_pts_ = pts;
+  }
+
+#ifdef HAVE_SONGFINGERPRINTING
+  // Don't resample more audio than the fingerprint needs.
+  if (pts - me->fingerprint_first_pts_ >= Chromaprinter::kPlayLengthSecs * GST_SECOND) {
+    return GST_PAD_PROBE_DROP;
+  }
+#endif
+
+  return GST_PAD_PROBE_OK;
+
+}
+
+GstFlowReturn SongAnalysisPipeline::NewFingerprintBufferCallback(GstAppSink *app_sink, gpointer self) {
+
+  SongAnalysisPipeline *me = reinterpret_cast<SongAnalysisPipeline*>(self);
+
+  GstSample *sample = gst_app_sink_pull_sample(app_sink);
+  if (!sample) return GST_FLOW_ERROR;
+  GstBuffer *buffer = gst_sample_get_buffer(sample);
+  if (buffer) {
+    GstMapInfo map;
+    if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+      const qint64 size = qMin(static_cast<qint64>(map.size), me->fingerprint_max_bytes_ - me->fingerprint_pcm_.size());
+      if (size > 0) {
+        me->fingerprint_pcm_.append(reinterpret_cast<const char*>(map.data), static_cast<int>(size));
+      }
+      gst_buffer_unmap(buffer, &map);
+    }
+  }
+  gst_sample_unref(sample);
+
+  return GST_FLOW_OK;
+
+}
+
+GstFlowReturn SongAnalysisPipeline::NewEBUR128BufferCallback(GstAppSink *app_sink, gpointer self) {
+
+#ifdef HAVE_EBUR128
+  SongAnalysisPipeline *me = reinterpret_cast<SongAnalysisPipeline*>(self);
+
+  GstSample *sample = gst_app_sink_pull_sample(app_sink);
+  if (!sample) return GST_FLOW_ERROR;
+  // Keep the other analyses running if this one fails, Finish() reports the failure.
+  me->ebur128_->AddSample(sample);
+  gst_sample_unref(sample);
+
+  return GST_FLOW_OK;
+#else
+  Q_UNUSED(app_sink);
+  Q_UNUSED(self);
+  return GST_FLOW_ERROR;
+#endif
+
+}
@@ -0,0 +1,112 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SONGANALYSISPIPELINE_H
+#define SONGANALYSISPIPELINE_H
+
+#include "config.h"
+
+#include <optional>
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+
+#include <QtGlobal>
+#include <QFlags>
+#include <QByteArray>
+#include <QString>
+
+#include "core/scoped_ptr.h"
+#include "core/song.h"
+#include "ebur128measures.h"
+
+class EBUR128Accumulator;
+class MoodbarBuilder;
+
+// Decodes a song once and tees the PCM data to every requested analysis,
+// instead of having the moodbar, EBU R 128 and fingerprint code decode the file each on their own.
+// Create one instance for each song.
+class SongAnalysisPipeline {
+ public:
+  explicit SongAnalysisPipeline(const Song &song);
+  ~SongAnalysisPipeline();
+
+  enum class Analysis {
+    None = 0x0,
+    Fingerprint = 0x1,
+    EBUR128 = 0x2,
+    Moodbar = 0x4
+  };
+  Q_DECLARE_FLAGS(Analyses, Analysis)
+
+  // The analyses compiled in.
+  static Analyses SupportedAnalyses();
+
+  // The analyses that can be done on this song.
+  // Fingerprints and moodbars are per file, so they are not available for CUE sheet sections.
+  Analyses AvailableAnalyses() const;
+
+  // Runs the requested analyses.
+  // This method is blocking, so you want to call it in another thread.
+  // Returns the analyses that succeeded.
+  Analyses Run(const Analyses analyses);
+
+  const QString &fingerprint() const { return fingerprint_; }
+  const std::optional<EBUR128Measures> &ebur128_measures() const { return ebur128_measures_; }
+  const QByteArray &moodbar_data() const { return moodbar_data_; }
+
+ private:
+  static GstElement *CreateElement(const QString &factory_name, GstElement *bin);
+  GstElement *CreateQueue();
+
+  static void NewPadCallback(GstElement *element, GstPad *pad, gpointer self);
+  static GstPadProbeReturn FingerprintProbeCallback(GstPad *pad, GstPadProbeInfo *info, gpointer self);
+  static GstFlowReturn NewFingerprintBufferCallback(GstAppSink *app_sink, gpointer self);
+  static GstFlowReturn NewEBUR128BufferCallback(GstAppSink *app_sink, gpointer self);
+
+ private:
+  static const int kTimeoutSecs;
+  static const qint64 kQueueNanosec;
+
+  const Song song_;
+
+  GstElement *pipeline_;
+  GstElement *tee_;
+
+  qint64 fingerprint_first_pts_;
+  qint64 fingerprint_max_bytes_;
+  QByteArray fingerprint_pcm_;
+#ifdef HAVE_EBUR128
+  ScopedPtr<EBUR128Accumulator> ebur128_;
+#endif
+#ifdef HAVE_MOODBAR
+  ScopedPtr<MoodbarBuilder> moodbar_;
+#endif
+
+  QString fingerprint_;
+  std::optional<EBUR128Measures> ebur128_measures_;
+  QByteArray moodbar_data_;
+
+  Q_DISABLE_COPY(SongAnalysisPipeline)
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(SongAnalysisPipeline::Analyses)
+
+#endif  // SONGANALYSISPIPELINE_H
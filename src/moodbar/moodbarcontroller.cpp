@@ -25,12 +25,16 @@
 #include "core/settings.h"
 #include "engine/enginebase.h"
 #include "settings/moodbarsettingspage.h"
+#include "playlist/playlist.h"
 #include "playlist/playlistmanager.h"
 
 #include "moodbarcontroller.h"
 #include "moodbarloader.h"
 #include "moodbarpipeline.h"
 
+// Number of upcoming tracks to generate moodbar data for in the background.
+const int MoodbarController::kPrefetchCount = 3;
+
 MoodbarController::MoodbarController(Application *app, QObject *parent)
     : QObject(parent),
       app_(app),
@@ -58,7 +62,7 @@ void MoodbarController::CurrentSongChanged(const Song &song) {
 
   QByteArray data;
   MoodbarPipeline *pipeline = nullptr;
-  const MoodbarLoader::Result result = app_->moodbar_loader()->Load(song.url(), song.has_cue(), &data, &pipeline);
+  const MoodbarLoader::Result result = app_->moodbar_loader()->Load(song.url(), song.has_cue(), &data, &pipeline, MoodbarLoader::Priority::Current);
 
   switch (result) {
     case MoodbarLoader::Result::CannotLoad:
@@ -78,6 +82,22 @@ void MoodbarController::CurrentSongChanged(const Song &song) {
       break;
   }
 
+  PrefetchUpcoming();
+
+}
+
+void MoodbarController::PrefetchUpcoming() {
+
+  Playlist *playlist = app_->playlist_manager()->active();
+  if (!playlist) return;
+
+  const QList<int> rows = playlist->upcoming_rows(kPrefetchCount);
+  for (const int row : rows) {
+    if (!playlist->has_item_at(row)) continue;
+    const Song song = playlist->item_at(row)->Metadata();
+    app_->moodbar_loader()->Prefetch(song.url(), song.has_cue());
+  }
+
 }
 
 void MoodbarController::PlaybackStopped() {
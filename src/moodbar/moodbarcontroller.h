@@ -44,6 +44,11 @@ class MoodbarController : public QObject {
   void AsyncLoadComplete(MoodbarPipeline *pipeline, const QUrl &url);
 
  private:
+  void PrefetchUpcoming();
+
+ private:
+  static const int kPrefetchCount;
+
   Application *app_;
   bool enabled_;
 };
@@ -19,6 +19,8 @@
 
 #include <memory>
 #include <chrono>
+#include <iterator>
+#include <utility>
 
 #include <QtGlobal>
 #include <QObject>
@@ -27,40 +29,109 @@
 #include <QStandardPaths>
 #include <QIODevice>
 #include <QDir>
+#include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
-#include <QAbstractNetworkCache>
-#include <QNetworkDiskCache>
 #include <QTimer>
 #include <QByteArray>
 #include <QString>
 #include <QUrl>
 #include <QSettings>
+#include <QNetworkDiskCache>
+#include <QNetworkCacheMetaData>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <QFutureWatcher>
 
 #include "core/logging.h"
 #include "core/scoped_ptr.h"
 #include "core/application.h"
 #include "core/settings.h"
+#include "core/taskmanager.h"
+#include "core/song.h"
+#include "collection/collectionbackend.h"
 
 #include "moodbarpipeline.h"
+#include "moodbarstore.h"
 
 #include "settings/moodbarsettingspage.h"
 
 using namespace std::chrono_literals;
 
+namespace {
+
+constexpr int kBatchReportInterval = 100;
+
+// Moodbars used to be cached in a directory with one file each, keyed by the percent encoded filename.
+void ImportDiskCache(MoodbarStore *store, const QString &cache_path) {
+
+  QDir cache_dir(cache_path);
+  if (!cache_dir.exists()) return;
+
+  QNetworkDiskCache cache;
+  cache.setCacheDirectory(cache_path);
+
+  int imported = 0;
+  QDirIterator it(cache_path, QStringList() << QStringLiteral("*.d"), QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QNetworkCacheMetaData metadata = cache.fileMetaData(it.next());
+    if (!metadata.isValid()) continue;
+    const QString filename = QUrl::fromPercentEncoding(metadata.url().toEncoded());
+    const quint64 key = MoodbarStore::KeyForUrl(QUrl::fromLocalFile(filename));
+    if (store->Contains(key)) continue;
+    ScopedPtr<QIODevice> device(cache.data(metadata.url()));
+    if (!device) continue;
+    if (store->Put(key, device->readAll())) ++imported;
+  }
+
+  qLog(Info) << "Imported" << imported << "moodbars from" << cache_path;
+
+  store->MaybeCompact();
+
+  if (!cache_dir.removeRecursively()) {
+    qLog(Error) << "Could not remove" << cache_path;
+  }
+
+}
+
+}  // namespace
+
 #ifdef Q_OS_WIN32
 #  include <windows.h>
 #endif
 
 MoodbarLoader::MoodbarLoader(Application *app, QObject *parent)
     : QObject(parent),
-      cache_(new QNetworkDiskCache(this)),
-      thread_(new QThread(this)),
+      app_(app),
+      store_(new MoodbarStore(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/moodbar.store"))),
       kMaxActiveRequests(qMax(1, QThread::idealThreadCount() / 2)),
+      batch_task_id_(-1),
+      batch_total_(0),
+      batch_done_(0),
+      batch_generated_(0),
+      store_open_(false),
       save_(false) {
 
-  cache_->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/moodbar"));
-  cache_->setMaximumCacheSize(60LL * 1024LL * 1024LL);  // 60MB - enough for 20,000 moodbars
+  // Opening the store reads the whole index, so it's done in the background.
+  // Requests are queued until it's open, the store may already have their moodbars.
+  MoodbarStore *store = &*store_;
+  const QString old_cache_path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/moodbar");
+  store_future_ = QtConcurrent::run([store, old_cache_path]() {
+    store->Open();
+    ImportDiskCache(store, old_cache_path);
+  });
+  QFutureWatcher<void> *watcher = new QFutureWatcher<void>();
+  QObject::connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher]() {
+    StoreOpened();
+    watcher->deleteLater();
+  });
+  watcher->setFuture(store_future_);
+
+  for (int i = 0; i < kMaxActiveRequests; ++i) {
+    QThread *worker = new QThread(this);
+    worker->setObjectName(QStringLiteral("MoodbarWorker%1").arg(i));
+    workers_ << worker;
+  }
 
   QObject::connect(app, &Application::SettingsChanged, this, &MoodbarLoader::ReloadSettings);
   ReloadSettings();
@@ -68,8 +139,16 @@ MoodbarLoader::MoodbarLoader(Application *app, QObject *parent)
 }
 
 MoodbarLoader::~MoodbarLoader() {
-  thread_->quit();
-  thread_->wait(1000);
+
+  store_future_.waitForFinished();
+
+  for (QThread *worker : std::as_const(workers_)) {
+    worker->quit();
+  }
+  for (QThread *worker : std::as_const(workers_)) {
+    worker->wait(1000);
+  }
+
 }
 
 void MoodbarLoader::ReloadSettings() {
@@ -93,13 +172,7 @@ QStringList MoodbarLoader::MoodFilenames(const QString &song_filename) {
 
 }
 
-QUrl MoodbarLoader::CacheUrlEntry(const QString &filename) {
-
-  return QUrl(QString::fromLatin1(QUrl::toPercentEncoding(filename)));
-
-}
-
-MoodbarLoader::Result MoodbarLoader::Load(const QUrl &url, const bool has_cue, QByteArray *data, MoodbarPipeline **async_pipeline) {
+MoodbarLoader::Result MoodbarLoader::Load(const QUrl &url, const bool has_cue, QByteArray *data, MoodbarPipeline **async_pipeline, const Priority priority) {
 
   if (!url.isLocalFile() || has_cue) {
     return Result::CannotLoad;
@@ -107,6 +180,13 @@ MoodbarLoader::Result MoodbarLoader::Load(const QUrl &url, const bool has_cue, Q
 
   // Are we in the middle of loading this moodbar already?
   if (requests_.contains(url)) {
+    // Move it up in the queue if it's more urgent now.
+    if (queued_priorities_.contains(url) && queued_priorities_[url] < priority) {
+      const Priority old_priority = queued_priorities_[url];
+      queued_requests_[old_priority].removeOne(url);
+      if (queued_requests_[old_priority].isEmpty()) queued_requests_.remove(old_priority);
+      Enqueue(url, priority);
+    }
     *async_pipeline = requests_[url];
     return Result::WillLoadAsync;
   }
@@ -130,29 +210,21 @@ MoodbarLoader::Result MoodbarLoader::Load(const QUrl &url, const bool has_cue, Q
     }
   }
 
-  // Maybe it exists in the cache?
-
-  QNetworkCacheMetaData disk_cache_metadata = cache_->metaData(CacheUrlEntry(filename));
-  if (disk_cache_metadata.isValid()) {
-    ScopedPtr<QIODevice> device_cache_file(cache_->data(disk_cache_metadata.url()));
-    if (device_cache_file) {
-      qLog(Info) << "Loading cached moodbar data for" << filename;
-      *data = device_cache_file->readAll();
-      if (!data->isEmpty()) {
-        return Result::Loaded;
-      }
+  // Maybe it exists in the store?
+  if (store_open_) {
+    *data = store_->Get(MoodbarStore::KeyForUrl(url));
+    if (!data->isEmpty()) {
+      qLog(Info) << "Loading stored moodbar data for" << filename;
+      return Result::Loaded;
     }
   }
 
-  if (!thread_->isRunning()) thread_->start(QThread::IdlePriority);
-
   // There was no existing file, analyze the audio file and create one.
   MoodbarPipeline *pipeline = new MoodbarPipeline(url);
-  pipeline->moveToThread(thread_);
   QObject::connect(pipeline, &MoodbarPipeline::Finished, this, [this, pipeline, url]() { RequestFinished(pipeline, url); });
 
   requests_[url] = pipeline;
-  queued_requests_ << url;
+  Enqueue(url, priority);
 
   MaybeTakeNextRequest();
 
@@ -161,19 +233,79 @@ MoodbarLoader::Result MoodbarLoader::Load(const QUrl &url, const bool has_cue, Q
 
 }
 
+void MoodbarLoader::Prefetch(const QUrl &url, const bool has_cue, const Priority priority) {
+
+  QByteArray data;
+  MoodbarPipeline *pipeline = nullptr;
+  Load(url, has_cue, &data, &pipeline, priority);
+
+}
+
+void MoodbarLoader::Enqueue(const QUrl &url, const Priority priority) {
+
+  // Rows painted last are the ones most likely still on screen.
+  if (priority == Priority::Visible) {
+    queued_requests_[priority].prepend(url);
+  }
+  else {
+    queued_requests_[priority].append(url);
+  }
+  queued_priorities_[url] = priority;
+
+}
+
+QThread *MoodbarLoader::IdleWorker() const {
+
+  const QList<QThread*> busy_workers = active_requests_.values();
+  for (QThread *worker : workers_) {
+    if (!busy_workers.contains(worker)) return worker;
+  }
+
+  return nullptr;
+
+}
+
 void MoodbarLoader::MaybeTakeNextRequest() {
 
   Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-  if (active_requests_.count() >= kMaxActiveRequests || queued_requests_.isEmpty()) {
-    return;
-  }
+  if (!store_open_) return;
+
+  while (active_requests_.count() < kMaxActiveRequests) {
+
+    // Feed the collection batch only when nothing more urgent is waiting.
+    if (queued_requests_.isEmpty() && !batch_urls_.isEmpty()) {
+      const QUrl url = batch_urls_.takeFirst();
+      batch_requests_ << url;
+      QByteArray data;
+      MoodbarPipeline *pipeline = nullptr;
+      if (Load(url, false, &data, &pipeline, Priority::Background) != Result::WillLoadAsync) {
+        batch_requests_.remove(url);
+        ++batch_done_;
+        UpdateBatchProgress();
+      }
+      continue;
+    }
+
+    if (queued_requests_.isEmpty()) return;
 
-  const QUrl url = queued_requests_.takeFirst();
-  active_requests_ << url;
+    // Highest priority first
+    QMap<Priority, QList<QUrl>>::iterator it = std::prev(queued_requests_.end());
+    const QUrl url = it.value().takeFirst();
+    if (it.value().isEmpty()) queued_requests_.erase(it);
+    queued_priorities_.remove(url);
 
-  qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
-  QMetaObject::invokeMethod(requests_[url], &MoodbarPipeline::Start, Qt::QueuedConnection);
+    QThread *worker = IdleWorker();
+    Q_ASSERT(worker);
+    if (!worker->isRunning()) worker->start(QThread::IdlePriority);
+
+    MoodbarPipeline *pipeline = requests_[url];
+    pipeline->moveToThread(worker);
+    active_requests_[url] = worker;
+
+    qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
+    QMetaObject::invokeMethod(pipeline, &MoodbarPipeline::Start, Qt::QueuedConnection);
+  }
 
 }
 
@@ -181,55 +313,191 @@ void MoodbarLoader::RequestFinished(MoodbarPipeline *request, const QUrl &url) {
 
   Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-  if (request->success()) {
+  // Requests finished with data from the store were never started.
+  if (request->success() && active_requests_.contains(url)) {
+    qLog(Info) << "Moodbar data generated successfully for" << url.toLocalFile();
+    SaveData(url, request->data());
+  }
 
-    const QString filename = url.toLocalFile();
+  // Remove the request from the active list and delete it
+  requests_.remove(url);
+  active_requests_.remove(url);
 
-    qLog(Info) << "Moodbar data generated successfully for" << filename;
+  QTimer::singleShot(1s, request, &MoodbarLoader::deleteLater);
 
-    // Save the data in the cache
-    QNetworkCacheMetaData disk_cache_metadata;
-    disk_cache_metadata.setSaveToDisk(true);
-    disk_cache_metadata.setUrl(CacheUrlEntry(filename));
-    // Qt 6 now ignores any entry without headers, so add a fake header.
-    disk_cache_metadata.setRawHeaders(QNetworkCacheMetaData::RawHeaderList() << qMakePair(QByteArray("moodbar"), QByteArray("moodbar")));
+  if (batch_requests_.remove(url)) {
+    if (request->success()) ++batch_generated_;
+    ++batch_done_;
+    UpdateBatchProgress();
+  }
 
-    QIODevice *device_cache_file = cache_->prepare(disk_cache_metadata);
-    if (device_cache_file) {
-      const qint64 data_written = device_cache_file->write(request->data());
-      if (data_written > 0) {
-        cache_->insert(device_cache_file);
-      }
-    }
+  MaybeTakeNextRequest();
+
+}
+
+void MoodbarLoader::StoreOpened() {
+
+  Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-    // Save the data alongside the original as well if we're configured to.
-    if (save_) {
-      QStringList mood_filenames = MoodFilenames(url.toLocalFile());
-      const QString mood_filename(mood_filenames[0]);
-      QFile mood_file(mood_filename);
-      if (mood_file.open(QIODevice::WriteOnly)) {
-        if (mood_file.write(request->data()) <= 0) {
-          qLog(Error) << "Error writing to mood file" << mood_filename << mood_file.errorString();
-        }
-        mood_file.close();
+  // Finish the requests made while the store was opening which it already has moodbars for.
+  const QList<QUrl> urls = queued_priorities_.keys();
+  for (const QUrl &url : urls) {
+    const QByteArray data = store_->Get(MoodbarStore::KeyForUrl(url));
+    if (data.isEmpty()) continue;
+    const Priority priority = queued_priorities_.take(url);
+    queued_requests_[priority].removeOne(url);
+    if (queued_requests_[priority].isEmpty()) queued_requests_.remove(priority);
+    qLog(Info) << "Loading stored moodbar data for" << url.toLocalFile();
+    requests_[url]->Finish(data);
+  }
+
+  store_open_ = true;
+
+  MaybeTakeNextRequest();
+
+}
+
+void MoodbarLoader::MaybeCompactStore() {
+
+  // Compacting rewrites the whole file, keep it off the GUI thread.
+  if (!store_open_ || !store_future_.isFinished() || !store_->NeedsCompaction()) return;
+
+  MoodbarStore *store = &*store_;
+  store_future_ = QtConcurrent::run([store]() { store->MaybeCompact(); });
+
+}
+
+bool MoodbarLoader::HasData(const QUrl &url) {
+
+  if (!url.isLocalFile()) return false;
+
+  const QString filename(url.toLocalFile());
+
+  const QStringList possible_mood_files = MoodFilenames(filename);
+  for (const QString &possible_mood_file : possible_mood_files) {
+    if (QFile::exists(possible_mood_file)) return true;
+  }
+
+  return store_->Contains(MoodbarStore::KeyForUrl(url));
+
+}
+
+void MoodbarLoader::SaveData(const QUrl &url, const QByteArray &data) {
+
+  Q_ASSERT(QThread::currentThread() == qApp->thread());
+
+  const QString filename = url.toLocalFile();
+
+  store_->Put(MoodbarStore::KeyForUrl(url), data);
+  MaybeCompactStore();
+
+  // Save the data alongside the original as well if we're configured to.
+  if (save_) {
+    QStringList mood_filenames = MoodFilenames(filename);
+    const QString mood_filename(mood_filenames[0]);
+    QFile mood_file(mood_filename);
+    if (mood_file.open(QIODevice::WriteOnly)) {
+      if (mood_file.write(data) <= 0) {
+        qLog(Error) << "Error writing to mood file" << mood_filename << mood_file.errorString();
+      }
+      mood_file.close();
 #ifdef Q_OS_WIN32
-        if (!SetFileAttributes(reinterpret_cast<LPCTSTR>(mood_filename.utf16()), FILE_ATTRIBUTE_HIDDEN)) {
-          qLog(Warning) << "Error setting hidden attribute for file" << mood_filename;
-        }
-#endif
+      if (!SetFileAttributes(reinterpret_cast<LPCTSTR>(mood_filename.utf16()), FILE_ATTRIBUTE_HIDDEN)) {
+        qLog(Warning) << "Error setting hidden attribute for file" << mood_filename;
       }
-      else {
-        qLog(Error) << "Error opening mood file" << mood_filename << "for writing:" << mood_file.errorString();
+#endif
+    }
+    else {
+      qLog(Error) << "Error opening mood file" << mood_filename << "for writing:" << mood_file.errorString();
+    }
+  }
+
+}
+
+void MoodbarLoader::GenerateAllAsync() {
+
+  if (batch_task_id_ != -1) return;
+
+  batch_task_id_ = app_->task_manager()->StartTask(tr("Generating moodbars"));
+
+  SharedPtr<CollectionBackend> collection_backend = app_->collection_backend();
+  QFuture<QList<QUrl>> future = QtConcurrent::run([this, collection_backend]() {
+    QList<QUrl> urls;
+    const SongList songs = collection_backend->GetAllSongs();
+    for (const Song &song : songs) {
+      if (song.url().isLocalFile() && !song.has_cue() && !song.unavailable() && !HasData(song.url())) {
+        urls << song.url();
       }
     }
+    return urls;
+  });
+  QFutureWatcher<QList<QUrl>> *watcher = new QFutureWatcher<QList<QUrl>>();
+  QObject::connect(watcher, &QFutureWatcher<QList<QUrl>>::finished, this, [this, watcher]() {
+    GenerateAll(watcher->result());
+    watcher->deleteLater();
+  });
+  watcher->setFuture(future);
+
+}
+
+void MoodbarLoader::GenerateAll(const QList<QUrl> &urls) {
+
+  QSet<QUrl> urls_added;
+  for (const QUrl &url : urls) {
+    if (!requests_.contains(url) && !urls_added.contains(url)) {
+      urls_added << url;
+      batch_urls_ << url;
+    }
   }
 
-  // Remove the request from the active list and delete it
-  requests_.remove(url);
-  active_requests_.remove(url);
+  batch_total_ = static_cast<int>(batch_urls_.count());
+  batch_done_ = 0;
+  batch_generated_ = 0;
+  batch_timer_.start();
 
-  QTimer::singleShot(1s, request, &MoodbarLoader::deleteLater);
+  qLog(Info) << "Generating moodbar data for" << batch_total_ << "songs using" << kMaxActiveRequests << "workers";
+
+  if (batch_urls_.isEmpty()) {
+    app_->task_manager()->SetTaskFinished(batch_task_id_);
+    batch_task_id_ = -1;
+    return;
+  }
+
+  UpdateBatchProgress();
 
   MaybeTakeNextRequest();
 
 }
+
+void MoodbarLoader::AbortGenerateAll() {
+
+  if (batch_task_id_ == -1) return;
+
+  // Requests already running are allowed to finish.
+  batch_total_ -= static_cast<int>(batch_urls_.count());
+  batch_urls_.clear();
+  UpdateBatchProgress();
+
+}
+
+void MoodbarLoader::UpdateBatchProgress() {
+
+  if (batch_task_id_ == -1) return;
+
+  app_->task_manager()->SetTaskProgress(batch_task_id_, batch_done_, batch_total_);
+
+  const double minutes = static_cast<double>(qMax(static_cast<qint64>(1), batch_timer_.elapsed())) / 60000.0;
+
+  if (!batch_urls_.isEmpty() || !batch_requests_.isEmpty()) {
+    if (batch_done_ % kBatchReportInterval == 0) {
+      qLog(Info) << "Generated moodbar data for" << batch_done_ << "of" << batch_total_ << "songs," << static_cast<double>(batch_done_) / minutes << "per minute";
+    }
+    return;
+  }
+
+  qLog(Info) << "Generated" << batch_generated_ << "moodbars for" << batch_total_ << "songs in" << batch_timer_.elapsed() / 1000 << "seconds," << static_cast<double>(batch_done_) / minutes << "per minute";
+
+  app_->task_manager()->SetTaskFinished(batch_task_id_);
+  batch_task_id_ = -1;
+
+}
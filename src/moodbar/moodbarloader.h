@@ -18,19 +18,25 @@
 #ifndef MOODBARLOADER_H
 #define MOODBARLOADER_H
 
+#include <QtGlobal>
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QHash>
 #include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QUrl>
+#include <QElapsedTimer>
+#include <QFuture>
+
+#include "core/scoped_ptr.h"
 
 class QThread;
 class QByteArray;
-class QNetworkDiskCache;
 class Application;
 class MoodbarPipeline;
+class MoodbarStore;
 
 class MoodbarLoader : public QObject {
   Q_OBJECT
@@ -52,27 +58,72 @@ class MoodbarLoader : public QObject {
     WillLoadAsync
   };
 
-  Result Load(const QUrl &url, const bool has_cue, QByteArray *data, MoodbarPipeline **async_pipeline);
+  // Queued requests are started highest priority first.
+  enum class Priority {
+    Background,  // Generating moodbars for the whole collection
+    Prefetch,    // Upcoming tracks in the play queue
+    Visible,     // Rows painted in a playlist
+    Current      // The song being played
+  };
+
+  Result Load(const QUrl &url, const bool has_cue, QByteArray *data, MoodbarPipeline **async_pipeline, const Priority priority = Priority::Visible);
+
+  // Starts generating moodbar data in the background if it doesn't exist yet.
+  void Prefetch(const QUrl &url, const bool has_cue, const Priority priority = Priority::Prefetch);
+
+  // Returns true if moodbar data was already created for this file.
+  // Can be called from any thread.
+  bool HasData(const QUrl &url);
+
+  // Stores moodbar data that was created outside of the loader, ie. by the collection analysis.
+  void SaveData(const QUrl &url, const QByteArray &data);
+
+ public slots:
+  // Generates moodbar data for all songs in the collection that don't have any yet.
+  void GenerateAllAsync();
+  void AbortGenerateAll();
 
  private slots:
   void ReloadSettings();
 
   void RequestFinished(MoodbarPipeline *request, const QUrl &url);
   void MaybeTakeNextRequest();
+  void GenerateAll(const QList<QUrl> &urls);
+  void StoreOpened();
+
+ private:
+  void Enqueue(const QUrl &url, const Priority priority);
+  QThread *IdleWorker() const;
+  void UpdateBatchProgress();
+  void MaybeCompactStore();
 
  private:
   static QStringList MoodFilenames(const QString &song_filename);
-  static QUrl CacheUrlEntry(const QString &filename);
 
  private:
-  QNetworkDiskCache *cache_;
-  QThread *thread_;
+  Application *app_;
+  ScopedPtr<MoodbarStore> store_;
+  // Opening and compacting the store run in the background, one at a time.
+  QFuture<void> store_future_;
+  bool store_open_;
 
+  // One worker thread per active request, the pipelines are moved to an idle worker when started.
   const int kMaxActiveRequests;
+  QList<QThread*> workers_;
 
   QMap<QUrl, MoodbarPipeline*> requests_;
-  QList<QUrl> queued_requests_;
-  QSet<QUrl> active_requests_;
+  QMap<Priority, QList<QUrl>> queued_requests_;
+  QHash<QUrl, Priority> queued_priorities_;
+  QMap<QUrl, QThread*> active_requests_;
+
+  // Collection batch, fed into the queue as workers become idle.
+  QList<QUrl> batch_urls_;
+  QSet<QUrl> batch_requests_;
+  int batch_task_id_;
+  int batch_total_;
+  int batch_done_;
+  int batch_generated_;
+  QElapsedTimer batch_timer_;
 
   bool save_;
 };
@@ -224,10 +224,21 @@ void MoodbarPipeline::Stop(const bool success) {
 
 }
 
+void MoodbarPipeline::Finish(const QByteArray &data) {
+
+  Q_ASSERT(!pipeline_);
+
+  success_ = true;
+  data_ = data;
+
+  emit Finished(true);
+
+}
+
 void MoodbarPipeline::Cleanup() {
 
   Q_ASSERT(QThread::currentThread() == thread());
-  Q_ASSERT(QThread::currentThread() != qApp->thread());
+  Q_ASSERT(!pipeline_ || QThread::currentThread() != qApp->thread());
 
   running_ = false;
   if (pipeline_) {
@@ -40,9 +40,15 @@ class MoodbarPipeline : public QObject {
   explicit MoodbarPipeline(const QUrl &url, QObject *parent = nullptr);
   ~MoodbarPipeline() override;
 
+  // Number of spectrum bands the moodbar is built from.
+  static const int kBands;
+
   bool success() const { return success_; }
   const QByteArray &data() const { return data_; }
 
+  // Finishes a pipeline that was never started with data found elsewhere.
+  void Finish(const QByteArray &data);
+
  public slots:
   void Start();
 
@@ -63,8 +69,6 @@ class MoodbarPipeline : public QObject {
   static GstBusSyncReply BusCallbackSync(GstBus*, GstMessage *msg, gpointer data);
 
  private:
-  static const int kBands;
-
   QUrl url_;
   GstElement *pipeline_;
   GstElement *convert_element_;
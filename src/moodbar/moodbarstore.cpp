@@ -0,0 +1,494 @@
+/*
+   Strawberry Music Player
+   Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <cstring>
+#include <algorithm>
+#include <utility>
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QMutex>
+#include <QList>
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDir>
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+#include <QCryptographicHash>
+
+#include "core/logging.h"
+#include "moodbarstore.h"
+
+// File layout:
+//   header: magic (8 bytes), version (4 bytes), reserved (4 bytes)
+//   records: key (8 bytes), flags (4 bytes), size (4 bytes), raw size (4 bytes), checksum (4 bytes), data (size bytes)
+// All numbers are little endian. A later record for the same key replaces the earlier one.
+
+const qint64 MoodbarStore::kDefaultMaxSize = 60LL * 1024LL * 1024LL;  // 60MB - enough for 20,000 moodbars
+const char MoodbarStore::kMagic[] = "SBMOODDB";
+const quint32 MoodbarStore::kVersion = 1;
+const qint64 MoodbarStore::kFileHeaderSize = 16;
+const qint64 MoodbarStore::kRecordHeaderSize = 24;
+const qint64 MoodbarStore::kCompactMinDeadBytes = 1024LL * 1024LL;
+const qint64 MoodbarStore::kMinGrowBytes = 256LL * 1024LL;
+const qint64 MoodbarStore::kMaxGrowBytes = 8LL * 1024LL * 1024LL;
+
+namespace {
+
+constexpr quint32 kFlagCompressed = 0x1;
+constexpr quint32 kFlagRemoved = 0x2;
+
+constexpr int kCompressionLevel = 9;
+
+quint32 Checksum(const char *data, const qint64 size) {
+
+  // FNV-1a
+  quint32 hash = 2166136261U;
+  for (qint64 i = 0; i < size; ++i) {
+    hash ^= static_cast<uchar>(data[i]);
+    hash *= 16777619U;
+  }
+  return hash;
+
+}
+
+}  // namespace
+
+MoodbarStore::MoodbarStore(const QString &filename, const qint64 max_size)
+    : filename_(filename),
+      max_size_(max_size),
+      map_(nullptr),
+      map_size_(0),
+      data_size_(0),
+      dead_bytes_(0),
+      use_counter_(0) {}
+
+MoodbarStore::~MoodbarStore() {
+
+  Close();
+
+}
+
+quint64 MoodbarStore::KeyForUrl(const QUrl &url) {
+
+  const QByteArray hash = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1);
+  return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(hash.constData()));
+
+}
+
+bool MoodbarStore::Open() {
+
+  QMutexLocker l(&mutex_);
+  if (!OpenLocked()) return false;
+  MaybeCompactLocked();
+  return true;
+
+}
+
+void MoodbarStore::Close() {
+
+  QMutexLocker l(&mutex_);
+  CloseLocked();
+
+}
+
+bool MoodbarStore::OpenLocked() {
+
+  CloseLocked();
+
+  const QFileInfo fileinfo(filename_);
+  if (!fileinfo.dir().exists() && !QDir().mkpath(fileinfo.dir().path())) {
+    qLog(Error) << "Could not create directory for" << filename_;
+    return false;
+  }
+
+  file_.setFileName(filename_);
+  if (!file_.open(QIODevice::ReadWrite)) {
+    qLog(Error) << "Could not open moodbar store" << filename_ << file_.errorString();
+    return false;
+  }
+
+  bool valid_header = false;
+  if (file_.size() >= kFileHeaderSize) {
+    const QByteArray header = file_.read(kFileHeaderSize);
+    valid_header = header.size() == kFileHeaderSize && memcmp(header.constData(), kMagic, 8) == 0 && qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(header.constData()) + 8) == kVersion;
+  }
+
+  if (!valid_header) {
+    if (file_.size() > 0) {
+      qLog(Warning) << "Discarding invalid moodbar store" << filename_;
+    }
+    QByteArray header(static_cast<int>(kFileHeaderSize), 0);
+    memcpy(header.data(), kMagic, 8);
+    qToLittleEndian<quint32>(kVersion, reinterpret_cast<uchar*>(header.data()) + 8);
+    if (!file_.resize(0) || !file_.seek(0) || file_.write(header) != kFileHeaderSize || !file_.flush()) {
+      qLog(Error) << "Could not initialize moodbar store" << filename_ << file_.errorString();
+      file_.close();
+      return false;
+    }
+  }
+
+  if (!MapLocked()) {
+    file_.close();
+    return false;
+  }
+
+  // Build the index from the record headers.
+  qint64 offset = kFileHeaderSize;
+  while (offset + kRecordHeaderSize <= map_size_) {
+    const uchar *header = map_ + offset;
+    const quint64 key = qFromLittleEndian<quint64>(header);
+    const quint32 flags = qFromLittleEndian<quint32>(header + 8);
+    const quint32 size = qFromLittleEndian<quint32>(header + 12);
+    const quint32 raw_size = qFromLittleEndian<quint32>(header + 16);
+    const quint32 checksum = qFromLittleEndian<quint32>(header + 20);
+    const qint64 data_offset = offset + kRecordHeaderSize;
+    if (data_offset + size > map_size_ || Checksum(reinterpret_cast<const char*>(map_ + data_offset), size) != checksum) {
+      break;
+    }
+
+    if (index_.contains(key)) {
+      dead_bytes_ += kRecordHeaderSize + index_[key].size;
+    }
+    if (flags & kFlagRemoved) {
+      index_.remove(key);
+      dead_bytes_ += kRecordHeaderSize;
+    }
+    else {
+      Entry entry;
+      entry.offset = data_offset;
+      entry.size = size;
+      entry.raw_size = raw_size;
+      entry.compressed = flags & kFlagCompressed;
+      // Compaction writes the records least recently used first.
+      entry.last_used = ++use_counter_;
+      index_.insert(key, entry);
+    }
+
+    offset = data_offset + size;
+  }
+
+  data_size_ = offset;
+
+  // Drop a partially written record left behind by a crash, space the file was grown by ahead of the records is all zero.
+  if (offset < map_size_ && std::any_of(map_ + offset, map_ + map_size_, [](const uchar c) { return c != 0; })) {
+    qLog(Warning) << "Truncating moodbar store" << filename_ << "from" << map_size_ << "to" << offset << "bytes";
+    file_.unmap(map_);
+    map_ = nullptr;
+    if (!file_.resize(offset) || !MapLocked()) {
+      CloseLocked();
+      return false;
+    }
+  }
+
+  qLog(Debug) << "Opened moodbar store" << filename_ << "with" << index_.count() << "moodbars";
+
+  return true;
+
+}
+
+void MoodbarStore::CloseLocked() {
+
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+  // Give back the space the file was grown by ahead of the records.
+  if (file_.isOpen() && data_size_ >= kFileHeaderSize && data_size_ < map_size_) {
+    file_.resize(data_size_);
+  }
+  map_size_ = 0;
+  data_size_ = 0;
+  if (file_.isOpen()) file_.close();
+  index_.clear();
+  dead_bytes_ = 0;
+
+}
+
+bool MoodbarStore::MapLocked() {
+
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+
+  map_size_ = file_.size();
+  map_ = file_.map(0, map_size_);
+  if (!map_) {
+    qLog(Error) << "Could not map moodbar store" << filename_ << file_.errorString();
+    map_size_ = 0;
+    return false;
+  }
+
+  return true;
+
+}
+
+bool MoodbarStore::GrowLocked(const qint64 min_size) {
+
+  // Grow geometrically so appending doesn't remap the file for every record.
+  const qint64 new_size = qMax(min_size, map_size_ + qBound(kMinGrowBytes, map_size_, kMaxGrowBytes));
+
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+
+  if (!file_.resize(new_size)) {
+    qLog(Error) << "Could not grow moodbar store" << filename_ << file_.errorString();
+    return false;
+  }
+
+  return MapLocked();
+
+}
+
+bool MoodbarStore::Contains(const quint64 key) {
+
+  QMutexLocker l(&mutex_);
+  return index_.contains(key);
+
+}
+
+QByteArray MoodbarStore::Get(const quint64 key) {
+
+  QMutexLocker l(&mutex_);
+
+  if (!map_ || !index_.contains(key)) return QByteArray();
+
+  Entry &entry = index_[key];
+  entry.last_used = ++use_counter_;
+  const char *data = reinterpret_cast<const char*>(map_ + entry.offset);
+  if (entry.compressed) {
+    return qUncompress(reinterpret_cast<const uchar*>(data), static_cast<int>(entry.size));
+  }
+
+  // The mapping changes when the file grows or is compacted, so the caller gets its own copy.
+  return QByteArray(data, static_cast<int>(entry.size));
+
+}
+
+bool MoodbarStore::Put(const quint64 key, const QByteArray &data) {
+
+  if (data.isEmpty()) return false;
+
+  // Only keep the compressed data if it saves at least a quarter.
+  const QByteArray compressed = qCompress(data, kCompressionLevel);
+  const bool use_compressed = compressed.size() < data.size() - data.size() / 4;
+
+  QMutexLocker l(&mutex_);
+
+  if (!map_) return false;
+
+  const qint64 replaced_bytes = index_.contains(key) ? kRecordHeaderSize + index_[key].size : 0;
+  if (!AppendLocked(key, use_compressed ? kFlagCompressed : 0, use_compressed ? compressed : data, static_cast<quint32>(data.size()))) {
+    return false;
+  }
+  dead_bytes_ += replaced_bytes;
+
+  return true;
+
+}
+
+bool MoodbarStore::Remove(const quint64 key) {
+
+  QMutexLocker l(&mutex_);
+
+  if (!map_ || !index_.contains(key)) return false;
+
+  const qint64 removed_bytes = kRecordHeaderSize + index_[key].size;
+  if (!AppendLocked(key, kFlagRemoved, QByteArray(), 0)) {
+    return false;
+  }
+  index_.remove(key);
+  dead_bytes_ += removed_bytes + kRecordHeaderSize;
+
+  return true;
+
+}
+
+bool MoodbarStore::AppendLocked(const quint64 key, const quint32 flags, const QByteArray &data, const quint32 raw_size) {
+
+  uchar header[kRecordHeaderSize];
+  qToLittleEndian<quint64>(key, header);
+  qToLittleEndian<quint32>(flags, header + 8);
+  qToLittleEndian<quint32>(static_cast<quint32>(data.size()), header + 12);
+  qToLittleEndian<quint32>(raw_size, header + 16);
+  qToLittleEndian<quint32>(Checksum(data.constData(), data.size()), header + 20);
+
+  const qint64 offset = data_size_;
+  const qint64 record_size = kRecordHeaderSize + data.size();
+  if (offset + record_size > map_size_ && !GrowLocked(offset + record_size)) {
+    CloseLocked();
+    return false;
+  }
+
+  if (!file_.seek(offset) || file_.write(reinterpret_cast<const char*>(header), kRecordHeaderSize) != kRecordHeaderSize || file_.write(data) != data.size() || !file_.flush()) {
+    qLog(Error) << "Could not write to moodbar store" << filename_ << file_.errorString();
+    // A partial record fails the checksum, it's overwritten by the next append or truncated on the next open.
+    return false;
+  }
+
+  data_size_ = offset + record_size;
+
+  if (!(flags & kFlagRemoved)) {
+    Entry entry;
+    entry.offset = offset + kRecordHeaderSize;
+    entry.size = static_cast<quint32>(data.size());
+    entry.raw_size = raw_size;
+    entry.compressed = flags & kFlagCompressed;
+    entry.last_used = ++use_counter_;
+    index_.insert(key, entry);
+  }
+
+  return true;
+
+}
+
+void MoodbarStore::EvictLocked() {
+
+  // Evict down to three quarters of the maximum size, so the next few moodbars don't trigger another compaction.
+  const qint64 target_size = max_size_ - max_size_ / 4;
+
+  QList<quint64> keys = index_.keys();
+  std::sort(keys.begin(), keys.end(), [this](const quint64 a, const quint64 b) { return index_[a].last_used < index_[b].last_used; });
+
+  int evicted = 0;
+  for (const quint64 key : std::as_const(keys)) {
+    if (data_size_ - dead_bytes_ <= target_size) break;
+    dead_bytes_ += kRecordHeaderSize + index_[key].size;
+    index_.remove(key);
+    ++evicted;
+  }
+
+  qLog(Debug) << "Evicted" << evicted << "moodbars from" << filename_;
+
+}
+
+bool MoodbarStore::NeedsCompaction() {
+
+  QMutexLocker l(&mutex_);
+  return NeedsCompactionLocked();
+
+}
+
+bool MoodbarStore::NeedsCompactionLocked() const {
+
+  return map_ && ((max_size_ > 0 && data_size_ - dead_bytes_ > max_size_) || (dead_bytes_ >= kCompactMinDeadBytes && dead_bytes_ > data_size_ / 2));
+
+}
+
+void MoodbarStore::MaybeCompact() {
+
+  QMutexLocker l(&mutex_);
+  MaybeCompactLocked();
+
+}
+
+void MoodbarStore::MaybeCompactLocked() {
+
+  if (max_size_ > 0 && data_size_ - dead_bytes_ > max_size_) {
+    // Evicted records are only gone from the index, compacting drops them from the file.
+    EvictLocked();
+    CompactLocked();
+  }
+  else if (dead_bytes_ >= kCompactMinDeadBytes && dead_bytes_ > data_size_ / 2) {
+    CompactLocked();
+  }
+
+}
+
+bool MoodbarStore::Compact() {
+
+  QMutexLocker l(&mutex_);
+  return CompactLocked();
+
+}
+
+bool MoodbarStore::CompactLocked() {
+
+  if (!map_) return false;
+
+  // The new file is written next to the old one and renamed over it, so the store is never left without a valid file.
+  QSaveFile compact_file(filename_);
+  if (!compact_file.open(QIODevice::WriteOnly)) {
+    qLog(Error) << "Could not open" << filename_ << "for compaction" << compact_file.errorString();
+    return false;
+  }
+
+  // Write the least recently used records first, the order is kept when the file is opened again.
+  QList<quint64> keys = index_.keys();
+  std::sort(keys.begin(), keys.end(), [this](const quint64 a, const quint64 b) { return index_[a].last_used < index_[b].last_used; });
+
+  bool success = compact_file.write(reinterpret_cast<const char*>(map_), kFileHeaderSize) == kFileHeaderSize;
+  for (const quint64 key : std::as_const(keys)) {
+    if (!success) break;
+    const Entry &entry = index_[key];
+    const qint64 record_size = kRecordHeaderSize + entry.size;
+    success = compact_file.write(reinterpret_cast<const char*>(map_ + entry.offset - kRecordHeaderSize), record_size) == record_size;
+  }
+
+  if (!success) {
+    qLog(Error) << "Could not write compacted moodbar store" << filename_ << compact_file.errorString();
+    compact_file.cancelWriting();
+    return false;
+  }
+
+  const qint64 old_size = data_size_;
+
+  // The old file can't be replaced while it's open and mapped on all platforms.
+  CloseLocked();
+  if (!compact_file.commit()) {
+    qLog(Error) << "Could not replace" << filename_ << "with the compacted moodbar store" << compact_file.errorString();
+    OpenLocked();
+    return false;
+  }
+  if (!OpenLocked()) return false;
+
+  qLog(Debug) << "Compacted moodbar store from" << old_size << "to" << data_size_ << "bytes";
+
+  return true;
+
+}
+
+int MoodbarStore::count() {
+
+  QMutexLocker l(&mutex_);
+  return static_cast<int>(index_.count());
+
+}
+
+qint64 MoodbarStore::file_size() {
+
+  QMutexLocker l(&mutex_);
+  return data_size_;
+
+}
+
+qint64 MoodbarStore::dead_bytes() {
+
+  QMutexLocker l(&mutex_);
+  return dead_bytes_;
+
+}
@@ -0,0 +1,110 @@
+/*
+   Strawberry Music Player
+   Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOODBARSTORE_H
+#define MOODBARSTORE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QHash>
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+class QUrl;
+
+// Stores all moodbars in a single append-only file which is memory mapped for reading.
+// Records are looked up through an in-memory index built when the file is opened,
+// replaced and removed records are dropped when the file is compacted.
+// When the moodbars take up more than max_size bytes, the least recently used are evicted on the next compaction.
+// All methods are thread-safe.
+class MoodbarStore {
+ public:
+  explicit MoodbarStore(const QString &filename, const qint64 max_size = kDefaultMaxSize);
+  ~MoodbarStore();
+
+  bool Open();
+  void Close();
+
+  static quint64 KeyForUrl(const QUrl &url);
+
+  bool Contains(const quint64 key);
+  // Returns an empty array if there is no moodbar for the key.
+  QByteArray Get(const quint64 key);
+  bool Put(const quint64 key, const QByteArray &data);
+  bool Remove(const quint64 key);
+
+  // Rewrites the file with only the current records, least recently used first.
+  bool Compact();
+  // Put() and Remove() never compact, so they stay cheap.
+  // The owner checks NeedsCompaction() after writing and calls MaybeCompact() away from the GUI thread.
+  bool NeedsCompaction();
+  // Evicts the least recently used moodbars if over the maximum size and compacts if enough of the file is dead.
+  void MaybeCompact();
+
+  int count();
+  qint64 file_size();
+  qint64 dead_bytes();
+
+ private:
+  struct Entry {
+    qint64 offset;  // Of the data, after the record header
+    quint32 size;
+    quint32 raw_size;
+    bool compressed;
+    quint64 last_used;
+  };
+
+  bool OpenLocked();
+  void CloseLocked();
+  bool MapLocked();
+  bool GrowLocked(const qint64 min_size);
+  bool AppendLocked(const quint64 key, const quint32 flags, const QByteArray &data, const quint32 raw_size);
+  bool CompactLocked();
+  void EvictLocked();
+  bool NeedsCompactionLocked() const;
+  void MaybeCompactLocked();
+
+ private:
+  static const qint64 kDefaultMaxSize;
+  static const char kMagic[];
+  static const quint32 kVersion;
+  static const qint64 kFileHeaderSize;
+  static const qint64 kRecordHeaderSize;
+  static const qint64 kCompactMinDeadBytes;
+  static const qint64 kMinGrowBytes;
+  static const qint64 kMaxGrowBytes;
+
+  const QString filename_;
+  const qint64 max_size_;
+  QMutex mutex_;
+  QFile file_;
+  uchar *map_;
+  // The file is grown ahead of the records, map_size_ is the mapped size and data_size_ the end of the last record.
+  qint64 map_size_;
+  qint64 data_size_;
+  QHash<quint64, Entry> index_;
+  qint64 dead_bytes_;
+  quint64 use_counter_;
+
+  Q_DISABLE_COPY(MoodbarStore)
+};
+
+#endif  // MOODBARSTORE_H
@@ -616,6 +616,27 @@ int Playlist::next_row(const bool ignore_repeat_track) {
 
 }
 
+QList<int> Playlist::upcoming_rows(const int count) const {
+
+  QList<int> rows;
+
+  for (int i = 0; i < queue_->ItemCount() && rows.count() < count; ++i) {
+    const QModelIndex source_index = queue_->mapToSource(queue_->index(i, 0));
+    if (source_index.isValid()) rows << source_index.row();
+  }
+
+  int virtual_index = current_virtual_index_;
+  while (rows.count() < count) {
+    virtual_index = NextVirtualIndex(virtual_index, true);
+    if (virtual_index < 0 || virtual_index >= virtual_items_.count()) break;
+    const int row = virtual_items_[virtual_index];
+    if (!rows.contains(row)) rows << row;
+  }
+
+  return rows;
+
+}
+
 int Playlist::previous_row(const bool ignore_repeat_track) {
 
   while (!played_indexes_.isEmpty()) {
@@ -185,6 +185,8 @@ class Playlist : public QAbstractListModel {
   void reset_played_indexes() { played_indexes_.clear(); }
   int next_row(const bool ignore_repeat_track = false);
   int previous_row(const bool ignore_repeat_track = false);
+  // Rows that will be played after the current one, queued items first. Does not wrap around or reshuffle.
+  QList<int> upcoming_rows(const int count) const;
 
   QModelIndex current_index() const;
 
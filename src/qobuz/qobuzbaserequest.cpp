@@ -39,6 +39,7 @@
 #include "core/logging.h"
 #include "core/shared_ptr.h"
 #include "core/networkaccessmanager.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "qobuzservice.h"
 #include "qobuzbaserequest.h"
 
@@ -69,7 +70,12 @@ QNetworkReply *QobuzBaseRequest::CreateRequest(const QString &ressource_name, co
   req.setRawHeader("X-App-Id", app_id().toUtf8());
   if (authenticated()) req.setRawHeader("X-User-Auth-Token", user_auth_token().toUtf8());
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+  req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+
   QNetworkReply *reply = network_->get(req);
+  service_->request_scheduler()->RequestStarted(reply);
   QObject::connect(reply, &QNetworkReply::sslErrors, this, &QobuzBaseRequest::HandleSSLErrors);
 
   qLog(Debug) << "Qobuz: Sending request" << url;
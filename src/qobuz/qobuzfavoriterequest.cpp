@@ -32,6 +32,7 @@
 #include "core/shared_ptr.h"
 #include "core/networkaccessmanager.h"
 #include "core/song.h"
+#include "streaming/streamingfavoritessync.h"
 #include "qobuzservice.h"
 #include "qobuzbaserequest.h"
 #include "qobuzfavoriterequest.h"
@@ -261,12 +262,15 @@ void QobuzFavoriteRequest::RemoveFavoritesReply(QNetworkReply *reply, const Favo
 
   switch (type) {
     case FavoriteType::Artists:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Artists, songs);
       emit ArtistsRemoved(songs);
       break;
     case FavoriteType::Albums:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Albums, songs);
       emit AlbumsRemoved(songs);
       break;
     case FavoriteType::Songs:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Songs, songs);
       emit SongsRemoved(songs);
       break;
   }
@@ -33,6 +33,7 @@
 #include <QJsonArray>
 #include <QJsonValue>
 #include <QTimer>
+#include <QDateTime>
 
 #include "core/logging.h"
 #include "core/shared_ptr.h"
@@ -42,18 +43,14 @@
 #include "utilities/timeconstants.h"
 #include "utilities/imageutils.h"
 #include "utilities/coverutils.h"
+#include "streaming/streamingfavoritessync.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "qobuzservice.h"
 #include "qobuzurlhandler.h"
 #include "qobuzbaserequest.h"
 #include "qobuzrequest.h"
 
 namespace {
-constexpr int kMaxConcurrentArtistsRequests = 3;
-constexpr int kMaxConcurrentAlbumsRequests = 3;
-constexpr int kMaxConcurrentSongsRequests = 3;
-constexpr int kMaxConcurrentArtistAlbumsRequests = 3;
-constexpr int kMaxConcurrentAlbumSongsRequests = 3;
-constexpr int kMaxConcurrentAlbumCoverRequests = 1;
 constexpr int kFlushRequestsDelay = 200;
 }  // namespace
 
@@ -95,11 +92,18 @@ QobuzRequest::QobuzRequest(QobuzService *service, QobuzUrlHandler *url_handler,
       album_covers_requests_total_(0),
       album_covers_requests_active_(0),
       album_covers_requests_received_(0),
+      favorites_sync_(query_type == QueryType::Artists ? StreamingFavoritesSync::Type::Artists : query_type == QueryType::Albums ? StreamingFavoritesSync::Type::Albums : StreamingFavoritesSync::Type::Songs),
       no_results_(false) {
 
   timer_flush_requests_->setInterval(kFlushRequestsDelay);
   timer_flush_requests_->setSingleShot(false);
   QObject::connect(timer_flush_requests_, &QTimer::timeout, this, &QobuzRequest::FlushRequests);
+  // Start queued requests as soon as the service can take more, instead of waiting for the timer.
+  QObject::connect(service_->request_scheduler(), &StreamingRequestScheduler::RequestsAvailable, this, &QobuzRequest::FlushRequests);
+
+  if (IsQuery()) {
+    favorites_sync_.Begin(StreamingFavoritesSync::LoadCursor(service_->settings_group(), favorites_sync_.type()));
+  }
 
 }
 
@@ -221,7 +225,7 @@ void QobuzRequest::AddArtistsRequest(const int offset, const int limit) {
 
 void QobuzRequest::FlushArtistsRequests() {
 
-  while (!artists_requests_queue_.isEmpty() && artists_requests_active_ < kMaxConcurrentArtistsRequests) {
+  while (!artists_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = artists_requests_queue_.dequeue();
 
@@ -273,7 +277,7 @@ void QobuzRequest::AddAlbumsRequest(const int offset, const int limit) {
 
 void QobuzRequest::FlushAlbumsRequests() {
 
-  while (!albums_requests_queue_.isEmpty() && albums_requests_active_ < kMaxConcurrentAlbumsRequests) {
+  while (!albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = albums_requests_queue_.dequeue();
 
@@ -325,7 +329,7 @@ void QobuzRequest::AddSongsRequest(const int offset, const int limit) {
 
 void QobuzRequest::FlushSongsRequests() {
 
-  while (!songs_requests_queue_.isEmpty() && songs_requests_active_ < kMaxConcurrentSongsRequests) {
+  while (!songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = songs_requests_queue_.dequeue();
 
@@ -488,6 +492,7 @@ void QobuzRequest::ArtistsReplyReceived(QNetworkReply *reply, const int limit_re
       continue;
     }
     QJsonObject obj_item = value_item.toObject();
+    const QDateTime added = ParseFavoriteAdded(obj_item);
 
     if (obj_item.contains(QLatin1String("item"))) {
       QJsonValue json_item = obj_item[QLatin1String("item")];
@@ -512,6 +517,8 @@ void QobuzRequest::ArtistsReplyReceived(QNetworkReply *reply, const int limit_re
     }
     artist.artist = obj_item[QLatin1String("name")].toString();
 
+    if (query_type_ == QueryType::Artists && !favorites_sync_.FavoriteReceived(artist.artist_id, added)) continue;
+
     if (artist_albums_requests_pending_.contains(artist.artist_id)) continue;
 
     ArtistAlbumsRequest request;
@@ -523,6 +530,21 @@ void QobuzRequest::ArtistsReplyReceived(QNetworkReply *reply, const int limit_re
 
   if (offset_requested != 0) emit UpdateProgress(query_id_, GetProgress(artists_received_, artists_total_));
 
+  if (query_type_ == QueryType::Artists) {
+    switch (favorites_sync_.PageReceived(artists_total_)) {
+      case StreamingFavoritesSync::Paging::Continue:
+        break;
+      case StreamingFavoritesSync::Paging::Restart:
+        artists_received_ = 0;
+        AddArtistsRequest();
+        ArtistsFinishCheck();
+        return;
+      case StreamingFavoritesSync::Paging::Stop:
+        ArtistsFinishCheck();
+        return;
+    }
+  }
+
   ArtistsFinishCheck(limit_requested, offset, artists_received);
 
 }
@@ -583,7 +605,7 @@ void QobuzRequest::AddArtistAlbumsRequest(const Artist &artist, const int offset
 
 void QobuzRequest::FlushArtistAlbumsRequests() {
 
-  while (!artist_albums_requests_queue_.isEmpty() && artist_albums_requests_active_ < kMaxConcurrentArtistAlbumsRequests) {
+  while (!artist_albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     const ArtistAlbumsRequest request = artist_albums_requests_queue_.dequeue();
 
@@ -721,6 +743,8 @@ void QobuzRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_req
     }
     album.album = obj_item[QLatin1String("title")].toString();
 
+    if (query_type_ == QueryType::Albums && !favorites_sync_.FavoriteReceived(album.album_id, ParseFavoriteAdded(obj_item))) continue;
+
     if (album_songs_requests_pending_.contains(album.album_id)) continue;
 
     QJsonValue value_artist = obj_item[QLatin1String("artist")];
@@ -760,6 +784,11 @@ void QobuzRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_req
     emit UpdateProgress(query_id_, GetProgress(albums_received_, albums_total_));
   }
 
+  if (query_type_ == QueryType::Albums && favorites_sync_.PageReceived(albums_total) == StreamingFavoritesSync::Paging::Stop) {
+    AlbumsFinishCheck(artist_requested);
+    return;
+  }
+
   AlbumsFinishCheck(artist_requested, limit_requested, offset, albums_total, albums_received);
 
 }
@@ -841,7 +870,7 @@ void QobuzRequest::AddAlbumSongsRequest(const Artist &artist, const Album &album
 
 void QobuzRequest::FlushAlbumSongsRequests() {
 
-  while (!album_songs_requests_queue_.isEmpty() && album_songs_requests_active_ < kMaxConcurrentAlbumSongsRequests) {
+  while (!album_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     AlbumSongsRequest request = album_songs_requests_queue_.dequeue();
     ParamList params = ParamList() << Param(QStringLiteral("album_id"), request.album.album_id);
@@ -1006,6 +1035,7 @@ void QobuzRequest::SongsReceived(QNetworkReply *reply, const Artist &artist_requ
     ++songs_received;
     Song song(Song::Source::Qobuz);
     ParseSong(song, obj_item, album_artist, album);
+    if (query_type_ == QueryType::Songs && !favorites_sync_.FavoriteReceived(song.song_id(), ParseFavoriteAdded(obj_item))) continue;
     if (!song.is_valid()) continue;
     if (song.disc() >= 2) multidisc = true;
     if (song.is_compilation()) compilation = true;
@@ -1023,6 +1053,11 @@ void QobuzRequest::SongsReceived(QNetworkReply *reply, const Artist &artist_requ
     emit UpdateProgress(query_id_, GetProgress(songs_received_, songs_total_));
   }
 
+  if (query_type_ == QueryType::Songs && favorites_sync_.PageReceived(songs_total) == StreamingFavoritesSync::Paging::Stop) {
+    SongsFinishCheck(album_artist, album);
+    return;
+  }
+
   SongsFinishCheck(album_artist, album, limit_requested, offset_requested, songs_total, songs_received);
 
 }
@@ -1222,6 +1257,15 @@ void QobuzRequest::ParseSong(Song &song, const QJsonObject &json_obj, const Arti
 
 }
 
+// Favorites have the time they were added to the favorites.
+QDateTime QobuzRequest::ParseFavoriteAdded(const QJsonObject &json_obj) {
+
+  if (!json_obj.contains(QLatin1String("favorited_at"))) return QDateTime();
+
+  return QDateTime::fromSecsSinceEpoch(json_obj[QLatin1String("favorited_at")].toVariant().toLongLong());
+
+}
+
 void QobuzRequest::GetAlbumCoversCheck() {
 
   if (
@@ -1288,13 +1332,14 @@ void QobuzRequest::AddAlbumCoverRequest(const Song &song) {
 
 void QobuzRequest::FlushAlbumCoverRequests() {
 
-  while (!album_cover_requests_queue_.isEmpty() && album_covers_requests_active_ < kMaxConcurrentAlbumCoverRequests) {
+  while (!album_cover_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Covers)) {
 
     AlbumCoverRequest request = album_cover_requests_queue_.dequeue();
 
     QNetworkRequest req(request.url);
     req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
     QNetworkReply *reply = network_->get(req);
+    service_->request_scheduler()->RequestStarted(reply, StreamingRequestScheduler::Category::Covers);
     album_cover_replies_ << reply;
     QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, request]() { AlbumCoverReceived(reply, request.url, request.filename); });
 
@@ -1421,12 +1466,21 @@ void QobuzRequest::FinishCheck() {
       timer_flush_requests_->stop();
     }
     finished_ = true;
+    if (IsQuery()) {
+      const StreamingFavoritesSync::Cursor cursor = favorites_sync_.Finish(errors_.isEmpty());
+      if (errors_.isEmpty()) {
+        StreamingFavoritesSync::SaveCursor(service_->settings_group(), favorites_sync_.type(), cursor);
+      }
+    }
     if (no_results_ && songs_.isEmpty()) {
       if (IsSearch())
         emit Results(query_id_, SongMap(), tr("No match."));
       else
         emit Results(query_id_, SongMap(), QString());
     }
+    else if (songs_.isEmpty() && errors_.isEmpty() && favorites_sync_.incremental()) {  // Nothing was added since the last sync.
+      emit Results(query_id_, SongMap(), QString());
+    }
     else {
       if (songs_.isEmpty() && errors_.isEmpty())
         emit Results(query_id_, songs_, tr("Unknown error"));
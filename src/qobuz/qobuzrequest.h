@@ -36,9 +36,11 @@
 #include <QStringList>
 #include <QUrl>
 #include <QJsonObject>
+#include <QDateTime>
 
 #include "core/shared_ptr.h"
 #include "core/song.h"
+#include "streaming/streamingfavoritessync.h"
 #include "qobuzbaserequest.h"
 
 class QNetworkReply;
@@ -61,6 +63,8 @@ class QobuzRequest : public QobuzBaseRequest {
   void Process();
   void Search(const int query_id, const QString &search_text);
 
+  const StreamingFavoritesSync &favorites_sync() const { return favorites_sync_; }
+
  private:
   struct Artist {
     QString artist_id;
@@ -156,6 +160,7 @@ class QobuzRequest : public QobuzBaseRequest {
   void FlushAlbumSongsRequests();
 
   void ParseSong(Song &song, const QJsonObject &json_obj, const Artist &album_artist, const Album &album);
+  static QDateTime ParseFavoriteAdded(const QJsonObject &json_obj);
 
   QString AlbumCoverFileName(const Song &song);
 
@@ -229,6 +234,8 @@ class QobuzRequest : public QobuzBaseRequest {
   int album_covers_requests_active_;
   int album_covers_requests_received_;
 
+  StreamingFavoritesSync favorites_sync_;
+
   SongMap songs_;
   QStringList errors_;
   bool no_results_;
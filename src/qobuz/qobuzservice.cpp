@@ -47,6 +47,7 @@
 #include "core/settings.h"
 #include "utilities/macaddrutils.h"
 #include "streaming/streamingsearchview.h"
+#include "streaming/streamingfavoritessync.h"
 #include "collection/collectionbackend.h"
 #include "collection/collectionmodel.h"
 #include "collection/collectionfilter.h"
@@ -531,7 +532,13 @@ void QobuzService::GetArtists() {
 void QobuzService::ArtistsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit ArtistsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = artists_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit ArtistsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit ArtistsResults(songs, error);
+  }
   ResetArtistsRequest();
 
 }
@@ -581,7 +588,13 @@ void QobuzService::GetAlbums() {
 void QobuzService::AlbumsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit AlbumsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = albums_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit AlbumsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit AlbumsResults(songs, error);
+  }
   ResetAlbumsRequest();
 
 }
@@ -631,7 +644,13 @@ void QobuzService::GetSongs() {
 void QobuzService::SongsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit SongsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = songs_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit SongsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit SongsResults(songs, error);
+  }
   ResetSongsRequest();
 
 }
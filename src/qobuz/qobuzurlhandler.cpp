@@ -19,11 +19,15 @@
 
 #include "config.h"
 
+#include <utility>
+
 #include <QObject>
 #include <QString>
 #include <QUrl>
+#include <QDateTime>
 
 #include "core/application.h"
+#include "core/logging.h"
 #include "core/taskmanager.h"
 #include "core/song.h"
 #include "qobuz/qobuzservice.h"
@@ -41,7 +45,31 @@ QobuzUrlHandler::QobuzUrlHandler(Application *app, QobuzService *service)
 
 UrlHandler::LoadResult QobuzUrlHandler::StartLoading(const QUrl &url) {
 
+  // Use the stream URL resolved ahead of time if it's still valid.
+  const LoadResult cached_result = cache_.Take(url);
+  if (cached_result.type_ == LoadResult::Type::TrackAvailable) {
+    LogCacheStats();
+    return cached_result;
+  }
+
+  // If the stream URL is already being prefetched, wait for that request instead of sending another.
+  for (QMap<uint, Request>::iterator it = requests_.begin(); it != requests_.end(); ++it) {
+    if (!it->prefetch || it->media_url != url) continue;
+    it->prefetch = false;
+    it->task_id = app_->task_manager()->StartTask(QStringLiteral("Loading %1 stream...").arg(url.scheme()));
+    // Counted when the request finishes, only the time spent before the player asked for it is saved.
+    it->attached_msec = QDateTime::currentMSecsSinceEpoch();
+    LoadResult ret(url);
+    ret.type_ = LoadResult::Type::WillLoadAsynchronously;
+    return ret;
+  }
+
+  cache_.RecordMiss();
+  LogCacheStats();
+
   Request req;
+  req.media_url = url;
+  req.started_msec = QDateTime::currentMSecsSinceEpoch();
   req.task_id = app_->task_manager()->StartTask(QStringLiteral("Loading %1 stream...").arg(url.scheme()));
   QString error;
   req.id = service_->GetStreamURL(url, error);
@@ -59,12 +87,42 @@ UrlHandler::LoadResult QobuzUrlHandler::StartLoading(const QUrl &url) {
 
 }
 
+void QobuzUrlHandler::Prefetch(const QUrl &url) {
+
+  // Don't start a login from the background.
+  if (!service_->authenticated() || cache_.Contains(url)) return;
+
+  for (const Request &req : std::as_const(requests_)) {
+    if (req.media_url == url) return;
+  }
+
+  Request req;
+  req.prefetch = true;
+  req.media_url = url;
+  req.started_msec = QDateTime::currentMSecsSinceEpoch();
+  QString error;
+  req.id = service_->GetStreamURL(url, error);
+  if (req.id == 0) return;
+
+  requests_.insert(req.id, req);
+
+}
+
 void QobuzUrlHandler::GetStreamURLFailure(const uint id, const QUrl &media_url, const QString &error) {
 
   if (!requests_.contains(id)) return;
   Request req = requests_.take(id);
+  if (req.prefetch) {
+    qLog(Debug) << "Failed to prefetch stream URL for" << media_url << error;
+    return;
+  }
   CancelTask(req.task_id);
 
+  if (req.attached_msec > 0) {
+    cache_.RecordMiss();
+    LogCacheStats();
+  }
+
   emit AsyncLoadComplete(LoadResult(media_url, LoadResult::Type::Error, error));
 
 }
@@ -73,12 +131,28 @@ void QobuzUrlHandler::GetStreamURLSuccess(const uint id, const QUrl &media_url,
 
   if (!requests_.contains(id)) return;
   Request req = requests_.take(id);
+
+  const LoadResult result(media_url, LoadResult::Type::TrackAvailable, stream_url, filetype, samplerate, bit_depth, duration);
+  if (req.prefetch) {
+    cache_.Insert(result, QDateTime::currentMSecsSinceEpoch() - req.started_msec);
+    return;
+  }
+
   CancelTask(req.task_id);
 
-  emit AsyncLoadComplete(LoadResult(media_url, LoadResult::Type::TrackAvailable, stream_url, filetype, samplerate, bit_depth, duration));
+  if (req.attached_msec > 0) {
+    cache_.RecordHit(req.attached_msec - req.started_msec);
+    LogCacheStats();
+  }
+
+  emit AsyncLoadComplete(result);
 
 }
 
 void QobuzUrlHandler::CancelTask(const int task_id) {
   app_->task_manager()->SetTaskFinished(task_id);
 }
+
+void QobuzUrlHandler::LogCacheStats() const {
+  qLog(Debug) << "Qobuz stream URL cache:" << cache_.hits() << "hits," << cache_.misses() << "misses (" << cache_.hit_rate_percent() << "%), saved" << cache_.saved_msec() << "ms";
+}
@@ -28,6 +28,7 @@
 
 #include "core/urlhandler.h"
 #include "core/song.h"
+#include "streaming/streamurlcache.h"
 #include "qobuz/qobuzservice.h"
 
 class Application;
@@ -40,9 +41,13 @@ class QobuzUrlHandler : public UrlHandler {
 
   QString scheme() const { return service_->url_scheme(); }
   LoadResult StartLoading(const QUrl &url);
+  void Prefetch(const QUrl &url);
+
+  const StreamURLCache &cache() const { return cache_; }
 
  private:
   void CancelTask(const int task_id);
+  void LogCacheStats() const;
 
  private slots:
   void GetStreamURLFailure(const uint id, const QUrl &media_url, const QString &error);
@@ -50,13 +55,19 @@ class QobuzUrlHandler : public UrlHandler {
 
  private:
   struct Request {
-    Request() : id(0), task_id(-1) {}
+    Request() : id(0), task_id(-1), prefetch(false), started_msec(0), attached_msec(0) {}
     uint id;
     int task_id;
+    bool prefetch;
+    qint64 started_msec;
+    // When the player asked for the stream URL while it was being prefetched.
+    qint64 attached_msec;
+    QUrl media_url;
   };
   Application *app_;
   QobuzService *service_;
   QMap<uint, Request> requests_;
+  StreamURLCache cache_;
 };
 
 #endif  // QOBUZURLHANDLER_H
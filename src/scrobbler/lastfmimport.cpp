@@ -49,7 +49,9 @@
 #include "lastfmscrobbler.h"
 
 namespace {
-constexpr int kRequestsDelay = 2000;
+// Last.fm allows about 5 requests per second, keep a few pages in flight below that.
+constexpr int kRequestsDelay = 250;
+constexpr int kMaxConcurrentRequests = 4;
 }
 
 LastFMImport::LastFMImport(SharedPtr<NetworkAccessManager> network, QObject *parent)
@@ -58,6 +60,7 @@ LastFMImport::LastFMImport(SharedPtr<NetworkAccessManager> network, QObject *par
       timer_flush_requests_(new QTimer(this)),
       lastplayed_(false),
       playcount_(false),
+      importing_(false),
       playcount_total_(0),
       lastplayed_total_(0),
       playcount_received_(0),
@@ -77,6 +80,12 @@ LastFMImport::~LastFMImport() {
 
 void LastFMImport::AbortAll() {
 
+  // Don't leave the statistics received so far staged until the next import.
+  if (importing_) {
+    importing_ = false;
+    emit StatisticsImportAborted();
+  }
+
   while (!replies_.isEmpty()) {
     QNetworkReply *reply = replies_.takeFirst();
     QObject::disconnect(reply, nullptr, this, nullptr);
@@ -221,6 +230,9 @@ void LastFMImport::ImportData(const bool lastplayed, const bool playcount) {
   lastplayed_ = lastplayed;
   playcount_ = playcount;
 
+  importing_ = true;
+  emit StatisticsImportStarted();
+
   if (lastplayed) AddGetRecentTracksRequest(0);
   if (playcount) AddGetTopTracksRequest(0);
 
@@ -228,6 +240,8 @@ void LastFMImport::ImportData(const bool lastplayed, const bool playcount) {
 
 void LastFMImport::FlushRequests() {
 
+  if (replies_.count() >= kMaxConcurrentRequests) return;
+
   if (!recent_tracks_requests_.isEmpty()) {
     SendGetRecentTracksRequest(recent_tracks_requests_.dequeue());
     return;
@@ -353,6 +367,7 @@ void LastFMImport::GetRecentTracksRequestFinished(QNetworkReply *reply, const in
 
     QJsonArray array_track = json_obj[QLatin1String("track")].toArray();
 
+    SongList songs;
     for (const QJsonValueRef value_track : array_track) {
 
       ++lastplayed_received_;
@@ -386,13 +401,19 @@ void LastFMImport::GetRecentTracksRequestFinished(QNetworkReply *reply, const in
       QString title = obj_track[QLatin1String("name")].toString();
       QDateTime datetime = QDateTime::fromString(date, QStringLiteral("dd MMM yyyy, hh:mm"));
       if (datetime.isValid()) {
-        emit UpdateLastPlayed(artist, album, title, datetime.toSecsSinceEpoch());
+        Song song;
+        song.set_artist(artist);
+        song.set_album(album);
+        song.set_title(title);
+        song.set_lastplayed(datetime.toSecsSinceEpoch());
+        songs << song;
       }
 
-      UpdateProgressCheck();
-
     }
 
+    if (!songs.isEmpty()) emit StatisticsReceived(songs);
+    UpdateProgressCheck();
+
     if (page == 1) {
       for (int i = 2; i <= pages; ++i) {
         AddGetRecentTracksRequest(i);
@@ -515,6 +536,7 @@ void LastFMImport::GetTopTracksRequestFinished(QNetworkReply *reply, const int p
   else {
 
     QJsonArray array_track = json_obj[QLatin1String("track")].toArray();
+    SongList songs;
     for (QJsonArray::iterator it = array_track.begin(); it != array_track.end(); ++it) {
 
       const QJsonValue &value_track = *it;
@@ -545,11 +567,17 @@ void LastFMImport::GetTopTracksRequestFinished(QNetworkReply *reply, const int p
 
       if (playcount <= 0) continue;
 
-      emit UpdatePlayCount(artist, title, playcount, false);
-      UpdateProgressCheck();
+      Song song;
+      song.set_artist(artist);
+      song.set_title(title);
+      song.set_playcount(static_cast<uint>(playcount));
+      songs << song;
 
     }
 
+    if (!songs.isEmpty()) emit StatisticsReceived(songs);
+    UpdateProgressCheck();
+
     if (page == 1) {
       for (int i = 2; i <= pages; ++i) {
         AddGetTopTracksRequest(i);
@@ -574,7 +602,13 @@ void LastFMImport::UpdateProgressCheck() {
 }
 
 void LastFMImport::FinishCheck() {
-  if (replies_.isEmpty() && recent_tracks_requests_.isEmpty() && top_tracks_requests_.isEmpty()) emit Finished();
+
+  if (replies_.isEmpty() && recent_tracks_requests_.isEmpty() && top_tracks_requests_.isEmpty()) {
+    importing_ = false;
+    emit StatisticsImportFinished();
+    emit Finished();
+  }
+
 }
 
 void LastFMImport::Error(const QString &error, const QVariant &debug) {
@@ -582,6 +616,12 @@ void LastFMImport::Error(const QString &error, const QVariant &debug) {
   qLog(Error) << error;
   if (debug.isValid()) qLog(Debug) << debug;
 
+  // Keep the statistics of the pages received before the error, the same as when each track was updated as it was received.
+  if (importing_) {
+    importing_ = false;
+    emit StatisticsImportFinished();
+  }
+
   emit FinishedWithError(error);
 
   AbortAll();
@@ -32,6 +32,7 @@
 #include <QDateTime>
 
 #include "core/shared_ptr.h"
+#include "core/song.h"
 
 class QTimer;
 class QNetworkReply;
@@ -81,8 +82,10 @@ class LastFMImport : public QObject {
   void FinishCheck();
 
  signals:
-  void UpdatePlayCount(const QString&, const QString&, const int, const bool = false);
-  void UpdateLastPlayed(const QString&, const QString&, const QString&, const qint64);
+  void StatisticsImportStarted();
+  void StatisticsReceived(const SongList &songs);
+  void StatisticsImportFinished();
+  void StatisticsImportAborted();
   void UpdateTotal(const int, const int);
   void UpdateProgress(const int, const int);
   void Finished();
@@ -100,6 +103,8 @@ class LastFMImport : public QObject {
   QString username_;
   bool lastplayed_;
   bool playcount_;
+  // Set from StatisticsImportStarted() until StatisticsImportFinished() or StatisticsImportAborted() is emitted.
+  bool importing_;
   int playcount_total_;
   int lastplayed_total_;
   int playcount_received_;
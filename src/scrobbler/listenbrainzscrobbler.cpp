@@ -68,6 +68,9 @@ constexpr char kClientIDB64[] = "b2VBVU53cVNRZXIwZXIwOUZpcWkwUQ==";
 constexpr char kClientSecretB64[] = "Uk9GZ2hrZVEzRjNvUHlFaHFpeVdQQQ==";
 constexpr char kCacheFile[] = "listenbrainzscrobbler.cache";
 constexpr int kScrobblesPerRequest = 10;
+// ListenBrainz accepts up to 1000 listens in an import request, use larger batches when sending a backlog.
+constexpr int kBacklogScrobblesPerRequest = 500;
+constexpr int kMaxSubmitRequests = 3;
 }  // namespace
 
 ListenBrainzScrobbler::ListenBrainzScrobbler(SharedPtr<ScrobblerSettings> settings, SharedPtr<NetworkAccessManager> network, QObject *parent)
@@ -78,10 +81,9 @@ ListenBrainzScrobbler::ListenBrainzScrobbler(SharedPtr<ScrobblerSettings> settin
       enabled_(false),
       expires_in_(-1),
       login_time_(0),
-      submitted_(false),
       scrobbled_(false),
       timestamp_(0),
-      submit_error_(false),
+      submit_state_(QLatin1String(kName), kMaxSubmitRequests),
       prefer_albumartist_(false) {
 
   refresh_login_timer_.setSingleShot(true);
@@ -521,18 +523,30 @@ void ListenBrainzScrobbler::Scrobble(const Song &song) {
 
 void ListenBrainzScrobbler::StartSubmit(const bool initial) {
 
-  if (!submitted_ && cache_->Count() > 0) {
-    if (initial && settings_->submit_delay() <= 0 && !submit_error_) {
-      if (timer_submit_.isActive()) {
-        timer_submit_.stop();
-      }
-      Submit();
-    }
-    else if (!timer_submit_.isActive()) {
-      int submit_delay = static_cast<int>(std::max(settings_->submit_delay(), submit_error_ ? 30 : 5) * kMsecPerSec);
-      timer_submit_.setInterval(submit_delay);
+  if (cache_->Count() <= 0) return;
+
+  if (submit_state_.rate_limited()) {
+    // Wait for the rate limit to reset, even if the timer was already started with a shorter delay.
+    const int rate_limit_msec = static_cast<int>(submit_state_.rate_limit_msec());
+    if (!timer_submit_.isActive() || timer_submit_.remainingTime() < rate_limit_msec) {
+      timer_submit_.setInterval(rate_limit_msec);
       timer_submit_.start();
     }
+    return;
+  }
+
+  if (!submit_state_.can_start()) return;
+
+  if (initial && settings_->submit_delay() <= 0 && !submit_state_.error()) {
+    if (timer_submit_.isActive()) {
+      timer_submit_.stop();
+    }
+    Submit();
+  }
+  else if (submit_state_.requests() == 0 && !timer_submit_.isActive()) {
+    const qint64 submit_delay = std::max(settings_->submit_delay() * kMsecPerSec, submit_state_.error() ? submit_state_.retry_delay_msec() : 5 * kMsecPerSec);
+    timer_submit_.setInterval(static_cast<int>(submit_delay));
+    timer_submit_.start();
   }
 
 }
@@ -543,44 +557,69 @@ void ListenBrainzScrobbler::Submit() {
 
   if (!enabled() || !authenticated() || settings_->offline()) return;
 
-  QJsonArray array;
+  if (submit_state_.rate_limited()) {
+    StartSubmit();
+    return;
+  }
+
+  const ScrobblerCacheItemPtrList all_cache_items = cache_->List();
+  const qint64 unsent = std::count_if(all_cache_items.begin(), all_cache_items.end(), [](ScrobblerCacheItemPtr cache_item) { return !cache_item->sent; });
+  const int scrobbles_per_request = unsent > kScrobblesPerRequest ? kBacklogScrobblesPerRequest : kScrobblesPerRequest;
+
   ScrobblerCacheItemPtrList cache_items_sent;
-  ScrobblerCacheItemPtrList all_cache_items = cache_->List();
   for (ScrobblerCacheItemPtr cache_item : all_cache_items) {
     if (cache_item->sent) continue;
-    if (cache_item->error && cache_items_sent.count() > 0) break;
+    // Scrobbles that failed before are sent alone.
+    if (cache_item->error && cache_items_sent.count() > 0) {
+      SendScrobbles(cache_items_sent);
+      cache_items_sent.clear();
+    }
+    if (!submit_state_.can_start()) break;
     cache_item->sent = true;
     cache_items_sent << cache_item;
+    if (cache_items_sent.count() >= scrobbles_per_request || cache_item->error) {
+      SendScrobbles(cache_items_sent);
+      cache_items_sent.clear();
+    }
+  }
+
+  if (cache_items_sent.count() > 0) {
+    SendScrobbles(cache_items_sent);
+  }
+
+}
+
+void ListenBrainzScrobbler::SendScrobbles(const ScrobblerCacheItemPtrList &cache_items) {
+
+  QJsonArray array;
+  for (ScrobblerCacheItemPtr cache_item : cache_items) {
     QJsonObject object_listen;
     object_listen.insert(QLatin1String("listened_at"), QJsonValue::fromVariant(cache_item->timestamp));
     object_listen.insert(QLatin1String("track_metadata"), JsonTrackMetadata(cache_item->metadata));
     array.append(QJsonValue::fromVariant(object_listen));
-    if (cache_items_sent.count() >= kScrobblesPerRequest || cache_item->error) break;
   }
 
-  if (cache_items_sent.count() <= 0) return;
-
-  submitted_ = true;
-
   QJsonObject object;
   object.insert(QLatin1String("listen_type"), QLatin1String("import"));
   object.insert(QLatin1String("payload"), array);
   QJsonDocument doc(object);
 
+  const int round = submit_state_.Started(cache_->Count());
+
   QUrl url(QStringLiteral("%1/1/submit-listens").arg(QLatin1String(kApiUrl)));
   QNetworkReply *reply = CreateRequest(url, doc);
-  QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, cache_items_sent]() { ScrobbleRequestFinished(reply, cache_items_sent); });
+  QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, cache_items, round]() { ScrobbleRequestFinished(reply, cache_items, round); });
 
 }
 
-void ListenBrainzScrobbler::ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items) {
+void ListenBrainzScrobbler::ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items, const int round) {
 
   if (!replies_.contains(reply)) return;
   replies_.removeAll(reply);
   QObject::disconnect(reply, nullptr, this, nullptr);
   reply->deleteLater();
 
-  submitted_ = false;
+  CheckRateLimit(reply);
 
   QJsonObject json_obj;
   QString error_message;
@@ -594,21 +633,32 @@ void ListenBrainzScrobbler::ScrobbleRequestFinished(QNetworkReply *reply, Scrobb
       qLog(Debug) << "ListenBrainz: Received scrobble reply without status.";
     }
     cache_->Flush(cache_items);
-    submit_error_ = false;
+    submit_state_.Succeeded(static_cast<int>(cache_items.count()), cache_->Count());
+    // Keep the other requests going while there is a backlog.
+    Submit();
+  }
+  else if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 429) {
+    // Sent again when the rate limit resets, use the retry delay if the server didn't say when that is.
+    if (!submit_state_.rate_limited()) {
+      submit_state_.RateLimited(ScrobblerSubmitState::kMinRetryDelayMsec);
+    }
+    submit_state_.Requeued();
+    cache_->ClearSent(cache_items);
+  }
+  else if (reply_result == ReplyResult::APIError && cache_items.count() > 1) {
+    // Some of the listens were rejected, send the batch again in halves until the rejected listens are sent alone.
+    qLog(Warning) << "ListenBrainz: Batch of" << cache_items.count() << "scrobbles was rejected, splitting it:" << error_message;
+    submit_state_.Requeued();
+    const int half = static_cast<int>(cache_items.count() / 2);
+    SendScrobbles(cache_items.mid(0, half));
+    SendScrobbles(cache_items.mid(half));
   }
   else {
-    submit_error_ = true;
+    submit_state_.Failed(round);
     if (reply_result == ReplyResult::APIError) {
-      if (cache_items.count() == 1) {
-        const ScrobbleMetadata &metadata = cache_items.first()->metadata;
-        Error(tr("Unable to scrobble %1 - %2 because of error: %3").arg(metadata.effective_albumartist()).arg(metadata.title).arg(error_message));
-        cache_->Flush(cache_items);
-      }
-      else {
-        Error(error_message);
-        cache_->SetError(cache_items);
-        cache_->ClearSent(cache_items);
-      }
+      const ScrobbleMetadata &metadata = cache_items.first()->metadata;
+      Error(tr("Unable to scrobble %1 - %2 because of error: %3").arg(metadata.effective_albumartist()).arg(metadata.title).arg(error_message));
+      cache_->Flush(cache_items);
     }
     else {
       Error(error_message);
@@ -620,6 +670,23 @@ void ListenBrainzScrobbler::ScrobbleRequestFinished(QNetworkReply *reply, Scrobb
 
 }
 
+void ListenBrainzScrobbler::CheckRateLimit(QNetworkReply *reply) {
+
+  // See https://listenbrainz.readthedocs.io/en/latest/users/api/index.html#rate-limiting
+  if (!reply->hasRawHeader("X-RateLimit-Remaining") || !reply->hasRawHeader("X-RateLimit-Reset-In")) return;
+
+  bool remaining_ok = false;
+  bool reset_in_ok = false;
+  const int remaining = reply->rawHeader("X-RateLimit-Remaining").toInt(&remaining_ok);
+  const qint64 reset_in = reply->rawHeader("X-RateLimit-Reset-In").toLongLong(&reset_in_ok);
+  if (!remaining_ok || !reset_in_ok) return;
+
+  if (remaining <= 0 || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 429) {
+    submit_state_.RateLimited(std::max(static_cast<qint64>(1), reset_in) * kMsecPerSec);
+  }
+
+}
+
 void ListenBrainzScrobbler::Love() {
 
   if (!song_playing_.is_valid() || !song_playing_.is_metadata_good()) return;
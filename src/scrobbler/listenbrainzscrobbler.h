@@ -37,6 +37,7 @@
 #include "scrobblerservice.h"
 #include "scrobblercache.h"
 #include "scrobblemetadata.h"
+#include "scrobblersubmitstate.h"
 
 class QNetworkReply;
 
@@ -59,7 +60,7 @@ class ListenBrainzScrobbler : public ScrobblerService {
 
   bool enabled() const override { return enabled_; }
   bool authenticated() const override { return !access_token_.isEmpty() && !user_token_.isEmpty(); }
-  bool submitted() const override { return submitted_; }
+  bool submitted() const override { return submit_state_.requests() > 0; }
   QString user_token() const { return user_token_; }
 
   void Authenticate();
@@ -88,7 +89,7 @@ class ListenBrainzScrobbler : public ScrobblerService {
   void AuthenticateReplyFinished(QNetworkReply *reply);
   void RequestNewAccessToken() { RequestAccessToken(); }
   void UpdateNowPlayingRequestFinished(QNetworkReply *reply);
-  void ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items);
+  void ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items, const int round);
   void LoveRequestFinished(QNetworkReply *reply);
 
  private:
@@ -99,6 +100,8 @@ class ListenBrainzScrobbler : public ScrobblerService {
   void Error(const QString &error, const QVariant &debug = QVariant());
   void RequestAccessToken(const QUrl &redirect_url = QUrl(), const QString &code = QString());
   void StartSubmit(const bool initial = false) override;
+  void SendScrobbles(const ScrobblerCacheItemPtrList &cache_items);
+  void CheckRateLimit(QNetworkReply *reply);
   void CheckScrobblePrevSong();
 
   SharedPtr<NetworkAccessManager> network_;
@@ -111,13 +114,12 @@ class ListenBrainzScrobbler : public ScrobblerService {
   QString token_type_;
   QString refresh_token_;
   quint64 login_time_;
-  bool submitted_;
   Song song_playing_;
   bool scrobbled_;
   quint64 timestamp_;
   QTimer refresh_login_timer_;
   QTimer timer_submit_;
-  bool submit_error_;
+  ScrobblerSubmitState submit_state_;
 
   bool prefer_albumartist_;
 
@@ -19,16 +19,20 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <utility>
 #include <functional>
 #include <chrono>
 #include <memory>
 
 #include <QObject>
 #include <QStandardPaths>
+#include <QMap>
 #include <QString>
+#include <QByteArray>
 #include <QFile>
+#include <QSaveFile>
 #include <QIODevice>
-#include <QTextStream>
 #include <QTimer>
 #include <QJsonDocument>
 #include <QJsonValue>
@@ -44,11 +48,16 @@
 using std::make_shared;
 using namespace std::chrono_literals;
 
+const int ScrobblerCache::kCompactMinRecords = 1000;
+
 ScrobblerCache::ScrobblerCache(const QString &filename, QObject *parent)
     : QObject(parent),
       timer_flush_(new QTimer(this)),
       filename_(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1Char('/') + filename),
-      loaded_(false) {
+      loaded_(false),
+      next_id_(1),
+      journal_records_(0),
+      compact_(false) {
 
   ReadCache();
   loaded_ = true;
@@ -63,25 +72,60 @@ ScrobblerCache::~ScrobblerCache() {
   scrobbler_cache_.clear();
 }
 
+// The cache file is a journal with one JSON object per line, either a scrobble or the ID of a scrobble that was removed.
+// Scrobbles and removals are appended to it, and it's only rewritten when most of the records are for removed scrobbles.
 void ScrobblerCache::ReadCache() {
 
   QFile file(filename_);
-  bool result = file.open(QIODevice::ReadOnly | QIODevice::Text);
+  bool result = file.open(QIODevice::ReadOnly);
   if (!result) return;
 
-  QTextStream stream(&file);
-#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
-  stream.setEncoding(QStringConverter::Encoding::Utf8);
-#else
-  stream.setCodec("UTF-8");
-#endif
-  QString data = stream.readAll();
+  bool first_record = true;
+  while (!file.atEnd()) {
+    const QByteArray line = file.readLine().trimmed();
+    if (line.isEmpty()) continue;
+
+    QJsonParseError error;
+    const QJsonDocument json_doc = QJsonDocument::fromJson(line, &error);
+    if (error.error != QJsonParseError::NoError || !json_doc.isObject() || (first_record && json_doc.object().contains(QLatin1String("tracks")))) {
+      // Caches written by older versions are a single JSON document, convert them to a journal on the next write.
+      if (first_record && file.seek(0)) {
+        ReadLegacyCache(file.readAll());
+        compact_ = true;
+        return;
+      }
+      // The last record might be incomplete if we crashed while writing it.
+      // Rewrite the file on the next write, records appended after a line without a newline would be lost.
+      qLog(Error) << "Scrobbler cache has an invalid record.";
+      compact_ = true;
+      continue;
+    }
+    first_record = false;
+    ++journal_records_;
+
+    const QJsonObject json_obj = json_doc.object();
+    if (json_obj.contains(QLatin1String("remove"))) {
+      scrobbler_cache_.remove(json_obj[QLatin1String("remove")].toVariant().toULongLong());
+      continue;
+    }
+
+    ScrobblerCacheItemPtr cache_item = ItemFromJson(json_obj);
+    if (!cache_item) continue;
+    cache_item->id = json_obj[QLatin1String("id")].toVariant().toULongLong();
+    if (cache_item->id == 0) cache_item->id = next_id_;
+    next_id_ = std::max(next_id_, cache_item->id + 1);
+    scrobbler_cache_.insert(cache_item->id, cache_item);
+  }
   file.close();
 
+}
+
+void ScrobblerCache::ReadLegacyCache(const QByteArray &data) {
+
   if (data.isEmpty()) return;
 
   QJsonParseError error;
-  QJsonDocument json_doc = QJsonDocument::fromJson(data.toUtf8(), &error);
+  QJsonDocument json_doc = QJsonDocument::fromJson(data, &error);
   if (error.error != QJsonParseError::NoError) {
     qLog(Error) << "Scrobbler cache is missing JSON data.";
     return;
@@ -119,73 +163,126 @@ void ScrobblerCache::ReadCache() {
       qLog(Debug) << value;
       continue;
     }
-    QJsonObject json_obj_track = value.toObject();
-    if (
-        !json_obj_track.contains(QLatin1String("timestamp")) ||
-        !json_obj_track.contains(QLatin1String("artist")) ||
-        !json_obj_track.contains(QLatin1String("album")) ||
-        !json_obj_track.contains(QLatin1String("title")) ||
-        !json_obj_track.contains(QLatin1String("track")) ||
-        !json_obj_track.contains(QLatin1String("albumartist")) ||
-        !json_obj_track.contains(QLatin1String("length_nanosec"))
-    ) {
-      qLog(Error) << "Scrobbler cache JSON tracks array value is missing data.";
-      qLog(Debug) << value;
-      continue;
-    }
+    ScrobblerCacheItemPtr cache_item = ItemFromJson(value.toObject());
+    if (!cache_item) continue;
+    cache_item->id = next_id_++;
+    scrobbler_cache_.insert(cache_item->id, cache_item);
+  }
 
-    ScrobbleMetadata metadata;
-    quint64 timestamp = json_obj_track[QLatin1String("timestamp")].toVariant().toULongLong();
-    metadata.artist = json_obj_track[QLatin1String("artist")].toString();
-    metadata.album = json_obj_track[QLatin1String("album")].toString();
-    metadata.title = json_obj_track[QLatin1String("title")].toString();
-    metadata.track = json_obj_track[QLatin1String("track")].toInt();
-    metadata.albumartist = json_obj_track[QLatin1String("albumartist")].toString();
-    metadata.length_nanosec = json_obj_track[QLatin1String("length_nanosec")].toVariant().toLongLong();
-
-    if (timestamp == 0 || metadata.artist.isEmpty() || metadata.title.isEmpty() || metadata.length_nanosec <= 0) {
-      qLog(Error) << "Invalid cache data" << "for song" << metadata.title;
-      continue;
-    }
+}
 
-    if (json_obj_track.contains(QLatin1String("grouping"))) {
-      metadata.grouping = json_obj_track[QLatin1String("grouping")].toString();
-    }
+ScrobblerCacheItemPtr ScrobblerCache::ItemFromJson(const QJsonObject &json_obj_track) {
+
+  if (
+      !json_obj_track.contains(QLatin1String("timestamp")) ||
+      !json_obj_track.contains(QLatin1String("artist")) ||
+      !json_obj_track.contains(QLatin1String("album")) ||
+      !json_obj_track.contains(QLatin1String("title")) ||
+      !json_obj_track.contains(QLatin1String("track")) ||
+      !json_obj_track.contains(QLatin1String("albumartist")) ||
+      !json_obj_track.contains(QLatin1String("length_nanosec"))
+  ) {
+    qLog(Error) << "Scrobbler cache JSON tracks array value is missing data.";
+    qLog(Debug) << json_obj_track;
+    return nullptr;
+  }
 
-    if (json_obj_track.contains(QLatin1String("musicbrainz_album_artist_id"))) {
-      metadata.musicbrainz_album_artist_id = json_obj_track[QLatin1String("musicbrainz_album_artist_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_artist_id"))) {
-      metadata.musicbrainz_artist_id = json_obj_track[QLatin1String("musicbrainz_artist_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_original_artist_id"))) {
-      metadata.musicbrainz_original_artist_id = json_obj_track[QLatin1String("musicbrainz_original_artist_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_album_id"))) {
-      metadata.musicbrainz_album_id = json_obj_track[QLatin1String("musicbrainz_album_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_original_album_id"))) {
-      metadata.musicbrainz_original_album_id = json_obj_track[QLatin1String("musicbrainz_original_album_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_recording_id"))) {
-      metadata.musicbrainz_recording_id = json_obj_track[QLatin1String("musicbrainz_recording_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_track_id"))) {
-      metadata.musicbrainz_track_id = json_obj_track[QLatin1String("musicbrainz_track_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_disc_id"))) {
-      metadata.musicbrainz_disc_id = json_obj_track[QLatin1String("musicbrainz_disc_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_release_group_id"))) {
-      metadata.musicbrainz_release_group_id = json_obj_track[QLatin1String("musicbrainz_release_group_id")].toString();
-    }
-    if (json_obj_track.contains(QLatin1String("musicbrainz_work_id"))) {
-      metadata.musicbrainz_work_id = json_obj_track[QLatin1String("musicbrainz_work_id")].toString();
-    }
+  ScrobbleMetadata metadata;
+  quint64 timestamp = json_obj_track[QLatin1String("timestamp")].toVariant().toULongLong();
+  metadata.artist = json_obj_track[QLatin1String("artist")].toString();
+  metadata.album = json_obj_track[QLatin1String("album")].toString();
+  metadata.title = json_obj_track[QLatin1String("title")].toString();
+  metadata.track = json_obj_track[QLatin1String("track")].toInt();
+  metadata.albumartist = json_obj_track[QLatin1String("albumartist")].toString();
+  metadata.length_nanosec = json_obj_track[QLatin1String("length_nanosec")].toVariant().toLongLong();
+
+  if (timestamp == 0 || metadata.artist.isEmpty() || metadata.title.isEmpty() || metadata.length_nanosec <= 0) {
+    qLog(Error) << "Invalid cache data" << "for song" << metadata.title;
+    return nullptr;
+  }
+
+  if (json_obj_track.contains(QLatin1String("grouping"))) {
+    metadata.grouping = json_obj_track[QLatin1String("grouping")].toString();
+  }
+
+  if (json_obj_track.contains(QLatin1String("musicbrainz_album_artist_id"))) {
+    metadata.musicbrainz_album_artist_id = json_obj_track[QLatin1String("musicbrainz_album_artist_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_artist_id"))) {
+    metadata.musicbrainz_artist_id = json_obj_track[QLatin1String("musicbrainz_artist_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_original_artist_id"))) {
+    metadata.musicbrainz_original_artist_id = json_obj_track[QLatin1String("musicbrainz_original_artist_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_album_id"))) {
+    metadata.musicbrainz_album_id = json_obj_track[QLatin1String("musicbrainz_album_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_original_album_id"))) {
+    metadata.musicbrainz_original_album_id = json_obj_track[QLatin1String("musicbrainz_original_album_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_recording_id"))) {
+    metadata.musicbrainz_recording_id = json_obj_track[QLatin1String("musicbrainz_recording_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_track_id"))) {
+    metadata.musicbrainz_track_id = json_obj_track[QLatin1String("musicbrainz_track_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_disc_id"))) {
+    metadata.musicbrainz_disc_id = json_obj_track[QLatin1String("musicbrainz_disc_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_release_group_id"))) {
+    metadata.musicbrainz_release_group_id = json_obj_track[QLatin1String("musicbrainz_release_group_id")].toString();
+  }
+  if (json_obj_track.contains(QLatin1String("musicbrainz_work_id"))) {
+    metadata.musicbrainz_work_id = json_obj_track[QLatin1String("musicbrainz_work_id")].toString();
+  }
+
+  return make_shared<ScrobblerCacheItem>(metadata, timestamp);
+
+}
+
+QByteArray ScrobblerCache::ItemRecord(ScrobblerCacheItemPtr cache_item) {
+
+  QJsonObject object;
+  object.insert(QLatin1String("id"), QJsonValue::fromVariant(cache_item->id));
+  object.insert(QLatin1String("timestamp"), QJsonValue::fromVariant(cache_item->timestamp));
+  object.insert(QLatin1String("artist"), QJsonValue::fromVariant(cache_item->metadata.artist));
+  object.insert(QLatin1String("album"), QJsonValue::fromVariant(cache_item->metadata.album));
+  object.insert(QLatin1String("title"), QJsonValue::fromVariant(cache_item->metadata.title));
+  object.insert(QLatin1String("track"), QJsonValue::fromVariant(cache_item->metadata.track));
+  object.insert(QLatin1String("albumartist"), QJsonValue::fromVariant(cache_item->metadata.albumartist));
+  object.insert(QLatin1String("grouping"), QJsonValue::fromVariant(cache_item->metadata.grouping));
+  object.insert(QLatin1String("musicbrainz_album_artist_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_album_artist_id));
+  object.insert(QLatin1String("musicbrainz_artist_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_artist_id));
+  object.insert(QLatin1String("musicbrainz_original_artist_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_original_artist_id));
+  object.insert(QLatin1String("musicbrainz_album_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_album_id));
+  object.insert(QLatin1String("musicbrainz_original_album_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_original_album_id));
+  object.insert(QLatin1String("musicbrainz_recording_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_recording_id));
+  object.insert(QLatin1String("musicbrainz_track_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_track_id));
+  object.insert(QLatin1String("musicbrainz_disc_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_disc_id));
+  object.insert(QLatin1String("musicbrainz_release_group_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_release_group_id));
+  object.insert(QLatin1String("musicbrainz_work_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_work_id));
+  object.insert(QLatin1String("length_nanosec"), QJsonValue::fromVariant(cache_item->metadata.length_nanosec));
+
+  return QJsonDocument(object).toJson(QJsonDocument::Compact);
+
+}
+
+QByteArray ScrobblerCache::RemoveRecord(ScrobblerCacheItemPtr cache_item) {
+
+  QJsonObject object;
+  object.insert(QLatin1String("remove"), QJsonValue::fromVariant(cache_item->id));
+
+  return QJsonDocument(object).toJson(QJsonDocument::Compact);
+
+}
+
+void ScrobblerCache::AppendRecord(const QByteArray &record) {
 
-    ScrobblerCacheItemPtr cache_item = make_shared<ScrobblerCacheItem>(metadata, timestamp);
-    scrobbler_cache_ << cache_item;
+  journal_pending_ << record;
+  ++journal_records_;
 
+  if (loaded_ && !timer_flush_->isActive()) {
+    timer_flush_->start();
   }
 
 }
@@ -194,68 +291,71 @@ void ScrobblerCache::WriteCache() {
 
   if (!loaded_) return;
 
-  qLog(Debug) << "Writing scrobbler cache file" << filename_;
-
   if (scrobbler_cache_.isEmpty()) {
     QFile file(filename_);
     if (file.exists()) file.remove();
+    journal_pending_.clear();
+    journal_records_ = 0;
+    compact_ = false;
     return;
   }
 
-  QJsonArray array;
-  for (ScrobblerCacheItemPtr cache_item : scrobbler_cache_) {
-    QJsonObject object;
-    object.insert(QLatin1String("timestamp"), QJsonValue::fromVariant(cache_item->timestamp));
-    object.insert(QLatin1String("artist"), QJsonValue::fromVariant(cache_item->metadata.artist));
-    object.insert(QLatin1String("album"), QJsonValue::fromVariant(cache_item->metadata.album));
-    object.insert(QLatin1String("title"), QJsonValue::fromVariant(cache_item->metadata.title));
-    object.insert(QLatin1String("track"), QJsonValue::fromVariant(cache_item->metadata.track));
-    object.insert(QLatin1String("albumartist"), QJsonValue::fromVariant(cache_item->metadata.albumartist));
-    object.insert(QLatin1String("grouping"), QJsonValue::fromVariant(cache_item->metadata.grouping));
-    object.insert(QLatin1String("musicbrainz_album_artist_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_album_artist_id));
-    object.insert(QLatin1String("musicbrainz_artist_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_artist_id));
-    object.insert(QLatin1String("musicbrainz_original_artist_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_original_artist_id));
-    object.insert(QLatin1String("musicbrainz_album_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_album_id));
-    object.insert(QLatin1String("musicbrainz_original_album_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_original_album_id));
-    object.insert(QLatin1String("musicbrainz_recording_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_recording_id));
-    object.insert(QLatin1String("musicbrainz_track_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_track_id));
-    object.insert(QLatin1String("musicbrainz_disc_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_disc_id));
-    object.insert(QLatin1String("musicbrainz_release_group_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_release_group_id));
-    object.insert(QLatin1String("musicbrainz_work_id"), QJsonValue::fromVariant(cache_item->metadata.musicbrainz_work_id));
-    object.insert(QLatin1String("length_nanosec"), QJsonValue::fromVariant(cache_item->metadata.length_nanosec));
-    array.append(QJsonValue::fromVariant(object));
+  if (compact_ || (journal_records_ >= kCompactMinRecords && journal_records_ > scrobbler_cache_.count() * 2)) {
+    CompactCache();
+    return;
   }
 
-  QJsonObject object;
-  object.insert(QLatin1String("tracks"), array);
-  QJsonDocument doc(object);
+  if (journal_pending_.isEmpty()) return;
+
+  qLog(Debug) << "Appending" << journal_pending_.count() << "records to scrobbler cache file" << filename_;
 
   QFile file(filename_);
-  bool result = file.open(QIODevice::WriteOnly | QIODevice::Text);
+  bool result = file.open(QIODevice::WriteOnly | QIODevice::Append);
   if (!result) {
     qLog(Error) << "Unable to open scrobbler cache file" << filename_;
     return;
   }
-  QTextStream stream(&file);
-#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
-  stream.setEncoding(QStringConverter::Encoding::Utf8);
-#else
-  stream.setCodec("UTF-8");
-#endif
-  stream << doc.toJson();
+  for (const QByteArray &record : std::as_const(journal_pending_)) {
+    file.write(record + '\n');
+  }
   file.close();
 
+  journal_pending_.clear();
+
+}
+
+void ScrobblerCache::CompactCache() {
+
+  qLog(Debug) << "Writing scrobbler cache file" << filename_;
+
+  QSaveFile file(filename_);
+  bool result = file.open(QIODevice::WriteOnly);
+  if (!result) {
+    qLog(Error) << "Unable to open scrobbler cache file" << filename_;
+    return;
+  }
+  for (ScrobblerCacheItemPtr cache_item : std::as_const(scrobbler_cache_)) {
+    file.write(ItemRecord(cache_item) + '\n');
+  }
+  if (!file.commit()) {
+    qLog(Error) << "Unable to write scrobbler cache file" << filename_;
+    return;
+  }
+
+  journal_pending_.clear();
+  journal_records_ = static_cast<int>(scrobbler_cache_.count());
+  compact_ = false;
+
 }
 
 ScrobblerCacheItemPtr ScrobblerCache::Add(const Song &song, const quint64 timestamp) {
 
   ScrobblerCacheItemPtr cache_item = make_shared<ScrobblerCacheItem>(ScrobbleMetadata(song), timestamp);
+  cache_item->id = next_id_++;
 
-  scrobbler_cache_ << cache_item;
+  scrobbler_cache_.insert(cache_item->id, cache_item);
 
-  if (loaded_ && !timer_flush_->isActive()) {
-    timer_flush_->start();
-  }
+  AppendRecord(ItemRecord(cache_item));
 
   return cache_item;
 
@@ -263,9 +363,10 @@ ScrobblerCacheItemPtr ScrobblerCache::Add(const Song &song, const quint64 timest
 
 void ScrobblerCache::Remove(ScrobblerCacheItemPtr cache_item) {
 
-  if (scrobbler_cache_.contains(cache_item)) {
-    scrobbler_cache_.removeAll(cache_item);
+  if (scrobbler_cache_.remove(cache_item->id) > 0) {
+    AppendRecord(RemoveRecord(cache_item));
   }
+
 }
 
 void ScrobblerCache::ClearSent(ScrobblerCacheItemPtrList cache_items) {
@@ -287,8 +388,8 @@ void ScrobblerCache::SetError(ScrobblerCacheItemPtrList cache_items) {
 void ScrobblerCache::Flush(ScrobblerCacheItemPtrList cache_items) {
 
   for (ScrobblerCacheItemPtr cache_item : cache_items) {
-    if (scrobbler_cache_.contains(cache_item)) {
-      scrobbler_cache_.removeAll(cache_item);
+    if (scrobbler_cache_.remove(cache_item->id) > 0) {
+      AppendRecord(RemoveRecord(cache_item));
     }
   }
 
@@ -27,11 +27,15 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QList>
+#include <QMap>
 #include <QString>
+#include <QByteArray>
+#include <QByteArrayList>
 
 #include "scrobblercacheitem.h"
 
 class QTimer;
+class QJsonObject;
 class Song;
 
 class ScrobblerCache : public QObject {
@@ -45,8 +49,8 @@ class ScrobblerCache : public QObject {
 
   ScrobblerCacheItemPtr Add(const Song &song, const quint64 timestamp);
   void Remove(ScrobblerCacheItemPtr cache_item);
-  int Count() const { return scrobbler_cache_.size(); };
-  ScrobblerCacheItemPtrList List() const { return scrobbler_cache_; }
+  int Count() const { return static_cast<int>(scrobbler_cache_.size()); };
+  ScrobblerCacheItemPtrList List() const { return scrobbler_cache_.values(); }
   void ClearSent(ScrobblerCacheItemPtrList cache_items);
   void SetError(ScrobblerCacheItemPtrList cache_items);
   void Flush(ScrobblerCacheItemPtrList cache_items);
@@ -55,10 +59,25 @@ class ScrobblerCache : public QObject {
   void WriteCache();
 
  private:
+  void ReadLegacyCache(const QByteArray &data);
+  static ScrobblerCacheItemPtr ItemFromJson(const QJsonObject &json_obj_track);
+  static QByteArray ItemRecord(ScrobblerCacheItemPtr cache_item);
+  static QByteArray RemoveRecord(ScrobblerCacheItemPtr cache_item);
+  void AppendRecord(const QByteArray &record);
+  void CompactCache();
+
+ private:
+  static const int kCompactMinRecords;
+
   QTimer *timer_flush_;
   QString filename_;
   bool loaded_;
-  QList<ScrobblerCacheItemPtr> scrobbler_cache_;
+  // Keyed by ID, which are handed out in the order the songs were scrobbled.
+  QMap<quint64, ScrobblerCacheItemPtr> scrobbler_cache_;
+  quint64 next_id_;
+  QByteArrayList journal_pending_;
+  int journal_records_;
+  bool compact_;
 };
 
 #endif  // SCROBBLERCACHE_H
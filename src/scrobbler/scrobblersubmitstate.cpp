@@ -0,0 +1,123 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QString>
+#include <QRandomGenerator>
+
+#include "core/logging.h"
+#include "scrobblersubmitstate.h"
+
+const qint64 ScrobblerSubmitState::kMinRetryDelayMsec = 30000;
+const qint64 ScrobblerSubmitState::kMaxRetryDelayMsec = 900000;
+
+ScrobblerSubmitState::ScrobblerSubmitState(const QString &name, const int max_requests)
+    : name_(name),
+      max_requests_(std::max(1, max_requests)),
+      requests_(0),
+      round_(0),
+      errors_(0),
+      retry_delay_msec_(0),
+      rate_limit_reset_msec_(0),
+      drained_(0) {}
+
+double ScrobblerSubmitState::drain_rate() const {
+
+  if (!drain_timer_.isValid() || drain_timer_.elapsed() <= 0) return 0.0;
+
+  return static_cast<double>(drained_) * 60000.0 / static_cast<double>(drain_timer_.elapsed());
+
+}
+
+qint64 ScrobblerSubmitState::rate_limit_msec() const {
+
+  if (!rate_limit_timer_.isValid()) return 0;
+
+  return std::max(static_cast<qint64>(0), rate_limit_reset_msec_ - rate_limit_timer_.elapsed());
+
+}
+
+int ScrobblerSubmitState::Started(const int backlog) {
+
+  if (!drain_timer_.isValid()) {
+    qLog(Debug) << name_ << "Submitting backlog of" << backlog << "scrobbles";
+    drained_ = 0;
+    drain_timer_.start();
+  }
+
+  ++requests_;
+
+  return round_;
+
+}
+
+void ScrobblerSubmitState::Succeeded(const int scrobbles, const int backlog) {
+
+  requests_ = std::max(0, requests_ - 1);
+  errors_ = 0;
+  retry_delay_msec_ = 0;
+  drained_ += scrobbles;
+
+  if (backlog > 0) {
+    qLog(Debug) << name_ << backlog << "scrobbles left, draining at" << drain_rate() << "scrobbles per minute";
+  }
+  else if (requests_ == 0 && drain_timer_.isValid()) {
+    qLog(Debug) << name_ << "Submitted" << drained_ << "scrobbles in" << drain_timer_.elapsed() << "ms";
+    drain_timer_.invalidate();
+  }
+
+}
+
+void ScrobblerSubmitState::Failed(const int round) {
+
+  requests_ = std::max(0, requests_ - 1);
+
+  // Requests already in flight when a request failed are likely to fail too, only back off once for them.
+  if (round != round_) return;
+
+  ++round_;
+  ++errors_;
+
+  const qint64 delay_msec = std::min(kMaxRetryDelayMsec, kMinRetryDelayMsec << std::min(errors_ - 1, 10));
+  retry_delay_msec_ = delay_msec / 2 + static_cast<qint64>(QRandomGenerator::global()->bounded(static_cast<quint32>(delay_msec / 2 + 1)));
+
+  qLog(Debug) << name_ << "Retrying scrobbles in" << retry_delay_msec_ << "ms after" << errors_ << "failed requests";
+
+}
+
+void ScrobblerSubmitState::Requeued() {
+
+  requests_ = std::max(0, requests_ - 1);
+
+}
+
+void ScrobblerSubmitState::RateLimited(const qint64 reset_msec) {
+
+  if (reset_msec <= rate_limit_msec()) return;
+
+  rate_limit_reset_msec_ = reset_msec;
+  rate_limit_timer_.start();
+
+  qLog(Debug) << name_ << "Rate limited, waiting" << reset_msec << "ms before sending more scrobbles";
+
+}
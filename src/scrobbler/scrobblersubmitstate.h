@@ -0,0 +1,75 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCROBBLERSUBMITSTATE_H
+#define SCROBBLERSUBMITSTATE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QString>
+#include <QElapsedTimer>
+
+// Keeps track of the scrobble requests a service has in flight, so a backlog can be sent as several batches at once.
+// After a failed request only one request is sent at a time until one succeeds, and the retry delay doubles for each
+// failure in a row, with jitter so several clients coming back online don't retry in lockstep.
+// No requests are started while the server asked to wait for its rate limit to reset.
+// Also measures how fast the backlog is drained.
+class ScrobblerSubmitState {
+ public:
+  explicit ScrobblerSubmitState(const QString &name, const int max_requests);
+
+  static const qint64 kMinRetryDelayMsec;
+  static const qint64 kMaxRetryDelayMsec;
+
+  int requests() const { return requests_; }
+  int max_requests() const { return errors_ > 0 ? 1 : max_requests_; }
+  bool can_start() const { return requests_ < max_requests() && !rate_limited(); }
+  bool error() const { return errors_ > 0; }
+  int errors() const { return errors_; }
+  qint64 retry_delay_msec() const { return retry_delay_msec_; }
+  bool rate_limited() const { return rate_limit_msec() > 0; }
+  // Milliseconds left until the rate limit resets.
+  qint64 rate_limit_msec() const;
+
+  // Scrobbles sent per minute since the backlog started draining.
+  double drain_rate() const;
+
+  // Returns the round the request belongs to, which must be passed back to Failed().
+  int Started(const int backlog);
+  void Succeeded(const int scrobbles, const int backlog);
+  void Failed(const int round);
+  // The request was answered, but its scrobbles are sent again in other requests.
+  void Requeued();
+  void RateLimited(const qint64 reset_msec);
+
+ private:
+  QString name_;
+  int max_requests_;
+  int requests_;
+  int round_;
+  int errors_;
+  qint64 retry_delay_msec_;
+  qint64 rate_limit_reset_msec_;
+  QElapsedTimer rate_limit_timer_;
+  int drained_;
+  QElapsedTimer drain_timer_;
+};
+
+#endif  // SCROBBLERSUBMITSTATE_H
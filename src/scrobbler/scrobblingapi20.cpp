@@ -65,6 +65,8 @@ const char *ScrobblingAPI20::kApiKey = "211990b4c96782c05d1536e7219eb56e";
 namespace {
 constexpr char kSecret[] = "80fd738f49596e9709b1bf9319c444a8";
 constexpr int kScrobblesPerRequest = 50;
+// Last.fm allows 50 scrobbles per request and an average of 5 requests per second, so a backlog can be sent a few requests at a time.
+constexpr int kMaxSubmitRequests = 2;
 }
 
 ScrobblingAPI20::ScrobblingAPI20(const QString &name, const QString &settings_group, const QString &auth_url, const QString &api_url, const bool batch, const QString &cache_file, SharedPtr<ScrobblerSettings> settings, SharedPtr<NetworkAccessManager> network, QObject *parent)
@@ -80,10 +82,9 @@ ScrobblingAPI20::ScrobblingAPI20(const QString &name, const QString &settings_gr
       enabled_(false),
       prefer_albumartist_(false),
       subscriber_(false),
-      submitted_(false),
       scrobbled_(false),
       timestamp_(0),
-      submit_error_(false) {
+      submit_state_(name, kMaxSubmitRequests) {
 
   timer_submit_.setSingleShot(true);
   QObject::connect(&timer_submit_, &QTimer::timeout, this, &ScrobblingAPI20::Submit);
@@ -468,18 +469,18 @@ void ScrobblingAPI20::Scrobble(const Song &song) {
 
 void ScrobblingAPI20::StartSubmit(const bool initial) {
 
-  if (!submitted_ && cache_->Count() > 0) {
-    if (initial && (!batch_ || settings_->submit_delay() <= 0) && !submit_error_) {
-      if (timer_submit_.isActive()) {
-        timer_submit_.stop();
-      }
-      Submit();
-    }
-    else if (!timer_submit_.isActive()) {
-      int submit_delay = static_cast<int>(std::max(settings_->submit_delay(), submit_error_ ? 30 : 5) * kMsecPerSec);
-      timer_submit_.setInterval(submit_delay);
-      timer_submit_.start();
+  if (cache_->Count() <= 0 || !submit_state_.can_start()) return;
+
+  if (initial && (!batch_ || settings_->submit_delay() <= 0) && !submit_state_.error()) {
+    if (timer_submit_.isActive()) {
+      timer_submit_.stop();
     }
+    Submit();
+  }
+  else if (submit_state_.requests() == 0 && !timer_submit_.isActive()) {
+    const qint64 submit_delay = std::max(settings_->submit_delay() * kMsecPerSec, submit_state_.error() ? submit_state_.retry_delay_msec() : 5 * kMsecPerSec);
+    timer_submit_.setInterval(static_cast<int>(submit_delay));
+    timer_submit_.start();
   }
 
 }
@@ -490,19 +491,36 @@ void ScrobblingAPI20::Submit() {
 
   qLog(Debug) << name_ << "Submitting scrobbles.";
 
-  ParamList params = ParamList() << Param(QStringLiteral("method"), QStringLiteral("track.scrobble"));
-
-  int i = 0;
   ScrobblerCacheItemPtrList all_cache_items = cache_->List();
   ScrobblerCacheItemPtrList cache_items_sent;
   for (ScrobblerCacheItemPtr cache_item : all_cache_items) {
     if (cache_item->sent) continue;
-    cache_item->sent = true;
     if (!batch_) {
+      cache_item->sent = true;
       SendSingleScrobble(cache_item);
       continue;
     }
+    if (!submit_state_.can_start()) break;
+    cache_item->sent = true;
     cache_items_sent << cache_item;
+    if (cache_items_sent.count() >= kScrobblesPerRequest) {
+      SendScrobbles(cache_items_sent);
+      cache_items_sent.clear();
+    }
+  }
+
+  if (cache_items_sent.count() > 0) {
+    SendScrobbles(cache_items_sent);
+  }
+
+}
+
+void ScrobblingAPI20::SendScrobbles(const ScrobblerCacheItemPtrList &cache_items) {
+
+  ParamList params = ParamList() << Param(QStringLiteral("method"), QStringLiteral("track.scrobble"));
+
+  int i = 0;
+  for (ScrobblerCacheItemPtr cache_item : cache_items) {
     params << Param(QStringLiteral("%1[%2]").arg(QStringLiteral("artist")).arg(i), prefer_albumartist_ ? cache_item->metadata.effective_albumartist() : cache_item->metadata.artist);
     params << Param(QStringLiteral("%1[%2]").arg(QStringLiteral("track")).arg(i), StripTitle(cache_item->metadata.title));
     params << Param(QStringLiteral("%1[%2]").arg(QStringLiteral("timestamp")).arg(i), QString::number(cache_item->timestamp));
@@ -517,39 +535,37 @@ void ScrobblingAPI20::Submit() {
       params << Param(QStringLiteral("%1[%2]").arg(QLatin1String("trackNumber")).arg(i), QString::number(cache_item->metadata.track));
     }
     ++i;
-    if (cache_items_sent.count() >= kScrobblesPerRequest) break;
   }
 
-  if (!batch_ || cache_items_sent.count() <= 0) return;
-
-  submitted_ = true;
+  const int round = submit_state_.Started(cache_->Count());
 
   QNetworkReply *reply = CreateRequest(params);
-  QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, cache_items_sent]() { ScrobbleRequestFinished(reply, cache_items_sent); });
+  QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, cache_items, round]() { ScrobbleRequestFinished(reply, cache_items, round); });
 
 }
 
-void ScrobblingAPI20::ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items) {
+void ScrobblingAPI20::ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items, const int round) {
 
   if (!replies_.contains(reply)) return;
   replies_.removeAll(reply);
   QObject::disconnect(reply, nullptr, this, nullptr);
   reply->deleteLater();
 
-  submitted_ = false;
-
   QJsonObject json_obj;
   QString error_message;
   if (GetJsonObject(reply, json_obj, error_message) != ReplyResult::Success) {
     Error(error_message);
     cache_->ClearSent(cache_items);
-    submit_error_ = true;
+    submit_state_.Failed(round);
     StartSubmit();
     return;
   }
 
   cache_->Flush(cache_items);
-  submit_error_ = false;
+  submit_state_.Succeeded(static_cast<int>(cache_items.count()), cache_->Count());
+
+  // Keep the other requests going while there is a backlog.
+  Submit();
 
   if (!json_obj.contains(QLatin1String("scrobbles"))) {
     Error(QStringLiteral("Json reply from server is missing scrobbles."), json_obj);
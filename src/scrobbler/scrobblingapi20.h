@@ -35,6 +35,7 @@
 #include "scrobblerservice.h"
 #include "scrobblercache.h"
 #include "scrobblercacheitem.h"
+#include "scrobblersubmitstate.h"
 
 class QNetworkReply;
 
@@ -57,7 +58,7 @@ class ScrobblingAPI20 : public ScrobblerService {
   bool enabled() const override { return enabled_; }
   bool authenticated() const override { return !username_.isEmpty() && !session_key_.isEmpty(); }
   bool subscriber() const { return subscriber_; }
-  bool submitted() const override { return submitted_; }
+  bool submitted() const override { return submit_state_.requests() > 0; }
   QString username() const { return username_; }
 
   void Authenticate();
@@ -78,7 +79,7 @@ class ScrobblingAPI20 : public ScrobblerService {
   void RedirectArrived();
   void AuthenticateReplyFinished(QNetworkReply *reply);
   void UpdateNowPlayingRequestFinished(QNetworkReply *reply);
-  void ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items);
+  void ScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtrList cache_items, const int round);
   void SingleScrobbleRequestFinished(QNetworkReply *reply, ScrobblerCacheItemPtr cache_item);
   void LoveRequestFinished(QNetworkReply *reply);
 
@@ -125,6 +126,7 @@ class ScrobblingAPI20 : public ScrobblerService {
 
   void RequestSession(const QString &token);
   void AuthError(const QString &error);
+  void SendScrobbles(const ScrobblerCacheItemPtrList &cache_items);
   void SendSingleScrobble(ScrobblerCacheItemPtr item);
   void Error(const QString &error, const QVariant &debug = QVariant());
   static QString ErrorString(const ScrobbleErrorCode error);
@@ -149,11 +151,10 @@ class ScrobblingAPI20 : public ScrobblerService {
   QString username_;
   QString session_key_;
 
-  bool submitted_;
   Song song_playing_;
   bool scrobbled_;
   quint64 timestamp_;
-  bool submit_error_;
+  ScrobblerSubmitState submit_state_;
 
   QTimer timer_submit_;
 
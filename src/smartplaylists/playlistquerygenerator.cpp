@@ -20,21 +20,29 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #include <QIODevice>
 #include <QDataStream>
 #include <QByteArray>
 #include <QString>
+#include <QVariant>
+#include <QList>
+#include <QSet>
+#include <QHash>
+#include <QRandomGenerator>
 
+#include "core/song.h"
 #include "playlistquerygenerator.h"
 #include "collection/collectionbackend.h"
 
-PlaylistQueryGenerator::PlaylistQueryGenerator(QObject *parent) : PlaylistGenerator(parent), dynamic_(false), current_pos_(0) {}
+PlaylistQueryGenerator::PlaylistQueryGenerator(QObject *parent) : PlaylistGenerator(parent), dynamic_(false), last_id_(-1) {}
 
 PlaylistQueryGenerator::PlaylistQueryGenerator(const QString &name, const SmartPlaylistSearch &search, const bool dynamic, QObject *parent)
     : PlaylistGenerator(parent),
       search_(search),
       dynamic_(dynamic),
-      current_pos_(0) {
+      last_id_(-1) {
 
   set_name(name);
 
@@ -44,7 +52,8 @@ void PlaylistQueryGenerator::Load(const SmartPlaylistSearch &search) {
 
   search_ = search;
   dynamic_ = false;
-  current_pos_ = 0;
+  last_sort_value_ = QVariant();
+  last_id_ = -1;
 
 }
 
@@ -70,36 +79,111 @@ QByteArray PlaylistQueryGenerator::Save() const {
 PlaylistItemPtrList PlaylistQueryGenerator::Generate() {
 
   previous_ids_.clear();
-  current_pos_ = 0;
+  previous_ids_set_.clear();
+  last_sort_value_ = QVariant();
+  last_id_ = -1;
   return GenerateMore(0);
 
 }
 
 PlaylistItemPtrList PlaylistQueryGenerator::GenerateMore(const int count) {
 
+  if (search_.sort_type_ == SmartPlaylistSearch::SortType::Random) {
+    return GenerateRandom(count > 0 ? count : search_.limit_);
+  }
+
+  // Continue after the last song instead of skipping the previous songs with an offset.
+  // The previous songs are still excluded, their sort value may have changed since, e.g. the play count.
   SmartPlaylistSearch search_copy = search_;
   search_copy.id_not_in_ = previous_ids_;
   if (count > 0) {
     search_copy.limit_ = count;
   }
-
-  if (search_copy.sort_type_ != SmartPlaylistSearch::SortType::Random) {
-    search_copy.first_item_ = current_pos_;
-    current_pos_ += search_copy.limit_;
+  search_copy.after_value_ = last_sort_value_;
+  search_copy.after_id_ = last_id_;
+
+  QVariant last_sort_value;
+  const SongList songs = collection_backend_->SmartPlaylistsFindSongs(search_copy, &last_sort_value);
+  if (!songs.isEmpty()) {
+    last_sort_value_ = last_sort_value;
+    last_id_ = songs.last().id();
   }
 
-  const SongList songs = collection_backend_->SmartPlaylistsFindSongs(search_copy);
   PlaylistItemPtrList items;
   items.reserve(songs.count());
   for (const Song &song : songs) {
     items << PlaylistItem::NewFromSong(song);
-    previous_ids_ << song.id();
+    AddPreviousId(song.id());
+  }
 
-    if (previous_ids_.count() > GetDynamicFuture() + GetDynamicHistory()) {
-      previous_ids_.removeFirst();
-    }
+  return items;
+
+}
+
+PlaylistItemPtrList PlaylistQueryGenerator::GenerateRandom(const int count) {
+
+  // Instead of sorting all matching songs by random() in SQL, draw from the cached IDs of the matching songs and only fetch the chosen songs.
+  const QList<int> ids = SampleIds(collection_backend_->SmartPlaylistsFindSongIds(search_), previous_ids_set_, count);
+  if (ids.isEmpty()) return PlaylistItemPtrList();
+
+  QHash<int, Song> songs;
+  const SongList song_list = collection_backend_->GetSongsById(ids);
+  for (const Song &song : song_list) {
+    songs.insert(song.id(), song);
+  }
+
+  PlaylistItemPtrList items;
+  items.reserve(ids.count());
+  for (const int id : ids) {
+    if (!songs.contains(id)) continue;
+    items << PlaylistItem::NewFromSong(songs.value(id));
+    AddPreviousId(id);
   }
 
   return items;
 
 }
+
+void PlaylistQueryGenerator::AddPreviousId(const int id) {
+
+  previous_ids_ << id;
+  previous_ids_set_.insert(id);
+
+  if (previous_ids_.count() > GetDynamicFuture() + GetDynamicHistory()) {
+    previous_ids_set_.remove(previous_ids_.takeFirst());
+  }
+
+}
+
+QList<int> PlaylistQueryGenerator::SampleIds(const QList<int> &ids, const QSet<int> &exclude, const int count) {
+
+  if (count == 0 || ids.isEmpty()) return QList<int>();
+
+  // When most of the IDs are needed, shuffle the remaining IDs instead of drawing them one by one.
+  if (count < 0 || count * 2 >= ids.count() - exclude.count()) {
+    QList<int> ret;
+    ret.reserve(ids.count());
+    for (const int id : ids) {
+      if (!exclude.contains(id)) ret << id;
+    }
+    std::shuffle(ret.begin(), ret.end(), *QRandomGenerator::global());
+    if (count >= 0 && ret.count() > count) {
+      ret = ret.mid(0, count);
+    }
+    return ret;
+  }
+
+  // At least twice as many IDs as we need are left, so few draws are rejected.
+  QList<int> ret;
+  ret.reserve(count);
+  QSet<int> chosen;
+  while (ret.count() < count) {
+    const int id = ids.at(QRandomGenerator::global()->bounded(static_cast<int>(ids.count())));
+    if (exclude.contains(id) || chosen.contains(id)) continue;
+    chosen.insert(id);
+    ret << id;
+  }
+
+  return ret;
+
+}
@@ -24,6 +24,8 @@
 #include "config.h"
 
 #include <QList>
+#include <QSet>
+#include <QVariant>
 #include <QByteArray>
 #include <QString>
 
@@ -51,12 +53,21 @@ class PlaylistQueryGenerator : public PlaylistGenerator {
   SmartPlaylistSearch search() const { return search_; }
   int GetDynamicFuture() override { return search_.limit_; }
 
+  // Draws count random IDs from ids without replacement, skipping the IDs in exclude. A negative count returns all of them shuffled.
+  static QList<int> SampleIds(const QList<int> &ids, const QSet<int> &exclude, const int count);
+
+ private:
+  PlaylistItemPtrList GenerateRandom(const int count);
+  void AddPreviousId(const int id);
+
  private:
   SmartPlaylistSearch search_;
   bool dynamic_;
 
   QList<int> previous_ids_;
-  int current_pos_;
+  QSet<int> previous_ids_set_;
+  QVariant last_sort_value_;
+  int last_id_;
 };
 
 #endif  // PLAYLISTQUERYGENERATOR_H
@@ -22,13 +22,15 @@
 
 #include <QString>
 #include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
 #include <QDataStream>
 
 #include "core/song.h"
 
 #include "smartplaylistsearch.h"
 
-SmartPlaylistSearch::SmartPlaylistSearch() : search_type_(SearchType::And), sort_type_(SortType::Random), sort_field_(SmartPlaylistSearchTerm::Field::Title), limit_(-1), first_item_(0) { Reset(); }
+SmartPlaylistSearch::SmartPlaylistSearch() : search_type_(SearchType::And), sort_type_(SortType::Random), sort_field_(SmartPlaylistSearchTerm::Field::Title), limit_(-1), after_id_(-1) { Reset(); }
 
 SmartPlaylistSearch::SmartPlaylistSearch(const SearchType type, const TermList &terms, const SortType sort_type, const SmartPlaylistSearchTerm::Field sort_field, const int limit)
     : search_type_(type),
@@ -36,7 +38,7 @@ SmartPlaylistSearch::SmartPlaylistSearch(const SearchType type, const TermList &
       sort_type_(sort_type),
       sort_field_(sort_field),
       limit_(limit),
-      first_item_(0) {}
+      after_id_(-1) {}
 
 void SmartPlaylistSearch::Reset() {
 
@@ -45,20 +47,21 @@ void SmartPlaylistSearch::Reset() {
   sort_type_ = SortType::Random;
   sort_field_ = SmartPlaylistSearchTerm::Field::Title;
   limit_ = -1;
-  first_item_ = 0;
+  id_not_in_.clear();
+  after_value_ = QVariant();
+  after_id_ = -1;
 
 }
 
-QString SmartPlaylistSearch::ToSql(const QString &songs_table) const {
+QStringList SmartPlaylistSearch::WhereClauses(QVariantMap &bound_values, const bool seek) const {
 
-  QString sql = QStringLiteral("SELECT %1 FROM %2").arg(Song::kRowIdColumnSpec, songs_table);
+  QStringList where_clauses;
 
   // Add search terms
-  QStringList where_clauses;
   QStringList term_where_clauses;
   term_where_clauses.reserve(terms_.count());
-  for (const SmartPlaylistSearchTerm &term : terms_) {
-    term_where_clauses << term.ToSql();
+  for (int i = 0; i < terms_.count(); ++i) {
+    term_where_clauses << terms_[i].ToSql(QStringLiteral(":term%1").arg(i), bound_values);
   }
 
   if (!terms_.isEmpty() && search_type_ != SearchType::All) {
@@ -67,18 +70,67 @@ QString SmartPlaylistSearch::ToSql(const QString &songs_table) const {
   }
 
   // Restrict the IDs of songs if we're making a dynamic playlist
-  if (!id_not_in_.isEmpty()) {
-    QString numbers;
-    for (int id : id_not_in_) {
-      numbers += (numbers.isEmpty() ? QLatin1String("") : QLatin1String(",")) + QString::number(id);
+  if (seek && !id_not_in_.isEmpty()) {
+    QStringList placeholders;
+    placeholders.reserve(id_not_in_.count());
+    for (int i = 0; i < id_not_in_.count(); ++i) {
+      const QString placeholder = QStringLiteral(":not_in%1").arg(i);
+      placeholders << placeholder;
+      bound_values.insert(placeholder, id_not_in_[i]);
+    }
+    where_clauses << QStringLiteral("(ROWID NOT IN (") + placeholders.join(QLatin1Char(',')) + QStringLiteral("))");
+  }
+
+  // Continue after the last song of the previous page, ROWID makes the order unique.
+  // The sort column is compared on its own too, so SQLite can seek in the index on the column instead of scanning from the start.
+  // NULL sorts first in ascending order, so in descending order the NULL rows of text and rating columns still follow.
+  if (seek && sort_type_ != SortType::Random && after_id_ >= 0) {
+    const QString col = SmartPlaylistSearchTerm::FieldColumnName(sort_field_);
+    const SmartPlaylistSearchTerm::Type type = SmartPlaylistSearchTerm::TypeOf(sort_field_);
+    bound_values.insert(QStringLiteral(":after_id"), after_id_);
+    if (after_value_.isNull()) {
+      if (sort_type_ == SortType::FieldAsc) {
+        where_clauses << QStringLiteral("(%1 IS NOT NULL OR ROWID > :after_id)").arg(col);
+      }
+      else {
+        where_clauses << QStringLiteral("(%1 IS NULL AND ROWID < :after_id)").arg(col);
+      }
+    }
+    else {
+      bound_values.insert(QStringLiteral(":after_value1"), after_value_);
+      bound_values.insert(QStringLiteral(":after_value2"), after_value_);
+      if (sort_type_ == SortType::FieldAsc) {
+        where_clauses << QStringLiteral("(%1 >= :after_value1 AND (%1 > :after_value2 OR ROWID > :after_id))").arg(col);
+      }
+      else if (type == SmartPlaylistSearchTerm::Type::Text || type == SmartPlaylistSearchTerm::Type::Rating) {
+        where_clauses << QStringLiteral("((%1 <= :after_value1 AND (%1 < :after_value2 OR ROWID < :after_id)) OR %1 IS NULL)").arg(col);
+      }
+      else {
+        where_clauses << QStringLiteral("(%1 <= :after_value1 AND (%1 < :after_value2 OR ROWID < :after_id))").arg(col);
+      }
     }
-    where_clauses << QStringLiteral("(ROWID NOT IN (") + numbers + QStringLiteral("))");
   }
 
   // We never want to include songs that have been deleted,
   // but are still kept in the database in case the directory containing them has just been unmounted.
   where_clauses << QStringLiteral("unavailable = 0");
 
+  return where_clauses;
+
+}
+
+QString SmartPlaylistSearch::ToSql(const QString &songs_table, QVariantMap &bound_values) const {
+
+  QString sql;
+  if (sort_type_ == SortType::Random) {
+    sql = QStringLiteral("SELECT %1 FROM %2").arg(Song::kRowIdColumnSpec, songs_table);
+  }
+  else {
+    // The sort column is added last so the caller can continue after the last song.
+    sql = QStringLiteral("SELECT %1, %2 FROM %3").arg(Song::kRowIdColumnSpec, SmartPlaylistSearchTerm::FieldColumnName(sort_field_), songs_table);
+  }
+
+  const QStringList where_clauses = WhereClauses(bound_values, true);
   if (!where_clauses.isEmpty()) {
     sql += QLatin1String(" WHERE ") + where_clauses.join(QLatin1String(" AND "));
   }
@@ -88,14 +140,12 @@ QString SmartPlaylistSearch::ToSql(const QString &songs_table) const {
     sql += QLatin1String(" ORDER BY random()");
   }
   else {
-    sql += QLatin1String(" ORDER BY ") + SmartPlaylistSearchTerm::FieldColumnName(sort_field_) + (sort_type_ == SortType::FieldAsc ? QLatin1String(" ASC") : QLatin1String(" DESC"));
+    const QString direction = sort_type_ == SortType::FieldAsc ? QLatin1String(" ASC") : QLatin1String(" DESC");
+    sql += QLatin1String(" ORDER BY ") + SmartPlaylistSearchTerm::FieldColumnName(sort_field_) + direction + QLatin1String(", ROWID") + direction;
   }
 
   // Add limit
-  if (first_item_ > 0) {
-    sql += QStringLiteral(" LIMIT %1 OFFSET %2").arg(limit_).arg(first_item_);
-  }
-  else if (limit_ != -1) {
+  if (limit_ != -1) {
     sql += QLatin1String(" LIMIT ") + QString::number(limit_);
   }
   //qLog(Debug) << sql;
@@ -104,6 +154,12 @@ QString SmartPlaylistSearch::ToSql(const QString &songs_table) const {
 
 }
 
+QString SmartPlaylistSearch::ToIdSql(const QString &songs_table, QVariantMap &bound_values) const {
+
+  return QStringLiteral("SELECT ROWID FROM %1 WHERE %2").arg(songs_table, WhereClauses(bound_values, false).join(QLatin1String(" AND ")));
+
+}
+
 bool SmartPlaylistSearch::is_valid() const {
 
   if (search_type_ == SearchType::All) return true;
@@ -25,6 +25,9 @@
 
 #include <QList>
 #include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
 #include <QDataStream>
 
 #include "playlistgenerator.h"
@@ -64,10 +67,19 @@ class SmartPlaylistSearch {
 
   // Not persisted, used to alter the behaviour of the query
   QList<int> id_not_in_;
-  int first_item_;
+  // For sorted searches, only songs after the song with this sort column value and ID are returned.
+  QVariant after_value_;
+  int after_id_;
 
   void Reset();
-  QString ToSql(const QString &songs_table) const;
+  // The values in the queries are bound to placeholders, bound_values needs to be bound before the query is executed.
+  // For sorted searches the value of the sort column is selected after the song columns.
+  QString ToSql(const QString &songs_table, QVariantMap &bound_values) const;
+  // Returns a query for the IDs of all matching songs, ignoring the sort order, limit and id_not_in_.
+  QString ToIdSql(const QString &songs_table, QVariantMap &bound_values) const;
+
+ private:
+  QStringList WhereClauses(QVariantMap &bound_values, const bool seek) const;
 };
 
 QDataStream &operator<<(QDataStream &s, const SmartPlaylistSearch &search);
@@ -34,22 +34,24 @@ SmartPlaylistSearchTerm::SmartPlaylistSearchTerm() : field_(Field::Title), opera
 SmartPlaylistSearchTerm::SmartPlaylistSearchTerm(Field field, Operator op, const QVariant &value)
     : field_(field), operator_(op), value_(value), datetype_(DateType::Hour) {}
 
-QString SmartPlaylistSearchTerm::ToSql() const {
+QString SmartPlaylistSearchTerm::ToSql(const QString &placeholder, QVariantMap &bound_values) const {
 
   QString col = FieldColumnName(field_);
   QString date = DateName(datetype_, true);
-  QString value = value_.toString();
-  value.replace(QLatin1Char('\''), QLatin1String("''"));
+  QVariant value = value_.toString();
+  QVariant second_value;
 
   if (field_ == Field::Filetype) {
-    Song::FileType filetype = Song::FiletypeByExtension(value);
+    Song::FileType filetype = Song::FiletypeByExtension(value_.toString());
     if (filetype == Song::FileType::Unknown) {
-      filetype = Song::FiletypeByDescription(value);
+      filetype = Song::FiletypeByDescription(value_.toString());
     }
-    value = QString::number(static_cast<int>(filetype));
+    value = static_cast<int>(filetype);
   }
 
-  QString second_value;
+  // Values are bound to the query, value_sql is what the column is compared with.
+  QString value_sql = placeholder;
+  QString second_value_sql = placeholder + QLatin1String("_2");
 
   bool special_date_query = (operator_ == Operator::NumericDate ||
                              operator_ == Operator::NumericDateNot ||
@@ -63,89 +65,79 @@ QString SmartPlaylistSearchTerm::ToSql() const {
     if (special_date_query) {
       // We have a numeric date, consider also the time for more precision
       col = QLatin1String("DATETIME(") + col + QLatin1String(", 'unixepoch', 'localtime')");
-      second_value = second_value_.toString();
-      second_value.replace(QLatin1Char('\''), QLatin1String("''"));
+      value = value_.toInt();
+      second_value = second_value_.toInt();
       if (date == QLatin1String("weeks")) {
         // Sqlite doesn't know weeks, transform them to days
         date = QLatin1String("days");
-        value = QString::number(value_.toInt() * 7);
-        second_value = QString::number(second_value_.toInt() * 7);
+        value = value_.toInt() * 7;
+        second_value = second_value_.toInt() * 7;
       }
+      value_sql = QLatin1String("DATETIME('now', '-' || ") + value_sql + QLatin1String(" || ' ") + date + QLatin1String("', 'localtime')");
+      second_value_sql = QLatin1String("DATETIME('now', '-' || ") + second_value_sql + QLatin1String(" || ' ") + date + QLatin1String("', 'localtime')");
     }
     else {
       // We have the exact date
       // The calendar widget specifies no time so ditch the possible time part
       // from integers representing the dates.
       col = QLatin1String("DATE(") + col + QLatin1String(", 'unixepoch', 'localtime')");
-      value = QLatin1String("DATE(") + value + QLatin1String(", 'unixepoch', 'localtime')");
+      value = value_.toLongLong();
+      value_sql = QLatin1String("DATE(") + value_sql + QLatin1String(", 'unixepoch', 'localtime')");
     }
   }
   else if (TypeOf(field_) == Type::Time) {
     // Convert seconds to nanoseconds
-    value = QLatin1String("CAST (") + value + QLatin1String(" *1000000000 AS INTEGER)");
+    value = value_.toDouble();
+    value_sql = QLatin1String("CAST (") + value_sql + QLatin1String(" *1000000000 AS INTEGER)");
   }
 
   // File paths need some extra processing since they are stored as encoded urls in the database.
   if (field_ == Field::Filepath) {
     if (operator_ == Operator::StartsWith || operator_ == Operator::Equals) {
-      value = QString::fromUtf8(QUrl::fromLocalFile(value).toEncoded());
+      value = QString::fromUtf8(QUrl::fromLocalFile(value_.toString()).toEncoded());
     }
     else {
-      value = QString::fromUtf8(QUrl(value).toEncoded());
+      value = QString::fromUtf8(QUrl(value_.toString()).toEncoded());
     }
   }
   else if (TypeOf(field_) == Type::Rating) {
     col = QLatin1String("CAST ((replace(") + col + QLatin1String(", -1, 0) + 0.05) * 10 AS INTEGER)");
-    value = QLatin1String("CAST ((") + value + QLatin1String(" + 0.05) * 10 AS INTEGER)");
+    value = value_.toDouble();
+    value_sql = QLatin1String("CAST ((") + value_sql + QLatin1String(" + 0.05) * 10 AS INTEGER)");
+  }
+
+  if (operator_ != Operator::Empty && operator_ != Operator::NotEmpty) {
+    bound_values.insert(placeholder, value);
   }
 
   switch (operator_) {
     case Operator::Contains:
-      return col + QLatin1String(" LIKE '%") + value + QLatin1String("%'");
+      return col + QLatin1String(" LIKE '%' || ") + value_sql + QLatin1String(" || '%'");
     case Operator::NotContains:
-      return col + QLatin1String(" NOT LIKE '%") + value + QLatin1String("%'");
+      return col + QLatin1String(" NOT LIKE '%' || ") + value_sql + QLatin1String(" || '%'");
     case Operator::StartsWith:
-      return col + QLatin1String(" LIKE '") + value + QLatin1String("%'");
+      return col + QLatin1String(" LIKE ") + value_sql + QLatin1String(" || '%'");
     case Operator::EndsWith:
-      return col + QLatin1String(" LIKE '%") + value + QLatin1Char('\'');
+      return col + QLatin1String(" LIKE '%' || ") + value_sql;
     case Operator::Equals:
       if (TypeOf(field_) == Type::Text) {
-        return col + QLatin1String(" LIKE '") + value + QLatin1Char('\'');
-      }
-      else if (TypeOf(field_) == Type::Date || TypeOf(field_) == Type::Time || TypeOf(field_) == Type::Rating) {
-        return col + QLatin1String(" = ") + value;
-      }
-      else {
-        return col + QLatin1String(" = '") + value + QLatin1Char('\'');
+        return col + QLatin1String(" LIKE ") + value_sql;
       }
+      return col + QLatin1String(" = ") + value_sql;
     case Operator::GreaterThan:
-      if (TypeOf(field_) == Type::Date || TypeOf(field_) == Type::Time || TypeOf(field_) == Type::Rating) {
-        return col + QLatin1String(" > ") + value;
-      }
-      else {
-        return col + QLatin1String(" > '") + value + QLatin1Char('\'');
-      }
+      return col + QLatin1String(" > ") + value_sql;
     case Operator::LessThan:
-      if (TypeOf(field_) == Type::Date || TypeOf(field_) == Type::Time || TypeOf(field_) == Type::Rating) {
-        return col + QLatin1String(" < ") + value;
-      }
-      else {
-        return col + QLatin1String(" < '") + value + QLatin1Char('\'');
-      }
+      return col + QLatin1String(" < ") + value_sql;
     case Operator::NumericDate:
-      return col + QLatin1String(" > ") + QLatin1String("DATETIME('now', '-") + value + QLatin1Char(' ') + date + QLatin1String("', 'localtime')");
+      return col + QLatin1String(" > ") + value_sql;
     case Operator::NumericDateNot:
-      return col + QLatin1String(" < ") + QLatin1String("DATETIME('now', '-") + value + QLatin1Char(' ') + date + QLatin1String("', 'localtime')");
+      return col + QLatin1String(" < ") + value_sql;
     case Operator::RelativeDate:
       // Consider the time range before the first date but after the second one
-      return QLatin1String("(") + col + QLatin1String(" < ") + QLatin1String("DATETIME('now', '-") + value + QLatin1Char(' ') + date + QLatin1String("', 'localtime') AND ") + col + QLatin1String(" > ") + QLatin1String("DATETIME('now', '-") + second_value + QLatin1Char(' ') + date + QLatin1String("', 'localtime'))");
+      bound_values.insert(placeholder + QLatin1String("_2"), second_value);
+      return QLatin1String("(") + col + QLatin1String(" < ") + value_sql + QLatin1String(" AND ") + col + QLatin1String(" > ") + second_value_sql + QLatin1String(")");
     case Operator::NotEquals:
-      if (TypeOf(field_) == Type::Text) {
-        return col + QLatin1String(" <> '") + value + QLatin1Char('\'');
-      }
-      else {
-        return col + QLatin1String(" <> ") + value;
-      }
+      return col + QLatin1String(" <> ") + value_sql;
     case Operator::Empty:
       return col + QLatin1String(" = ''");
     case Operator::NotEmpty:
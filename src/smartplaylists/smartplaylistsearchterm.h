@@ -27,6 +27,7 @@
 #include <QList>
 #include <QDataStream>
 #include <QVariant>
+#include <QVariantMap>
 #include <QString>
 
 class SmartPlaylistSearchTerm {
@@ -121,7 +122,8 @@ class SmartPlaylistSearchTerm {
   // For relative dates, we need a second parameter, might be useful somewhere else
   QVariant second_value_;
 
-  QString ToSql() const;
+  // Returns the SQL for the term, with the values bound to placeholders starting with placeholder.
+  QString ToSql(const QString &placeholder, QVariantMap &bound_values) const;
   bool is_valid() const;
   bool operator==(const SmartPlaylistSearchTerm &other) const;
   bool operator!=(const SmartPlaylistSearchTerm &other) const { return !(*this == other); }
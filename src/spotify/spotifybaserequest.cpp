@@ -36,6 +36,7 @@
 
 #include "core/logging.h"
 #include "core/networkaccessmanager.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "spotifyservice.h"
 #include "spotifybaserequest.h"
 
@@ -60,7 +61,12 @@ QNetworkReply *SpotifyBaseRequest::CreateRequest(const QString &ressource_name,
   req.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/x-www-form-urlencoded"));
   if (!access_token().isEmpty()) req.setRawHeader("authorization", "Bearer " + access_token().toUtf8());
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+  req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+
   QNetworkReply *reply = network_->get(req);
+  service_->request_scheduler()->RequestStarted(reply);
   QObject::connect(reply, &QNetworkReply::sslErrors, this, &SpotifyBaseRequest::HandleSSLErrors);
 
   qLog(Debug) << "Spotify: Sending request" << url;
@@ -38,6 +38,7 @@
 #include "core/logging.h"
 #include "core/networkaccessmanager.h"
 #include "core/song.h"
+#include "streaming/streamingfavoritessync.h"
 #include "spotifyservice.h"
 #include "spotifybaserequest.h"
 #include "spotifyfavoriterequest.h"
@@ -290,12 +291,15 @@ void SpotifyFavoriteRequest::RemoveFavoritesReply(QNetworkReply *reply, const Fa
 
   switch (type) {
     case FavoriteType_Artists:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Artists, songs);
       emit ArtistsRemoved(songs);
       break;
     case FavoriteType_Albums:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Albums, songs);
       emit AlbumsRemoved(songs);
       break;
     case FavoriteType_Songs:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Songs, songs);
       emit SongsRemoved(songs);
       break;
   }
@@ -31,6 +31,7 @@
 #include <QJsonArray>
 #include <QJsonValue>
 #include <QTimer>
+#include <QDateTime>
 
 #include "core/logging.h"
 #include "core/networkaccessmanager.h"
@@ -39,17 +40,13 @@
 #include "utilities/timeconstants.h"
 #include "utilities/imageutils.h"
 #include "utilities/coverutils.h"
+#include "streaming/streamingfavoritessync.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "spotifyservice.h"
 #include "spotifybaserequest.h"
 #include "spotifyrequest.h"
 
 namespace {
-const int kMaxConcurrentArtistsRequests = 1;
-const int kMaxConcurrentAlbumsRequests = 1;
-const int kMaxConcurrentSongsRequests = 1;
-const int kMaxConcurrentArtistAlbumsRequests = 1;
-const int kMaxConcurrentAlbumSongsRequests = 1;
-const int kMaxConcurrentAlbumCoverRequests = 10;
 const int kFlushRequestsDelay = 200;
 }
 
@@ -91,11 +88,19 @@ SpotifyRequest::SpotifyRequest(SpotifyService *service, Application *app, Networ
       album_covers_requests_total_(0),
       album_covers_requests_active_(0),
       album_covers_requests_received_(0),
+      favorites_sync_(type == QueryType::Artists ? StreamingFavoritesSync::Type::Artists : type == QueryType::Albums ? StreamingFavoritesSync::Type::Albums : StreamingFavoritesSync::Type::Songs),
       no_results_(false) {
 
   timer_flush_requests_->setInterval(kFlushRequestsDelay);
   timer_flush_requests_->setSingleShot(false);
   QObject::connect(timer_flush_requests_, &QTimer::timeout, this, &SpotifyRequest::FlushRequests);
+  // Start queued requests as soon as the service can take more, instead of waiting for the timer.
+  QObject::connect(service_->request_scheduler(), &StreamingRequestScheduler::RequestsAvailable, this, &SpotifyRequest::FlushRequests);
+
+  // Followed artists have no date, so they are always received in full.
+  if (type_ == QueryType::Albums || type_ == QueryType::Songs) {
+    favorites_sync_.Begin(StreamingFavoritesSync::LoadCursor(service_->settings_group(), favorites_sync_.type()));
+  }
 
 }
 
@@ -228,7 +233,7 @@ void SpotifyRequest::AddArtistsRequest(const int offset, const int limit) {
 
 void SpotifyRequest::FlushArtistsRequests() {
 
-  while (!artists_requests_queue_.isEmpty() && artists_requests_active_ < kMaxConcurrentArtistsRequests) {
+  while (!artists_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = artists_requests_queue_.dequeue();
 
@@ -282,7 +287,7 @@ void SpotifyRequest::AddAlbumsRequest(const int offset, const int limit) {
 
 void SpotifyRequest::FlushAlbumsRequests() {
 
-  while (!albums_requests_queue_.isEmpty() && albums_requests_active_ < kMaxConcurrentAlbumsRequests) {
+  while (!albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = albums_requests_queue_.dequeue();
 
@@ -333,7 +338,7 @@ void SpotifyRequest::AddSongsRequest(const int offset, const int limit) {
 
 void SpotifyRequest::FlushSongsRequests() {
 
-  while (!songs_requests_queue_.isEmpty() && songs_requests_active_ < kMaxConcurrentSongsRequests) {
+  while (!songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = songs_requests_queue_.dequeue();
 
@@ -585,7 +590,7 @@ void SpotifyRequest::AddArtistAlbumsRequest(const Artist &artist, const int offs
 
 void SpotifyRequest::FlushArtistAlbumsRequests() {
 
-  while (!artist_albums_requests_queue_.isEmpty() && artist_albums_requests_active_ < kMaxConcurrentArtistAlbumsRequests) {
+  while (!artist_albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     ArtistAlbumsRequest request = artist_albums_requests_queue_.dequeue();
 
@@ -686,6 +691,7 @@ void SpotifyRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_a
       continue;
     }
     QJsonObject obj_item = value_item.toObject();
+    const QDateTime added = ParseFavoriteAdded(obj_item);
 
     if (obj_item.contains(QLatin1String("item"))) {
       QJsonValue json_item = obj_item[QLatin1String("item")];
@@ -723,6 +729,8 @@ void SpotifyRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_a
     album.album_id = obj_item[QLatin1String("id")].toString();
     album.album = obj_item[QLatin1String("name")].toString();
 
+    if (type_ == QueryType::Albums && !favorites_sync_.FavoriteReceived(album.album_id, added)) continue;
+
     if (artist_artist.artist_id.isEmpty() && obj_item.contains(QLatin1String("artists")) && obj_item[QLatin1String("artists")].isArray()) {
       QJsonArray array_artists = obj_item[QLatin1String("artists")].toArray();
       for (const QJsonValueRef value : array_artists) {
@@ -802,6 +810,11 @@ void SpotifyRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_a
     emit UpdateProgress(query_id_, GetProgress(albums_received_, albums_total_));
   }
 
+  if (type_ == QueryType::Albums && favorites_sync_.PageReceived(albums_total) == StreamingFavoritesSync::Paging::Stop) {
+    AlbumsFinishCheck(artist_artist);
+    return;
+  }
+
   AlbumsFinishCheck(artist_artist, limit_requested, offset, albums_total, albums_received);
 
 }
@@ -889,7 +902,7 @@ void SpotifyRequest::AddAlbumSongsRequest(const Artist &artist, const Album &alb
 
 void SpotifyRequest::FlushAlbumSongsRequests() {
 
-  while (!album_songs_requests_queue_.isEmpty() && album_songs_requests_active_ < kMaxConcurrentAlbumSongsRequests) {
+  while (!album_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     AlbumSongsRequest request = album_songs_requests_queue_.dequeue();
     ++album_songs_requests_active_;
@@ -988,6 +1001,7 @@ void SpotifyRequest::SongsReceived(QNetworkReply *reply, const Artist &artist, c
       continue;
     }
     QJsonObject obj_item = value_item.toObject();
+    const QDateTime added = ParseFavoriteAdded(obj_item);
 
     if (obj_item.contains(QLatin1String("item")) && obj_item[QLatin1String("item")].isObject()) {
       obj_item = obj_item[QLatin1String("item")].toObject();
@@ -1000,6 +1014,7 @@ void SpotifyRequest::SongsReceived(QNetworkReply *reply, const Artist &artist, c
     ++songs_received;
     Song song(Song::Source::Spotify);
     ParseSong(song, obj_item, artist, album);
+    if (type_ == QueryType::Songs && !favorites_sync_.FavoriteReceived(song.song_id(), added)) continue;
     if (!song.is_valid()) continue;
     if (song.disc() >= 2) multidisc = true;
     if (song.is_compilation()) compilation = true;
@@ -1017,6 +1032,11 @@ void SpotifyRequest::SongsReceived(QNetworkReply *reply, const Artist &artist, c
     emit UpdateProgress(query_id_, GetProgress(songs_received_, songs_total_));
   }
 
+  if (type_ == QueryType::Songs && favorites_sync_.PageReceived(songs_total) == StreamingFavoritesSync::Paging::Stop) {
+    SongsFinishCheck(artist, album);
+    return;
+  }
+
   SongsFinishCheck(artist, album, limit_requested, offset_requested, songs_total, songs_received);
 
 }
@@ -1057,6 +1077,15 @@ void SpotifyRequest::SongsFinishCheck(const Artist &artist, const Album &album,
 
 }
 
+// Saved albums and tracks are returned with the date they were saved.
+QDateTime SpotifyRequest::ParseFavoriteAdded(const QJsonObject &json_obj) {
+
+  if (!json_obj.contains(QLatin1String("added_at"))) return QDateTime();
+
+  return QDateTime::fromString(json_obj[QLatin1String("added_at")].toString(), Qt::ISODate);
+
+}
+
 void SpotifyRequest::ParseSong(Song &song, const QJsonObject &json_obj, const Artist &album_artist, const Album &album) {
 
   if (
@@ -1225,13 +1254,14 @@ void SpotifyRequest::AddAlbumCoverRequest(const Song &song) {
 
 void SpotifyRequest::FlushAlbumCoverRequests() {
 
-  while (!album_cover_requests_queue_.isEmpty() && album_covers_requests_active_ < kMaxConcurrentAlbumCoverRequests) {
+  while (!album_cover_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Covers)) {
 
     AlbumCoverRequest request = album_cover_requests_queue_.dequeue();
 
     QNetworkRequest req(request.url);
     req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
     QNetworkReply *reply = network_->get(req);
+    service_->request_scheduler()->RequestStarted(reply, StreamingRequestScheduler::Category::Covers);
     album_cover_replies_ << reply;
     QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, request]() { AlbumCoverReceived(reply, request.album_id, request.url, request.filename); });
 
@@ -1358,12 +1388,21 @@ void SpotifyRequest::FinishCheck() {
       timer_flush_requests_->stop();
     }
     finished_ = true;
+    if (IsQuery()) {
+      const StreamingFavoritesSync::Cursor cursor = favorites_sync_.Finish(errors_.isEmpty());
+      if (errors_.isEmpty()) {
+        StreamingFavoritesSync::SaveCursor(service_->settings_group(), favorites_sync_.type(), cursor);
+      }
+    }
     if (no_results_ && songs_.isEmpty()) {
       if (IsSearch())
         emit Results(query_id_, SongMap(), tr("No match."));
       else
         emit Results(query_id_, SongMap(), QString());
     }
+    else if (songs_.isEmpty() && errors_.isEmpty() && favorites_sync_.incremental()) {  // Nothing was added since the last sync.
+      emit Results(query_id_, SongMap(), QString());
+    }
     else {
       if (songs_.isEmpty() && errors_.isEmpty()) {
         emit Results(query_id_, songs_, tr("Data missing error"));
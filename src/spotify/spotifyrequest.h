@@ -36,8 +36,10 @@
 #include <QUrl>
 #include <QJsonObject>
 #include <QTimer>
+#include <QDateTime>
 
 #include "core/song.h"
+#include "streaming/streamingfavoritessync.h"
 #include "spotifybaserequest.h"
 
 class QNetworkReply;
@@ -57,6 +59,8 @@ class SpotifyRequest : public SpotifyBaseRequest {
   void Process();
   void Search(const int query_id, const QString &search_text);
 
+  const StreamingFavoritesSync &favorites_sync() const { return favorites_sync_; }
+
  private:
   struct Artist {
     QString artist_id;
@@ -149,6 +153,7 @@ class SpotifyRequest : public SpotifyBaseRequest {
   void FlushAlbumSongsRequests();
 
   void ParseSong(Song &song, const QJsonObject &json_obj, const Artist &album_artist, const Album &album);
+  static QDateTime ParseFavoriteAdded(const QJsonObject &json_obj);
 
   void GetAlbumCoversCheck();
   void GetAlbumCovers();
@@ -222,6 +227,8 @@ class SpotifyRequest : public SpotifyBaseRequest {
   int album_covers_requests_active_;
   int album_covers_requests_received_;
 
+  StreamingFavoritesSync favorites_sync_;
+
   SongMap songs_;
   QStringList errors_;
   bool no_results_;
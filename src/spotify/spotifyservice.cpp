@@ -55,6 +55,8 @@
 #include "utilities/timeconstants.h"
 #include "utilities/randutils.h"
 #include "streaming/streamingsearchview.h"
+#include "streaming/streamingfavoritessync.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "collection/collectionbackend.h"
 #include "collection/collectionmodel.h"
 #include "spotifyservice.h"
@@ -136,6 +138,10 @@ SpotifyService::SpotifyService(Application *app, QObject *parent)
   timer_search_delay_->setSingleShot(true);
   QObject::connect(timer_search_delay_, &QTimer::timeout, this, &SpotifyService::StartSearch);
 
+  // The API is quickly rate limited, but the covers are served from a CDN.
+  request_scheduler()->set_initial_concurrency(StreamingRequestScheduler::Category::Api, 1);
+  request_scheduler()->set_initial_concurrency(StreamingRequestScheduler::Category::Covers, StreamingRequestScheduler::kMaxConcurrencyHttp1);
+
   QObject::connect(this, &SpotifyService::AddArtists, favorite_request_, &SpotifyFavoriteRequest::AddArtists);
   QObject::connect(this, &SpotifyService::AddAlbums, favorite_request_, &SpotifyFavoriteRequest::AddAlbums);
   QObject::connect(this, &SpotifyService::AddSongs, favorite_request_, QOverload<const SongList&>::of(&SpotifyFavoriteRequest::AddSongs));
@@ -532,7 +538,13 @@ void SpotifyService::GetArtists() {
 void SpotifyService::ArtistsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit ArtistsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = artists_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit ArtistsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit ArtistsResults(songs, error);
+  }
   ResetArtistsRequest();
 
 }
@@ -584,7 +596,13 @@ void SpotifyService::GetAlbums() {
 void SpotifyService::AlbumsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit AlbumsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = albums_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit AlbumsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit AlbumsResults(songs, error);
+  }
   ResetAlbumsRequest();
 
 }
@@ -636,7 +654,13 @@ void SpotifyService::GetSongs() {
 void SpotifyService::SongsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit SongsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = songs_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit SongsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit SongsResults(songs, error);
+  }
   ResetSongsRequest();
 
 }
@@ -22,9 +22,12 @@
 #include <QtGlobal>
 #include <QWidget>
 #include <QProgressBar>
+#include <QPushButton>
+#include <QAction>
 #include <QKeyEvent>
 #include <QContextMenuEvent>
 
+#include "core/iconloader.h"
 #include "collection/collectionfilterwidget.h"
 #include "streamingcollectionview.h"
 #include "streamingcollectionviewcontainer.h"
@@ -32,9 +35,14 @@
 
 StreamingCollectionViewContainer::StreamingCollectionViewContainer(QWidget *parent)
     : QWidget(parent),
-      ui_(new Ui_StreamingCollectionViewContainer) {
+      ui_(new Ui_StreamingCollectionViewContainer),
+      action_resync_(new QAction(IconLoader::Load(QStringLiteral("view-refresh")), tr("Refresh entire catalogue"), this)) {
 
   ui_->setupUi(this);
+
+  // Refresh only receives what changed since the last refresh, the full refresh is in the context menu of the button.
+  ui_->refresh->setContextMenuPolicy(Qt::ActionsContextMenu);
+  ui_->refresh->addAction(action_resync_);
   ui_->view->SetFilter(ui_->filter_widget);
 
   QObject::connect(ui_->filter_widget, &CollectionFilterWidget::UpPressed, ui_->view, &StreamingCollectionView::UpAndFocus);
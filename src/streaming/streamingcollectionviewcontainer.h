@@ -31,6 +31,7 @@
 
 class QStackedWidget;
 class QPushButton;
+class QAction;
 class QLabel;
 class QProgressBar;
 class QContextMenuEvent;
@@ -53,6 +54,7 @@ class StreamingCollectionViewContainer : public QWidget {
   StreamingCollectionView *view() const { return ui_->view; }
   CollectionFilterWidget *filter_widget() const { return ui_->filter_widget; }
   QPushButton *button_refresh() const { return ui_->refresh; }
+  QAction *action_resync() const { return action_resync_; }
   QPushButton *button_close() const { return ui_->close; }
   QPushButton *button_abort() const { return ui_->abort; }
   QLabel *status() const { return ui_->status; }
@@ -63,6 +65,7 @@ class StreamingCollectionViewContainer : public QWidget {
 
  private:
   Ui_StreamingCollectionViewContainer *ui_;
+  QAction *action_resync_;
 
 };
 
@@ -0,0 +1,222 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QDateTime>
+
+#include "core/song.h"
+#include "core/settings.h"
+#include "streamingfavoritessync.h"
+
+namespace {
+
+QString KeyPrefix(const StreamingFavoritesSync::Type type) {
+
+  switch (type) {
+    case StreamingFavoritesSync::Type::Artists:
+      return QStringLiteral("favorites_sync_artists");
+    case StreamingFavoritesSync::Type::Albums:
+      return QStringLiteral("favorites_sync_albums");
+    case StreamingFavoritesSync::Type::Songs:
+      return QStringLiteral("favorites_sync_songs");
+  }
+
+  return QString();
+
+}
+
+}  // namespace
+
+StreamingFavoritesSync::StreamingFavoritesSync(const Type type)
+    : type_(type),
+      mode_(Mode::Full),
+      reached_cursor_(false),
+      total_(0),
+      new_favorites_(0) {}
+
+StreamingFavoritesSync::Cursor StreamingFavoritesSync::LoadCursor(const QString &settings_group, const Type type) {
+
+  const QString prefix = KeyPrefix(type);
+
+  Cursor cursor;
+  Settings s;
+  s.beginGroup(settings_group);
+  cursor.added = s.value(prefix + QLatin1String("_added")).toDateTime();
+  cursor.added_ids = s.value(prefix + QLatin1String("_added_ids")).toStringList();
+  cursor.total = s.value(prefix + QLatin1String("_total"), -1).toInt();
+  s.endGroup();
+
+  return cursor;
+
+}
+
+void StreamingFavoritesSync::SaveCursor(const QString &settings_group, const Type type, const Cursor &cursor) {
+
+  if (!cursor.is_valid()) {
+    ClearCursor(settings_group, type);
+    return;
+  }
+
+  const QString prefix = KeyPrefix(type);
+
+  Settings s;
+  s.beginGroup(settings_group);
+  s.setValue(prefix + QLatin1String("_added"), cursor.added);
+  s.setValue(prefix + QLatin1String("_added_ids"), cursor.added_ids);
+  s.setValue(prefix + QLatin1String("_total"), cursor.total);
+  s.endGroup();
+
+}
+
+void StreamingFavoritesSync::ClearCursor(const QString &settings_group, const Type type) {
+
+  const QString prefix = KeyPrefix(type);
+
+  Settings s;
+  s.beginGroup(settings_group);
+  s.remove(prefix + QLatin1String("_added"));
+  s.remove(prefix + QLatin1String("_added_ids"));
+  s.remove(prefix + QLatin1String("_total"));
+  s.endGroup();
+
+}
+
+void StreamingFavoritesSync::FavoritesRemoved(const QString &settings_group, const Type type, const SongList &songs) {
+
+  Cursor cursor = LoadCursor(settings_group, type);
+  if (!cursor.is_valid()) return;
+
+  QSet<QString> ids;
+  for (const Song &song : songs) {
+    switch (type) {
+      case Type::Artists:
+        ids.insert(song.artist_id());
+        break;
+      case Type::Albums:
+        ids.insert(song.album_id());
+        break;
+      case Type::Songs:
+        ids.insert(song.song_id());
+        break;
+    }
+  }
+
+  cursor.total = std::max(0, cursor.total - static_cast<int>(ids.count()));
+  SaveCursor(settings_group, type, cursor);
+
+}
+
+void StreamingFavoritesSync::Begin(const Cursor &cursor) {
+
+  cursor_ = cursor;
+  mode_ = cursor_.is_valid() ? Mode::Incremental : Mode::Full;
+  reached_cursor_ = false;
+  total_ = 0;
+  new_favorites_ = 0;
+  favorite_ids_.clear();
+  newest_added_ = QDateTime();
+  newest_ids_.clear();
+
+}
+
+bool StreamingFavoritesSync::IsNew(const QString &id, const QDateTime &added) const {
+
+  // Without a date we can't tell, so it has to be fetched.
+  if (!added.isValid()) return true;
+
+  return added > cursor_.added || (added == cursor_.added && !cursor_.added_ids.contains(id));
+
+}
+
+bool StreamingFavoritesSync::FavoriteReceived(const QString &id, const QDateTime &added) {
+
+  favorite_ids_ << id;
+
+  if (added.isValid()) {
+    if (!newest_added_.isValid() || added > newest_added_) {
+      newest_added_ = added;
+      newest_ids_.clear();
+    }
+    if (added == newest_added_ && !newest_ids_.contains(id)) {
+      newest_ids_ << id;
+    }
+  }
+
+  if (mode_ == Mode::Full) return true;
+
+  if (IsNew(id, added)) {
+    ++new_favorites_;
+    return true;
+  }
+
+  reached_cursor_ = true;
+
+  return false;
+
+}
+
+StreamingFavoritesSync::Paging StreamingFavoritesSync::PageReceived(const int total) {
+
+  total_ = total;
+
+  if (mode_ != Mode::Incremental || !reached_cursor_) return Paging::Continue;
+
+  // Nothing was removed if the new favorites account for the difference.
+  if (total_ == cursor_.total + new_favorites_) return Paging::Stop;
+
+  // The songs of an artist don't all have the artist ID of the favorite, so they can't be pruned by ID.
+  if (type_ == Type::Artists) {
+    mode_ = Mode::Full;
+    return Paging::Restart;
+  }
+
+  mode_ = Mode::Prune;
+
+  return Paging::Continue;
+
+}
+
+StreamingFavoritesSync::Cursor StreamingFavoritesSync::Finish(const bool success) {
+
+  if (!success) {
+    // Don't remove anything based on an incomplete favorites list.
+    if (mode_ == Mode::Prune) mode_ = Mode::Incremental;
+    return cursor_;
+  }
+
+  // If the cursor was never reached, all favorites were received anyway.
+  if (mode_ == Mode::Incremental && !reached_cursor_) {
+    mode_ = Mode::Full;
+  }
+
+  Cursor cursor;
+  cursor.added = newest_added_;
+  cursor.added_ids = newest_ids_;
+  cursor.total = total_;
+
+  return cursor;
+
+}
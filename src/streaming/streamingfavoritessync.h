@@ -0,0 +1,105 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STREAMINGFAVORITESSYNC_H
+#define STREAMINGFAVORITESSYNC_H
+
+#include "config.h"
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include "core/song.h"
+
+// Keeps track of what was received the last time the favorites of a streaming service were synced,
+// so a refresh only needs to receive the favorites added since then.
+// The favorites must be received newest first. When the number of favorites doesn't add up, favorites were removed
+// on the service, the rest of the favorites list is then received to find the favorites that are gone.
+class StreamingFavoritesSync {
+ public:
+  enum class Type {
+    Artists,
+    Albums,
+    Songs
+  };
+
+  enum class Mode {
+    // All favorites are received, the results replace the collection.
+    Full,
+    // Only favorites added since the last sync are received, the results are added to the collection.
+    Incremental,
+    // As incremental, but favorite_ids() is the complete list of favorites, songs for other favorites are removed.
+    Prune
+  };
+
+  enum class Paging {
+    Continue,
+    Restart,
+    Stop
+  };
+
+  struct Cursor {
+    Cursor() : total(-1) {}
+    // Date the newest favorite was added, and the favorites added at that time.
+    QDateTime added;
+    QStringList added_ids;
+    int total;
+    bool is_valid() const { return added.isValid() && total >= 0; }
+  };
+
+  explicit StreamingFavoritesSync(const Type type = Type::Songs);
+
+  static Cursor LoadCursor(const QString &settings_group, const Type type);
+  static void SaveCursor(const QString &settings_group, const Type type, const Cursor &cursor);
+  static void ClearCursor(const QString &settings_group, const Type type);
+  // Called when favorites are removed from the collection, so the next sync doesn't mistake it for a removal on the service.
+  static void FavoritesRemoved(const QString &settings_group, const Type type, const SongList &songs);
+
+  // Starts a sync, an invalid cursor makes it a full sync.
+  void Begin(const Cursor &cursor = Cursor());
+  // Called for each favorite in the order received, returns true if the favorite needs to be fetched.
+  bool FavoriteReceived(const QString &id, const QDateTime &added);
+  // Called after each page of favorites with the total number of favorites.
+  Paging PageReceived(const int total);
+  // Called when all requests are finished, returns the cursor to save for the next sync.
+  Cursor Finish(const bool success);
+
+  Type type() const { return type_; }
+  Mode mode() const { return mode_; }
+  bool incremental() const { return mode_ != Mode::Full; }
+  bool prune() const { return mode_ == Mode::Prune; }
+  int new_favorites() const { return new_favorites_; }
+  const QStringList &favorite_ids() const { return favorite_ids_; }
+
+ private:
+  bool IsNew(const QString &id, const QDateTime &added) const;
+
+  Type type_;
+  Mode mode_;
+  Cursor cursor_;
+  bool reached_cursor_;
+  int total_;
+  int new_favorites_;
+  QStringList favorite_ids_;
+  QDateTime newest_added_;
+  QStringList newest_ids_;
+};
+
+#endif  // STREAMINGFAVORITESSYNC_H
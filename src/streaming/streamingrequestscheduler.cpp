@@ -0,0 +1,238 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "core/logging.h"
+#include "core/networkaccessmanager.h"
+#include "streamingrequestscheduler.h"
+
+// Qt opens at most 6 connections to the same host, more requests than that are just queued by Qt.
+const int StreamingRequestScheduler::kMaxConcurrencyHttp1 = 6;
+const int StreamingRequestScheduler::kMaxConcurrencyHttp2 = 16;
+const double StreamingRequestScheduler::kIncreaseLatencyFactor = 2.0;
+const qint64 StreamingRequestScheduler::kIncreaseLatencySlackMsec = 50;
+const qint64 StreamingRequestScheduler::kMinBackoffMsec = 1000;
+const qint64 StreamingRequestScheduler::kMaxBackoffMsec = 120000;
+const int StreamingRequestScheduler::kIdleLogDelayMsec = 5000;
+
+StreamingRequestScheduler::StreamingRequestScheduler(const QString &name, QObject *parent)
+    : QObject(parent),
+      name_(name),
+      timer_available_(new QTimer(this)),
+      timer_idle_(new QTimer(this)) {
+
+  clock_.start();
+
+  api_.concurrency = 3.0;
+  covers_.concurrency = 1.0;
+
+  timer_available_->setSingleShot(true);
+  timer_available_->setInterval(0);
+  QObject::connect(timer_available_, &QTimer::timeout, this, &StreamingRequestScheduler::RequestsAvailable);
+
+  timer_idle_->setSingleShot(true);
+  timer_idle_->setInterval(kIdleLogDelayMsec);
+  QObject::connect(timer_idle_, &QTimer::timeout, this, &StreamingRequestScheduler::Idle);
+
+}
+
+void StreamingRequestScheduler::set_initial_concurrency(const Category category, const int concurrency) {
+
+  // It's not known yet if the server supports HTTP/2, so start within the HTTP/1 limit.
+  state(category).concurrency = std::clamp(concurrency, 1, kMaxConcurrencyHttp1);
+
+}
+
+bool StreamingRequestScheduler::CanStart(const Category category) const {
+
+  const State &s = state(category);
+  if (clock_.elapsed() < s.paused_until_msec) return false;
+
+  return s.in_flight < concurrency(category);
+
+}
+
+void StreamingRequestScheduler::RequestStarted(QNetworkReply *reply, const Category category) {
+
+  ++state(category).in_flight;
+  replies_.insert(reply, category);
+  timer_idle_->stop();
+
+  const qint64 started_msec = clock_.elapsed();
+  QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, category, started_msec]() { RequestFinished(reply, category, started_msec); });
+  QObject::connect(reply, &QNetworkReply::destroyed, this, &StreamingRequestScheduler::ReplyDestroyed);
+
+}
+
+void StreamingRequestScheduler::ReplyDestroyed(QObject *object) {
+
+  // Deleted without finishing, don't count it as in flight forever.
+  QNetworkReply *reply = static_cast<QNetworkReply*>(object);
+  if (!replies_.contains(reply)) return;
+
+  State &s = state(replies_.take(reply));
+  s.in_flight = std::max(0, s.in_flight - 1);
+  timer_available_->start();
+
+}
+
+void StreamingRequestScheduler::RequestFinished(QNetworkReply *reply, const Category category, const qint64 started_msec) {
+
+  if (!replies_.contains(reply)) return;
+  replies_.remove(reply);
+
+  State &s = state(category);
+  s.in_flight = std::max(0, s.in_flight - 1);
+
+  if (api_.in_flight == 0 && covers_.in_flight == 0) {
+    timer_idle_->start();
+  }
+
+  // Aborted by us, this says nothing about the server.
+  if (reply->error() == QNetworkReply::OperationCanceledError) {
+    timer_available_->start();
+    return;
+  }
+
+  const qint64 now_msec = clock_.elapsed();
+  const qint64 latency_msec = now_msec - started_msec;
+  const int http_code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+  if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()) {
+    s.http2 = true;
+  }
+#endif
+
+  ++s.stats.requests;
+  s.stats.latency_total_msec += latency_msec;
+  s.stats.latency_min_msec = s.stats.requests == 1 ? latency_msec : std::min(s.stats.latency_min_msec, latency_msec);
+  s.stats.latency_max_msec = std::max(s.stats.latency_max_msec, latency_msec);
+
+  if (http_code == 429 || http_code == 503) {
+    ++s.stats.errors;
+    ++s.stats.rate_limited;
+    // Use Retry-After if the server sent it, otherwise double the pause for each time we're rate limited in a row.
+    const qint64 retry_after_msec = NetworkAccessManager::RetryAfterMsec(reply);
+    if (retry_after_msec > 0) {
+      s.backoff_msec = std::min(retry_after_msec, kMaxBackoffMsec);
+    }
+    else if (now_msec >= s.paused_until_msec) {
+      s.backoff_msec = s.backoff_msec == 0 ? kMinBackoffMsec : std::min(s.backoff_msec * 2, kMaxBackoffMsec);
+    }
+    s.paused_until_msec = std::max(s.paused_until_msec, now_msec + s.backoff_msec);
+    Decrease(s, started_msec);
+    QTimer::singleShot(static_cast<int>(s.paused_until_msec - now_msec), this, &StreamingRequestScheduler::RequestsAvailable);
+    return;
+  }
+
+  if (http_code >= 500) {
+    ++s.stats.errors;
+    Decrease(s, started_msec);
+  }
+  else if (reply->error() != QNetworkReply::NoError) {
+    // Other errors such as 404 don't mean the server is overloaded.
+    ++s.stats.errors;
+  }
+  else {
+    s.backoff_msec = 0;
+    s.smoothed_latency_msec = s.smoothed_latency_msec == 0.0 ? static_cast<double>(latency_msec) : s.smoothed_latency_msec * 0.875 + static_cast<double>(latency_msec) * 0.125;
+    s.min_latency_msec = s.min_latency_msec == 0 ? std::max(1LL, latency_msec) : std::min(s.min_latency_msec, std::max(1LL, latency_msec));
+    // When the latency goes up the requests are queued on the server, more concurrent requests would only make it worse.
+    if (s.smoothed_latency_msec <= static_cast<double>(s.min_latency_msec) * kIncreaseLatencyFactor + static_cast<double>(kIncreaseLatencySlackMsec)) {
+      const double max_concurrency = s.http2 ? kMaxConcurrencyHttp2 : kMaxConcurrencyHttp1;
+      s.concurrency = std::min(max_concurrency, s.concurrency + 1.0 / s.concurrency);
+    }
+  }
+
+  timer_available_->start();
+
+}
+
+void StreamingRequestScheduler::Decrease(State &s, const qint64 started_msec) {
+
+  // Requests sent before the last decrease were sent with the old limit, only decrease once for them.
+  if (started_msec < s.decreased_msec) return;
+
+  s.concurrency = std::max(1.0, s.concurrency / 2.0);
+  s.decreased_msec = clock_.elapsed();
+
+  qLog(Debug) << name_ << "is overloaded, concurrency is now" << static_cast<int>(s.concurrency);
+
+}
+
+int StreamingRequestScheduler::concurrency(const Category category) const {
+
+  return static_cast<int>(std::floor(state(category).concurrency));
+
+}
+
+bool StreamingRequestScheduler::paused(const Category category) const {
+
+  return clock_.elapsed() < state(category).paused_until_msec;
+
+}
+
+StreamingRequestScheduler::Stats StreamingRequestScheduler::stats(const Category category) const {
+
+  const State &s = state(category);
+  Stats stats = s.stats;
+  stats.in_flight = s.in_flight;
+  stats.concurrency = concurrency(category);
+  stats.http2 = s.http2;
+
+  return stats;
+
+}
+
+void StreamingRequestScheduler::ResetStats() {
+
+  api_.stats = Stats();
+  api_.logged_requests = 0;
+  covers_.stats = Stats();
+  covers_.logged_requests = 0;
+
+}
+
+void StreamingRequestScheduler::Idle() {
+
+  LogStats(QStringLiteral("API"), api_);
+  LogStats(QStringLiteral("cover"), covers_);
+
+}
+
+void StreamingRequestScheduler::LogStats(const QString &category_name, State &s) {
+
+  if (s.stats.requests == s.logged_requests) return;
+  s.logged_requests = s.stats.requests;
+
+  qLog(Debug) << name_ << s.stats.requests << category_name << "requests," << s.stats.errors << "errors," << s.stats.rate_limited << "rate limited, latency average" << s.stats.latency_average_msec() << "ms, min" << s.stats.latency_min_msec << "ms, max" << s.stats.latency_max_msec << "ms, concurrency" << static_cast<int>(s.concurrency) << (s.http2 ? "using HTTP/2" : "using HTTP/1.1");
+
+}
@@ -0,0 +1,124 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STREAMINGREQUESTSCHEDULER_H
+#define STREAMINGREQUESTSCHEDULER_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QElapsedTimer>
+
+class QTimer;
+class QNetworkReply;
+
+// Limits how many requests a streaming service has in flight.
+// The limit starts low, grows by about one request for each window of fast successful requests, stops growing when the
+// latency goes up, and is halved when the server returns 429 or 5xx. On 429 and 503 no requests are started until the
+// Retry-After time has passed. When the server uses HTTP/2 the requests are multiplexed, so the limit can grow higher.
+class StreamingRequestScheduler : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit StreamingRequestScheduler(const QString &name, QObject *parent = nullptr);
+
+  enum class Category {
+    Api,
+    Covers
+  };
+
+  struct Stats {
+    Stats() : requests(0), errors(0), rate_limited(0), latency_total_msec(0), latency_min_msec(0), latency_max_msec(0), in_flight(0), concurrency(0), http2(false) {}
+    int requests;
+    int errors;
+    int rate_limited;
+    qint64 latency_total_msec;
+    qint64 latency_min_msec;
+    qint64 latency_max_msec;
+    int in_flight;
+    int concurrency;
+    bool http2;
+    qint64 latency_average_msec() const { return requests > 0 ? latency_total_msec / requests : 0; }
+  };
+
+  static const int kMaxConcurrencyHttp1;
+  static const int kMaxConcurrencyHttp2;
+
+  void set_initial_concurrency(const Category category, const int concurrency);
+
+  // Returns true if another request can be started now.
+  bool CanStart(const Category category) const;
+  // Must be called for each request sent, the reply is tracked until it's finished.
+  void RequestStarted(QNetworkReply *reply, const Category category = Category::Api);
+
+  int concurrency(const Category category) const;
+  bool paused(const Category category) const;
+  Stats stats(const Category category) const;
+  void ResetStats();
+
+ signals:
+  // Emitted when requests that could not be started before can be started now.
+  void RequestsAvailable();
+
+ private:
+  struct State {
+    State() : concurrency(1.0), in_flight(0), http2(false), smoothed_latency_msec(0.0), min_latency_msec(0), paused_until_msec(0), backoff_msec(0), decreased_msec(-1), logged_requests(0) {}
+    double concurrency;
+    int in_flight;
+    bool http2;
+    double smoothed_latency_msec;
+    qint64 min_latency_msec;
+    qint64 paused_until_msec;
+    qint64 backoff_msec;
+    qint64 decreased_msec;
+    int logged_requests;
+    Stats stats;
+  };
+
+  State &state(const Category category) { return category == Category::Covers ? covers_ : api_; }
+  const State &state(const Category category) const { return category == Category::Covers ? covers_ : api_; }
+
+  void RequestFinished(QNetworkReply *reply, const Category category, const qint64 started_msec);
+  void Decrease(State &s, const qint64 started_msec);
+  void LogStats(const QString &category_name, State &s);
+
+ private slots:
+  void ReplyDestroyed(QObject *object);
+  void Idle();
+
+ private:
+  static const double kIncreaseLatencyFactor;
+  static const qint64 kIncreaseLatencySlackMsec;
+  static const qint64 kMinBackoffMsec;
+  static const qint64 kMaxBackoffMsec;
+  static const int kIdleLogDelayMsec;
+
+  QString name_;
+  QElapsedTimer clock_;
+  QTimer *timer_available_;
+  QTimer *timer_idle_;
+  State api_;
+  State covers_;
+  QHash<QNetworkReply*, Category> replies_;
+};
+
+#endif  // STREAMINGREQUESTSCHEDULER_H
@@ -0,0 +1,92 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QCache>
+#include <QString>
+#include <QDateTime>
+
+#include "core/song.h"
+#include "streamingsearchcache.h"
+
+const int StreamingSearchCache::kDefaultMaxSongs = 5000;
+const qint64 StreamingSearchCache::kDefaultTtlMsec = 600000;
+
+StreamingSearchCache::StreamingSearchCache(const int max_songs, const qint64 ttl_msec)
+    : ttl_msec_(ttl_msec),
+      hits_(0),
+      misses_(0) {
+
+  cache_.setMaxCost(max_songs);
+
+}
+
+QString StreamingSearchCache::Key(const Song::Source source, const int type, const QString &query) {
+
+  return QStringLiteral("%1:%2:%3").arg(static_cast<int>(source)).arg(type).arg(query.simplified().toLower());
+
+}
+
+bool StreamingSearchCache::IsExpired(const Entry *entry) const {
+
+  return QDateTime::currentMSecsSinceEpoch() - entry->inserted_msec > ttl_msec_;
+
+}
+
+bool StreamingSearchCache::Contains(const QString &key) const {
+
+  const Entry *entry = cache_.object(key);
+  return entry && !IsExpired(entry);
+
+}
+
+bool StreamingSearchCache::Get(const QString &key, SongMap *songs) {
+
+  Entry *entry = cache_.object(key);
+  if (!entry || IsExpired(entry)) {
+    if (entry) cache_.remove(key);
+    ++misses_;
+    return false;
+  }
+
+  ++hits_;
+  *songs = entry->songs;
+
+  return true;
+
+}
+
+void StreamingSearchCache::Insert(const QString &key, const SongMap &songs) {
+
+  if (songs.isEmpty()) return;
+
+  Entry *entry = new Entry;
+  entry->songs = songs;
+  entry->inserted_msec = QDateTime::currentMSecsSinceEpoch();
+  cache_.insert(key, entry, std::max(1, static_cast<int>(songs.count())));
+
+}
+
+void StreamingSearchCache::Clear() {
+  cache_.clear();
+}
@@ -0,0 +1,68 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STREAMINGSEARCHCACHE_H
+#define STREAMINGSEARCHCACHE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QCache>
+#include <QString>
+
+#include "core/song.h"
+
+// Recent streaming search results, so going back to a previous query doesn't search the service again.
+// The least recently used results are dropped when the cache is full, the cost of an entry is the number of songs.
+class StreamingSearchCache {
+ public:
+  explicit StreamingSearchCache(const int max_songs = kDefaultMaxSongs, const qint64 ttl_msec = kDefaultTtlMsec);
+
+  static const int kDefaultMaxSongs;
+  static const qint64 kDefaultTtlMsec;
+
+  // Queries differing only in case or whitespace give the same key.
+  static QString Key(const Song::Source source, const int type, const QString &query);
+
+  bool Contains(const QString &key) const;
+  // Returns false if there are no results for the key, or they're older than the TTL.
+  bool Get(const QString &key, SongMap *songs);
+  void Insert(const QString &key, const SongMap &songs);
+  void Clear();
+
+  int count() const { return static_cast<int>(cache_.count()); }
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    SongMap songs;
+    qint64 inserted_msec;
+  };
+
+  bool IsExpired(const Entry *entry) const;
+
+ private:
+  const qint64 ttl_msec_;
+  QCache<QString, Entry> cache_;
+  int hits_;
+  int misses_;
+};
+
+#endif  // STREAMINGSEARCHCACHE_H
@@ -108,7 +108,8 @@ StreamingSearchView::StreamingSearchView(QWidget *parent)
       search_type_(StreamingSearchView::SearchType::Artists),
       search_error_(false),
       last_search_id_(0),
-      searches_next_id_(1) {
+      searches_next_id_(1),
+      running_service_id_(-1) {
 
   ui_->setupUi(this);
 
@@ -212,6 +213,9 @@ void StreamingSearchView::ReloadSettings() {
 
   Settings s;
 
+  // The search limits might have changed.
+  search_cache_.Clear();
+
   // Collection settings
 
   s.beginGroup(service_->settings_group());
@@ -363,6 +367,7 @@ void StreamingSearchView::timerEvent(QTimerEvent *e) {
 
   QMap<int, DelayedSearch>::iterator it = delayed_searches_.find(e->timerId());
   if (it != delayed_searches_.end()) {
+    killTimer(e->timerId());
     SearchAsync(it.value().id_, it.value().query_, it.value().type_);
     delayed_searches_.erase(it);  // clazy:exclude=strict-iterators
     return;
@@ -396,11 +401,9 @@ void StreamingSearchView::TextEdited(const QString &text) {
   current_proxy_ = back_proxy_;
   swap_models_timer_->start();
 
-  // Cancel the last search (if any) and start the new one.
-  CancelSearch(last_search_id_);
-
   // If text query is empty, don't start a new search
   if (trimmed.isEmpty()) {
+    CancelSearch(last_search_id_);
     last_search_id_ = -1;
     ui_->label_helptext->setText(tr("Enter search terms above to find music"));
     ui_->label_status->clear();
@@ -466,8 +469,21 @@ bool StreamingSearchView::Matches(const QStringList &tokens, const QString &stri
 int StreamingSearchView::SearchAsync(const QString &query, const SearchType type) {
 
   const int id = searches_next_id_++;
+  const QString cache_key = StreamingSearchCache::Key(service_->source(), static_cast<int>(type), query);
+
+  // The same search is still running, wait for its results instead of searching again.
+  if (pending_searches_.contains(running_service_id_) && pending_searches_[running_service_id_].cache_key_ == cache_key) {
+    CancelDelayedSearch(last_search_id_);
+    pending_searches_[running_service_id_].orig_id_ = id;
+    return id;
+  }
 
-  int timer_id = startTimer(kDelayedSearchTimeoutMs);
+  // Cancel the last search if it's still waiting for the user to stop typing.
+  // A search that was already sent is left to finish into the cache, its results aren't shown since it's not the last search anymore.
+  CancelDelayedSearch(last_search_id_);
+
+  // Cached results don't need to wait for the user to stop typing.
+  int timer_id = startTimer(search_cache_.Contains(cache_key) ? 0 : kDelayedSearchTimeoutMs);
   delayed_searches_[timer_id].id_ = id;
   delayed_searches_[timer_id].query_ = query;
   delayed_searches_[timer_id].type_ = type;
@@ -478,8 +494,24 @@ int StreamingSearchView::SearchAsync(const QString &query, const SearchType type
 
 void StreamingSearchView::SearchAsync(const int id, const QString &query, const SearchType type) {
 
+  const QString cache_key = StreamingSearchCache::Key(service_->source(), static_cast<int>(type), query);
+
+  SongMap songs;
+  if (search_cache_.Get(cache_key, &songs)) {
+    ShowResults(id, songs, QString());
+    return;
+  }
+
+  // The services run one search at a time, so the new search replaces the one still running.
+  if (running_service_id_ != -1) {
+    pending_searches_.remove(running_service_id_);
+    running_service_id_ = -1;
+    service_->CancelSearch();
+  }
+
   const int service_id = service_->Search(query, type);
-  pending_searches_[service_id] = PendingState(id, TokenizeQuery(query));
+  pending_searches_[service_id] = PendingState(id, TokenizeQuery(query), cache_key);
+  running_service_id_ = service_id;
 
 }
 
@@ -489,7 +521,16 @@ void StreamingSearchView::SearchDone(const int service_id, const SongMap &songs,
 
   // Map back to the original id.
   const PendingState state = pending_searches_.take(service_id);
-  const int search_id = state.orig_id_;
+  if (service_id == running_service_id_) running_service_id_ = -1;
+
+  // Keep the results even if the user has moved on to another query, they might come back to it.
+  search_cache_.Insert(state.cache_key_, songs);
+
+  ShowResults(state.orig_id_, songs, error);
+
+}
+
+void StreamingSearchView::ShowResults(const int search_id, const SongMap &songs, const QString &error) {
 
   if (songs.isEmpty()) {
     SearchError(search_id, error);
@@ -515,15 +556,25 @@ void StreamingSearchView::SearchDone(const int service_id, const SongMap &songs,
 
 void StreamingSearchView::CancelSearch(const int id) {
 
+  if (CancelDelayedSearch(id)) return;
+
+  running_service_id_ = -1;
+  service_->CancelSearch();
+
+}
+
+bool StreamingSearchView::CancelDelayedSearch(const int id) {
+
   QMap<int, DelayedSearch>::iterator it;
   for (it = delayed_searches_.begin(); it != delayed_searches_.end(); ++it) {
     if (it.value().id_ == id) {
       killTimer(it.key());
       delayed_searches_.erase(it);  // clazy:exclude=strict-iterators
-      return;
+      return true;
     }
   }
-  service_->CancelSearch();
+
+  return false;
 
 }
 
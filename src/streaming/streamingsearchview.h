@@ -43,6 +43,7 @@
 #include "core/song.h"
 #include "collection/collectionmodel.h"
 #include "covermanager/albumcoverloaderresult.h"
+#include "streamingsearchcache.h"
 
 class QSortFilterProxyModel;
 class QMimeData;
@@ -91,9 +92,10 @@ class StreamingSearchView : public QWidget {
  protected:
   struct PendingState {
     PendingState() : orig_id_(-1) {}
-    PendingState(int orig_id, const QStringList &tokens) : orig_id_(orig_id), tokens_(tokens) {}
+    PendingState(int orig_id, const QStringList &tokens, const QString &cache_key = QString()) : orig_id_(orig_id), tokens_(tokens), cache_key_(cache_key) {}
     int orig_id_;
     QStringList tokens_;
+    QString cache_key_;
 
     bool operator<(const PendingState &b) const {
       return orig_id_ < b.orig_id_;
@@ -131,6 +133,8 @@ class StreamingSearchView : public QWidget {
   void SearchAsync(const int id, const QString &query, const SearchType type);
   void SearchError(const int id, const QString &error);
   void CancelSearch(const int id);
+  bool CancelDelayedSearch(const int id);
+  void ShowResults(const int id, const SongMap &songs, const QString &error);
 
   QString PixmapCacheKey(const Result &result) const;
   bool FindCachedPixmap(const Result &result, QPixmap *pixmap) const;
@@ -213,6 +217,10 @@ class StreamingSearchView : public QWidget {
   QMap<int, DelayedSearch> delayed_searches_;
   QMap<int, PendingState> pending_searches_;
 
+  StreamingSearchCache search_cache_;
+  // The service only runs one search at a time, this is the one it's running.
+  int running_service_id_;
+
   QMap<quint64, QPair<QModelIndex, QString>> cover_loader_tasks_;
 };
 Q_DECLARE_METATYPE(StreamingSearchView::Result)
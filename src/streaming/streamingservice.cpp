@@ -21,6 +21,7 @@
 #include <QString>
 
 #include "streamingservice.h"
+#include "streamingrequestscheduler.h"
 #include "core/song.h"
 #include "settings/settingsdialog.h"
 
@@ -33,4 +34,5 @@ StreamingService::StreamingService(const Song::Source source, const QString &nam
       name_(name),
       url_scheme_(url_scheme),
       settings_group_(settings_group),
-      settings_page_(settings_page) {}
+      settings_page_(settings_page),
+      request_scheduler_(new StreamingRequestScheduler(name, this)) {}
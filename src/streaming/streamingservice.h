@@ -25,6 +25,7 @@
 #include <QMetaType>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QUrl>
 #include <QIcon>
 
@@ -37,6 +38,7 @@ class Application;
 class CollectionBackend;
 class CollectionModel;
 class CollectionFilter;
+class StreamingRequestScheduler;
 
 class StreamingService : public QObject {
   Q_OBJECT
@@ -52,6 +54,7 @@ class StreamingService : public QObject {
   virtual QString url_scheme() const { return url_scheme_; }
   virtual QString settings_group() const { return settings_group_; }
   virtual SettingsDialog::Page settings_page() const { return settings_page_; }
+  StreamingRequestScheduler *request_scheduler() const { return request_scheduler_; }
   virtual bool has_initial_load_settings() const { return false; }
   virtual void InitialLoadSettings() {}
   virtual void ReloadSettings() {}
@@ -102,16 +105,19 @@ class StreamingService : public QObject {
   void UpdateProgress(const int max);
 
   void ArtistsResults(const SongMap &songs, const QString &error);
+  void ArtistsUpdated(const SongMap &songs, const QStringList &artist_ids, const bool prune, const QString &error);
   void ArtistsUpdateStatus(const QString &text);
   void ArtistsProgressSetMaximum(const int max);
   void ArtistsUpdateProgress(const int max);
 
   void AlbumsResults(const SongMap &songs, const QString &error);
+  void AlbumsUpdated(const SongMap &songs, const QStringList &album_ids, const bool prune, const QString &error);
   void AlbumsUpdateStatus(const QString &text);
   void AlbumsProgressSetMaximum(const int max);
   void AlbumsUpdateProgress(const int max);
 
   void SongsResults(const SongMap &songs, const QString &error);
+  void SongsUpdated(const SongMap &songs, const QStringList &song_ids, const bool prune, const QString &error);
   void SongsUpdateStatus(const QString &text);
   void SongsProgressSetMaximum(const int max);
   void SongsUpdateProgress(const int max);
@@ -142,6 +148,7 @@ class StreamingService : public QObject {
   QString url_scheme_;
   QString settings_group_;
   SettingsDialog::Page settings_page_;
+  StreamingRequestScheduler *request_scheduler_;
 };
 
 using StreamingServicePtr = SharedPtr<StreamingService>;
@@ -41,6 +41,7 @@
 #include "collection/collectionfilter.h"
 #include "collection/collectionfilterwidget.h"
 #include "streamingservice.h"
+#include "streamingfavoritessync.h"
 #include "streamingtabsview.h"
 #include "streamingcollectionview.h"
 #include "streamingcollectionviewcontainer.h"
@@ -78,9 +79,11 @@ StreamingTabsView::StreamingTabsView(Application *app, StreamingServicePtr servi
     QObject::connect(ui_->artists_collection->view(), &StreamingCollectionView::RemoveSongs, &*service_, &StreamingService::RemoveArtists);
 
     QObject::connect(ui_->artists_collection->button_refresh(), &QPushButton::clicked, this, &StreamingTabsView::GetArtists);
+    QObject::connect(ui_->artists_collection->action_resync(), &QAction::triggered, this, &StreamingTabsView::ResyncArtists);
     QObject::connect(ui_->artists_collection->button_close(), &QPushButton::clicked, this, &StreamingTabsView::AbortGetArtists);
     QObject::connect(ui_->artists_collection->button_abort(), &QPushButton::clicked, this, &StreamingTabsView::AbortGetArtists);
     QObject::connect(&*service_, &StreamingService::ArtistsResults, this, &StreamingTabsView::ArtistsFinished);
+    QObject::connect(&*service_, &StreamingService::ArtistsUpdated, this, &StreamingTabsView::ArtistsUpdated);
     QObject::connect(&*service_, &StreamingService::ArtistsUpdateStatus, ui_->artists_collection->status(), &QLabel::setText);
     QObject::connect(&*service_, &StreamingService::ArtistsProgressSetMaximum, ui_->artists_collection->progressbar(), &QProgressBar::setMaximum);
     QObject::connect(&*service_, &StreamingService::ArtistsUpdateProgress, ui_->artists_collection->progressbar(), &QProgressBar::setValue);
@@ -110,9 +113,11 @@ StreamingTabsView::StreamingTabsView(Application *app, StreamingServicePtr servi
     QObject::connect(ui_->albums_collection->view(), &StreamingCollectionView::RemoveSongs, &*service_, &StreamingService::RemoveAlbums);
 
     QObject::connect(ui_->albums_collection->button_refresh(), &QPushButton::clicked, this, &StreamingTabsView::GetAlbums);
+    QObject::connect(ui_->albums_collection->action_resync(), &QAction::triggered, this, &StreamingTabsView::ResyncAlbums);
     QObject::connect(ui_->albums_collection->button_close(), &QPushButton::clicked, this, &StreamingTabsView::AbortGetAlbums);
     QObject::connect(ui_->albums_collection->button_abort(), &QPushButton::clicked, this, &StreamingTabsView::AbortGetAlbums);
     QObject::connect(&*service_, &StreamingService::AlbumsResults, this, &StreamingTabsView::AlbumsFinished);
+    QObject::connect(&*service_, &StreamingService::AlbumsUpdated, this, &StreamingTabsView::AlbumsUpdated);
     QObject::connect(&*service_, &StreamingService::AlbumsUpdateStatus, ui_->albums_collection->status(), &QLabel::setText);
     QObject::connect(&*service_, &StreamingService::AlbumsProgressSetMaximum, ui_->albums_collection->progressbar(), &QProgressBar::setMaximum);
     QObject::connect(&*service_, &StreamingService::AlbumsUpdateProgress, ui_->albums_collection->progressbar(), &QProgressBar::setValue);
@@ -142,9 +147,11 @@ StreamingTabsView::StreamingTabsView(Application *app, StreamingServicePtr servi
     QObject::connect(ui_->songs_collection->view(), &StreamingCollectionView::RemoveSongs, &*service_, &StreamingService::RemoveSongsByList);
 
     QObject::connect(ui_->songs_collection->button_refresh(), &QPushButton::clicked, this, &StreamingTabsView::GetSongs);
+    QObject::connect(ui_->songs_collection->action_resync(), &QAction::triggered, this, &StreamingTabsView::ResyncSongs);
     QObject::connect(ui_->songs_collection->button_close(), &QPushButton::clicked, this, &StreamingTabsView::AbortGetSongs);
     QObject::connect(ui_->songs_collection->button_abort(), &QPushButton::clicked, this, &StreamingTabsView::AbortGetSongs);
     QObject::connect(&*service_, &StreamingService::SongsResults, this, &StreamingTabsView::SongsFinished);
+    QObject::connect(&*service_, &StreamingService::SongsUpdated, this, &StreamingTabsView::SongsUpdated);
     QObject::connect(&*service_, &StreamingService::SongsUpdateStatus, ui_->songs_collection->status(), &QLabel::setText);
     QObject::connect(&*service_, &StreamingService::SongsProgressSetMaximum, ui_->songs_collection->progressbar(), &QProgressBar::setMaximum);
     QObject::connect(&*service_, &StreamingService::SongsUpdateProgress, ui_->songs_collection->progressbar(), &QProgressBar::setValue);
@@ -258,6 +265,13 @@ void StreamingTabsView::AbortGetArtists() {
 
 }
 
+void StreamingTabsView::ResyncArtists() {
+
+  StreamingFavoritesSync::ClearCursor(service_->settings_group(), StreamingFavoritesSync::Type::Artists);
+  GetArtists();
+
+}
+
 void StreamingTabsView::ArtistsFinished(const SongMap &songs, const QString &error) {
 
   if (songs.isEmpty() && !error.isEmpty()) {
@@ -275,6 +289,19 @@ void StreamingTabsView::ArtistsFinished(const SongMap &songs, const QString &err
 
 }
 
+void StreamingTabsView::ArtistsUpdated(const SongMap &songs, const QStringList &artist_ids, const bool prune, const QString &error) {
+
+  if (songs.isEmpty() && !error.isEmpty()) {
+    ArtistsFinished(songs, error);
+    return;
+  }
+
+  ui_->artists_collection->stacked()->setCurrentWidget(ui_->artists_collection->streamingcollection_page());
+  ui_->artists_collection->status()->clear();
+  service_->artists_collection_backend()->MergeSongsBySongIDAsync(songs, prune ? QStringLiteral("artist_id") : QString(), artist_ids);
+
+}
+
 void StreamingTabsView::GetAlbums() {
 
   if (!service_->authenticated() && service_->oauth()) {
@@ -300,6 +327,13 @@ void StreamingTabsView::AbortGetAlbums() {
 
 }
 
+void StreamingTabsView::ResyncAlbums() {
+
+  StreamingFavoritesSync::ClearCursor(service_->settings_group(), StreamingFavoritesSync::Type::Albums);
+  GetAlbums();
+
+}
+
 void StreamingTabsView::AlbumsFinished(const SongMap &songs, const QString &error) {
 
   if (songs.isEmpty() && !error.isEmpty()) {
@@ -317,6 +351,19 @@ void StreamingTabsView::AlbumsFinished(const SongMap &songs, const QString &erro
 
 }
 
+void StreamingTabsView::AlbumsUpdated(const SongMap &songs, const QStringList &album_ids, const bool prune, const QString &error) {
+
+  if (songs.isEmpty() && !error.isEmpty()) {
+    AlbumsFinished(songs, error);
+    return;
+  }
+
+  ui_->albums_collection->stacked()->setCurrentWidget(ui_->albums_collection->streamingcollection_page());
+  ui_->albums_collection->status()->clear();
+  service_->albums_collection_backend()->MergeSongsBySongIDAsync(songs, prune ? QStringLiteral("album_id") : QString(), album_ids);
+
+}
+
 void StreamingTabsView::GetSongs() {
 
   if (!service_->authenticated() && service_->oauth()) {
@@ -342,6 +389,13 @@ void StreamingTabsView::AbortGetSongs() {
 
 }
 
+void StreamingTabsView::ResyncSongs() {
+
+  StreamingFavoritesSync::ClearCursor(service_->settings_group(), StreamingFavoritesSync::Type::Songs);
+  GetSongs();
+
+}
+
 void StreamingTabsView::SongsFinished(const SongMap &songs, const QString &error) {
 
   if (songs.isEmpty() && !error.isEmpty()) {
@@ -359,6 +413,19 @@ void StreamingTabsView::SongsFinished(const SongMap &songs, const QString &error
 
 }
 
+void StreamingTabsView::SongsUpdated(const SongMap &songs, const QStringList &song_ids, const bool prune, const QString &error) {
+
+  if (songs.isEmpty() && !error.isEmpty()) {
+    SongsFinished(songs, error);
+    return;
+  }
+
+  ui_->songs_collection->stacked()->setCurrentWidget(ui_->songs_collection->streamingcollection_page());
+  ui_->songs_collection->status()->clear();
+  service_->songs_collection_backend()->MergeSongsBySongIDAsync(songs, prune ? QStringLiteral("song_id") : QString(), song_ids);
+
+}
+
 void StreamingTabsView::OpenSettingsDialog() {
   app_->OpenSettingsDialogAtPage(service_->settings_page());
 }
@@ -26,6 +26,7 @@
 #include <QWidget>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 
 #include "core/shared_ptr.h"
 #include "settings/settingsdialog.h"
@@ -65,9 +66,15 @@ class StreamingTabsView : public QWidget {
   void AbortGetArtists();
   void AbortGetAlbums();
   void AbortGetSongs();
+  void ResyncArtists();
+  void ResyncAlbums();
+  void ResyncSongs();
   void ArtistsFinished(const SongMap &songs, const QString &error);
   void AlbumsFinished(const SongMap &songs, const QString &error);
   void SongsFinished(const SongMap &songs, const QString &error);
+  void ArtistsUpdated(const SongMap &songs, const QStringList &artist_ids, const bool prune, const QString &error);
+  void AlbumsUpdated(const SongMap &songs, const QStringList &album_ids, const bool prune, const QString &error);
+  void SongsUpdated(const SongMap &songs, const QStringList &song_ids, const bool prune, const QString &error);
 
  private:
   Application *app_;
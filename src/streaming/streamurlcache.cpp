@@ -0,0 +1,149 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QList>
+#include <QPair>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QDateTime>
+
+#include "core/urlhandler.h"
+#include "streamurlcache.h"
+
+const qint64 StreamURLCache::kDefaultLifetimeMsec = 120000;
+const qint64 StreamURLCache::kMaxLifetimeMsec = 600000;
+const qint64 StreamURLCache::kExpiryMarginMsec = 30000;
+const int StreamURLCache::kMaxEntries = 16;
+
+StreamURLCache::StreamURLCache() : hits_(0), misses_(0), saved_msec_(0) {}
+
+QDateTime StreamURLCache::ExpiryFromUrl(const QUrl &stream_url) {
+
+  const QUrlQuery url_query(stream_url);
+  const QList<QPair<QString, QString>> items = url_query.queryItems();
+  for (const QPair<QString, QString> &item : items) {
+    const QString key = item.first.toLower();
+    bool ok = false;
+    // Qobuz uses etsp, signed CDN URLs use Expires.
+    if (key == QLatin1String("etsp") || key == QLatin1String("expires")) {
+      const qint64 secs = item.second.toLongLong(&ok);
+      if (ok && secs > 0) return QDateTime::fromSecsSinceEpoch(secs);
+    }
+    // Akamai style tokens have the expiry as exp=<seconds> inside the token value.
+    if (key.contains(QLatin1String("token")) || key == QLatin1String("hdnea") || key == QLatin1String("hdnts")) {
+      const QStringList fields = QUrl::fromPercentEncoding(item.second.toUtf8()).split(QLatin1Char('~'));
+      for (const QString &field : fields) {
+        if (!field.startsWith(QLatin1String("exp="))) continue;
+        const qint64 secs = field.mid(4).toLongLong(&ok);
+        if (ok && secs > 0) return QDateTime::fromSecsSinceEpoch(secs);
+      }
+    }
+  }
+
+  return QDateTime();
+
+}
+
+void StreamURLCache::Insert(const UrlHandler::LoadResult &result, const qint64 resolve_msec) {
+
+  if (result.type_ != UrlHandler::LoadResult::Type::TrackAvailable || !result.media_url_.isValid() || !result.stream_url_.isValid()) return;
+
+  const qint64 now_msec = QDateTime::currentMSecsSinceEpoch();
+  const QDateTime expiry = ExpiryFromUrl(result.stream_url_);
+
+  Entry entry;
+  entry.result = result;
+  entry.resolve_msec = resolve_msec;
+  entry.expires_msec = expiry.isValid() ? std::min(expiry.toMSecsSinceEpoch() - kExpiryMarginMsec, now_msec + kMaxLifetimeMsec) : now_msec + kDefaultLifetimeMsec;
+  if (entry.expires_msec <= now_msec) return;
+
+  RemoveExpired();
+
+  // Make room by dropping the entry closest to expiring.
+  while (entries_.count() >= kMaxEntries && !entries_.contains(result.media_url_)) {
+    QHash<QUrl, Entry>::iterator oldest = entries_.begin();
+    for (QHash<QUrl, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->expires_msec < oldest->expires_msec) oldest = it;
+    }
+    entries_.erase(oldest);
+  }
+
+  entries_.insert(result.media_url_, entry);
+
+}
+
+bool StreamURLCache::Contains(const QUrl &media_url) {
+
+  RemoveExpired();
+  return entries_.contains(media_url);
+
+}
+
+UrlHandler::LoadResult StreamURLCache::Take(const QUrl &media_url) {
+
+  RemoveExpired();
+
+  if (!entries_.contains(media_url)) return UrlHandler::LoadResult(media_url);
+
+  const Entry entry = entries_.take(media_url);
+  RecordHit(entry.resolve_msec);
+
+  return entry.result;
+
+}
+
+void StreamURLCache::Clear() {
+  entries_.clear();
+}
+
+void StreamURLCache::RecordHit(const qint64 saved_msec) {
+
+  ++hits_;
+  saved_msec_ += std::max(static_cast<qint64>(0), saved_msec);
+
+}
+
+int StreamURLCache::hit_rate_percent() const {
+
+  if (hits_ + misses_ == 0) return 0;
+  return hits_ * 100 / (hits_ + misses_);
+
+}
+
+void StreamURLCache::RemoveExpired() {
+
+  const qint64 now_msec = QDateTime::currentMSecsSinceEpoch();
+  for (QHash<QUrl, Entry>::iterator it = entries_.begin(); it != entries_.end();) {
+    if (it->expires_msec <= now_msec) {
+      it = entries_.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+}
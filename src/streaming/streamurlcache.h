@@ -0,0 +1,80 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STREAMURLCACHE_H
+#define STREAMURLCACHE_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QHash>
+#include <QUrl>
+#include <QDateTime>
+
+#include "core/urlhandler.h"
+
+// Stream URLs resolved ahead of time for upcoming playlist items, keyed by the media URL.
+// Streaming services sign the URLs with an expiry time, entries are dropped a little before they expire.
+// Each entry can only be used once, the player keeps the stream URL as temporary metadata after that.
+class StreamURLCache {
+ public:
+  explicit StreamURLCache();
+
+  static const qint64 kDefaultLifetimeMsec;
+  static const qint64 kMaxLifetimeMsec;
+  static const qint64 kExpiryMarginMsec;
+  static const int kMaxEntries;
+
+  // Returns the expiry time signed into the stream URL, or an invalid QDateTime if it's unknown.
+  static QDateTime ExpiryFromUrl(const QUrl &stream_url);
+
+  // resolve_msec is how long it took to get the stream URL, which is saved each time the entry is used.
+  void Insert(const UrlHandler::LoadResult &result, const qint64 resolve_msec);
+  bool Contains(const QUrl &media_url);
+  // Returns and removes the entry, the type is NoMoreTracks if there's no valid entry for the media URL.
+  UrlHandler::LoadResult Take(const QUrl &media_url);
+  void Clear();
+
+  int count() const { return static_cast<int>(entries_.count()); }
+
+  void RecordHit(const qint64 saved_msec);
+  void RecordMiss() { ++misses_; }
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+  int hit_rate_percent() const;
+  qint64 saved_msec() const { return saved_msec_; }
+
+ private:
+  struct Entry {
+    Entry() : expires_msec(0), resolve_msec(0) {}
+    UrlHandler::LoadResult result;
+    qint64 expires_msec;
+    qint64 resolve_msec;
+  };
+
+  void RemoveExpired();
+
+ private:
+  QHash<QUrl, Entry> entries_;
+  int hits_;
+  int misses_;
+  qint64 saved_msec_;
+};
+
+#endif  // STREAMURLCACHE_H
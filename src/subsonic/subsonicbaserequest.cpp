@@ -38,6 +38,7 @@
 #include <QJsonValue>
 
 #include "utilities/randutils.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "subsonicservice.h"
 #include "subsonicbaserequest.h"
 
@@ -111,6 +112,7 @@ QNetworkReply *SubsonicBaseRequest::CreateGetRequest(const QString &ressource_na
 #endif
 
   QNetworkReply *reply = network_->get(req);
+  service_->request_scheduler()->RequestStarted(reply);
   QObject::connect(reply, &QNetworkReply::sslErrors, this, &SubsonicBaseRequest::HandleSSLErrors);
 
   //qLog(Debug) << "Subsonic: Sending request" << url;
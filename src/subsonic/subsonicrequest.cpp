@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <utility>
+
 #include <QObject>
 #include <QDir>
 #include <QMimeDatabase>
@@ -45,17 +47,12 @@
 #include "core/networktimeouts.h"
 #include "utilities/imageutils.h"
 #include "utilities/timeconstants.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "subsonicservice.h"
 #include "subsonicurlhandler.h"
 #include "subsonicbaserequest.h"
 #include "subsonicrequest.h"
 
-namespace {
-constexpr int kMaxConcurrentAlbumsRequests = 3;
-constexpr int kMaxConcurrentAlbumSongsRequests = 3;
-constexpr int kMaxConcurrentAlbumCoverRequests = 1;
-}  // namespace
-
 SubsonicRequest::SubsonicRequest(SubsonicService *service, SubsonicUrlHandler *url_handler, Application *app, QObject *parent)
     : SubsonicBaseRequest(service, parent),
       service_(service),
@@ -64,7 +61,10 @@ SubsonicRequest::SubsonicRequest(SubsonicService *service, SubsonicUrlHandler *u
       network_(new QNetworkAccessManager(this)),
       timeouts_(new NetworkTimeouts(30000, this)),
       finished_(false),
+      bulk_songs_(false),
+      albums_song_count_(0),
       albums_requests_active_(0),
+      search_songs_requests_active_(0),
       album_songs_requests_active_(0),
       album_songs_requested_(0),
       album_songs_received_(0),
@@ -75,6 +75,8 @@ SubsonicRequest::SubsonicRequest(SubsonicService *service, SubsonicUrlHandler *u
 
   network_->setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
 
+  QObject::connect(service_->request_scheduler(), &StreamingRequestScheduler::RequestsAvailable, this, &SubsonicRequest::FlushRequests);
+
 }
 
 SubsonicRequest::~SubsonicRequest() {
@@ -98,14 +100,20 @@ SubsonicRequest::~SubsonicRequest() {
 void SubsonicRequest::Reset() {
 
   finished_ = false;
+  bulk_songs_ = false;
 
   albums_requests_queue_.clear();
+  search_songs_requests_queue_.clear();
   album_songs_requests_queue_.clear();
   album_cover_requests_queue_.clear();
   album_songs_requests_pending_.clear();
+  albums_.clear();
+  albums_song_count_ = 0;
+  search_song_ids_.clear();
   album_covers_requests_sent_.clear();
 
   albums_requests_active_ = 0;
+  search_songs_requests_active_ = 0;
   album_songs_requests_active_ = 0;
   album_songs_requested_ = 0;
   album_songs_received_ = 0;
@@ -122,6 +130,17 @@ void SubsonicRequest::Reset() {
 
 }
 
+void SubsonicRequest::FlushRequests() {
+
+  if (finished_) return;
+
+  if (!albums_requests_queue_.isEmpty()) FlushAlbumsRequests();
+  if (!search_songs_requests_queue_.isEmpty()) FlushSearchSongsRequests();
+  if (!album_songs_requests_queue_.isEmpty()) FlushAlbumSongsRequests();
+  if (!album_cover_requests_queue_.isEmpty()) FlushAlbumCoverRequests();
+
+}
+
 void SubsonicRequest::GetAlbums() {
 
   emit UpdateStatus(tr("Retrieving albums..."));
@@ -136,13 +155,13 @@ void SubsonicRequest::AddAlbumsRequest(const int offset, const int size) {
   request.size = size;
   request.offset = offset;
   albums_requests_queue_.enqueue(request);
-  if (albums_requests_active_ < kMaxConcurrentAlbumsRequests) FlushAlbumsRequests();
+  if (service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) FlushAlbumsRequests();
 
 }
 
 void SubsonicRequest::FlushAlbumsRequests() {
 
-  while (!albums_requests_queue_.isEmpty() && albums_requests_active_ < kMaxConcurrentAlbumsRequests) {
+  while (!albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = albums_requests_queue_.dequeue();
     ++albums_requests_active_;
@@ -280,9 +299,14 @@ void SubsonicRequest::AlbumsReplyReceived(QNetworkReply *reply, const int offset
 
     if (album_songs_requests_pending_.contains(album_id)) continue;
 
+    albums_song_count_ += obj_album[QLatin1String("songCount")].toInt();
+
     Request request;
     request.album_id = album_id;
     request.album_artist = artist;
+    if (obj_album.contains(QLatin1String("created"))) {
+      request.created = QDateTime::fromString(obj_album[QLatin1String("created")].toString(), Qt::ISODate).toSecsSinceEpoch();
+    }
     album_songs_requests_pending_.insert(album_id, request);
 
   }
@@ -302,28 +326,267 @@ void SubsonicRequest::AlbumsFinishCheck(const int offset, const int size, const
     }
   }
 
-  if (!albums_requests_queue_.isEmpty() && albums_requests_active_ < kMaxConcurrentAlbumsRequests) FlushAlbumsRequests();
+  if (!albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) FlushAlbumsRequests();
 
   if (albums_requests_queue_.isEmpty() && albums_requests_active_ <= 0) { // Albums list is finished, get songs for all albums.
+    if (bulk_songs_) {
+      albums_.swap(album_songs_requests_pending_);
+      emit UpdateStatus(tr("Retrieving songs..."));
+      AddSearchSongsRequest();
+    }
+    else {
+      GetAlbumSongs();
+    }
+  }
+
+  FinishCheck();
+
+}
+
+void SubsonicRequest::GetAlbumSongs() {
+
+  for (QHash<QString, Request> ::iterator it = album_songs_requests_pending_.begin(); it != album_songs_requests_pending_.end(); ++it) {
+    Request request = it.value();
+    AddAlbumSongsRequest(request.artist_id, request.album_id, request.album_artist);
+  }
+  album_songs_requests_pending_.clear();
+
+  if (album_songs_requested_ > 0) {
+    if (album_songs_requested_ == 1) emit UpdateStatus(tr("Retrieving songs for %1 album...").arg(album_songs_requested_));
+    else emit UpdateStatus(tr("Retrieving songs for %1 albums...").arg(album_songs_requested_));
+    emit ProgressSetMaximum(album_songs_requested_);
+    emit UpdateProgress(0);
+  }
+
+}
+
+void SubsonicRequest::GetSongs() {
+
+  // search3 doesn't have the album artist, so get it from the album list before the songs.
+  bulk_songs_ = true;
+  GetAlbums();
+
+}
+
+void SubsonicRequest::AddSearchSongsRequest(const int offset, const int size) {
+
+  Request request;
+  request.size = size;
+  request.offset = offset;
+  search_songs_requests_queue_.enqueue(request);
+  if (service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) FlushSearchSongsRequests();
+
+}
+
+void SubsonicRequest::FlushSearchSongsRequests() {
+
+  while (!search_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
+
+    Request request = search_songs_requests_queue_.dequeue();
+    ++search_songs_requests_active_;
+
+    ParamList params = ParamList() << Param(QStringLiteral("query"), QString())
+                                   << Param(QStringLiteral("artistCount"), QStringLiteral("0"))
+                                   << Param(QStringLiteral("albumCount"), QStringLiteral("0"))
+                                   << Param(QStringLiteral("songCount"), QString::number(request.size));
+    if (request.offset > 0) params << Param(QStringLiteral("songOffset"), QString::number(request.offset));
 
-    for (QHash<QString, Request> ::iterator it = album_songs_requests_pending_.begin(); it != album_songs_requests_pending_.end(); ++it) {
-      Request request = it.value();
-      AddAlbumSongsRequest(request.artist_id, request.album_id, request.album_artist);
+    QNetworkReply *reply = CreateGetRequest(QStringLiteral("search3"), params);
+    replies_ << reply;
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, request]() { SearchSongsReplyReceived(reply, request.offset, request.size); });
+    timeouts_->AddReply(reply);
+
+  }
+
+}
+
+void SubsonicRequest::SearchSongsReplyReceived(QNetworkReply *reply, const int offset_requested, const int size_requested) {
+
+  if (!replies_.contains(reply)) return;
+  replies_.removeAll(reply);
+  QObject::disconnect(reply, nullptr, this, nullptr);
+  reply->deleteLater();
+
+  --search_songs_requests_active_;
+
+  QByteArray data = GetReplyData(reply);
+
+  if (finished_) return;
+
+  if (data.isEmpty()) {
+    SearchSongsFinishCheck(offset_requested, size_requested);
+    return;
+  }
+
+  QJsonObject json_obj = ExtractJsonObj(data);
+  if (json_obj.isEmpty()) {
+    SearchSongsFinishCheck(offset_requested, size_requested);
+    return;
+  }
+
+  if (json_obj.contains(QLatin1String("error"))) {
+    QJsonValue json_error = json_obj[QLatin1String("error")];
+    if (!json_error.isObject()) {
+      Error(QStringLiteral("Json error is not an object."), json_obj);
+      SearchSongsFinishCheck(offset_requested, size_requested);
+      return;
+    }
+    json_obj = json_error.toObject();
+    if (!json_obj.isEmpty() && json_obj.contains(QLatin1String("code")) && json_obj.contains(QLatin1String("message"))) {
+      int code = json_obj[QLatin1String("code")].toInt();
+      QString message = json_obj[QLatin1String("message")].toString();
+      // Not all servers allow an empty search query, get the songs for each album in the album list instead.
+      if (offset_requested == 0) {
+        Warn(QStringLiteral("Bulk song retrieval is not supported by the server: %1 (%2)").arg(message).arg(code));
+        bulk_songs_ = false;
+        album_songs_requests_pending_.swap(albums_);
+        GetAlbumSongs();
+        SongsFinishCheck();
+        return;
+      }
+      Error(QStringLiteral("%1 (%2)").arg(message).arg(code));
+      SearchSongsFinishCheck(offset_requested, size_requested);
     }
-    album_songs_requests_pending_.clear();
+    else {
+      Error(QStringLiteral("Json error object is missing code or message."), json_obj);
+      SearchSongsFinishCheck(offset_requested, size_requested);
+    }
+    return;
+  }
 
-    if (album_songs_requested_ > 0) {
-      if (album_songs_requested_ == 1) emit UpdateStatus(tr("Retrieving songs for %1 album...").arg(album_songs_requested_));
-      else emit UpdateStatus(tr("Retrieving songs for %1 albums...").arg(album_songs_requested_));
-      emit ProgressSetMaximum(album_songs_requested_);
-      emit UpdateProgress(0);
+  if (!json_obj.contains(QLatin1String("searchResult3"))) {
+    Error(QStringLiteral("Json reply is missing searchResult3."), json_obj);
+    SearchSongsFinishCheck(offset_requested, size_requested);
+    return;
+  }
+  QJsonValue value_searchresult = json_obj[QLatin1String("searchResult3")];
+  if (!value_searchresult.isObject()) {
+    Error(QStringLiteral("Json search result is not an object."), value_searchresult);
+    SearchSongsFinishCheck(offset_requested, size_requested);
+    return;
+  }
+  json_obj = value_searchresult.toObject();
+
+  // The song array is left out when there are no more songs.
+  if (!json_obj.contains(QLatin1String("song")) || json_obj[QLatin1String("song")].isNull()) {
+    if (offset_requested == 0) no_results_ = true;
+    SearchSongsFinishCheck(offset_requested, size_requested);
+    return;
+  }
+  QJsonValue json_song = json_obj[QLatin1String("song")];
+  if (!json_song.isArray()) {
+    Error(QStringLiteral("Json song is not an array."), json_obj);
+    SearchSongsFinishCheck(offset_requested, size_requested);
+    return;
+  }
+  QJsonArray array_songs = json_song.toArray();
+
+  int songs_received = 0;
+  int songs_added = 0;
+  for (const QJsonValueRef value_song : array_songs) {
+
+    ++songs_received;
+
+    if (!value_song.isObject()) {
+      Error(QStringLiteral("Invalid Json reply, track is not a object."));
+      continue;
+    }
+
+    const QJsonObject obj_song = value_song.toObject();
+    const QString song_id = obj_song[QLatin1String("id")].toVariant().toString();
+    if (!search_song_ids_.contains(song_id)) {
+      search_song_ids_.insert(song_id);
+      ++songs_added;
     }
+    const QString album_id = obj_song[QLatin1String("albumId")].toVariant().toString();
+    const Request album = albums_.value(album_id);
+
+    Song song(Song::Source::Subsonic);
+    ParseSong(song, obj_song, album.artist_id, album_id, album.album_artist, album.created);
+    if (!song.is_valid()) continue;
+    songs_.insert(song.song_id(), song);
+
+  }
+
+  emit UpdateStatus(tr("Retrieved %1 songs...").arg(songs_.count()));
+
+  SearchSongsFinishCheck(offset_requested, size_requested, songs_received, songs_added);
+
+}
+
+int SubsonicRequest::NextSearchSongsOffset(const int offset, const int size, const int songs_received, const int songs_added, const int songs_expected) {
+
+  // Some servers return fewer songs than requested per page, so keep going until a page is empty.
+  if (songs_received <= 0 || songs_added <= 0) return -1;
+
+  const int offset_next = offset + songs_received;
+
+  // The song counts of the albums aren't always exact, so allow one more page.
+  if (songs_expected > 0 && offset_next >= songs_expected + size) return -1;
+
+  return offset_next;
+
+}
+
+void SubsonicRequest::SearchSongsFinishCheck(const int offset, const int size, const int songs_received, const int songs_added) {
+
+  if (finished_) return;
+
+  const int offset_next = NextSearchSongsOffset(offset, size, songs_received, songs_added, albums_song_count_);
+  if (offset_next > 0) {
+    AddSearchSongsRequest(offset_next, size);
+  }
+  else if (songs_received > 0 && songs_added <= 0) {
+    Warn(QStringLiteral("Server returned no new songs at offset %1, stopping.").arg(offset));
+  }
+
+  if (!search_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) FlushSearchSongsRequests();
+
+  if (search_songs_requests_queue_.isEmpty() && search_songs_requests_active_ <= 0) {
+    DetectAlbums();
+    SongsFinishCheck();
+    return;
   }
 
   FinishCheck();
 
 }
 
+// Does the same compilation and multi-disc detection as when the songs are received per album.
+void SubsonicRequest::DetectAlbums() {
+
+  QHash<QString, SongList> album_songs;
+  for (const Song &song : std::as_const(songs_)) {
+    if (!song.album_id().isEmpty()) album_songs[song.album_id()] << song;
+  }
+
+  for (QHash<QString, SongList>::iterator it = album_songs.begin(); it != album_songs.end(); ++it) {
+    DetectAlbum(it.value());
+    for (const Song &song : std::as_const(it.value())) {
+      songs_.insert(song.song_id(), song);
+    }
+  }
+
+}
+
+void SubsonicRequest::DetectAlbum(SongList &songs) {
+
+  bool compilation = false;
+  bool multidisc = false;
+  for (const Song &song : std::as_const(songs)) {
+    if (song.disc() >= 2) multidisc = true;
+    if (song.is_compilation()) compilation = true;
+  }
+
+  for (Song &song : songs) {
+    if (compilation) song.set_compilation_detected(true);
+    if (!multidisc) {
+      song.set_disc(0);
+    }
+  }
+
+}
+
 void SubsonicRequest::AddAlbumSongsRequest(const QString &artist_id, const QString &album_id, const QString &album_artist, const int offset) {
 
   Request request;
@@ -333,13 +596,13 @@ void SubsonicRequest::AddAlbumSongsRequest(const QString &artist_id, const QStri
   request.offset = offset;
   album_songs_requests_queue_.enqueue(request);
   ++album_songs_requested_;
-  if (album_songs_requests_active_ < kMaxConcurrentAlbumSongsRequests) FlushAlbumSongsRequests();
+  if (service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) FlushAlbumSongsRequests();
 
 }
 
 void SubsonicRequest::FlushAlbumSongsRequests() {
 
-  while (!album_songs_requests_queue_.isEmpty() && album_songs_requests_active_ < kMaxConcurrentAlbumSongsRequests) {
+  while (!album_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = album_songs_requests_queue_.dequeue();
     ++album_songs_requests_active_;
@@ -432,8 +695,6 @@ void SubsonicRequest::AlbumSongsReplyReceived(QNetworkReply *reply, const QStrin
     created = QDateTime::fromString(obj_album[QLatin1String("created")].toString(), Qt::ISODate).toSecsSinceEpoch();
   }
 
-  bool compilation = false;
-  bool multidisc = false;
   SongList songs;
   for (const QJsonValueRef value_song : array_songs) {
 
@@ -446,16 +707,11 @@ void SubsonicRequest::AlbumSongsReplyReceived(QNetworkReply *reply, const QStrin
     Song song(Song::Source::Subsonic);
     ParseSong(song, obj_song, artist_id, album_id, album_artist, created);
     if (!song.is_valid()) continue;
-    if (song.disc() >= 2) multidisc = true;
-    if (song.is_compilation()) compilation = true;
     songs << song;
   }
 
-  for (Song song : songs) {
-    if (compilation) song.set_compilation_detected(true);
-    if (!multidisc) {
-      song.set_disc(0);
-    }
+  DetectAlbum(songs);
+  for (const Song &song : std::as_const(songs)) {
     songs_.insert(song.song_id(), song);
   }
 
@@ -467,7 +723,7 @@ void SubsonicRequest::SongsFinishCheck() {
 
   if (finished_) return;
 
-  if (!album_songs_requests_queue_.isEmpty() && album_songs_requests_active_ < kMaxConcurrentAlbumSongsRequests) FlushAlbumSongsRequests();
+  if (!album_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) FlushAlbumSongsRequests();
 
   if (
       download_album_covers() &&
@@ -735,7 +991,7 @@ void SubsonicRequest::AddAlbumCoverRequest(const Song &song) {
 
 void SubsonicRequest::FlushAlbumCoverRequests() {
 
-  while (!album_cover_requests_queue_.isEmpty() && album_covers_requests_active_ < kMaxConcurrentAlbumCoverRequests) {
+  while (!album_cover_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Covers)) {
 
     AlbumCoverRequest request = album_cover_requests_queue_.dequeue();
     ++album_covers_requests_active_;
@@ -754,6 +1010,7 @@ void SubsonicRequest::FlushAlbumCoverRequests() {
     }
 
     QNetworkReply *reply = network_->get(req);
+    service_->request_scheduler()->RequestStarted(reply, StreamingRequestScheduler::Category::Covers);
     album_cover_replies_ << reply;
     QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, request]() { AlbumCoverReceived(reply, request); });
     timeouts_->AddReply(reply);
@@ -851,7 +1108,7 @@ void SubsonicRequest::AlbumCoverReceived(QNetworkReply *reply, const AlbumCoverR
 
 void SubsonicRequest::AlbumCoverFinishCheck() {
 
-  if (!album_cover_requests_queue_.isEmpty() && album_covers_requests_active_ < kMaxConcurrentAlbumCoverRequests) {
+  if (!album_cover_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Covers)) {
     FlushAlbumCoverRequests();
   }
 
@@ -864,11 +1121,13 @@ void SubsonicRequest::FinishCheck() {
   if (
       !finished_ &&
       albums_requests_queue_.isEmpty() &&
+      search_songs_requests_queue_.isEmpty() &&
       album_songs_requests_queue_.isEmpty() &&
       album_cover_requests_queue_.isEmpty() &&
       album_songs_requests_pending_.isEmpty() &&
       album_covers_requests_sent_.isEmpty() &&
       albums_requests_active_ <= 0 &&
+      search_songs_requests_active_ <= 0 &&
       album_songs_requests_active_ <= 0 &&
       album_songs_received_ >= album_songs_requested_ &&
       album_covers_requests_active_ <= 0 &&
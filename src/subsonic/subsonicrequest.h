@@ -57,17 +57,30 @@ class SubsonicRequest : public SubsonicBaseRequest {
   void ReloadSettings();
 
   void GetAlbums();
+  // Gets all songs by paging search3 with an empty query instead of requesting each album.
+  // The album list is still retrieved first for the album artist and date of the songs.
+  void GetSongs();
   void Reset();
 
+  // Marks all songs of an album as a compilation if one of them is, and clears the disc if the album has a single disc.
+  // Used both for the songs received per album and in bulk.
+  static void DetectAlbum(SongList &songs);
+
+  // Returns the offset of the next search3 page, or -1 when the songs are complete.
+  // Stops when a page adds no new songs, a server ignoring songOffset returns the same page forever,
+  // and when well past the song count of the albums if known.
+  static int NextSearchSongsOffset(const int offset, const int size, const int songs_received, const int songs_added, const int songs_expected);
+
  private:
   struct Request {
-    explicit Request() : offset(0), size(0) {}
+    explicit Request() : offset(0), size(0), created(0) {}
     QString artist_id;
     QString album_id;
     QString song_id;
     int offset;
     int size;
     QString album_artist;
+    qint64 created;
   };
   struct AlbumCoverRequest {
     QString artist_id;
@@ -84,7 +97,9 @@ class SubsonicRequest : public SubsonicBaseRequest {
   void UpdateProgress(const int progress);
 
  private slots:
+  void FlushRequests();
   void AlbumsReplyReceived(QNetworkReply *reply, const int offset_requested, const int size_requested);
+  void SearchSongsReplyReceived(QNetworkReply *reply, const int offset_requested, const int size_requested);
   void AlbumSongsReplyReceived(QNetworkReply *reply, const QString &artist_id, const QString &album_id, const QString &album_artist);
   void AlbumCoverReceived(QNetworkReply *reply, const AlbumCoverRequest &request);
 
@@ -94,6 +109,12 @@ class SubsonicRequest : public SubsonicBaseRequest {
   void FlushAlbumsRequests();
 
   void AlbumsFinishCheck(const int offset = 0, const int size = 0, const int albums_received = 0);
+  void GetAlbumSongs();
+
+  void AddSearchSongsRequest(const int offset = 0, const int size = 500);
+  void FlushSearchSongsRequests();
+  void SearchSongsFinishCheck(const int offset = 0, const int size = 0, const int songs_received = 0, const int songs_added = 0);
+  void DetectAlbums();
   void SongsFinishCheck();
 
   void AddAlbumSongsRequest(const QString &artist_id, const QString &album_id, const QString &album_artist, const int offset = 0);
@@ -117,15 +138,24 @@ class SubsonicRequest : public SubsonicBaseRequest {
   NetworkTimeouts *timeouts_;
 
   bool finished_;
+  bool bulk_songs_;
 
   QQueue<Request> albums_requests_queue_;
+  QQueue<Request> search_songs_requests_queue_;
   QQueue<Request> album_songs_requests_queue_;
   QQueue<AlbumCoverRequest> album_cover_requests_queue_;
 
   QHash<QString, Request> album_songs_requests_pending_;
+  // The album list when getting songs in bulk, for the album artist and date.
+  QHash<QString, Request> albums_;
+  // Total of the song counts in the album list, 0 if the server doesn't have them.
+  int albums_song_count_;
+  // IDs of the songs received from search3, to notice a page that was already received.
+  QSet<QString> search_song_ids_;
   QMultiMap<QString, QString> album_covers_requests_sent_;
 
   int albums_requests_active_;
+  int search_songs_requests_active_;
 
   int album_songs_requests_active_;
   int album_songs_requested_;
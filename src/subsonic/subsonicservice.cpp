@@ -80,6 +80,7 @@ SubsonicService::SubsonicService(Application *app, QObject *parent)
       http2_(false),
       verify_certificate_(false),
       download_album_covers_(true),
+      bulk_sync_(false),
       auth_method_(SubsonicSettingsPage::AuthMethod::MD5),
       ping_redirects_(0) {
 
@@ -130,6 +131,7 @@ void SubsonicService::ReloadSettings() {
   http2_ = s.value("http2", false).toBool();
   verify_certificate_ = s.value("verifycertificate", false).toBool();
   download_album_covers_ = s.value("downloadalbumcovers", true).toBool();
+  bulk_sync_ = s.value("bulksync", false).toBool();
   auth_method_ = static_cast<SubsonicSettingsPage::AuthMethod>(s.value("authmethod", static_cast<int>(SubsonicSettingsPage::AuthMethod::MD5)).toInt());
 
   s.endGroup();
@@ -426,7 +428,12 @@ void SubsonicService::GetSongs() {
   QObject::connect(&*songs_request_, &SubsonicRequest::ProgressSetMaximum, this, &SubsonicService::SongsProgressSetMaximum);
   QObject::connect(&*songs_request_, &SubsonicRequest::UpdateProgress, this, &SubsonicService::SongsUpdateProgress);
 
-  songs_request_->GetAlbums();
+  if (bulk_sync_) {
+    songs_request_->GetSongs();
+  }
+  else {
+    songs_request_->GetAlbums();
+  }
 
 }
 
@@ -74,6 +74,7 @@ class SubsonicService : public StreamingService {
   bool http2() const { return http2_; }
   bool verify_certificate() const { return verify_certificate_; }
   bool download_album_covers() const { return download_album_covers_; }
+  bool bulk_sync() const { return bulk_sync_; }
   SubsonicSettingsPage::AuthMethod auth_method() const { return auth_method_; }
 
   SharedPtr<CollectionBackend> collection_backend() const { return collection_backend_; }
@@ -119,6 +120,7 @@ class SubsonicService : public StreamingService {
   bool http2_;
   bool verify_certificate_;
   bool download_album_covers_;
+  bool bulk_sync_;
   SubsonicSettingsPage::AuthMethod auth_method_;
 
   QStringList errors_;
@@ -37,6 +37,7 @@
 #include "core/logging.h"
 #include "core/shared_ptr.h"
 #include "core/networkaccessmanager.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "tidalservice.h"
 #include "tidalbaserequest.h"
 
@@ -63,7 +64,12 @@ QNetworkReply *TidalBaseRequest::CreateRequest(const QString &ressource_name, co
   if (oauth() && !access_token().isEmpty()) req.setRawHeader("authorization", "Bearer " + access_token().toUtf8());
   else if (!session_id().isEmpty()) req.setRawHeader("X-Tidal-SessionId", session_id().toUtf8());
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+  req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+
   QNetworkReply *reply = network_->get(req);
+  service_->request_scheduler()->RequestStarted(reply);
   QObject::connect(reply, &QNetworkReply::sslErrors, this, &TidalBaseRequest::HandleSSLErrors);
 
   //qLog(Debug) << "Tidal: Sending request" << url;
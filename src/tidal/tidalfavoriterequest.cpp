@@ -35,6 +35,7 @@
 #include "core/shared_ptr.h"
 #include "core/networkaccessmanager.h"
 #include "core/song.h"
+#include "streaming/streamingfavoritessync.h"
 #include "tidalservice.h"
 #include "tidalbaserequest.h"
 #include "tidalfavoriterequest.h"
@@ -286,12 +287,15 @@ void TidalFavoriteRequest::RemoveFavoritesReply(QNetworkReply *reply, const Favo
 
   switch (type) {
     case FavoriteType::Artists:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Artists, songs);
       emit ArtistsRemoved(songs);
       break;
     case FavoriteType::Albums:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Albums, songs);
       emit AlbumsRemoved(songs);
       break;
     case FavoriteType::Songs:
+      StreamingFavoritesSync::FavoritesRemoved(service_->settings_group(), StreamingFavoritesSync::Type::Songs, songs);
       emit SongsRemoved(songs);
       break;
   }
@@ -33,6 +33,7 @@
 #include <QJsonArray>
 #include <QJsonValue>
 #include <QTimer>
+#include <QDateTime>
 
 #include "core/logging.h"
 #include "core/shared_ptr.h"
@@ -42,6 +43,8 @@
 #include "utilities/timeconstants.h"
 #include "utilities/imageutils.h"
 #include "utilities/coverutils.h"
+#include "streaming/streamingfavoritessync.h"
+#include "streaming/streamingrequestscheduler.h"
 #include "tidalservice.h"
 #include "tidalurlhandler.h"
 #include "tidalbaserequest.h"
@@ -49,12 +52,6 @@
 
 namespace {
 constexpr char kResourcesUrl[] = "https://resources.tidal.com";
-constexpr int kMaxConcurrentArtistsRequests = 3;
-constexpr int kMaxConcurrentAlbumsRequests = 3;
-constexpr int kMaxConcurrentSongsRequests = 3;
-constexpr int kMaxConcurrentArtistAlbumsRequests = 3;
-constexpr int kMaxConcurrentAlbumSongsRequests = 3;
-constexpr int kMaxConcurrentAlbumCoverRequests = 1;
 constexpr int kFlushRequestsDelay = 200;
 }  // namespace
 
@@ -98,11 +95,18 @@ TidalRequest::TidalRequest(TidalService *service, TidalUrlHandler *url_handler,
       album_covers_requests_total_(0),
       album_covers_requests_active_(0),
       album_covers_requests_received_(0),
+      favorites_sync_(query_type == QueryType::Artists ? StreamingFavoritesSync::Type::Artists : query_type == QueryType::Albums ? StreamingFavoritesSync::Type::Albums : StreamingFavoritesSync::Type::Songs),
       need_login_(false) {
 
   timer_flush_requests_->setInterval(kFlushRequestsDelay);
   timer_flush_requests_->setSingleShot(false);
   QObject::connect(timer_flush_requests_, &QTimer::timeout, this, &TidalRequest::FlushRequests);
+  // Start queued requests as soon as the service can take more, instead of waiting for the timer.
+  QObject::connect(service_->request_scheduler(), &StreamingRequestScheduler::RequestsAvailable, this, &TidalRequest::FlushRequests);
+
+  if (IsQuery()) {
+    favorites_sync_.Begin(StreamingFavoritesSync::LoadCursor(service_->settings_group(), favorites_sync_.type()));
+  }
 
 }
 
@@ -245,7 +249,7 @@ void TidalRequest::AddArtistsRequest(const int offset, const int limit) {
 
 void TidalRequest::FlushArtistsRequests() {
 
-  while (!artists_requests_queue_.isEmpty() && artists_requests_active_ < kMaxConcurrentArtistsRequests) {
+  while (!artists_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = artists_requests_queue_.dequeue();
 
@@ -253,6 +257,10 @@ void TidalRequest::FlushArtistsRequests() {
     if (query_type_ == QueryType::SearchArtists) parameters << Param(QStringLiteral("query"), search_text_);
     if (request.limit > 0) parameters << Param(QStringLiteral("limit"), QString::number(request.limit));
     if (request.offset > 0) parameters << Param(QStringLiteral("offset"), QString::number(request.offset));
+    if (query_type_ == QueryType::Artists) {  // Newest first for the favorites sync
+      parameters << Param(QStringLiteral("order"), QStringLiteral("DATE"));
+      parameters << Param(QStringLiteral("orderDirection"), QStringLiteral("DESC"));
+    }
     QNetworkReply *reply = nullptr;
     if (query_type_ == QueryType::Artists) {
       reply = CreateRequest(QStringLiteral("users/%1/favorites/artists").arg(service_->user_id()), parameters);
@@ -293,7 +301,7 @@ void TidalRequest::AddAlbumsRequest(const int offset, const int limit) {
 
 void TidalRequest::FlushAlbumsRequests() {
 
-  while (!albums_requests_queue_.isEmpty() && albums_requests_active_ < kMaxConcurrentAlbumsRequests) {
+  while (!albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = albums_requests_queue_.dequeue();
 
@@ -301,6 +309,10 @@ void TidalRequest::FlushAlbumsRequests() {
     if (query_type_ == QueryType::SearchAlbums) parameters << Param(QStringLiteral("query"), search_text_);
     if (request.limit > 0) parameters << Param(QStringLiteral("limit"), QString::number(request.limit));
     if (request.offset > 0) parameters << Param(QStringLiteral("offset"), QString::number(request.offset));
+    if (query_type_ == QueryType::Albums) {  // Newest first for the favorites sync
+      parameters << Param(QStringLiteral("order"), QStringLiteral("DATE"));
+      parameters << Param(QStringLiteral("orderDirection"), QStringLiteral("DESC"));
+    }
     QNetworkReply *reply = nullptr;
     if (query_type_ == QueryType::Albums) {
       reply = CreateRequest(QStringLiteral("users/%1/favorites/albums").arg(service_->user_id()), parameters);
@@ -341,7 +353,7 @@ void TidalRequest::AddSongsRequest(const int offset, const int limit) {
 
 void TidalRequest::FlushSongsRequests() {
 
-  while (!songs_requests_queue_.isEmpty() && songs_requests_active_ < kMaxConcurrentSongsRequests) {
+  while (!songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     Request request = songs_requests_queue_.dequeue();
 
@@ -349,6 +361,10 @@ void TidalRequest::FlushSongsRequests() {
     if (query_type_ == QueryType::SearchSongs) parameters << Param(QStringLiteral("query"), search_text_);
     if (request.limit > 0) parameters << Param(QStringLiteral("limit"), QString::number(request.limit));
     if (request.offset > 0) parameters << Param(QStringLiteral("offset"), QString::number(request.offset));
+    if (query_type_ == QueryType::Songs) {  // Newest first for the favorites sync
+      parameters << Param(QStringLiteral("order"), QStringLiteral("DATE"));
+      parameters << Param(QStringLiteral("orderDirection"), QStringLiteral("DESC"));
+    }
     QNetworkReply *reply = nullptr;
     if (query_type_ == QueryType::Songs) {
       reply = CreateRequest(QStringLiteral("users/%1/favorites/tracks").arg(service_->user_id()), parameters);
@@ -486,6 +502,7 @@ void TidalRequest::ArtistsReplyReceived(QNetworkReply *reply, const int limit_re
       continue;
     }
     QJsonObject obj_item = value_item.toObject();
+    const QDateTime added = ParseFavoriteAdded(obj_item);
 
     if (obj_item.contains(QLatin1String("item"))) {
       QJsonValue json_item = obj_item[QLatin1String("item")];
@@ -510,6 +527,8 @@ void TidalRequest::ArtistsReplyReceived(QNetworkReply *reply, const int limit_re
     }
     artist.artist = obj_item[QLatin1String("name")].toString();
 
+    if (query_type_ == QueryType::Artists && !favorites_sync_.FavoriteReceived(artist.artist_id, added)) continue;
+
     if (artist_albums_requests_pending_.contains(artist.artist_id)) continue;
 
     ArtistAlbumsRequest request;
@@ -521,6 +540,21 @@ void TidalRequest::ArtistsReplyReceived(QNetworkReply *reply, const int limit_re
 
   if (offset_requested != 0) emit UpdateProgress(query_id_, GetProgress(artists_received_, artists_total_));
 
+  if (query_type_ == QueryType::Artists) {
+    switch (favorites_sync_.PageReceived(artists_total_)) {
+      case StreamingFavoritesSync::Paging::Continue:
+        break;
+      case StreamingFavoritesSync::Paging::Restart:
+        artists_received_ = 0;
+        AddArtistsRequest();
+        ArtistsFinishCheck();
+        return;
+      case StreamingFavoritesSync::Paging::Stop:
+        ArtistsFinishCheck();
+        return;
+    }
+  }
+
   ArtistsFinishCheck(limit_requested, offset, artists_received);
 
 }
@@ -581,7 +615,7 @@ void TidalRequest::AddArtistAlbumsRequest(const Artist &artist, const int offset
 
 void TidalRequest::FlushArtistAlbumsRequests() {
 
-  while (!artist_albums_requests_queue_.isEmpty() && artist_albums_requests_active_ < kMaxConcurrentArtistAlbumsRequests) {
+  while (!artist_albums_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     const ArtistAlbumsRequest request = artist_albums_requests_queue_.dequeue();
 
@@ -668,6 +702,7 @@ void TidalRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_req
       continue;
     }
     QJsonObject obj_item = value_item.toObject();
+    const QDateTime added = ParseFavoriteAdded(obj_item);
 
     if (obj_item.contains(QLatin1String("item"))) {
       QJsonValue json_item = obj_item[QLatin1String("item")];
@@ -728,6 +763,8 @@ void TidalRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_req
       continue;
     }
 
+    if (query_type_ == QueryType::Albums && !favorites_sync_.FavoriteReceived(album.album_id, added)) continue;
+
     if (album_songs_requests_pending_.contains(album.album_id)) continue;
 
     if (!obj_item.contains(QLatin1String("artist")) || !obj_item.contains(QLatin1String("title")) || !obj_item.contains(QLatin1String("audioQuality"))) {
@@ -771,6 +808,11 @@ void TidalRequest::AlbumsReceived(QNetworkReply *reply, const Artist &artist_req
     emit UpdateProgress(query_id_, GetProgress(albums_received_, albums_total_));
   }
 
+  if (query_type_ == QueryType::Albums && favorites_sync_.PageReceived(albums_total) == StreamingFavoritesSync::Paging::Stop) {
+    AlbumsFinishCheck(artist_requested);
+    return;
+  }
+
   AlbumsFinishCheck(artist_requested, limit_requested, offset, albums_total, albums_received);
 
 }
@@ -857,7 +899,7 @@ void TidalRequest::AddAlbumSongsRequest(const Artist &artist, const Album &album
 
 void TidalRequest::FlushAlbumSongsRequests() {
 
-  while (!album_songs_requests_queue_.isEmpty() && album_songs_requests_active_ < kMaxConcurrentAlbumSongsRequests) {
+  while (!album_songs_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Api)) {
 
     AlbumSongsRequest request = album_songs_requests_queue_.dequeue();
     ParamList parameters;
@@ -947,6 +989,7 @@ void TidalRequest::SongsReceived(QNetworkReply *reply, const Artist &artist, con
       continue;
     }
     QJsonObject obj_item = value_item.toObject();
+    const QDateTime added = ParseFavoriteAdded(obj_item);
 
     if (obj_item.contains(QLatin1String("item"))) {
       QJsonValue item = obj_item[QLatin1String("item")];
@@ -960,6 +1003,7 @@ void TidalRequest::SongsReceived(QNetworkReply *reply, const Artist &artist, con
     ++songs_received;
     Song song(Song::Source::Tidal);
     ParseSong(song, obj_item, artist, album);
+    if (query_type_ == QueryType::Songs && !favorites_sync_.FavoriteReceived(song.song_id(), added)) continue;
     if (!song.is_valid()) continue;
     if (song.disc() >= 2) multidisc = true;
     if (song.is_compilation()) compilation = true;
@@ -977,6 +1021,11 @@ void TidalRequest::SongsReceived(QNetworkReply *reply, const Artist &artist, con
     emit UpdateProgress(query_id_, GetProgress(songs_received_, songs_total_));
   }
 
+  if (query_type_ == QueryType::Songs && favorites_sync_.PageReceived(songs_total) == StreamingFavoritesSync::Paging::Stop) {
+    SongsFinishCheck(artist, album);
+    return;
+  }
+
   SongsFinishCheck(artist, album, limit_requested, offset_requested, songs_total, songs_received);
 
 }
@@ -1160,6 +1209,15 @@ void TidalRequest::ParseSong(Song &song, const QJsonObject &json_obj, const Arti
 
 }
 
+// Favorites are returned as an item with the date it was added to the favorites.
+QDateTime TidalRequest::ParseFavoriteAdded(const QJsonObject &json_obj) {
+
+  if (!json_obj.contains(QLatin1String("created")) || !json_obj.contains(QLatin1String("item"))) return QDateTime();
+
+  return QDateTime::fromString(json_obj[QLatin1String("created")].toString(), Qt::ISODateWithMs);
+
+}
+
 void TidalRequest::GetAlbumCoversCheck() {
 
   if (
@@ -1224,13 +1282,14 @@ void TidalRequest::AddAlbumCoverRequest(const Song &song) {
 
 void TidalRequest::FlushAlbumCoverRequests() {
 
-  while (!album_cover_requests_queue_.isEmpty() && album_covers_requests_active_ < kMaxConcurrentAlbumCoverRequests) {
+  while (!album_cover_requests_queue_.isEmpty() && service_->request_scheduler()->CanStart(StreamingRequestScheduler::Category::Covers)) {
 
     AlbumCoverRequest request = album_cover_requests_queue_.dequeue();
 
     QNetworkRequest req(request.url);
     req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
     QNetworkReply *reply = network_->get(req);
+    service_->request_scheduler()->RequestStarted(reply, StreamingRequestScheduler::Category::Covers);
     album_cover_replies_ << reply;
     QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, request]() { AlbumCoverReceived(reply, request.album_id, request.url, request.filename); });
 
@@ -1358,6 +1417,12 @@ void TidalRequest::FinishCheck() {
       timer_flush_requests_->stop();
     }
     finished_ = true;
+    if (IsQuery()) {
+      const StreamingFavoritesSync::Cursor cursor = favorites_sync_.Finish(errors_.isEmpty());
+      if (errors_.isEmpty()) {
+        StreamingFavoritesSync::SaveCursor(service_->settings_group(), favorites_sync_.type(), cursor);
+      }
+    }
     if (songs_.isEmpty()) {
       if (errors_.isEmpty()) {
         if (IsSearch()) {
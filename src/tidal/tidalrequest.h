@@ -36,9 +36,11 @@
 #include <QStringList>
 #include <QUrl>
 #include <QJsonObject>
+#include <QDateTime>
 
 #include "core/shared_ptr.h"
 #include "core/song.h"
+#include "streaming/streamingfavoritessync.h"
 
 #include "tidalbaserequest.h"
 
@@ -62,6 +64,8 @@ class TidalRequest : public TidalBaseRequest {
   void set_need_login() override { need_login_ = true; }
   void Search(const int query_id, const QString &search_text);
 
+  const StreamingFavoritesSync &favorites_sync() const { return favorites_sync_; }
+
  private:
   struct Artist {
     QString artist_id;
@@ -159,6 +163,7 @@ class TidalRequest : public TidalBaseRequest {
   void FlushAlbumSongsRequests();
 
   void ParseSong(Song &song, const QJsonObject &json_obj, const Artist &album_artist, const Album &album);
+  static QDateTime ParseFavoriteAdded(const QJsonObject &json_obj);
 
   void GetAlbumCoversCheck();
   void GetAlbumCovers();
@@ -233,6 +238,8 @@ class TidalRequest : public TidalBaseRequest {
   int album_covers_requests_active_;
   int album_covers_requests_received_;
 
+  StreamingFavoritesSync favorites_sync_;
+
   SongMap songs_;
   QStringList errors_;
   bool need_login_;
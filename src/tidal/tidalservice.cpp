@@ -52,6 +52,7 @@
 #include "utilities/randutils.h"
 #include "utilities/timeconstants.h"
 #include "streaming/streamingsearchview.h"
+#include "streaming/streamingfavoritessync.h"
 #include "collection/collectionbackend.h"
 #include "collection/collectionmodel.h"
 #include "collection/collectionfilter.h"
@@ -746,7 +747,13 @@ void TidalService::GetArtists() {
 void TidalService::ArtistsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit ArtistsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = artists_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit ArtistsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit ArtistsResults(songs, error);
+  }
   ResetArtistsRequest();
 
 }
@@ -801,7 +808,13 @@ void TidalService::GetAlbums() {
 void TidalService::AlbumsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit AlbumsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = albums_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit AlbumsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit AlbumsResults(songs, error);
+  }
   ResetAlbumsRequest();
 
 }
@@ -856,7 +869,13 @@ void TidalService::GetSongs() {
 void TidalService::SongsResultsReceived(const int id, const SongMap &songs, const QString &error) {
 
   Q_UNUSED(id);
-  emit SongsResults(songs, error);
+  const StreamingFavoritesSync &favorites_sync = songs_request_->favorites_sync();
+  if (favorites_sync.incremental()) {
+    emit SongsUpdated(songs, favorites_sync.favorite_ids(), favorites_sync.prune(), error);
+  }
+  else {
+    emit SongsResults(songs, error);
+  }
   ResetSongsRequest();
 
 }
@@ -30,6 +30,7 @@
 
 #include "core/urlhandler.h"
 #include "core/song.h"
+#include "streaming/streamurlcache.h"
 #include "tidal/tidalservice.h"
 
 class Application;
@@ -42,9 +43,13 @@ class TidalUrlHandler : public UrlHandler {
 
   QString scheme() const override { return service_->url_scheme(); }
   LoadResult StartLoading(const QUrl &url) override;
+  void Prefetch(const QUrl &url) override;
+
+  const StreamURLCache &cache() const { return cache_; }
 
  private:
   void CancelTask(const int task_id);
+  void LogCacheStats() const;
 
  private slots:
   void GetStreamURLFailure(const uint id, const QUrl &media_url, const QString &error);
@@ -52,13 +57,19 @@ class TidalUrlHandler : public UrlHandler {
 
  private:
   struct Request {
-    Request() : id(0), task_id(-1) {}
+    Request() : id(0), task_id(-1), prefetch(false), started_msec(0), attached_msec(0) {}
     uint id;
     int task_id;
+    bool prefetch;
+    qint64 started_msec;
+    // When the player asked for the stream URL while it was being prefetched.
+    qint64 attached_msec;
+    QUrl media_url;
   };
   Application *app_;
   TidalService *service_;
   QMap<uint, Request> requests_;
+  StreamURLCache cache_;
 };
 
 #endif  // TIDALURLHANDLER_H
@@ -93,6 +93,33 @@ QByteArray ImageUtils::FileToJpegData(const QString &filename) {
 
 }
 
+QImage ImageUtils::ReadImageFromData(const QByteArray &image_data, const QSize scale_size) {
+
+  if (image_data.isEmpty()) return QImage();
+
+  QBuffer buffer;
+  buffer.setData(image_data);
+  if (!buffer.open(QIODevice::ReadOnly)) return QImage();
+
+  QImageReader reader(&buffer);
+
+  // Let the decoder downscale large images, for JPEG this is done while decoding so the full size image is never allocated.
+  // Decode to twice the size we scale to, so ScaleImage still does the last step with smooth transformation.
+  if (scale_size.isValid()) {
+    const QSize image_size = reader.size();
+    const QSize decode_size = image_size.scaled(scale_size * 2, Qt::KeepAspectRatio);
+    if (image_size.isValid() && decode_size.width() < image_size.width() && decode_size.height() < image_size.height() && !decode_size.isEmpty()) {
+      reader.setScaledSize(decode_size);
+    }
+  }
+
+  QImage image = reader.read();
+  buffer.close();
+
+  return image;
+
+}
+
 QImage ImageUtils::ScaleImage(const QImage &image, const QSize desired_size, const qreal device_pixel_ratio, const bool pad) {
 
   if (image.isNull() || (image.width() == desired_size.width() && image.height() == desired_size.height())) {
@@ -39,6 +39,7 @@ class ImageUtils {
   static QStringList SupportedImageFormats();
   static QByteArray SaveImageToJpegData(const QImage &image = QImage());
   static QByteArray FileToJpegData(const QString &filename);
+  static QImage ReadImageFromData(const QByteArray &image_data, const QSize scale_size = QSize());
   static QImage ScaleImage(const QImage &image, const QSize desired_size, const qreal device_pixel_ratio = 1.0F, const bool pad = true);
   static QImage GenerateNoCoverImage(const QSize size, const qreal device_pixel_ratio);
 };
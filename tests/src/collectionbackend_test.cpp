@@ -316,6 +316,52 @@ TEST_F(SingleSong, DeleteSongs) {
 
 }
 
+TEST_F(SingleSong, ImportStatistics) {
+
+  AddDummySong();
+  if (HasFatalFailure()) return;
+
+  Song lastplayed;
+  lastplayed.set_artist(QStringLiteral("artist"));
+  lastplayed.set_album(QStringLiteral("Album"));
+  lastplayed.set_title(QStringLiteral("title "));
+  lastplayed.set_lastplayed(1000);
+
+  Song older_lastplayed(lastplayed);
+  older_lastplayed.set_lastplayed(500);
+
+  Song playcount;
+  playcount.set_artist(QStringLiteral("Artist"));
+  playcount.set_title(QStringLiteral("Title"));
+  playcount.set_playcount(7);
+
+  Song other;
+  other.set_artist(QStringLiteral("Other artist"));
+  other.set_title(QStringLiteral("Title"));
+  other.set_playcount(3);
+
+  QSignalSpy statistics_spy(&*backend_, &CollectionBackend::SongsStatisticsChanged);
+
+  backend_->StartStatisticsImport();
+  backend_->AddStatisticsImport(SongList() << lastplayed << older_lastplayed);
+  backend_->AddStatisticsImport(SongList() << playcount << other);
+  backend_->FinishStatisticsImport();
+
+  ASSERT_EQ(1, statistics_spy.count());
+  SongList songs = statistics_spy[0][0].value<SongList>();
+  ASSERT_EQ(1, songs.count());
+  EXPECT_EQ(1000, songs[0].lastplayed());
+  EXPECT_EQ(7U, songs[0].playcount());
+
+  // Importing the same statistics again doesn't change anything.
+  backend_->StartStatisticsImport();
+  backend_->AddStatisticsImport(SongList() << lastplayed << playcount);
+  backend_->FinishStatisticsImport();
+
+  EXPECT_EQ(1, statistics_spy.count());
+
+}
+
 TEST_F(SingleSong, MarkSongsUnavailable) {
 
   AddDummySong();
@@ -0,0 +1,171 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QNetworkRequest>
+
+#include "mock_networkaccessmanager.h"
+
+#include "covermanager/coverprovider.h"
+#include "covermanager/coverproviderscheduler.h"
+
+namespace {
+
+class MockCoverProvider : public CoverProvider {
+ public:
+  explicit MockCoverProvider() : CoverProvider(QStringLiteral("Mock"), true, false, 1.0, true, true, nullptr, nullptr, nullptr) {}
+
+  bool StartSearch(const QString &artist, const QString &album, const QString &title, const int id) override {
+    Q_UNUSED(artist);
+    Q_UNUSED(album);
+    Q_UNUSED(title);
+    Q_UNUSED(id);
+    return true;
+  }
+
+  void Error(const QString &error, const QVariant &debug = QVariant()) override {
+    Q_UNUSED(error);
+    Q_UNUSED(debug);
+  }
+
+  using CoverProvider::CheckRateLimited;
+};
+
+class CoverProviderSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scheduler_.set_clock([this]() { return now_msec_; });
+  }
+
+  void Schedule(const int count, QObject *context = nullptr) {
+    for (int i = 0; i < count; ++i) {
+      scheduler_.Schedule(&provider_, context ? context : &context_, [this]() { ++started_; });
+    }
+  }
+
+  MockCoverProvider provider_;
+  CoverProviderScheduler scheduler_;
+  QObject context_;
+  qint64 now_msec_ = 0;
+  int started_ = 0;
+};
+
+TEST_F(CoverProviderSchedulerTest, LimitsConcurrency) {
+
+  scheduler_.set_rate(1000.0, 100);
+  Schedule(5);
+  scheduler_.Dispatch();
+
+  EXPECT_EQ(2, started_);
+  EXPECT_EQ(2, scheduler_.active(&provider_));
+  EXPECT_EQ(3, scheduler_.queued(&provider_));
+
+  scheduler_.Finished(&provider_);
+  scheduler_.Dispatch();
+
+  EXPECT_EQ(3, started_);
+  EXPECT_EQ(2, scheduler_.active(&provider_));
+
+}
+
+TEST_F(CoverProviderSchedulerTest, LimitsRate) {
+
+  scheduler_.set_rate(4.0, 1);
+  Schedule(3);
+  scheduler_.Dispatch();
+
+  EXPECT_EQ(1, started_);
+  scheduler_.Finished(&provider_);
+  scheduler_.Dispatch();
+  EXPECT_EQ(1, started_);
+
+  // The next token is available after 250 ms.
+  now_msec_ += 200;
+  scheduler_.Dispatch();
+  EXPECT_EQ(1, started_);
+
+  now_msec_ += 50;
+  scheduler_.Dispatch();
+  EXPECT_EQ(2, started_);
+
+}
+
+TEST_F(CoverProviderSchedulerTest, BacksOffWhenRateLimited) {
+
+  Schedule(1);
+  scheduler_.Dispatch();
+  ASSERT_EQ(1, started_);
+
+  MockNetworkReply reply;
+  reply.setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 429);
+  provider_.CheckRateLimited(&reply);
+  scheduler_.Finished(&provider_);
+
+  EXPECT_TRUE(scheduler_.paused(&provider_));
+  EXPECT_EQ(1, scheduler_.concurrency(&provider_));
+
+  Schedule(1);
+  scheduler_.Dispatch();
+  EXPECT_EQ(1, started_);
+  EXPECT_EQ(1, scheduler_.queued(&provider_));
+
+  // Without Retry-After the first pause is 2 seconds.
+  now_msec_ += 1999;
+  scheduler_.Dispatch();
+  EXPECT_TRUE(scheduler_.paused(&provider_));
+  EXPECT_EQ(1, started_);
+
+  now_msec_ += 1;
+  scheduler_.Dispatch();
+  EXPECT_FALSE(scheduler_.paused(&provider_));
+  EXPECT_EQ(2, started_);
+
+}
+
+TEST_F(CoverProviderSchedulerTest, IgnoresSuccessfulReplies) {
+
+  MockNetworkReply reply;
+  reply.setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+  provider_.CheckRateLimited(&reply);
+
+  Schedule(1);
+  scheduler_.Dispatch();
+
+  EXPECT_FALSE(scheduler_.paused(&provider_));
+  EXPECT_EQ(1, started_);
+
+}
+
+TEST_F(CoverProviderSchedulerTest, CancelDropsQueuedRequests) {
+
+  QObject context;
+  Schedule(2, &context);
+  scheduler_.Cancel(&context);
+  scheduler_.Dispatch();
+
+  EXPECT_EQ(0, started_);
+  EXPECT_EQ(0, scheduler_.queued(&provider_));
+
+}
+
+}  // namespace
@@ -0,0 +1,124 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <QVector>
+#include <QElapsedTimer>
+#include <QtDebug>
+
+#include "analyzer/fht.h"
+
+namespace {
+
+QVector<float> TestSignal(const int size) {
+
+  QVector<float> signal(size);
+  for (int i = 0; i < size; ++i) {
+    signal[i] = static_cast<float>(0.5 * sin(2.0 * M_PI * 3.0 * i / size) + 0.25 * cos(2.0 * M_PI * 17.0 * i / size) + 0.1 * sin(0.37 * i * i));
+  }
+  return signal;
+
+}
+
+// The doubled power spectrum computed from the Hartley transform, this is what FHT::power2() used to return.
+QVector<float> HartleyPower2(FHT &fht, const QVector<float> &signal) {
+
+  const int size = fht.size();
+  QVector<float> h = signal;
+  fht.transform(h.data());
+
+  QVector<float> power(size / 2);
+  power[0] = 2 * h[0] * h[0];
+  for (int i = 1; i < size / 2; ++i) {
+    power[i] = h[i] * h[i] + h[size - i] * h[size - i];
+  }
+  return power;
+
+}
+
+}  // namespace
+
+TEST(FHTTest, Power2MatchesHartleyTransform) {
+
+  for (uint exp = 3; exp <= 9; ++exp) {
+    FHT fht(exp);
+    const QVector<float> signal = TestSignal(fht.size());
+    const QVector<float> expected = HartleyPower2(fht, signal);
+
+    QVector<float> power = signal;
+    fht.power2(power.data());
+
+    const float max_power = *std::max_element(expected.begin(), expected.end());
+    for (int i = 0; i < fht.size() / 2; ++i) {
+      EXPECT_NEAR(expected[i], power[i], max_power * 1e-5F) << "size" << fht.size() << "bin" << i;
+    }
+  }
+
+}
+
+TEST(FHTTest, SpectrumOfSine) {
+
+  FHT fht(9);
+  QVector<float> signal(fht.size());
+  for (int i = 0; i < fht.size(); ++i) {
+    signal[i] = static_cast<float>(sin(2.0 * M_PI * 32.0 * i / fht.size()));
+  }
+
+  fht.spectrum(signal.data());
+
+  const int peak = static_cast<int>(std::max_element(signal.begin(), signal.begin() + fht.size() / 2) - signal.begin());
+  EXPECT_EQ(32, peak);
+
+}
+
+// Run with --gtest_also_run_disabled_tests to compare against the Hartley transform.
+TEST(FHTTest, DISABLED_Benchmark) {
+
+  constexpr int kIterations = 100000;
+
+  for (uint exp = 5; exp <= 9; ++exp) {
+    FHT fht(exp);
+    const QVector<float> signal = TestSignal(fht.size());
+    QVector<float> scratch(fht.size());
+    float sum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kIterations; ++i) {
+      sum += HartleyPower2(fht, signal)[1];
+    }
+    const qint64 hartley_ns = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < kIterations; ++i) {
+      std::copy(signal.begin(), signal.end(), scratch.begin());
+      fht.power2(scratch.data());
+      sum += scratch[1];
+    }
+    const qint64 fft_ns = timer.nsecsElapsed();
+
+    EXPECT_GT(sum, 0);
+    qDebug() << "size" << fht.size() << "hartley" << hartley_ns / kIterations << "ns" << "fft" << fft_ns / kIterations << "ns";
+  }
+
+}
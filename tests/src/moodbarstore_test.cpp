@@ -0,0 +1,209 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "moodbar/moodbarstore.h"
+
+namespace {
+
+QByteArray MoodbarData(const int seed) {
+
+  // 1000 samples of 3 bytes like the moodbar builder outputs.
+  QByteArray data(3000, 0);
+  for (int i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>((i * seed + i / 7) & 0xFF);
+  }
+  return data;
+
+}
+
+class MoodbarStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.isValid());
+    filename_ = temp_dir_.path() + QStringLiteral("/moodbar.store");
+  }
+
+  QTemporaryDir temp_dir_;
+  QString filename_;
+};
+
+TEST_F(MoodbarStoreTest, PutAndGet) {
+
+  MoodbarStore store(filename_);
+  ASSERT_TRUE(store.Open());
+
+  const quint64 key = MoodbarStore::KeyForUrl(QUrl::fromLocalFile(QStringLiteral("/music/song.flac")));
+  EXPECT_FALSE(store.Contains(key));
+  EXPECT_TRUE(store.Get(key).isEmpty());
+
+  ASSERT_TRUE(store.Put(key, MoodbarData(1)));
+  EXPECT_TRUE(store.Contains(key));
+  EXPECT_EQ(MoodbarData(1), store.Get(key));
+  EXPECT_EQ(1, store.count());
+
+}
+
+TEST_F(MoodbarStoreTest, ReplaceAndRemove) {
+
+  MoodbarStore store(filename_);
+  ASSERT_TRUE(store.Open());
+
+  ASSERT_TRUE(store.Put(1, MoodbarData(1)));
+  ASSERT_TRUE(store.Put(1, MoodbarData(2)));
+  EXPECT_EQ(MoodbarData(2), store.Get(1));
+  EXPECT_EQ(1, store.count());
+  EXPECT_GT(store.dead_bytes(), 0);
+
+  ASSERT_TRUE(store.Remove(1));
+  EXPECT_FALSE(store.Contains(1));
+  EXPECT_EQ(0, store.count());
+  EXPECT_FALSE(store.Remove(1));
+
+}
+
+TEST_F(MoodbarStoreTest, Reopen) {
+
+  {
+    MoodbarStore store(filename_);
+    ASSERT_TRUE(store.Open());
+    for (int i = 1; i <= 10; ++i) {
+      ASSERT_TRUE(store.Put(i, MoodbarData(i)));
+    }
+    ASSERT_TRUE(store.Put(3, MoodbarData(30)));
+    ASSERT_TRUE(store.Remove(5));
+  }
+
+  MoodbarStore store(filename_);
+  ASSERT_TRUE(store.Open());
+  EXPECT_EQ(9, store.count());
+  EXPECT_EQ(MoodbarData(1), store.Get(1));
+  EXPECT_EQ(MoodbarData(30), store.Get(3));
+  EXPECT_FALSE(store.Contains(5));
+  EXPECT_EQ(MoodbarData(10), store.Get(10));
+
+}
+
+TEST_F(MoodbarStoreTest, Compact) {
+
+  MoodbarStore store(filename_);
+  ASSERT_TRUE(store.Open());
+  for (int i = 1; i <= 10; ++i) {
+    ASSERT_TRUE(store.Put(i, MoodbarData(i)));
+  }
+  for (int i = 1; i <= 5; ++i) {
+    ASSERT_TRUE(store.Remove(i));
+  }
+
+  const qint64 size_before = store.file_size();
+  ASSERT_TRUE(store.Compact());
+  EXPECT_LT(store.file_size(), size_before);
+  EXPECT_EQ(0, store.dead_bytes());
+  EXPECT_EQ(5, store.count());
+  for (int i = 6; i <= 10; ++i) {
+    EXPECT_EQ(MoodbarData(i), store.Get(i));
+  }
+
+}
+
+TEST_F(MoodbarStoreTest, EvictsLeastRecentlyUsed) {
+
+  const qint64 max_size = 16LL * 1024LL;
+
+  MoodbarStore store(filename_, max_size);
+  ASSERT_TRUE(store.Open());
+  for (int i = 1; i <= 200; ++i) {
+    ASSERT_TRUE(store.Put(i, MoodbarData(i)));
+    // Keep the first moodbar in use.
+    EXPECT_EQ(MoodbarData(1), store.Get(1));
+    if (store.NeedsCompaction()) {
+      store.MaybeCompact();
+      EXPECT_FALSE(store.NeedsCompaction());
+    }
+  }
+
+  EXPECT_LE(store.file_size(), max_size);
+  EXPECT_LT(store.count(), 200);
+  EXPECT_TRUE(store.Contains(1));
+  EXPECT_FALSE(store.Contains(2));
+  EXPECT_EQ(MoodbarData(200), store.Get(200));
+
+  // Evicted moodbars stay gone after reopening.
+  store.Close();
+  ASSERT_TRUE(store.Open());
+  EXPECT_TRUE(store.Contains(1));
+  EXPECT_FALSE(store.Contains(2));
+
+}
+
+TEST_F(MoodbarStoreTest, PutDoesNotCompact) {
+
+  const qint64 max_size = 16LL * 1024LL;
+
+  MoodbarStore store(filename_, max_size);
+  ASSERT_TRUE(store.Open());
+  for (int i = 1; i <= 200; ++i) {
+    ASSERT_TRUE(store.Put(i, MoodbarData(i)));
+  }
+
+  EXPECT_EQ(200, store.count());
+  EXPECT_TRUE(store.NeedsCompaction());
+
+  store.MaybeCompact();
+  EXPECT_FALSE(store.NeedsCompaction());
+  EXPECT_LE(store.file_size(), max_size);
+  EXPECT_TRUE(store.Contains(200));
+
+}
+
+TEST_F(MoodbarStoreTest, TruncatesTornRecord) {
+
+  qint64 size = 0;
+  {
+    MoodbarStore store(filename_);
+    ASSERT_TRUE(store.Open());
+    ASSERT_TRUE(store.Put(1, MoodbarData(1)));
+    size = store.file_size();
+    ASSERT_TRUE(store.Put(2, MoodbarData(2)));
+  }
+
+  // Simulate a crash in the middle of writing the second record.
+  {
+    QFile file(filename_);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    ASSERT_TRUE(file.resize(size + 30));
+  }
+
+  MoodbarStore store(filename_);
+  ASSERT_TRUE(store.Open());
+  EXPECT_EQ(1, store.count());
+  EXPECT_EQ(MoodbarData(1), store.Get(1));
+  EXPECT_FALSE(store.Contains(2));
+  EXPECT_EQ(size, store.file_size());
+
+}
+
+}  // namespace
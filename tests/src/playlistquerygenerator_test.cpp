@@ -0,0 +1,86 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <QList>
+#include <QSet>
+
+#include "smartplaylists/playlistquerygenerator.h"
+
+namespace {
+
+QList<int> Range(const int count) {
+
+  QList<int> ids;
+  for (int i = 1; i <= count; ++i) {
+    ids << i;
+  }
+  return ids;
+
+}
+
+TEST(PlaylistQueryGeneratorTest, SampleIdsWithoutReplacement) {
+
+  const QList<int> ids = Range(1000);
+  const QList<int> sample = PlaylistQueryGenerator::SampleIds(ids, QSet<int>(), 50);
+
+  ASSERT_EQ(50, sample.count());
+  QSet<int> unique;
+  for (const int id : sample) {
+    EXPECT_TRUE(ids.contains(id));
+    unique.insert(id);
+  }
+  EXPECT_EQ(50, unique.count());
+
+}
+
+TEST(PlaylistQueryGeneratorTest, SampleIdsSkipsExcluded) {
+
+  const QList<int> ids = Range(100);
+  QSet<int> exclude;
+  for (int i = 1; i <= 90; ++i) {
+    exclude.insert(i);
+  }
+
+  const QList<int> sample = PlaylistQueryGenerator::SampleIds(ids, exclude, 20);
+  ASSERT_EQ(10, sample.count());
+  for (const int id : sample) {
+    EXPECT_GT(id, 90);
+  }
+
+}
+
+TEST(PlaylistQueryGeneratorTest, SampleIdsAll) {
+
+  const QList<int> ids = Range(200);
+  QList<int> sample = PlaylistQueryGenerator::SampleIds(ids, QSet<int>(), -1);
+
+  ASSERT_EQ(200, sample.count());
+  std::sort(sample.begin(), sample.end());
+  EXPECT_EQ(ids, sample);
+
+  EXPECT_TRUE(PlaylistQueryGenerator::SampleIds(ids, QSet<int>(), 0).isEmpty());
+  EXPECT_TRUE(PlaylistQueryGenerator::SampleIds(QList<int>(), QSet<int>(), 10).isEmpty());
+
+}
+
+}  // namespace
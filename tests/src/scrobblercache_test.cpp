@@ -0,0 +1,143 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+#include "core/song.h"
+#include "scrobbler/scrobblercache.h"
+
+namespace {
+
+class ScrobblerCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    QStandardPaths::setTestModeEnabled(true);
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    QFile::remove(Filename());
+  }
+
+  void TearDown() override {
+    QFile::remove(Filename());
+  }
+
+  static QString Filename() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/scrobblercache_test.cache");
+  }
+
+  static Song MakeSong(const int i) {
+    Song song;
+    song.set_artist(QStringLiteral("Artist"));
+    song.set_title(QStringLiteral("Title %1").arg(i));
+    song.set_length_nanosec(180000000000LL);
+    return song;
+  }
+};
+
+TEST_F(ScrobblerCacheTest, AppendsAndRemoves) {
+
+  {
+    ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+    ScrobblerCacheItemPtrList items;
+    for (int i = 0; i < 3; ++i) {
+      items << cache.Add(MakeSong(i), 1000 + i);
+    }
+    cache.WriteCache();
+    cache.Flush(ScrobblerCacheItemPtrList() << items[1]);
+    cache.WriteCache();
+  }
+
+  ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+  ASSERT_EQ(2, cache.Count());
+  EXPECT_EQ(QStringLiteral("Title 0"), cache.List()[0]->metadata.title);
+  EXPECT_EQ(QStringLiteral("Title 2"), cache.List()[1]->metadata.title);
+
+  // New scrobbles don't reuse the IDs of the ones read.
+  ScrobblerCacheItemPtr item = cache.Add(MakeSong(3), 2000);
+  EXPECT_GT(item->id, cache.List()[1]->id);
+
+}
+
+TEST_F(ScrobblerCacheTest, RemovesFileWhenEmpty) {
+
+  ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+  ScrobblerCacheItemPtr item = cache.Add(MakeSong(0), 1000);
+  cache.WriteCache();
+  EXPECT_TRUE(QFile::exists(Filename()));
+
+  cache.Flush(ScrobblerCacheItemPtrList() << item);
+  cache.WriteCache();
+  EXPECT_FALSE(QFile::exists(Filename()));
+
+}
+
+TEST_F(ScrobblerCacheTest, RewritesAfterTornRecord) {
+
+  {
+    ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+    cache.Add(MakeSong(0), 1000);
+    cache.WriteCache();
+  }
+
+  // Simulate a crash in the middle of appending a record, leaving a line without a newline.
+  {
+    QFile file(Filename());
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    file.write("{\"id\":2,\"timestamp\":10");
+    file.close();
+  }
+
+  {
+    ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+    ASSERT_EQ(1, cache.Count());
+    cache.Add(MakeSong(1), 2000);
+    cache.WriteCache();
+  }
+
+  ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+  ASSERT_EQ(2, cache.Count());
+  EXPECT_EQ(QStringLiteral("Title 0"), cache.List()[0]->metadata.title);
+  EXPECT_EQ(QStringLiteral("Title 1"), cache.List()[1]->metadata.title);
+
+}
+
+TEST_F(ScrobblerCacheTest, ReadsLegacyCache) {
+
+  QFile file(Filename());
+  ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+  file.write("{\n    \"tracks\": [\n        {\n            \"timestamp\": 1000,\n            \"artist\": \"Artist\",\n            \"album\": \"\",\n            \"title\": \"Title\",\n            \"track\": 1,\n            \"albumartist\": \"\",\n            \"length_nanosec\": 180000000000\n        }\n    ]\n}\n");
+  file.close();
+
+  {
+    ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+    ASSERT_EQ(1, cache.Count());
+    EXPECT_EQ(QStringLiteral("Title"), cache.List()[0]->metadata.title);
+    cache.WriteCache();
+  }
+
+  ScrobblerCache cache(QStringLiteral("scrobblercache_test.cache"), nullptr);
+  EXPECT_EQ(1, cache.Count());
+
+}
+
+}  // namespace
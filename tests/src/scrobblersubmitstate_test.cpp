@@ -0,0 +1,126 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+
+#include "scrobbler/scrobblersubmitstate.h"
+
+namespace {
+
+TEST(ScrobblerSubmitStateTest, LimitsRequests) {
+
+  ScrobblerSubmitState state(QStringLiteral("Test"), 3);
+  EXPECT_TRUE(state.can_start());
+
+  state.Started(100);
+  state.Started(100);
+  state.Started(100);
+  EXPECT_EQ(3, state.requests());
+  EXPECT_FALSE(state.can_start());
+
+  state.Succeeded(10, 90);
+  EXPECT_EQ(2, state.requests());
+  EXPECT_TRUE(state.can_start());
+
+}
+
+TEST(ScrobblerSubmitStateTest, BacksOffOncePerRound) {
+
+  ScrobblerSubmitState state(QStringLiteral("Test"), 3);
+  const int round = state.Started(100);
+  state.Started(100);
+
+  state.Failed(round);
+  EXPECT_TRUE(state.error());
+  EXPECT_EQ(1, state.errors());
+  EXPECT_EQ(1, state.max_requests());
+  EXPECT_GE(state.retry_delay_msec(), ScrobblerSubmitState::kMinRetryDelayMsec / 2);
+  EXPECT_LE(state.retry_delay_msec(), ScrobblerSubmitState::kMinRetryDelayMsec);
+
+  // The other request was sent before the first failure.
+  state.Failed(round);
+  EXPECT_EQ(1, state.errors());
+  EXPECT_EQ(0, state.requests());
+
+  state.Failed(state.Started(100));
+  EXPECT_EQ(2, state.errors());
+  EXPECT_GE(state.retry_delay_msec(), ScrobblerSubmitState::kMinRetryDelayMsec);
+  EXPECT_LE(state.retry_delay_msec(), ScrobblerSubmitState::kMinRetryDelayMsec * 2);
+
+}
+
+TEST(ScrobblerSubmitStateTest, RetryDelayIsCapped) {
+
+  ScrobblerSubmitState state(QStringLiteral("Test"), 2);
+  for (int i = 0; i < 50; ++i) {
+    state.Failed(state.Started(10));
+  }
+
+  EXPECT_LE(state.retry_delay_msec(), ScrobblerSubmitState::kMaxRetryDelayMsec);
+  EXPECT_GE(state.retry_delay_msec(), ScrobblerSubmitState::kMaxRetryDelayMsec / 2);
+
+}
+
+TEST(ScrobblerSubmitStateTest, SuccessClearsError) {
+
+  ScrobblerSubmitState state(QStringLiteral("Test"), 2);
+  state.Failed(state.Started(10));
+  ASSERT_TRUE(state.error());
+
+  state.Started(10);
+  state.Succeeded(10, 0);
+  EXPECT_FALSE(state.error());
+  EXPECT_EQ(0, state.retry_delay_msec());
+  EXPECT_EQ(2, state.max_requests());
+
+}
+
+TEST(ScrobblerSubmitStateTest, RateLimitHoldsRequests) {
+
+  ScrobblerSubmitState state(QStringLiteral("Test"), 3);
+  state.RateLimited(60000);
+  EXPECT_TRUE(state.rate_limited());
+  EXPECT_FALSE(state.can_start());
+  EXPECT_GT(state.rate_limit_msec(), 0);
+  EXPECT_LE(state.rate_limit_msec(), 60000);
+
+  // A shorter reset doesn't cut the wait short.
+  state.RateLimited(10);
+  EXPECT_GT(state.rate_limit_msec(), 10);
+
+  // Rate limiting is not an error, the requests are not throttled once it resets.
+  EXPECT_FALSE(state.error());
+  EXPECT_EQ(3, state.max_requests());
+
+}
+
+TEST(ScrobblerSubmitStateTest, RequeuedDoesNotBackOff) {
+
+  ScrobblerSubmitState state(QStringLiteral("Test"), 3);
+  state.Started(1000);
+  state.Requeued();
+  EXPECT_EQ(0, state.requests());
+  EXPECT_FALSE(state.error());
+  EXPECT_EQ(0, state.retry_delay_msec());
+
+}
+
+}  // namespace
@@ -0,0 +1,281 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <QVariant>
+#include <QVariantMap>
+#include <QString>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QtDebug>
+
+#include "core/scoped_ptr.h"
+#include "core/shared_ptr.h"
+#include "core/song.h"
+#include "core/database.h"
+#include "collection/collectionbackend.h"
+#include "collection/collection.h"
+#include "smartplaylists/smartplaylistsearch.h"
+#include "smartplaylists/smartplaylistsearchterm.h"
+
+using std::make_unique;
+using std::make_shared;
+
+// clazy:excludeall=non-pod-global-static,returning-void-expression
+
+namespace {
+
+TEST(SmartPlaylistSearchTermTest, BindsValues) {
+
+  SmartPlaylistSearchTerm term(SmartPlaylistSearchTerm::Field::Artist, SmartPlaylistSearchTerm::Operator::Contains, QStringLiteral("O'Brien"));
+  QVariantMap bound_values;
+
+  EXPECT_EQ(QStringLiteral("artist LIKE '%' || :term || '%'"), term.ToSql(QStringLiteral(":term"), bound_values));
+  EXPECT_EQ(QStringLiteral("O'Brien"), bound_values.value(QStringLiteral(":term")).toString());
+
+}
+
+TEST(SmartPlaylistSearchTermTest, BindsRelativeDates) {
+
+  SmartPlaylistSearchTerm term(SmartPlaylistSearchTerm::Field::LastPlayed, SmartPlaylistSearchTerm::Operator::RelativeDate, 1);
+  term.second_value_ = 2;
+  term.datetype_ = SmartPlaylistSearchTerm::DateType::Week;
+  QVariantMap bound_values;
+
+  const QString sql = term.ToSql(QStringLiteral(":term"), bound_values);
+  EXPECT_TRUE(sql.contains(QLatin1String(":term_2")));
+  EXPECT_EQ(7, bound_values.value(QStringLiteral(":term")).toInt());
+  EXPECT_EQ(14, bound_values.value(QStringLiteral(":term_2")).toInt());
+
+}
+
+class SmartPlaylistSearchTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    database_ = make_shared<MemoryDatabase>(nullptr);
+    backend_ = make_unique<CollectionBackend>();
+    backend_->Init(database_, nullptr, Song::Source::Collection, QLatin1String(SCollection::kSongsTable), QLatin1String(SCollection::kDirsTable), QLatin1String(SCollection::kSubdirsTable));
+  }
+
+  // Inserts songs directly, so many songs can be added quickly.
+  void AddSongs(const int count) {
+
+    QSqlDatabase db(database_->Connect());
+    db.transaction();
+    QSqlQuery q(db);
+    q.prepare(QStringLiteral("INSERT INTO %1 (title, artist, url, directory_id, mtime, ctime, filesize, playcount, skipcount, lastplayed, rating) VALUES (:title, :artist, :url, 1, 1, :ctime, 1, :playcount, :skipcount, :lastplayed, :rating)").arg(QLatin1String(SCollection::kSongsTable)));
+    for (int i = 0; i < count; ++i) {
+      q.bindValue(QStringLiteral(":title"), QStringLiteral("Title %1").arg(i));
+      // Leave some artists and ratings empty to check NULL values are paged correctly.
+      q.bindValue(QStringLiteral(":artist"), i % 7 == 0 ? QVariant() : QVariant(QStringLiteral("Artist %1").arg(i % 13)));
+      q.bindValue(QStringLiteral(":url"), QStringLiteral("file:///music/%1.flac").arg(i));
+      q.bindValue(QStringLiteral(":ctime"), 1000 + (i % 1000));
+      q.bindValue(QStringLiteral(":playcount"), i % 11);
+      q.bindValue(QStringLiteral(":skipcount"), i % 5);
+      q.bindValue(QStringLiteral(":lastplayed"), i % 3 == 0 ? -1 : 1000 + (i % 997));
+      q.bindValue(QStringLiteral(":rating"), i % 17 == 0 ? QVariant() : QVariant(static_cast<double>(i % 11) / 10.0));
+      ASSERT_TRUE(q.exec());
+    }
+    db.commit();
+
+  }
+
+  // Reads all songs for the search, count songs at a time.
+  QList<int> PageIds(SmartPlaylistSearch search, const int count) {
+
+    QList<int> ids;
+    search.limit_ = count;
+    forever {
+      QVariant last_sort_value;
+      const SongList songs = backend_->SmartPlaylistsFindSongs(search, &last_sort_value);
+      if (songs.isEmpty()) break;
+      for (const Song &song : songs) {
+        ids << song.id();
+      }
+      search.after_value_ = last_sort_value;
+      search.after_id_ = songs.last().id();
+    }
+
+    return ids;
+
+  }
+
+  QList<int> AllIds(SmartPlaylistSearch search) {
+
+    QList<int> ids;
+    search.limit_ = -1;
+    const SongList songs = backend_->SmartPlaylistsFindSongs(search);
+    for (const Song &song : songs) {
+      ids << song.id();
+    }
+
+    return ids;
+
+  }
+
+  SharedPtr<Database> database_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+  ScopedPtr<CollectionBackend> backend_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+};
+
+TEST_F(SmartPlaylistSearchTest, SeeksToNextPage) {
+
+  AddSongs(100);
+  if (HasFatalFailure()) return;
+
+  const QList<SmartPlaylistSearchTerm::Field> fields = QList<SmartPlaylistSearchTerm::Field>() << SmartPlaylistSearchTerm::Field::PlayCount << SmartPlaylistSearchTerm::Field::Rating << SmartPlaylistSearchTerm::Field::Artist;
+  for (const SmartPlaylistSearchTerm::Field field : fields) {
+    for (const SmartPlaylistSearch::SortType sort_type : {SmartPlaylistSearch::SortType::FieldAsc, SmartPlaylistSearch::SortType::FieldDesc}) {
+      const SmartPlaylistSearch search(SmartPlaylistSearch::SearchType::All, SmartPlaylistSearch::TermList(), sort_type, field);
+      const QList<int> all_ids = AllIds(search);
+      ASSERT_EQ(100, all_ids.count());
+      EXPECT_EQ(all_ids, PageIds(search, 7));
+    }
+  }
+
+}
+
+TEST_F(SmartPlaylistSearchTest, SeeksWithTerms) {
+
+  AddSongs(100);
+  if (HasFatalFailure()) return;
+
+  const SmartPlaylistSearch search(SmartPlaylistSearch::SearchType::And, SmartPlaylistSearch::TermList() << SmartPlaylistSearchTerm(SmartPlaylistSearchTerm::Field::Title, SmartPlaylistSearchTerm::Operator::StartsWith, QStringLiteral("Title 1")), SmartPlaylistSearch::SortType::FieldDesc, SmartPlaylistSearchTerm::Field::PlayCount);
+
+  const QList<int> all_ids = AllIds(search);
+  EXPECT_EQ(11, all_ids.count());
+  EXPECT_EQ(all_ids, PageIds(search, 3));
+
+}
+
+TEST_F(SmartPlaylistSearchTest, ExcludesIds) {
+
+  AddSongs(20);
+  if (HasFatalFailure()) return;
+
+  SmartPlaylistSearch search(SmartPlaylistSearch::SearchType::All, SmartPlaylistSearch::TermList(), SmartPlaylistSearch::SortType::FieldAsc, SmartPlaylistSearchTerm::Field::PlayCount);
+  const QList<int> all_ids = AllIds(search);
+  ASSERT_EQ(20, all_ids.count());
+
+  search.id_not_in_ = all_ids.mid(0, 5);
+  const QList<int> expected_ids = all_ids.mid(5);
+  EXPECT_EQ(expected_ids, AllIds(search));
+  EXPECT_EQ(expected_ids, PageIds(search, 4));
+
+}
+
+TEST_F(SmartPlaylistSearchTest, KeepsCacheOnStatisticsChange) {
+
+  AddSongs(20);
+  if (HasFatalFailure()) return;
+
+  const SmartPlaylistSearch title_search(SmartPlaylistSearch::SearchType::And, SmartPlaylistSearch::TermList() << SmartPlaylistSearchTerm(SmartPlaylistSearchTerm::Field::Title, SmartPlaylistSearchTerm::Operator::StartsWith, QStringLiteral("Title")), SmartPlaylistSearch::SortType::Random, SmartPlaylistSearchTerm::Field::Title);
+  const SmartPlaylistSearch playcount_search(SmartPlaylistSearch::SearchType::And, SmartPlaylistSearch::TermList() << SmartPlaylistSearchTerm(SmartPlaylistSearchTerm::Field::PlayCount, SmartPlaylistSearchTerm::Operator::GreaterThan, -1), SmartPlaylistSearch::SortType::Random, SmartPlaylistSearchTerm::Field::Title);
+  EXPECT_EQ(20, backend_->SmartPlaylistsFindSongIds(title_search).count());
+  EXPECT_EQ(20, backend_->SmartPlaylistsFindSongIds(playcount_search).count());
+
+  // Songs added behind the back of the backend are only seen by the searches cleared on a statistics change.
+  AddSongs(5);
+  if (HasFatalFailure()) return;
+  emit backend_->SongsStatisticsChanged(SongList());
+
+  EXPECT_EQ(20, backend_->SmartPlaylistsFindSongIds(title_search).count());
+  EXPECT_EQ(25, backend_->SmartPlaylistsFindSongIds(playcount_search).count());
+
+}
+
+TEST_F(SmartPlaylistSearchTest, DoesNotCacheTimeRelativeSearch) {
+
+  AddSongs(10);
+  if (HasFatalFailure()) return;
+
+  QSqlDatabase db(database_->Connect());
+  QSqlQuery q(db);
+  q.prepare(QStringLiteral("UPDATE %1 SET ctime = :ctime").arg(QLatin1String(SCollection::kSongsTable)));
+  q.bindValue(QStringLiteral(":ctime"), QDateTime::currentSecsSinceEpoch() - 60);
+  ASSERT_TRUE(q.exec());
+
+  // Added in the last hour.
+  const SmartPlaylistSearch search(SmartPlaylistSearch::SearchType::And, SmartPlaylistSearch::TermList() << SmartPlaylistSearchTerm(SmartPlaylistSearchTerm::Field::DateCreated, SmartPlaylistSearchTerm::Operator::NumericDate, 1), SmartPlaylistSearch::SortType::Random, SmartPlaylistSearchTerm::Field::Title);
+  EXPECT_EQ(10, backend_->SmartPlaylistsFindSongIds(search).count());
+
+  // Age the songs without the backend noticing, like time passing does.
+  q.bindValue(QStringLiteral(":ctime"), QDateTime::currentSecsSinceEpoch() - 7200);
+  ASSERT_TRUE(q.exec());
+
+  EXPECT_EQ(0, backend_->SmartPlaylistsFindSongIds(search).count());
+
+}
+
+// Run with --gtest_also_run_disabled_tests, this takes a while.
+TEST_F(SmartPlaylistSearchTest, DISABLED_Benchmark) {
+
+  AddSongs(500000);
+  if (HasFatalFailure()) return;
+
+  const QList<SmartPlaylistSearchTerm::Field> fields = QList<SmartPlaylistSearchTerm::Field>()
+    << SmartPlaylistSearchTerm::Field::PlayCount
+    << SmartPlaylistSearchTerm::Field::SkipCount
+    << SmartPlaylistSearchTerm::Field::LastPlayed
+    << SmartPlaylistSearchTerm::Field::Rating
+    << SmartPlaylistSearchTerm::Field::DateCreated
+    << SmartPlaylistSearchTerm::Field::Artist;
+
+  for (const SmartPlaylistSearchTerm::Field field : fields) {
+    SmartPlaylistSearch search(SmartPlaylistSearch::SearchType::All, SmartPlaylistSearch::TermList(), SmartPlaylistSearch::SortType::FieldDesc, field, 50);
+
+    // Page 1000 pages in.
+    QVariant last_sort_value;
+    SongList songs;
+    for (int page = 0; page < 1000; ++page) {
+      songs = backend_->SmartPlaylistsFindSongs(search, &last_sort_value);
+      ASSERT_FALSE(songs.isEmpty());
+      search.after_value_ = last_sort_value;
+      search.after_id_ = songs.last().id();
+    }
+
+    const QStringList plan = backend_->SmartPlaylistsQueryPlan(search);
+    qDebug() << SmartPlaylistSearchTerm::FieldColumnName(field) << plan;
+    for (const QString &detail : plan) {
+      EXPECT_FALSE(detail.contains(QLatin1String("USE TEMP B-TREE FOR ORDER BY"))) << detail.toStdString();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    songs = backend_->SmartPlaylistsFindSongs(search, &last_sort_value);
+    const qint64 seek_msec = timer.elapsed();
+
+    SmartPlaylistSearch first_page_search = search;
+    first_page_search.after_value_ = QVariant();
+    first_page_search.after_id_ = -1;
+    timer.restart();
+    backend_->SmartPlaylistsFindSongs(first_page_search);
+    const qint64 first_page_msec = timer.elapsed();
+
+    qDebug() << SmartPlaylistSearchTerm::FieldColumnName(field) << "first page" << first_page_msec << "ms, page 1001" << seek_msec << "ms";
+  }
+
+}
+
+}  // namespace
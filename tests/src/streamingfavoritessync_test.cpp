@@ -0,0 +1,155 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include "streaming/streamingfavoritessync.h"
+
+namespace {
+
+QDateTime Added(const int day) {
+  return QDateTime(QDate(2024, 1, day), QTime(12, 0), Qt::UTC);
+}
+
+StreamingFavoritesSync::Cursor MakeCursor(const int day, const QStringList &added_ids, const int total) {
+
+  StreamingFavoritesSync::Cursor cursor;
+  cursor.added = Added(day);
+  cursor.added_ids = added_ids;
+  cursor.total = total;
+  return cursor;
+
+}
+
+TEST(StreamingFavoritesSyncTest, FullSyncWithoutCursor) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Songs);
+  sync.Begin();
+
+  EXPECT_FALSE(sync.incremental());
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("1"), Added(1)));
+  EXPECT_EQ(StreamingFavoritesSync::Paging::Continue, sync.PageReceived(2));
+
+  const StreamingFavoritesSync::Cursor cursor = sync.Finish(true);
+  EXPECT_EQ(StreamingFavoritesSync::Mode::Full, sync.mode());
+  EXPECT_TRUE(cursor.is_valid());
+  EXPECT_EQ(Added(2), cursor.added);
+  EXPECT_EQ(QStringList() << QStringLiteral("2"), cursor.added_ids);
+  EXPECT_EQ(2, cursor.total);
+
+}
+
+TEST(StreamingFavoritesSyncTest, StopsAtCursor) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Albums);
+  sync.Begin(MakeCursor(2, QStringList() << QStringLiteral("2"), 2));
+
+  EXPECT_TRUE(sync.incremental());
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("3"), Added(3)));
+  EXPECT_FALSE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+  EXPECT_FALSE(sync.FavoriteReceived(QStringLiteral("1"), Added(1)));
+  EXPECT_EQ(StreamingFavoritesSync::Paging::Stop, sync.PageReceived(3));
+
+  const StreamingFavoritesSync::Cursor cursor = sync.Finish(true);
+  EXPECT_EQ(StreamingFavoritesSync::Mode::Incremental, sync.mode());
+  EXPECT_EQ(1, sync.new_favorites());
+  EXPECT_EQ(Added(3), cursor.added);
+  EXPECT_EQ(3, cursor.total);
+
+}
+
+TEST(StreamingFavoritesSyncTest, NewFavoriteAddedAtCursorTime) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Songs);
+  sync.Begin(MakeCursor(2, QStringList() << QStringLiteral("2"), 1));
+
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("3"), Added(2)));
+  EXPECT_FALSE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+  EXPECT_EQ(StreamingFavoritesSync::Paging::Stop, sync.PageReceived(2));
+
+  const StreamingFavoritesSync::Cursor cursor = sync.Finish(true);
+  EXPECT_EQ(2, cursor.added_ids.count());
+
+}
+
+TEST(StreamingFavoritesSyncTest, PrunesWhenFavoritesWereRemoved) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Songs);
+  sync.Begin(MakeCursor(2, QStringList() << QStringLiteral("2"), 3));
+
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("4"), Added(4)));
+  EXPECT_FALSE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+  EXPECT_EQ(StreamingFavoritesSync::Paging::Continue, sync.PageReceived(2));
+  EXPECT_TRUE(sync.prune());
+
+  sync.Finish(true);
+  EXPECT_TRUE(sync.prune());
+  EXPECT_EQ(QStringList() << QStringLiteral("4") << QStringLiteral("2"), sync.favorite_ids());
+
+}
+
+TEST(StreamingFavoritesSyncTest, RestartsArtistsWhenFavoritesWereRemoved) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Artists);
+  sync.Begin(MakeCursor(2, QStringList() << QStringLiteral("2"), 3));
+
+  EXPECT_FALSE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+  EXPECT_EQ(StreamingFavoritesSync::Paging::Restart, sync.PageReceived(2));
+  EXPECT_FALSE(sync.incremental());
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+
+}
+
+TEST(StreamingFavoritesSyncTest, FailedPruneKeepsCursor) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Albums);
+  const StreamingFavoritesSync::Cursor old_cursor = MakeCursor(2, QStringList() << QStringLiteral("2"), 3);
+  sync.Begin(old_cursor);
+
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("4"), Added(4)));
+  EXPECT_FALSE(sync.FavoriteReceived(QStringLiteral("2"), Added(2)));
+  sync.PageReceived(2);
+
+  const StreamingFavoritesSync::Cursor cursor = sync.Finish(false);
+  EXPECT_FALSE(sync.prune());
+  EXPECT_EQ(old_cursor.added, cursor.added);
+  EXPECT_EQ(old_cursor.total, cursor.total);
+
+}
+
+TEST(StreamingFavoritesSyncTest, UndatedFavoritesAreReceivedInFull) {
+
+  StreamingFavoritesSync sync(StreamingFavoritesSync::Type::Songs);
+  sync.Begin(MakeCursor(2, QStringList() << QStringLiteral("2"), 1));
+
+  EXPECT_TRUE(sync.FavoriteReceived(QStringLiteral("2"), QDateTime()));
+  EXPECT_EQ(StreamingFavoritesSync::Paging::Continue, sync.PageReceived(1));
+
+  const StreamingFavoritesSync::Cursor cursor = sync.Finish(true);
+  EXPECT_EQ(StreamingFavoritesSync::Mode::Full, sync.mode());
+  EXPECT_FALSE(cursor.is_valid());
+
+}
+
+}  // namespace
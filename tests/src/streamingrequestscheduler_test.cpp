@@ -0,0 +1,135 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QNetworkRequest>
+#include <QTest>
+
+#include "mock_networkaccessmanager.h"
+
+#include "streaming/streamingrequestscheduler.h"
+
+namespace {
+
+class StreamingRequestSchedulerTest : public ::testing::Test {
+ protected:
+  StreamingRequestSchedulerTest() : scheduler_(QStringLiteral("Test")) {}
+
+  void Finish(const int http_code, const int count = 1) {
+    for (int i = 0; i < count; ++i) {
+      MockNetworkReply reply;
+      reply.setAttribute(QNetworkRequest::HttpStatusCodeAttribute, http_code);
+      scheduler_.RequestStarted(&reply);
+      reply.Done();
+    }
+  }
+
+  StreamingRequestScheduler scheduler_;
+};
+
+TEST_F(StreamingRequestSchedulerTest, LimitsRequestsInFlight) {
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Api, 2);
+
+  MockNetworkReply reply1;
+  MockNetworkReply reply2;
+  EXPECT_TRUE(scheduler_.CanStart(StreamingRequestScheduler::Category::Api));
+  scheduler_.RequestStarted(&reply1);
+  EXPECT_TRUE(scheduler_.CanStart(StreamingRequestScheduler::Category::Api));
+  scheduler_.RequestStarted(&reply2);
+  EXPECT_FALSE(scheduler_.CanStart(StreamingRequestScheduler::Category::Api));
+  EXPECT_TRUE(scheduler_.CanStart(StreamingRequestScheduler::Category::Covers));
+
+  reply1.setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+  reply1.Done();
+  EXPECT_TRUE(scheduler_.CanStart(StreamingRequestScheduler::Category::Api));
+  EXPECT_EQ(1, scheduler_.stats(StreamingRequestScheduler::Category::Api).in_flight);
+
+}
+
+TEST_F(StreamingRequestSchedulerTest, GrowsOnSuccess) {
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Api, 1);
+  Finish(200, 20);
+
+  EXPECT_GT(scheduler_.concurrency(StreamingRequestScheduler::Category::Api), 1);
+  EXPECT_LE(scheduler_.concurrency(StreamingRequestScheduler::Category::Api), StreamingRequestScheduler::kMaxConcurrencyHttp1);
+
+  Finish(200, 200);
+  EXPECT_EQ(StreamingRequestScheduler::kMaxConcurrencyHttp1, scheduler_.concurrency(StreamingRequestScheduler::Category::Api));
+
+}
+
+TEST_F(StreamingRequestSchedulerTest, ClampsInitialConcurrency) {
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Covers, 10);
+  EXPECT_EQ(StreamingRequestScheduler::kMaxConcurrencyHttp1, scheduler_.concurrency(StreamingRequestScheduler::Category::Covers));
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Covers, 0);
+  EXPECT_EQ(1, scheduler_.concurrency(StreamingRequestScheduler::Category::Covers));
+
+}
+
+TEST_F(StreamingRequestSchedulerTest, HalvesOnServerError) {
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Api, 4);
+  Finish(500);
+
+  EXPECT_EQ(2, scheduler_.concurrency(StreamingRequestScheduler::Category::Api));
+  EXPECT_FALSE(scheduler_.paused(StreamingRequestScheduler::Category::Api));
+  EXPECT_EQ(1, scheduler_.stats(StreamingRequestScheduler::Category::Api).errors);
+
+}
+
+TEST_F(StreamingRequestSchedulerTest, PausesWhenRateLimited) {
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Api, 4);
+  Finish(429);
+
+  EXPECT_TRUE(scheduler_.paused(StreamingRequestScheduler::Category::Api));
+  EXPECT_FALSE(scheduler_.CanStart(StreamingRequestScheduler::Category::Api));
+  EXPECT_EQ(2, scheduler_.concurrency(StreamingRequestScheduler::Category::Api));
+  EXPECT_EQ(1, scheduler_.stats(StreamingRequestScheduler::Category::Api).rate_limited);
+
+}
+
+TEST_F(StreamingRequestSchedulerTest, ClientErrorsDontDecrease) {
+
+  scheduler_.set_initial_concurrency(StreamingRequestScheduler::Category::Api, 4);
+  Finish(404);
+
+  EXPECT_EQ(4, scheduler_.concurrency(StreamingRequestScheduler::Category::Api));
+
+}
+
+TEST_F(StreamingRequestSchedulerTest, EmitsRequestsAvailable) {
+
+  int available = 0;
+  QObject::connect(&scheduler_, &StreamingRequestScheduler::RequestsAvailable, &scheduler_, [&available]() { ++available; });
+
+  Finish(200, 3);
+  QTest::qWait(20);
+
+  EXPECT_EQ(1, available);
+
+}
+
+}  // namespace
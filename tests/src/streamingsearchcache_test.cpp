@@ -0,0 +1,102 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QTest>
+
+#include "core/song.h"
+#include "streaming/streamingsearchcache.h"
+
+namespace {
+
+SongMap Songs(const int count) {
+
+  SongMap songs;
+  for (int i = 0; i < count; ++i) {
+    Song song(Song::Source::Tidal);
+    song.set_song_id(QString::number(i));
+    songs.insert(song.song_id(), song);
+  }
+  return songs;
+
+}
+
+TEST(StreamingSearchCacheTest, NormalizesQuery) {
+
+  EXPECT_EQ(StreamingSearchCache::Key(Song::Source::Tidal, 1, QStringLiteral("Daft  Punk ")), StreamingSearchCache::Key(Song::Source::Tidal, 1, QStringLiteral("daft punk")));
+  EXPECT_NE(StreamingSearchCache::Key(Song::Source::Tidal, 1, QStringLiteral("daft punk")), StreamingSearchCache::Key(Song::Source::Tidal, 2, QStringLiteral("daft punk")));
+  EXPECT_NE(StreamingSearchCache::Key(Song::Source::Tidal, 1, QStringLiteral("daft punk")), StreamingSearchCache::Key(Song::Source::Qobuz, 1, QStringLiteral("daft punk")));
+
+}
+
+TEST(StreamingSearchCacheTest, GetReturnsInsertedSongs) {
+
+  StreamingSearchCache cache;
+  cache.Insert(QStringLiteral("a"), Songs(3));
+
+  SongMap songs;
+  EXPECT_TRUE(cache.Get(QStringLiteral("a"), &songs));
+  EXPECT_EQ(3, songs.count());
+  EXPECT_FALSE(cache.Get(QStringLiteral("b"), &songs));
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+
+}
+
+TEST(StreamingSearchCacheTest, DropsLeastRecentlyUsed) {
+
+  StreamingSearchCache cache(10);
+  cache.Insert(QStringLiteral("a"), Songs(4));
+  cache.Insert(QStringLiteral("b"), Songs(4));
+
+  SongMap songs;
+  EXPECT_TRUE(cache.Get(QStringLiteral("a"), &songs));
+  cache.Insert(QStringLiteral("c"), Songs(4));
+
+  EXPECT_TRUE(cache.Contains(QStringLiteral("a")));
+  EXPECT_FALSE(cache.Contains(QStringLiteral("b")));
+  EXPECT_TRUE(cache.Contains(QStringLiteral("c")));
+
+}
+
+TEST(StreamingSearchCacheTest, ExpiresEntries) {
+
+  StreamingSearchCache cache(100, 20);
+  cache.Insert(QStringLiteral("a"), Songs(1));
+  EXPECT_TRUE(cache.Contains(QStringLiteral("a")));
+
+  QTest::qWait(50);
+
+  SongMap songs;
+  EXPECT_FALSE(cache.Get(QStringLiteral("a"), &songs));
+  EXPECT_EQ(0, cache.count());
+
+}
+
+TEST(StreamingSearchCacheTest, IgnoresEmptyResults) {
+
+  StreamingSearchCache cache;
+  cache.Insert(QStringLiteral("a"), SongMap());
+  EXPECT_FALSE(cache.Contains(QStringLiteral("a")));
+
+}
+
+}  // namespace
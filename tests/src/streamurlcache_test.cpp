@@ -0,0 +1,84 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QUrl>
+#include <QDateTime>
+
+#include "core/urlhandler.h"
+#include "streaming/streamurlcache.h"
+
+namespace {
+
+UrlHandler::LoadResult Resolved(const QUrl &media_url, const QUrl &stream_url) {
+  return UrlHandler::LoadResult(media_url, UrlHandler::LoadResult::Type::TrackAvailable, stream_url);
+}
+
+QUrl StreamUrl(const QString &query) {
+  return QUrl(QStringLiteral("https://streaming.example.com/track.flac?") + query);
+}
+
+TEST(StreamURLCacheTest, ParsesExpiry) {
+
+  EXPECT_EQ(QDateTime::fromSecsSinceEpoch(1700000000), StreamURLCache::ExpiryFromUrl(StreamUrl(QStringLiteral("etsp=1700000000&hmac=abc"))));
+  EXPECT_EQ(QDateTime::fromSecsSinceEpoch(1700000000), StreamURLCache::ExpiryFromUrl(StreamUrl(QStringLiteral("Expires=1700000000&Signature=abc"))));
+  EXPECT_EQ(QDateTime::fromSecsSinceEpoch(1700000000), StreamURLCache::ExpiryFromUrl(StreamUrl(QStringLiteral("token=st%3D1699990000~exp%3D1700000000~hmac%3Dabc"))));
+  EXPECT_FALSE(StreamURLCache::ExpiryFromUrl(StreamUrl(QStringLiteral("id=1"))).isValid());
+
+}
+
+TEST(StreamURLCacheTest, TakeRemovesEntry) {
+
+  StreamURLCache cache;
+  const QUrl media_url(QStringLiteral("tidal:track:1"));
+  cache.Insert(Resolved(media_url, StreamUrl(QStringLiteral("id=1"))), 250);
+
+  EXPECT_TRUE(cache.Contains(media_url));
+  EXPECT_EQ(UrlHandler::LoadResult::Type::TrackAvailable, cache.Take(media_url).type_);
+  EXPECT_EQ(UrlHandler::LoadResult::Type::NoMoreTracks, cache.Take(media_url).type_);
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(250, cache.saved_msec());
+
+}
+
+TEST(StreamURLCacheTest, SkipsExpiredUrls) {
+
+  StreamURLCache cache;
+  const QUrl media_url(QStringLiteral("qobuz:track:1"));
+  const qint64 expires = QDateTime::currentSecsSinceEpoch() + StreamURLCache::kExpiryMarginMsec / 1000 - 1;
+  cache.Insert(Resolved(media_url, StreamUrl(QStringLiteral("etsp=%1").arg(expires))), 100);
+
+  EXPECT_FALSE(cache.Contains(media_url));
+
+}
+
+TEST(StreamURLCacheTest, LimitsSize) {
+
+  StreamURLCache cache;
+  for (int i = 0; i < StreamURLCache::kMaxEntries + 4; ++i) {
+    cache.Insert(Resolved(QUrl(QStringLiteral("tidal:track:%1").arg(i)), StreamUrl(QStringLiteral("id=%1").arg(i))), 100);
+  }
+
+  EXPECT_EQ(StreamURLCache::kMaxEntries, cache.count());
+
+}
+
+}  // namespace
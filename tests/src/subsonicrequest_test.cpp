@@ -0,0 +1,133 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QStringList>
+
+#include "core/song.h"
+#include "subsonic/subsonicrequest.h"
+
+namespace {
+
+Song MakeSong(const QString &song_id, const QString &artist, const int disc) {
+
+  Song song(Song::Source::Subsonic);
+  song.set_song_id(song_id);
+  song.set_album_id(QStringLiteral("1"));
+  song.set_album(QStringLiteral("Album"));
+  song.set_artist(artist);
+  song.set_title(QStringLiteral("Title %1").arg(song_id));
+  song.set_disc(disc);
+  song.set_valid(true);
+  return song;
+
+}
+
+TEST(SubsonicRequestTest, DetectAlbumClearsSingleDisc) {
+
+  SongList songs = SongList() << MakeSong(QStringLiteral("1"), QStringLiteral("Artist"), 1) << MakeSong(QStringLiteral("2"), QStringLiteral("Artist"), 1);
+  SubsonicRequest::DetectAlbum(songs);
+  for (const Song &song : songs) {
+    EXPECT_EQ(0, song.disc());
+    EXPECT_FALSE(song.is_compilation());
+  }
+
+}
+
+TEST(SubsonicRequestTest, DetectAlbumKeepsMultiDisc) {
+
+  SongList songs = SongList() << MakeSong(QStringLiteral("1"), QStringLiteral("Artist"), 1) << MakeSong(QStringLiteral("2"), QStringLiteral("Artist"), 2);
+  SubsonicRequest::DetectAlbum(songs);
+  EXPECT_EQ(1, songs[0].disc());
+  EXPECT_EQ(2, songs[1].disc());
+
+}
+
+TEST(SubsonicRequestTest, DetectAlbumMarksCompilation) {
+
+  // Different artists alone don't make a compilation, the same as when the songs are received per album.
+  SongList songs = SongList() << MakeSong(QStringLiteral("1"), QStringLiteral("Artist 1"), 1) << MakeSong(QStringLiteral("2"), QStringLiteral("Artist 2"), 1);
+  SubsonicRequest::DetectAlbum(songs);
+  EXPECT_FALSE(songs[0].is_compilation());
+  EXPECT_FALSE(songs[1].is_compilation());
+
+  songs[1].set_compilation(true);
+  SubsonicRequest::DetectAlbum(songs);
+  EXPECT_TRUE(songs[0].is_compilation());
+  EXPECT_TRUE(songs[1].is_compilation());
+
+}
+
+// Pages through a server with the given songs the way SubsonicRequest does, returns the number of requests.
+int PageSongs(const QStringList &server_songs, const bool ignores_offset, const int songs_expected, QStringList *songs) {
+
+  const int size = 2;
+  int requests = 0;
+  int offset = 0;
+  while (offset >= 0 && requests < 100) {
+    ++requests;
+    const QStringList page = server_songs.mid(ignores_offset ? 0 : offset, size);
+    int songs_added = 0;
+    for (const QString &song_id : page) {
+      if (songs->contains(song_id)) continue;
+      *songs << song_id;
+      ++songs_added;
+    }
+    offset = SubsonicRequest::NextSearchSongsOffset(offset, size, static_cast<int>(page.count()), songs_added, songs_expected);
+  }
+
+  return requests;
+
+}
+
+TEST(SubsonicRequestTest, PagesUntilEmptyPage) {
+
+  const QStringList server_songs = QStringList() << QStringLiteral("1") << QStringLiteral("2") << QStringLiteral("3") << QStringLiteral("4") << QStringLiteral("5");
+  QStringList songs;
+  EXPECT_EQ(4, PageSongs(server_songs, false, 0, &songs));
+  EXPECT_EQ(server_songs, songs);
+
+}
+
+TEST(SubsonicRequestTest, StopsWhenServerRepeatsPage) {
+
+  const QStringList server_songs = QStringList() << QStringLiteral("1") << QStringLiteral("2") << QStringLiteral("3") << QStringLiteral("4") << QStringLiteral("5");
+  QStringList songs;
+  EXPECT_EQ(2, PageSongs(server_songs, true, 0, &songs));
+  EXPECT_EQ(QStringList() << QStringLiteral("1") << QStringLiteral("2"), songs);
+
+}
+
+TEST(SubsonicRequestTest, StopsPastExpectedSongs) {
+
+  QStringList server_songs;
+  for (int i = 0; i < 50; ++i) {
+    server_songs << QString::number(i);
+  }
+
+  // A server that keeps returning songs is stopped one page after the song count of the albums.
+  QStringList songs;
+  EXPECT_EQ(6, PageSongs(server_songs, false, 10, &songs));
+  EXPECT_EQ(12, songs.count());
+
+}
+
+}  // namespace
@@ -0,0 +1,121 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2024, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <QString>
+#include <QSize>
+#include <QColor>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include "core/song.h"
+#include "covermanager/thumbnailstore.h"
+
+namespace {
+
+QImage Thumbnail(const int width, const int height, const QColor &color) {
+
+  QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+  image.fill(color);
+  return image;
+
+}
+
+class ThumbnailStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.isValid());
+    filename_ = temp_dir_.path() + QStringLiteral("/thumbnails.store");
+  }
+
+  QTemporaryDir temp_dir_;
+  QString filename_;
+};
+
+TEST_F(ThumbnailStoreTest, PutAndGet) {
+
+  ThumbnailStore store(filename_, QSize(32, 32), 1024 * 1024);
+  ASSERT_TRUE(store.Open());
+
+  const quint64 key = ThumbnailStore::AlbumKey(Song::Source::Collection, QStringLiteral("Artist"), QStringLiteral("Album"));
+  EXPECT_TRUE(store.Get(key, 1).isNull());
+
+  ASSERT_TRUE(store.Put(key, 1, Thumbnail(32, 24, Qt::red)));
+  const QImage image = store.Get(key, 1);
+  EXPECT_EQ(QSize(32, 24), image.size());
+  EXPECT_EQ(Thumbnail(32, 24, Qt::red), image);
+
+  // A thumbnail for another cover source is not returned.
+  EXPECT_TRUE(store.Get(key, 2).isNull());
+
+  // Larger than the tile size.
+  EXPECT_FALSE(store.Put(key + 1, 1, Thumbnail(64, 64, Qt::red)));
+
+}
+
+TEST_F(ThumbnailStoreTest, ReopenAndInvalidate) {
+
+  const quint64 key1 = ThumbnailStore::AlbumKey(Song::Source::Collection, QStringLiteral("Artist"), QStringLiteral("Album 1"));
+  const quint64 key2 = ThumbnailStore::AlbumKey(Song::Source::Collection, QStringLiteral("Artist"), QStringLiteral("Album 2"));
+
+  {
+    ThumbnailStore store(filename_, QSize(32, 32), 1024 * 1024);
+    ASSERT_TRUE(store.Open());
+    ASSERT_TRUE(store.Put(key1, 1, Thumbnail(32, 32, Qt::red)));
+    ASSERT_TRUE(store.Put(key2, 1, Thumbnail(32, 32, Qt::green)));
+    ASSERT_TRUE(store.Put(key1, 1, Thumbnail(32, 32, Qt::blue)));
+  }
+
+  ThumbnailStore store(filename_, QSize(32, 32), 1024 * 1024);
+  ASSERT_TRUE(store.Open());
+  EXPECT_EQ(2, store.count());
+  EXPECT_EQ(Thumbnail(32, 32, Qt::blue), store.Get(key1, 1));
+  EXPECT_EQ(Thumbnail(32, 32, Qt::green), store.Get(key2, 1));
+
+  ThumbnailStore::InvalidateAlbum(Song::Source::Collection, QStringLiteral("Artist"), QStringLiteral("Album 2"));
+  EXPECT_TRUE(store.Get(key2, 1).isNull());
+  EXPECT_EQ(1, store.count());
+
+  // A store with another tile size discards the file.
+  store.Close();
+  ThumbnailStore store_large(filename_, QSize(64, 64), 1024 * 1024);
+  ASSERT_TRUE(store_large.Open());
+  EXPECT_EQ(0, store_large.count());
+
+}
+
+TEST_F(ThumbnailStoreTest, ReusesTilesWhenFull) {
+
+  // Room for 4 tiles of 8x8.
+  ThumbnailStore store(filename_, QSize(8, 8), 32 + (4 * (32 + (8 * 8 * 4))));
+  ASSERT_TRUE(store.Open());
+
+  for (quint64 key = 1; key <= 6; ++key) {
+    ASSERT_TRUE(store.Put(key, 1, Thumbnail(8, 8, Qt::red)));
+  }
+
+  EXPECT_EQ(4, store.count());
+  EXPECT_TRUE(store.Get(1, 1).isNull());
+  EXPECT_TRUE(store.Get(2, 1).isNull());
+  EXPECT_FALSE(store.Get(6, 1).isNull());
+
+}
+
+}  // namespace
@@ -24,6 +24,8 @@
 #include <QByteArray>
 #include <QString>
 #include <QDateTime>
+#include <QBuffer>
+#include <QImage>
 #include <QtDebug>
 
 #include "test_utils.h"
@@ -34,6 +36,7 @@
 #include "utilities/cryptutils.h"
 #include "utilities/colorutils.h"
 #include "utilities/transliterate.h"
+#include "utilities/imageutils.h"
 #include "core/logging.h"
 
 TEST(UtilitiesTest, PrettyTimeDelta) {
@@ -244,3 +247,25 @@ TEST(UtilitiesTest, ReplaceMessage) {
   ASSERT_EQ(Utilities::ReplaceMessage(QStringLiteral("%title% - %artist%"), song, QLatin1String("")), song.title() + QStringLiteral(" - ") + song.artist());
 
 }
+
+TEST(UtilitiesTest, ReadImageFromData) {
+
+  QImage image(1000, 500, QImage::Format_RGB32);
+  image.fill(Qt::red);
+  QByteArray image_data;
+  QBuffer buffer(&image_data);
+  ASSERT_TRUE(buffer.open(QIODevice::WriteOnly));
+  ASSERT_TRUE(image.save(&buffer, "PNG"));
+  buffer.close();
+
+  ASSERT_EQ(ImageUtils::ReadImageFromData(image_data).size(), QSize(1000, 500));
+
+  // Decoded to twice the size it's scaled to.
+  ASSERT_EQ(ImageUtils::ReadImageFromData(image_data, QSize(100, 100)).size(), QSize(200, 100));
+
+  // Never upscaled.
+  ASSERT_EQ(ImageUtils::ReadImageFromData(image_data, QSize(800, 800)).size(), QSize(1000, 500));
+
+  ASSERT_TRUE(ImageUtils::ReadImageFromData(QByteArray()).isNull());
+
+}